@@ -39,10 +39,16 @@ struct ObjectData
 
 		int geometryID;
 		int materialID;
-		float padding0;
+		int geometryTableOffset;
 		float padding1;
 };
 
+struct GeometryData
+{
+		int geometryID;
+		int materialID;
+};
+
 struct MaterialData
 {
     vec4 color;
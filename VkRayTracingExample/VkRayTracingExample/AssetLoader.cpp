@@ -0,0 +1,185 @@
+#include <chrono>
+
+#include "AssetLoader.h"
+#include "MeshCache.h"
+
+#include <stb_image.h>
+
+DecodedImage::DecodedImage(DecodedImage&& other)
+	: Pixels(other.Pixels)
+	, Width(other.Width)
+	, Height(other.Height)
+{
+	other.Pixels = nullptr;
+}
+
+DecodedImage::~DecodedImage()
+{
+	Release();
+}
+
+DecodedImage& DecodedImage::operator=(DecodedImage&& other)
+{
+	if (this != &other)
+	{
+		Release();
+		Pixels = other.Pixels;
+		Width = other.Width;
+		Height = other.Height;
+		other.Pixels = nullptr;
+	}
+	return *this;
+}
+
+bool DecodedImage::Decode(const char* filePath)
+{
+	Release();
+	int texChannels = 0;
+	Pixels = stbi_load(filePath, &Width, &Height, &texChannels, STBI_rgb_alpha);
+	return Pixels != nullptr;
+}
+
+void DecodedImage::Release()
+{
+	if (Pixels != nullptr)
+	{
+		stbi_image_free(Pixels);
+		Pixels = nullptr;
+	}
+}
+
+void AssetLoader::Destroy()
+{
+	if (m_jobSystem.IsInitialized())
+	{
+		m_jobSystem.Destroy();
+	}
+	ReleasePayloads();
+}
+
+void AssetLoader::RequestMesh(const std::string& filePath)
+{
+	Request(m_meshes, filePath);
+}
+
+void AssetLoader::RequestImage(const std::string& filePath)
+{
+	Request(m_images, filePath);
+}
+
+void AssetLoader::RequestShaderCode(const std::string& filePath)
+{
+	Request(m_shaderCodes, filePath);
+}
+
+void AssetLoader::LoadRequests(uint32_t threadCount)
+{
+	std::chrono::high_resolution_clock::time_point startTime = std::chrono::high_resolution_clock::now();
+
+	if (m_jobSystem.IsInitialized() && threadCount != 0 && threadCount != m_jobSystem.GetThreadCount())
+	{
+		m_jobSystem.Destroy();
+	}
+	if (!m_jobSystem.IsInitialized())
+	{
+		m_jobSystem.Initialize(threadCount);
+	}
+
+	//meshes are queued first, they are the longest jobs and the others fill the gaps around them
+	JobCounter counter;
+	uint32_t meshCount = RunDecodeJobs
+	(
+		m_meshes, counter,
+		[](const std::string& filePath, std::vector<FbxGeometryData>& outGeometries)
+		{
+			//up to date caches are mapped by the upload stage, stale ones are cooked here and the payload is kept only if the write failed
+			if (MeshCache::IsUpToDate(filePath))
+			{
+				return true;
+			}
+			gFbxGeomLoader.LoadConcurrent(filePath, outGeometries);
+			if (MeshCache::Write(filePath, outGeometries))
+			{
+				outGeometries = std::vector<FbxGeometryData>();
+			}
+			return true;
+		}
+	);
+	uint32_t imageCount = RunDecodeJobs
+	(
+		m_images, counter,
+		[](const std::string& filePath, DecodedImage& outImage)
+		{
+			return outImage.Decode(filePath.c_str());
+		}
+	);
+	uint32_t shaderCount = RunDecodeJobs
+	(
+		m_shaderCodes, counter,
+		[](const std::string& filePath, std::vector<char>& outCode)
+		{
+			return ReadBinaryFile(filePath, outCode);
+		}
+	);
+	m_jobSystem.Wait(counter);
+
+	//reporter is not thread safe, failures are reported after the jobs
+	ReportFailures(m_meshes, "Mesh");
+	ReportFailures(m_images, "Image");
+	ReportFailures(m_shaderCodes, "Shader");
+
+	if (meshCount + imageCount + shaderCount > 0)
+	{
+		std::chrono::duration<double, std::milli> elapsed = std::chrono::high_resolution_clock::now() - startTime;
+		char message[256] = {};
+		sprintf_s
+		(
+			message,
+			"Assets decoded : %u meshes, %u images, %u shaders on %u threads in %.3f ms.",
+			meshCount,
+			imageCount,
+			shaderCount,
+			m_jobSystem.GetThreadCount() + 1,
+			elapsed.count()
+		);
+		REPORT(EReportType::REPORT_TYPE_LOG, message);
+	}
+}
+
+bool AssetLoader::TakeMesh(const std::string& filePath, std::vector<FbxGeometryData>& outGeometries)
+{
+	return Take(m_meshes, filePath, outGeometries);
+}
+
+bool AssetLoader::TakeImage(const std::string& filePath, DecodedImage& outImage)
+{
+	return Take(m_images, filePath, outImage);
+}
+
+bool AssetLoader::TakeShaderCode(const std::string& filePath, std::vector<char>& outCode)
+{
+	return Take(m_shaderCodes, filePath, outCode);
+}
+
+void AssetLoader::ReleasePayloads()
+{
+	m_meshes = PayloadList<std::vector<FbxGeometryData>>();
+	m_images = PayloadList<DecodedImage>();
+	m_shaderCodes = PayloadList<std::vector<char>>();
+}
+
+bool AssetLoader::ReadBinaryFile(const std::string& filePath, std::vector<char>& outData)
+{
+	std::ifstream file(filePath, std::ios::binary);
+	if (!file.is_open())
+	{
+		return false;
+	}
+
+	file.seekg(0, std::ios_base::end);
+	uint32_t fileSize = static_cast<uint32_t>(file.tellg());
+	outData.resize(fileSize);
+	file.seekg(0, std::ios_base::beg);
+	file.read(outData.data(), fileSize);
+	return fileSize > 0 && file.good();
+}
@@ -0,0 +1,163 @@
+#pragma once
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "Utils.h"
+#include "JobSystem.h"
+
+//rgba8 pixels of an image file, released when the image is destroyed
+struct DecodedImage
+{
+	DecodedImage() {}
+	DecodedImage(DecodedImage&& other);
+	~DecodedImage();
+
+	DecodedImage& operator=(DecodedImage&& other);
+
+	DecodedImage(const DecodedImage&) = delete;
+	DecodedImage& operator=(const DecodedImage&) = delete;
+
+	//thread safe, false if the file is missing or not an image
+	bool Decode(const char* filePath);
+	void Release();
+
+	uint8_t* Pixels = nullptr;
+	int Width = 0;
+	int Height = 0;
+};
+
+enum class EAssetPayloadState : uint8_t
+{
+	REQUESTED,
+	DECODED,
+	FAILED,
+	TAKEN
+};
+
+//decodes requested meshes, images and spir-v files at once on the job system, one job per file
+//the containers take the decoded payloads when they create the device resources, so only the upload is left serial
+//files which are not requested or failed to decode are read by the containers themselves as before
+//meshes are cooked to their mesh cache by the jobs, the payload of a mesh is empty when its cache can be mapped
+class AssetLoader : public TSingleton<AssetLoader>
+{
+public:
+	AssetLoader(token) {};
+
+public:
+	void Destroy();
+
+	//duplicated and empty paths are ignored
+	void RequestMesh(const std::string& filePath);
+	void RequestImage(const std::string& filePath);
+	void RequestShaderCode(const std::string& filePath);
+	//decodes every pending request and blocks until all of them are completed, the calling thread decodes too
+	//threadCount is the number of workers, 0 keeps the running workers or starts one less than the hardware threads
+	void LoadRequests(uint32_t threadCount = 0);
+
+	//false if the file is not decoded, the payload is moved out and can be taken only once
+	bool TakeMesh(const std::string& filePath, std::vector<FbxGeometryData>& outGeometries);
+	bool TakeImage(const std::string& filePath, DecodedImage& outImage);
+	bool TakeShaderCode(const std::string& filePath, std::vector<char>& outCode);
+	//payloads which are not taken are released and the requests are forgotten
+	void ReleasePayloads();
+
+	static bool ReadBinaryFile(const std::string& filePath, std::vector<char>& outData);
+
+protected:
+	template <typename PayloadType>
+	struct PayloadList
+	{
+		std::unordered_map<std::string, uint32_t> Indices;
+		std::vector<std::string> FilePaths;
+		//sized before the jobs are run, each job writes only its own slot
+		std::vector<PayloadType> Payloads;
+		std::vector<EAssetPayloadState> States;
+	};
+
+	template <typename PayloadType>
+	void Request(PayloadList<PayloadType>& list, const std::string& filePath);
+	//runs one job per pending request of the list, returns the number of jobs
+	template <typename PayloadType, typename DecodeFunctionType>
+	uint32_t RunDecodeJobs(PayloadList<PayloadType>& list, JobCounter& counter, DecodeFunctionType decode);
+	template <typename PayloadType>
+	bool Take(PayloadList<PayloadType>& list, const std::string& filePath, PayloadType& outPayload);
+	template <typename PayloadType>
+	void ReportFailures(PayloadList<PayloadType>& list, const char* assetType);
+
+private:
+	JobSystem m_jobSystem;
+
+	PayloadList<std::vector<FbxGeometryData>> m_meshes;
+	PayloadList<DecodedImage> m_images;
+	PayloadList<std::vector<char>> m_shaderCodes;
+};
+
+#define gAssetLoader AssetLoader::Instance()
+
+template <typename PayloadType>
+void AssetLoader::Request(PayloadList<PayloadType>& list, const std::string& filePath)
+{
+	if (filePath.empty() || list.Indices.find(filePath) != list.Indices.end())
+	{
+		return;
+	}
+	list.Indices.insert(std::make_pair(filePath, static_cast<uint32_t>(list.FilePaths.size())));
+	list.FilePaths.push_back(filePath);
+	list.States.push_back(EAssetPayloadState::REQUESTED);
+}
+
+template <typename PayloadType, typename DecodeFunctionType>
+uint32_t AssetLoader::RunDecodeJobs(PayloadList<PayloadType>& list, JobCounter& counter, DecodeFunctionType decode)
+{
+	list.Payloads.resize(list.FilePaths.size());
+
+	uint32_t jobCount = 0;
+	for (uint32_t i = 0; i < list.FilePaths.size(); i++)
+	{
+		if (list.States[i] != EAssetPayloadState::REQUESTED)
+		{
+			continue;
+		}
+
+		PayloadList<PayloadType>* payloads = &list;
+		m_jobSystem.Run
+		(
+			[payloads, i, decode]()
+			{
+				payloads->States[i] = decode(payloads->FilePaths[i], payloads->Payloads[i]) ? EAssetPayloadState::DECODED : EAssetPayloadState::FAILED;
+			},
+			&counter
+		);
+		jobCount++;
+	}
+	return jobCount;
+}
+
+template <typename PayloadType>
+bool AssetLoader::Take(PayloadList<PayloadType>& list, const std::string& filePath, PayloadType& outPayload)
+{
+	auto iterFind = list.Indices.find(filePath);
+	if (iterFind == list.Indices.end() || list.States[iterFind->second] != EAssetPayloadState::DECODED)
+	{
+		return false;
+	}
+	outPayload = std::move(list.Payloads[iterFind->second]);
+	list.States[iterFind->second] = EAssetPayloadState::TAKEN;
+	return true;
+}
+
+template <typename PayloadType>
+void AssetLoader::ReportFailures(PayloadList<PayloadType>& list, const char* assetType)
+{
+	for (uint32_t i = 0; i < list.FilePaths.size(); i++)
+	{
+		if (list.States[i] == EAssetPayloadState::FAILED)
+		{
+			char message[256] = {};
+			sprintf_s(message, "%s decode failed : %s", assetType, list.FilePaths[i].c_str());
+			REPORT(EReportType::REPORT_TYPE_WARN, message);
+		}
+	}
+}
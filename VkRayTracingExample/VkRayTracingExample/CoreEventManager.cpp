@@ -1,5 +1,29 @@
 #include "CoreEventManager.h"
 
+CoreEventManager::CoreEventManager(token)
+{
+	m_mouseEventQueue.SetMergeFunction
+	(
+		[](MouseEvent& pendingEvent, const MouseEvent& mouseEvent)
+		{
+			pendingEvent.m_keyEvent |= mouseEvent.m_keyEvent;
+			pendingEvent.m_dx += mouseEvent.m_dx;
+			pendingEvent.m_dy += mouseEvent.m_dy;
+			pendingEvent.m_wheelDelta += mouseEvent.m_wheelDelta;
+			pendingEvent.m_posX = mouseEvent.m_posX;
+			pendingEvent.m_posY = mouseEvent.m_posY;
+		}
+	);
+	m_mouseEventQueue.OnEvent.Add
+	(
+		[this](const ECoreEventType& eventType, const MouseEvent& mouseEvent)
+		{
+			MouseEvent mergedEvent = mouseEvent;
+			ExecMouseEvent(&mergedEvent);
+		}
+	);
+}
+
 void CoreEventManager::Destroy()
 {
 	ClearEvents();
@@ -9,50 +33,50 @@ CoreEventHandle CoreEventManager::RegisterEventCallback(ECoreEventType eventType
 {
 	CoreEventHandle eventHandle;
 	eventHandle.m_coreEventType = eventType;
-	eventHandle.m_eventIndex = reinterpret_cast<CoreEventIndex>(eventCommand);
-
-	m_eventMap[static_cast<int>(eventType)].insert(std::make_pair(eventHandle.m_eventIndex, eventCommand));
+	eventHandle.m_eventIndex = PackSlotHandle(m_eventCallbacks[static_cast<int>(eventType)].Insert(eventCommand)) + 1;
 
 	return eventHandle;
 }
 
 void CoreEventManager::UnregisterEventCallback(CoreEventHandle eventHandle)
 {
-	if (m_eventMap[static_cast<int>(eventHandle.m_coreEventType)].find(eventHandle.m_eventIndex) != m_eventMap[static_cast<int>(eventHandle.m_coreEventType)].end())
+	if (eventHandle.m_coreEventType == ECoreEventType::CORE_EVENT_INVALID_EVENT || eventHandle.m_eventIndex == 0)
 	{
-		m_eventMap[static_cast<int>(eventHandle.m_coreEventType)].erase(eventHandle.m_eventIndex);
+		return;
 	}
-	if (m_eventBuffer.find(eventHandle.m_eventIndex) != m_eventBuffer.end())
-	{
-		CoreEventCallbackBase* removeEvent = m_eventBuffer[eventHandle.m_eventIndex];
-		m_eventBuffer.erase(eventHandle.m_eventIndex);
 
-		if (removeEvent != nullptr)
+	TSlotMap<CoreEventCallbackBase*>& eventCallbacks = m_eventCallbacks[static_cast<int>(eventHandle.m_coreEventType)];
+	SlotHandle slotHandle = UnpackSlotHandle(eventHandle.m_eventIndex - 1);
+	CoreEventCallbackBase** removeEvent = eventCallbacks.Find(slotHandle);
+	if (removeEvent != nullptr)
+	{
+		CoreEventCallbackBase* removeEventCallback = *removeEvent;
+		eventCallbacks.SwapRemove(slotHandle);
+		if (removeEventCallback != nullptr)
 		{
-			delete removeEvent;
-			removeEvent = nullptr;
+			delete removeEventCallback;
 		}
 	}
 }
 
 void CoreEventManager::ExecEvent(ECoreEventType eventType)
 {
-	for (auto cur : m_eventMap[static_cast<int>(eventType)])
+	for (CoreEventCallbackBase* cur : m_eventCallbacks[static_cast<int>(eventType)])
 	{
-		if (cur.second != nullptr)
+		if (cur != nullptr)
 		{
-			cur.second->ExecEvent();
+			cur->ExecEvent();
 		}
 	}
 }
 
 void CoreEventManager::ExecMouseEvent(MouseEvent* mouseEvent)
 {
-	for (auto cur : m_eventMap[static_cast<int>(ECoreEventType::CORE_EVNET_MOUSE_EVENT)])
+	for (CoreEventCallbackBase* cur : m_eventCallbacks[static_cast<int>(ECoreEventType::CORE_EVNET_MOUSE_EVENT)])
 	{
-		if (cur.second != nullptr)
+		if (cur != nullptr)
 		{
-			MouseEventCallbackBase* mouseEvnet = dynamic_cast<MouseEventCallbackBase*>(cur.second);
+			MouseEventCallbackBase* mouseEvnet = dynamic_cast<MouseEventCallbackBase*>(cur);
 			if (mouseEvnet != nullptr)
 			{
 				mouseEvnet->ExecEvent(mouseEvent);
@@ -63,11 +87,11 @@ void CoreEventManager::ExecMouseEvent(MouseEvent* mouseEvent)
 
 void CoreEventManager::ExecScreenSizeChangedEvent(ScreenSizeChangedEvent* screenSizeChangedEvent)
 {
-	for (auto cur : m_eventMap[static_cast<int>(ECoreEventType::CORE_EVENT_SCREEN_SIZE_CHANGED_EVENT)])
+	for (CoreEventCallbackBase* cur : m_eventCallbacks[static_cast<int>(ECoreEventType::CORE_EVENT_SCREEN_SIZE_CHANGED_EVENT)])
 	{
-		if (cur.second != nullptr)
+		if (cur != nullptr)
 		{
-			CoreSystemEventCallbackBase* screenSizeChangedEvnet = dynamic_cast<CoreSystemEventCallbackBase*>(cur.second);
+			CoreSystemEventCallbackBase* screenSizeChangedEvnet = dynamic_cast<CoreSystemEventCallbackBase*>(cur);
 			if (screenSizeChangedEvnet != nullptr)
 			{
 				screenSizeChangedEvnet->ExecEvent(screenSizeChangedEvent);
@@ -76,20 +100,31 @@ void CoreEventManager::ExecScreenSizeChangedEvent(ScreenSizeChangedEvent* screen
 	}
 }
 
-void CoreEventManager::ClearEvents()
+void CoreEventManager::PostMouseEvent(MouseEvent* mouseEvent)
 {
-	for (auto cur : m_eventMap)
+	if (mouseEvent != nullptr)
 	{
-		cur.clear();
+		m_mouseEventQueue.Post(ECoreEventType::CORE_EVNET_MOUSE_EVENT, *mouseEvent);
 	}
+}
+
+void CoreEventManager::FlushEvents()
+{
+	m_mouseEventQueue.Flush();
+}
 
-	for (auto cur : m_eventBuffer)
+void CoreEventManager::ClearEvents()
+{
+	m_mouseEventQueue.Clear();
+	for (TSlotMap<CoreEventCallbackBase*>& eventCallbacks : m_eventCallbacks)
 	{
-		if (cur.second != nullptr)
+		for (CoreEventCallbackBase* cur : eventCallbacks)
 		{
-			delete cur.second;
-			cur.second = nullptr;
+			if (cur != nullptr)
+			{
+				delete cur;
+			}
 		}
+		eventCallbacks.Clear();
 	}
-	m_eventBuffer.clear();
 }
\ No newline at end of file
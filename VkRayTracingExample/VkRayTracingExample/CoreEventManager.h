@@ -1,14 +1,16 @@
 #pragma once
 
 #include <vector>
-#include <map>
 
 #include "Singleton.h"
 #include "Events.h"
 #include "Commands.h"
+#include "EventQueue.h"
+#include "SlotMap.h"
 
 typedef unsigned long long CoreEventIndex;
 
+//event index is the packed slot handle of the callback plus one, 0 is never registered
 struct CoreEventHandle
 {
 	ECoreEventType m_coreEventType = ECoreEventType::CORE_EVENT_INVALID_EVENT;
@@ -98,12 +100,13 @@ public:
 class CoreEventManager : public TSingleton<CoreEventManager>
 {
 public:
-	CoreEventManager(token) {};
+	CoreEventManager(token);
 
 public:
 
 	void Destroy();
 
+	//the callback is owned by the manager and deleted when it is unregistered
 	CoreEventHandle RegisterEventCallback(ECoreEventType eventType, CoreEventCallbackBase* eventCommand);
 	void UnregisterEventCallback(CoreEventHandle eventHandle);
 	
@@ -111,15 +114,18 @@ public:
 	void ExecMouseEvent(MouseEvent* mouseEvent);
 	void ExecScreenSizeChangedEvent(ScreenSizeChangedEvent* mouseEvent);
 
+	//mouse messages of a frame are merged into one event, flags are combined and deltas are summed
+	void PostMouseEvent(MouseEvent* mouseEvent);
+	//dispatches the merged events once, called at the start of each frame
+	void FlushEvents();
+
 	void ClearEvents();
 
 	template<typename OwnerClass, typename FuncPtr>
 	CoreEventHandle RegisterMouseEventCallback(OwnerClass* owner, FuncPtr funcPtr)
 	{
 		CoreEventCallbackBase* mouseCallback = new MouseEventCallback<OwnerClass, FuncPtr, MouseEvent*>(owner, funcPtr);
-		CoreEventHandle eventHandle = RegisterEventCallback(ECoreEventType::CORE_EVNET_MOUSE_EVENT, mouseCallback);
-		m_eventBuffer.insert(std::make_pair(eventHandle.m_eventIndex, mouseCallback));
-		return eventHandle;
+		return RegisterEventCallback(ECoreEventType::CORE_EVNET_MOUSE_EVENT, mouseCallback);
 	}
 
 	//ŸԿ  丵    غ
@@ -127,15 +133,14 @@ public:
 	CoreEventHandle RegisterScreenSizeChangedEventCallback(OwnerClass* owner, FuncPtr funcPtr)
 	{
 		CoreEventCallbackBase* screenSizeChangedEventCallback = new ScreenSizeChangedEventCallback<OwnerClass, FuncPtr, CoreSystemEvent*>(owner, funcPtr);		
-		CoreEventHandle eventHandle = RegisterEventCallback(ECoreEventType::CORE_EVENT_SCREEN_SIZE_CHANGED_EVENT, screenSizeChangedEventCallback);
-		m_eventBuffer.insert(std::make_pair(eventHandle.m_eventIndex, screenSizeChangedEventCallback));
-		return eventHandle;
+		return RegisterEventCallback(ECoreEventType::CORE_EVENT_SCREEN_SIZE_CHANGED_EVENT, screenSizeChangedEventCallback);
 	}
 
 private:
 
-	std::map<CoreEventIndex, CoreEventCallbackBase*> m_eventMap[static_cast<unsigned int>(ECoreEventType::CORE_EVENT_END_INDEX)];
-	std::map<CoreEventIndex, CoreEventCallbackBase*> m_eventBuffer;
+	//callbacks of each event type are dispatched from one contiguous array
+	TSlotMap<CoreEventCallbackBase*> m_eventCallbacks[static_cast<unsigned int>(ECoreEventType::CORE_EVENT_END_INDEX)];
+	TEventQueue<ECoreEventType, MouseEvent> m_mouseEventQueue;
 };
 
 #define gCoreEventMgr CoreEventManager::Instance()
\ No newline at end of file
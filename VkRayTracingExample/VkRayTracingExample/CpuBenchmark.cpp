@@ -0,0 +1,658 @@
+#include <algorithm>
+#include <chrono>
+#include <functional>
+#include <random>
+#include <thread>
+
+#include "CpuBenchmark.h"
+#include "CpuBvhTraversal.h"
+#include "Delegate.h"
+#include "AssetLoader.h"
+#include "MeshCache.h"
+#include "SimpleGeometry.h"
+
+//listener captures of growing size, the last one does not fit the inline storage of a delegate
+struct IndexListener
+{
+	uint64_t* Sink;
+	uint32_t Index;
+	void operator()(uint32_t param) const { *Sink += param ^ Index; }
+};
+
+struct TintListener
+{
+	uint64_t* Sink;
+	uint32_t Index;
+	glm::vec4 Tint;
+	void operator()(uint32_t param) const { *Sink += param ^ Index; }
+};
+
+struct TransformListener
+{
+	uint64_t* Sink;
+	uint32_t Index;
+	glm::mat4 Transform;
+	void operator()(uint32_t param) const { *Sink += param ^ Index; }
+};
+
+//Metal1-3, Glass and Paint texture sets, the example mesh and the ray tracing shaders
+static const char* ASSET_BENCHMARK_MESH = "../Resources/Mesh/MeetMat.fbx";
+static const char* ASSET_BENCHMARK_IMAGES[] =
+{
+	"../Resources/Textures/Metal1/metal1_basecolor.png",
+	"../Resources/Textures/Metal1/metal1_normal.png",
+	"../Resources/Textures/Metal1/metal1_roughness.png",
+	"../Resources/Textures/Metal1/metal1_metallic.png",
+	"../Resources/Textures/Metal1/metal1_ao.png",
+	"../Resources/Textures/Metal2/metal2_basecolor.png",
+	"../Resources/Textures/Metal2/metal2_normal.png",
+	"../Resources/Textures/Metal2/metal2_roughness.png",
+	"../Resources/Textures/Metal2/metal2_metallic.png",
+	"../Resources/Textures/Metal2/metal2_ao.png",
+	"../Resources/Textures/Metal3/metal3_basecolor.png",
+	"../Resources/Textures/Metal3/metal3_normal.png",
+	"../Resources/Textures/Metal3/metal3_roughness.png",
+	"../Resources/Textures/Metal3/metal3_metallic.png",
+	"../Resources/Textures/Metal3/metal3_ao.png",
+	"../Resources/Textures/Glass/glass_basecolor.png",
+	"../Resources/Textures/Glass/glass_normal.png",
+	"../Resources/Textures/Glass/glass_roughness.png",
+	"../Resources/Textures/Glass/glass_metallic.png",
+	"../Resources/Textures/Paint/Paint_basecolor.png",
+	"../Resources/Textures/Paint/Paint_normal.png",
+	"../Resources/Textures/Paint/Paint_roughness.png",
+	"../Resources/Textures/Paint/Paint_metallic.png",
+};
+static const char* ASSET_BENCHMARK_SHADERS[] =
+{
+	"../Resources/Shaders/RayGen.spr",
+	"../Resources/Shaders/Miss.spr",
+	"../Resources/Shaders/ShadowMiss.spr",
+	"../Resources/Shaders/Hit.spr",
+	"../Resources/Shaders/Hit_Default.spr",
+	"../Resources/Shaders/Hit_Transparent.spr",
+	"../Resources/Shaders/Hit_Refract.spr",
+};
+
+static uint64_t GetDecodedMeshSize(std::vector<FbxGeometryData>& geometries)
+{
+	uint64_t size = 0;
+	for (FbxGeometryData& geometry : geometries)
+	{
+		size += geometry.m_positions.size() * sizeof(glm::vec3) + geometry.m_indices.size() * sizeof(uint32_t);
+	}
+	return size;
+}
+
+//host side stand in of the mapped staging memory of the vertex and index buffers
+static void CopyToStaging(std::vector<uint8_t>& staging, const void* data, size_t size)
+{
+	if (staging.size() < size)
+	{
+		staging.resize(size);
+	}
+	memcpy(staging.data(), data, size);
+}
+
+//returns add, call and remove time in ms, listeners are removed in random order like instances removed from a scene
+template <typename ListType, typename ListenerType>
+static void MeasureListenerList(ListType& list, uint32_t listenerCount, uint32_t iterationCount, uint64_t& outSink, double* outTimes)
+{
+	std::vector<CommandHandle> handles(listenerCount);
+	std::chrono::high_resolution_clock::time_point startTime = std::chrono::high_resolution_clock::now();
+	for (uint32_t i = 0; i < listenerCount; i++)
+	{
+		ListenerType listener = {};
+		listener.Sink = &outSink;
+		listener.Index = i;
+		handles[i] = list.Add(listener);
+	}
+	std::chrono::duration<double, std::milli> elapsed = std::chrono::high_resolution_clock::now() - startTime;
+	outTimes[0] = elapsed.count();
+
+	startTime = std::chrono::high_resolution_clock::now();
+	for (uint32_t i = 0; i < iterationCount; i++)
+	{
+		list.Exec(i);
+	}
+	elapsed = std::chrono::high_resolution_clock::now() - startTime;
+	outTimes[1] = elapsed.count();
+
+	std::mt19937 randomEngine(5678);
+	std::shuffle(handles.begin(), handles.end(), randomEngine);
+	startTime = std::chrono::high_resolution_clock::now();
+	for (CommandHandle handle : handles)
+	{
+		list.Remove(handle);
+	}
+	elapsed = std::chrono::high_resolution_clock::now() - startTime;
+	outTimes[2] = elapsed.count();
+}
+
+void CpuBenchmark::RunBvhBuild(uint32_t iterationCount)
+{
+	iterationCount = iterationCount > 0 ? iterationCount : 1;
+
+	FbxGeometryData meetMat = {};
+	if (LoadExampleMesh(meetMat))
+	{
+		MeasureBvhBuild("MeetMat", meetMat, iterationCount);
+	}
+
+	FbxGeometryData heightGrid = {};
+	GenerateHeightGrid(708, heightGrid);
+	MeasureBvhBuild("HeightGrid", heightGrid, iterationCount);
+
+	FbxGeometryData triangleSoup = {};
+	GenerateTriangleSoup(1000000, triangleSoup);
+	MeasureBvhBuild("TriangleSoup", triangleSoup, iterationCount);
+}
+
+void CpuBenchmark::RunRayTraversal(uint32_t iterationCount)
+{
+	iterationCount = iterationCount > 0 ? iterationCount : 1;
+
+	char message[256] = {};
+	sprintf_s(message, "Ray traversal benchmark : cpu supports %s.", CpuBvhTraversal::GetSimdLevelName(CpuBvhTraversal::DetectSimdLevel()));
+	REPORT(EReportType::REPORT_TYPE_LOG, message);
+
+	FbxGeometryData meetMat = {};
+	if (LoadExampleMesh(meetMat))
+	{
+		MeasureRayTraversal("MeetMat", meetMat, iterationCount);
+	}
+
+	FbxGeometryData heightGrid = {};
+	GenerateHeightGrid(708, heightGrid);
+	MeasureRayTraversal("HeightGrid", heightGrid, iterationCount);
+}
+
+void CpuBenchmark::RunDelegates(uint32_t iterationCount)
+{
+	iterationCount = iterationCount > 0 ? iterationCount : 1;
+
+	//a few render passes, the meshes of a scene and every instance per mesh of a large scene
+	uint32_t listenerCounts[] = { 16, 1024, 65536 };
+	for (uint32_t listenerCount : listenerCounts)
+	{
+		MeasureDelegates<IndexListener>(listenerCount, iterationCount);
+		MeasureDelegates<TintListener>(listenerCount, iterationCount);
+		MeasureDelegates<TransformListener>(listenerCount, iterationCount);
+	}
+}
+
+template <typename ListenerType>
+void CpuBenchmark::MeasureDelegates(uint32_t listenerCount, uint32_t iterationCount)
+{
+	uint64_t commandListSink = 0;
+	double commandListTimes[3] = {};
+	{
+		LambdaCommandListWithOneParam<std::function<void(uint32_t)>, uint32_t> commandList;
+		MeasureListenerList<decltype(commandList), ListenerType>(commandList, listenerCount, iterationCount, commandListSink, commandListTimes);
+	}
+
+	uint64_t delegateListSink = 0;
+	double delegateListTimes[3] = {};
+	{
+		TDelegateList<void(uint32_t)> delegateList;
+		MeasureListenerList<decltype(delegateList), ListenerType>(delegateList, listenerCount, iterationCount, delegateListSink, delegateListTimes);
+	}
+
+	double callCount = static_cast<double>(listenerCount) * iterationCount;
+	char message[256] = {};
+	sprintf_s
+	(
+		message,
+		"Delegate benchmark [%u byte capture, %u listeners] : std::function add %.1f ns, call %.2f ns, remove %.1f ns, delegate add %.1f ns, call %.2f ns, remove %.1f ns, %s.",
+		static_cast<uint32_t>(sizeof(ListenerType)),
+		listenerCount,
+		commandListTimes[0] * 1000000.0 / listenerCount,
+		commandListTimes[1] * 1000000.0 / callCount,
+		commandListTimes[2] * 1000000.0 / listenerCount,
+		delegateListTimes[0] * 1000000.0 / listenerCount,
+		delegateListTimes[1] * 1000000.0 / callCount,
+		delegateListTimes[2] * 1000000.0 / listenerCount,
+		commandListSink == delegateListSink ? "same results" : "results differ"
+	);
+	REPORT(EReportType::REPORT_TYPE_LOG, message);
+}
+
+void CpuBenchmark::RunAssetLoading(uint32_t iterationCount)
+{
+	iterationCount = iterationCount > 0 ? iterationCount : 1;
+
+	//1 thread decodes on the calling thread without the job system like the loads before the asset loader
+	uint64_t serialBytes = 0;
+	double serialTime = MeasureAssetLoading(1, iterationCount, serialBytes);
+	if (serialBytes == 0)
+	{
+		REPORT(EReportType::REPORT_TYPE_WARN, "Benchmark assets are not found, asset loading benchmark is skipped.");
+		return;
+	}
+
+	char message[256] = {};
+	sprintf_s
+	(
+		message,
+		"Asset loading benchmark [1 thread] : 1 mesh, %u images, %u shaders, %.1f MB decoded in %.3f ms.",
+		static_cast<uint32_t>(sizeof(ASSET_BENCHMARK_IMAGES) / sizeof(ASSET_BENCHMARK_IMAGES[0])),
+		static_cast<uint32_t>(sizeof(ASSET_BENCHMARK_SHADERS) / sizeof(ASSET_BENCHMARK_SHADERS[0])),
+		serialBytes / (1024.0 * 1024.0),
+		serialTime
+	);
+	REPORT(EReportType::REPORT_TYPE_LOG, message);
+
+	uint32_t hardwareThreadCount = std::max(std::thread::hardware_concurrency(), 2u);
+	for (uint32_t threadCount = 2; ; threadCount = std::min(threadCount * 2, hardwareThreadCount))
+	{
+		uint64_t parallelBytes = 0;
+		double parallelTime = MeasureAssetLoading(threadCount, iterationCount, parallelBytes);
+		sprintf_s
+		(
+			message,
+			"Asset loading benchmark [%u threads] : %.3f ms, %.2fx faster than 1 thread, %s.",
+			threadCount,
+			parallelTime,
+			serialTime / parallelTime,
+			parallelBytes == serialBytes ? "same payloads" : "payloads differ"
+		);
+		REPORT(EReportType::REPORT_TYPE_LOG, message);
+		if (threadCount == hardwareThreadCount)
+		{
+			break;
+		}
+	}
+	gAssetLoader.Destroy();
+}
+
+double CpuBenchmark::MeasureAssetLoading(uint32_t threadCount, uint32_t iterationCount, uint64_t& outBytes)
+{
+	std::chrono::high_resolution_clock::time_point startTime = std::chrono::high_resolution_clock::now();
+	for (uint32_t iteration = 0; iteration < iterationCount; iteration++)
+	{
+		outBytes = 0;
+		std::vector<FbxGeometryData> geometries;
+		if (threadCount > 1)
+		{
+			//calling thread decodes too, so the job system runs one worker less
+			gAssetLoader.RequestMesh(ASSET_BENCHMARK_MESH);
+			for (const char* imagePath : ASSET_BENCHMARK_IMAGES)
+			{
+				gAssetLoader.RequestImage(imagePath);
+			}
+			for (const char* shaderPath : ASSET_BENCHMARK_SHADERS)
+			{
+				gAssetLoader.RequestShaderCode(shaderPath);
+			}
+			gAssetLoader.LoadRequests(threadCount - 1);
+			gAssetLoader.TakeMesh(ASSET_BENCHMARK_MESH, geometries);
+		}
+
+		//the mesh is mapped from its cache once it is cooked, as the geometry load does
+		MeshCache meshCache;
+		if (meshCache.Open(ASSET_BENCHMARK_MESH))
+		{
+			for (uint32_t i = 0; i < meshCache.GetMeshCount(); i++)
+			{
+				outBytes += meshCache.GetMesh(i).VertexCount * sizeof(glm::vec3) + meshCache.GetMesh(i).IndexCount * sizeof(uint32_t);
+			}
+		}
+		else
+		{
+			if (geometries.empty())
+			{
+				gFbxGeomLoader.Load(ASSET_BENCHMARK_MESH, geometries);
+				MeshCache::Write(ASSET_BENCHMARK_MESH, geometries);
+			}
+			outBytes += GetDecodedMeshSize(geometries);
+		}
+
+		//payloads which were not decoded by the job system are decoded here, as the containers do
+		for (const char* imagePath : ASSET_BENCHMARK_IMAGES)
+		{
+			DecodedImage image;
+			if (!gAssetLoader.TakeImage(imagePath, image))
+			{
+				image.Decode(imagePath);
+			}
+			outBytes += image.Pixels != nullptr ? static_cast<uint64_t>(image.Width) * image.Height * 4 : 0;
+		}
+		for (const char* shaderPath : ASSET_BENCHMARK_SHADERS)
+		{
+			std::vector<char> code;
+			if (gAssetLoader.TakeShaderCode(shaderPath, code) || AssetLoader::ReadBinaryFile(shaderPath, code))
+			{
+				outBytes += code.size();
+			}
+		}
+		gAssetLoader.ReleasePayloads();
+	}
+	std::chrono::duration<double, std::milli> elapsed = std::chrono::high_resolution_clock::now() - startTime;
+	return elapsed.count() / iterationCount;
+}
+
+void CpuBenchmark::RunMeshCache(uint32_t iterationCount)
+{
+	iterationCount = iterationCount > 0 ? iterationCount : 1;
+
+	MeasureMeshCache("../Resources/Mesh/MeetMat.fbx", iterationCount);
+	MeasureMeshCache("../Resources/Mesh/Plane.fbx", iterationCount);
+}
+
+void CpuBenchmark::MeasureMeshCache(const char* sourceFilePath, uint32_t iterationCount)
+{
+	//fbx path of the geometry load, vertices are converted, hashed and copied to the host copies and the staging memory
+	std::vector<uint8_t> staging;
+	std::vector<FbxGeometryData> geometries;
+	uint64_t fbxHash = 0;
+	std::chrono::high_resolution_clock::time_point startTime = std::chrono::high_resolution_clock::now();
+	for (uint32_t iteration = 0; iteration < iterationCount; iteration++)
+	{
+		geometries.clear();
+		fbxHash = 0;
+		gFbxGeomLoader.Load(sourceFilePath, geometries);
+		for (FbxGeometryData& geometry : geometries)
+		{
+			std::vector<DefaultVertex> verts;
+			glm::vec3 boundsMin = glm::vec3(0.0f);
+			glm::vec3 boundsMax = glm::vec3(0.0f);
+			SimpleMeshData::BuildVertices(geometry, verts, boundsMin, boundsMax);
+			fbxHash ^= SimpleMeshData::ComputeContentHash(geometry.m_positions.data(), static_cast<uint32_t>(geometry.m_positions.size()), geometry.m_indices.data(), static_cast<uint32_t>(geometry.m_indices.size()));
+
+			std::vector<glm::vec3> hostPositions(geometry.m_positions);
+			std::vector<uint32_t> hostIndices(geometry.m_indices);
+			std::vector<DefaultVertex> hostVertices(verts);
+			CopyToStaging(staging, verts.data(), verts.size() * sizeof(DefaultVertex));
+			CopyToStaging(staging, geometry.m_indices.data(), geometry.m_indices.size() * sizeof(uint32_t));
+		}
+	}
+	std::chrono::duration<double, std::milli> fbxTime = std::chrono::high_resolution_clock::now() - startTime;
+	if (geometries.empty())
+	{
+		REPORT(EReportType::REPORT_TYPE_WARN, "Benchmark mesh is not loaded, mesh cache benchmark is skipped.");
+		return;
+	}
+
+	//cooked once, like the first load of the source
+	startTime = std::chrono::high_resolution_clock::now();
+	bool isCached = MeshCache::Write(sourceFilePath, geometries);
+	std::chrono::duration<double, std::milli> cookTime = std::chrono::high_resolution_clock::now() - startTime;
+
+	uint64_t cacheHash = 0;
+	startTime = std::chrono::high_resolution_clock::now();
+	for (uint32_t iteration = 0; iteration < iterationCount && isCached; iteration++)
+	{
+		cacheHash = 0;
+		MeshCache meshCache;
+		isCached = meshCache.Open(sourceFilePath);
+		for (uint32_t i = 0; i < meshCache.GetMeshCount(); i++)
+		{
+			const MeshCacheFileMesh& mesh = meshCache.GetMesh(i);
+			cacheHash ^= mesh.ContentHash;
+
+			//host copies are made on demand from the mapping, the load copies only to the staging memory
+			CopyToStaging(staging, meshCache.GetVertices(i), mesh.VertexCount * sizeof(DefaultVertex));
+			CopyToStaging(staging, meshCache.GetIndices(i), mesh.IndexCount * sizeof(uint32_t));
+		}
+	}
+	std::chrono::duration<double, std::milli> cacheTime = std::chrono::high_resolution_clock::now() - startTime;
+	if (!isCached)
+	{
+		REPORT(EReportType::REPORT_TYPE_WARN, "Mesh cache is not written or not valid, mesh cache benchmark is skipped.");
+		return;
+	}
+
+	char message[256] = {};
+	sprintf_s
+	(
+		message,
+		"Mesh cache benchmark [%s] : fbx load %.3f ms, cook %.3f ms, cached load %.3f ms, %.1fx faster, %s.",
+		sourceFilePath,
+		fbxTime.count() / iterationCount,
+		cookTime.count(),
+		cacheTime.count() / iterationCount,
+		fbxTime.count() / cacheTime.count(),
+		fbxHash == cacheHash ? "same content hash" : "content hash differs"
+	);
+	REPORT(EReportType::REPORT_TYPE_LOG, message);
+}
+
+bool CpuBenchmark::LoadExampleMesh(FbxGeometryData& outGeometry)
+{
+	std::vector<FbxGeometryData> geometries;
+	gFbxGeomLoader.Load("../Resources/Mesh/MeetMat.fbx", geometries);
+	for (FbxGeometryData& geometry : geometries)
+	{
+		uint32_t baseVertex = static_cast<uint32_t>(outGeometry.m_positions.size());
+		outGeometry.m_positions.insert(outGeometry.m_positions.end(), geometry.m_positions.begin(), geometry.m_positions.end());
+		for (uint32_t index : geometry.m_indices)
+		{
+			outGeometry.m_indices.push_back(baseVertex + index);
+		}
+	}
+	if (outGeometry.m_indices.empty())
+	{
+		REPORT(EReportType::REPORT_TYPE_WARN, "MeetMat.fbx is not loaded, benchmark runs on synthetic meshes only.");
+		return false;
+	}
+	return true;
+}
+
+void CpuBenchmark::GenerateHeightGrid(uint32_t gridSize, FbxGeometryData& outGeometry)
+{
+	std::mt19937 randomEngine(1234);
+	std::uniform_real_distribution<float> noise(-0.5f, 0.5f);
+
+	uint32_t vertexCountPerLine = gridSize + 1;
+	outGeometry.m_positions.resize(vertexCountPerLine * vertexCountPerLine);
+	for (uint32_t z = 0; z < vertexCountPerLine; z++)
+	{
+		for (uint32_t x = 0; x < vertexCountPerLine; x++)
+		{
+			float height = 8.0f * sinf(x * 0.05f) * cosf(z * 0.07f) + noise(randomEngine);
+			outGeometry.m_positions[z * vertexCountPerLine + x] = glm::vec3(static_cast<float>(x), height, static_cast<float>(z));
+		}
+	}
+
+	//two triangles per cell, gridSize 708 gives about a million triangles
+	outGeometry.m_indices.reserve(gridSize * gridSize * 6);
+	for (uint32_t z = 0; z < gridSize; z++)
+	{
+		for (uint32_t x = 0; x < gridSize; x++)
+		{
+			uint32_t i0 = z * vertexCountPerLine + x;
+			uint32_t i1 = i0 + 1;
+			uint32_t i2 = i0 + vertexCountPerLine;
+			uint32_t i3 = i2 + 1;
+			outGeometry.m_indices.push_back(i0);
+			outGeometry.m_indices.push_back(i2);
+			outGeometry.m_indices.push_back(i1);
+			outGeometry.m_indices.push_back(i1);
+			outGeometry.m_indices.push_back(i2);
+			outGeometry.m_indices.push_back(i3);
+		}
+	}
+}
+
+void CpuBenchmark::GenerateTriangleSoup(uint32_t triangleCount, FbxGeometryData& outGeometry)
+{
+	std::mt19937 randomEngine(5678);
+	std::uniform_real_distribution<float> center(-100.0f, 100.0f);
+	std::uniform_real_distribution<float> offset(-1.0f, 1.0f);
+
+	outGeometry.m_positions.resize(triangleCount * 3);
+	outGeometry.m_indices.resize(triangleCount * 3);
+	for (uint32_t i = 0; i < triangleCount; i++)
+	{
+		glm::vec3 triangleCenter = glm::vec3(center(randomEngine), center(randomEngine), center(randomEngine));
+		for (uint32_t j = 0; j < 3; j++)
+		{
+			outGeometry.m_positions[i * 3 + j] = triangleCenter + glm::vec3(offset(randomEngine), offset(randomEngine), offset(randomEngine));
+			outGeometry.m_indices[i * 3 + j] = i * 3 + j;
+		}
+	}
+}
+
+void CpuBenchmark::MeasureBvhBuild(const char* name, FbxGeometryData& geometry, uint32_t iterationCount)
+{
+	WorkerThreadPool workerPool;
+	workerPool.Initialize();
+
+	CpuBvh bvh;
+	double singleThreadBuildTime = 0.0;
+	double multiThreadBuildTime = 0.0;
+	for (uint32_t i = 0; i < iterationCount; i++)
+	{
+		std::chrono::high_resolution_clock::time_point startTime = std::chrono::high_resolution_clock::now();
+		bvh.Build(geometry);
+		std::chrono::duration<double, std::milli> elapsed = std::chrono::high_resolution_clock::now() - startTime;
+		singleThreadBuildTime += elapsed.count();
+
+		startTime = std::chrono::high_resolution_clock::now();
+		bvh.Build(geometry, &workerPool);
+		elapsed = std::chrono::high_resolution_clock::now() - startTime;
+		multiThreadBuildTime += elapsed.count();
+	}
+	singleThreadBuildTime /= iterationCount;
+	multiThreadBuildTime /= iterationCount;
+
+	char message[256] = {};
+	sprintf_s
+	(
+		message,
+		"Bvh build benchmark [%s] : %u triangles, %u nodes, %u leaves, sah %.3f, 1 thread %.3f ms, %u workers %.3f ms.",
+		name,
+		bvh.GetTriangleCount(),
+		bvh.GetNodeCount(),
+		bvh.GetLeafCount(),
+		bvh.ComputeSahCost(),
+		singleThreadBuildTime,
+		workerPool.GetThreadCount(),
+		multiThreadBuildTime
+	);
+	REPORT(EReportType::REPORT_TYPE_LOG, message);
+
+	workerPool.Destroy();
+}
+
+void CpuBenchmark::MeasureRayTraversal(const char* name, FbxGeometryData& geometry, uint32_t iterationCount)
+{
+	CpuBvh bvh;
+	if (!bvh.Build(geometry))
+	{
+		return;
+	}
+	CpuBvhTraversal traversal;
+	if (!traversal.Initialize(&bvh))
+	{
+		return;
+	}
+
+	glm::vec3 boundsMin = bvh.GetNode(0).BoundsMin;
+	glm::vec3 boundsMax = bvh.GetNode(0).BoundsMax;
+	glm::vec3 boundsCenter = (boundsMin + boundsMax) * 0.5f;
+	float boundsRadius = glm::length(boundsMax - boundsMin) * 0.5f;
+
+	//coherent rays from a pinhole camera facing the mesh
+	const uint32_t imageSize = 512;
+	std::vector<CpuRay> primaryRays(imageSize * imageSize);
+	glm::vec3 cameraPosition = boundsCenter + glm::vec3(0.3f, 0.4f, 1.5f) * boundsRadius;
+	glm::vec3 forward = glm::normalize(boundsCenter - cameraPosition);
+	glm::vec3 right = glm::normalize(glm::cross(forward, glm::vec3(0.0f, 1.0f, 0.0f)));
+	glm::vec3 up = glm::cross(right, forward);
+	for (uint32_t y = 0; y < imageSize; y++)
+	{
+		for (uint32_t x = 0; x < imageSize; x++)
+		{
+			float screenX = (x + 0.5f) / imageSize * 2.0f - 1.0f;
+			float screenY = (y + 0.5f) / imageSize * 2.0f - 1.0f;
+			CpuRay& ray = primaryRays[y * imageSize + x];
+			ray.Origin = cameraPosition;
+			ray.Direction = glm::normalize(forward + (right * screenX + up * screenY) * 0.6f);
+		}
+	}
+
+	//incoherent rays starting inside the bounds, like secondary bounces
+	std::mt19937 randomEngine(4321);
+	std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+	std::vector<CpuRay> randomRays(imageSize * imageSize);
+	for (CpuRay& ray : randomRays)
+	{
+		ray.Origin = boundsMin + (boundsMax - boundsMin) * glm::vec3(unit(randomEngine), unit(randomEngine), unit(randomEngine));
+		float cosTheta = unit(randomEngine) * 2.0f - 1.0f;
+		float sinTheta = sqrtf(1.0f - cosTheta * cosTheta);
+		float phi = unit(randomEngine) * 6.28318530718f;
+		ray.Direction = glm::vec3(sinTheta * cosf(phi), sinTheta * sinf(phi), cosTheta);
+	}
+
+	const char* rayTypeNames[] = { "primary", "random" };
+	std::vector<CpuRay>* rayLists[] = { &primaryRays, &randomRays };
+	for (uint32_t rayType = 0; rayType < 2; rayType++)
+	{
+		std::vector<CpuRay>& rays = *rayLists[rayType];
+		uint32_t rayCount = static_cast<uint32_t>(rays.size());
+		std::vector<CpuRayHit> referenceHits(rayCount);
+		std::vector<CpuRayHit> hits(rayCount);
+		std::vector<uint8_t> occluded(rayCount);
+
+		ECpuSimdLevel simdLevels[] = { ECpuSimdLevel::SCALAR, ECpuSimdLevel::SSE, ECpuSimdLevel::AVX2 };
+		for (ECpuSimdLevel simdLevel : simdLevels)
+		{
+			traversal.SetSimdLevel(simdLevel);
+			if (traversal.GetSimdLevel() != simdLevel)
+			{
+				continue;
+			}
+
+			std::chrono::high_resolution_clock::time_point startTime = std::chrono::high_resolution_clock::now();
+			for (uint32_t i = 0; i < iterationCount; i++)
+			{
+				traversal.Intersect(rays.data(), hits.data(), rayCount);
+			}
+			std::chrono::duration<double, std::milli> closestHitTime = std::chrono::high_resolution_clock::now() - startTime;
+
+			startTime = std::chrono::high_resolution_clock::now();
+			for (uint32_t i = 0; i < iterationCount; i++)
+			{
+				traversal.Occluded(rays.data(), occluded.data(), rayCount);
+			}
+			std::chrono::duration<double, std::milli> anyHitTime = std::chrono::high_resolution_clock::now() - startTime;
+
+			//results of the simd kernels are checked against the scalar kernel
+			uint32_t hitCount = 0;
+			uint32_t mismatchCount = 0;
+			for (uint32_t i = 0; i < rayCount; i++)
+			{
+				if (simdLevel == ECpuSimdLevel::SCALAR)
+				{
+					referenceHits[i] = hits[i];
+				}
+				hitCount += hits[i].IsHit() ? 1 : 0;
+				bool isSameHit = hits[i].IsHit() == referenceHits[i].IsHit() && (!hits[i].IsHit() || fabsf(hits[i].T - referenceHits[i].T) <= 1e-4f * referenceHits[i].T);
+				bool isSameOcclusion = (occluded[i] != 0) == referenceHits[i].IsHit();
+				mismatchCount += (isSameHit && isSameOcclusion) ? 0 : 1;
+			}
+
+			double totalRayCount = static_cast<double>(rayCount) * iterationCount;
+			char message[256] = {};
+			sprintf_s
+			(
+				message,
+				"Ray traversal benchmark [%s, %s, %s] : %u rays, %u hits, closest %.2f Mrays/s, any %.2f Mrays/s, %u mismatches.",
+				name,
+				rayTypeNames[rayType],
+				CpuBvhTraversal::GetSimdLevelName(simdLevel),
+				rayCount,
+				hitCount,
+				totalRayCount / (closestHitTime.count() * 1000.0),
+				totalRayCount / (anyHitTime.count() * 1000.0),
+				mismatchCount
+			);
+			REPORT(EReportType::REPORT_TYPE_LOG, message);
+		}
+	}
+
+	char message[256] = {};
+	sprintf_s(message, "Ray traversal benchmark [%s] : %u wide nodes, %u triangle blocks.", name, traversal.GetWideNodeCount(), traversal.GetTriangleBlockCount());
+	REPORT(EReportType::REPORT_TYPE_LOG, message);
+}
@@ -0,0 +1,32 @@
+#pragma once
+
+#include "Utils.h"
+
+//cpu side benchmarks, run without a vulkan device
+class CpuBenchmark
+{
+public:
+	//bvh build time and sah quality on the example mesh and on synthetic million triangle meshes
+	static void RunBvhBuild(uint32_t iterationCount);
+	//closest and any hit throughput of every simd level against the scalar binary bvh traversal
+	static void RunRayTraversal(uint32_t iterationCount);
+	//add, call and remove cost of the delegate lists against the std::function lambda command lists
+	static void RunDelegates(uint32_t iterationCount);
+	//startup decode time of the bundled texture sets, the example mesh and the shaders, serial against the job system per thread count
+	static void RunAssetLoading(uint32_t iterationCount);
+	//mesh load time through the fbx sdk against the mapped mesh cache, up to the copy into the staging memory
+	static void RunMeshCache(uint32_t iterationCount);
+
+protected:
+	//every geometry of the example mesh merged into one
+	static bool LoadExampleMesh(FbxGeometryData& outGeometry);
+	static void GenerateHeightGrid(uint32_t gridSize, FbxGeometryData& outGeometry);
+	static void GenerateTriangleSoup(uint32_t triangleCount, FbxGeometryData& outGeometry);
+	static void MeasureBvhBuild(const char* name, FbxGeometryData& geometry, uint32_t iterationCount);
+	static void MeasureRayTraversal(const char* name, FbxGeometryData& geometry, uint32_t iterationCount);
+	template <typename ListenerType>
+	static void MeasureDelegates(uint32_t listenerCount, uint32_t iterationCount);
+	//average ms of one decode of every benchmark asset, outBytes is the size of the decoded payloads
+	static double MeasureAssetLoading(uint32_t threadCount, uint32_t iterationCount, uint64_t& outBytes);
+	static void MeasureMeshCache(const char* sourceFilePath, uint32_t iterationCount);
+};
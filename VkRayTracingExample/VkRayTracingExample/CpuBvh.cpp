@@ -0,0 +1,326 @@
+#include <cfloat>
+#include <algorithm>
+
+#include "CpuBvh.h"
+#include "SimpleGeometry.h"
+
+bool CpuBvh::Build(std::vector<glm::vec3>& positions, std::vector<uint32_t>& indices, WorkerThreadPool* workerPool)
+{
+	Clear();
+
+	uint32_t triangleCount = static_cast<uint32_t>(indices.size() / 3);
+	if (triangleCount == 0)
+	{
+		REPORT(EReportType::REPORT_TYPE_WARN, "Bvh source has no triangle.");
+		return false;
+	}
+
+	BuildContext context;
+	context.Triangles.resize(triangleCount);
+	context.Centroids.resize(triangleCount);
+	context.WorkerPool = workerPool;
+	m_triangleIndices.resize(triangleCount);
+	for (uint32_t i = 0; i < triangleCount; i++)
+	{
+		uint32_t i0 = indices[i * 3];
+		uint32_t i1 = indices[i * 3 + 1];
+		uint32_t i2 = indices[i * 3 + 2];
+		if (i0 >= positions.size() || i1 >= positions.size() || i2 >= positions.size())
+		{
+			REPORT(EReportType::REPORT_TYPE_ERROR, "Bvh source index is out of range.");
+			return false;
+		}
+		context.Triangles[i].V0 = positions[i0];
+		context.Triangles[i].V1 = positions[i1];
+		context.Triangles[i].V2 = positions[i2];
+		context.Centroids[i] = (positions[i0] + positions[i1] + positions[i2]) * (1.0f / 3.0f);
+		m_triangleIndices[i] = i;
+	}
+
+	//node 1 is left unused so every sibling pair starts at an even index
+	m_nodes.resize(static_cast<size_t>(triangleCount) * 2 + 1);
+	context.NodeCount = 2;
+
+	CpuBvhNode& root = m_nodes[0];
+	root.LeftFirst = 0;
+	root.TriangleCount = triangleCount;
+	UpdateNodeBounds(context, root);
+
+	if (workerPool != nullptr && workerPool->IsInitialized())
+	{
+		workerPool->Enqueue
+		(
+			[this, &context]()
+			{
+				Subdivide(context, 0);
+			}
+		);
+		workerPool->WaitIdle();
+	}
+	else
+	{
+		context.WorkerPool = nullptr;
+		Subdivide(context, 0);
+	}
+
+	m_nodeCount = context.NodeCount;
+	m_nodes.resize(m_nodeCount);
+	m_nodes.shrink_to_fit();
+
+	//leaves address triangles directly, so triangles are stored in leaf order
+	m_triangles.resize(triangleCount);
+	for (uint32_t i = 0; i < triangleCount; i++)
+	{
+		m_triangles[i] = context.Triangles[m_triangleIndices[i]];
+	}
+
+	return true;
+}
+
+bool CpuBvh::Build(FbxGeometryData& geometryData, WorkerThreadPool* workerPool)
+{
+	return Build(geometryData.m_positions, geometryData.m_indices, workerPool);
+}
+
+bool CpuBvh::Build(SimpleMeshData* meshData, WorkerThreadPool* workerPool)
+{
+	if (meshData == nullptr)
+	{
+		return false;
+	}
+	return Build(meshData->GetHostPositions(), meshData->GetHostIndices(), workerPool);
+}
+
+void CpuBvh::Clear()
+{
+	m_nodes.clear();
+	m_nodeCount = 0;
+	m_triangles.clear();
+	m_triangleIndices.clear();
+}
+
+float CpuBvh::ComputeSahCost()
+{
+	if (m_nodeCount == 0)
+	{
+		return 0.0f;
+	}
+
+	float rootArea = GetSurfaceArea(m_nodes[0].BoundsMin, m_nodes[0].BoundsMax);
+	if (rootArea <= 0.0f)
+	{
+		return INTERSECTION_COST * m_nodes[0].TriangleCount;
+	}
+
+	float cost = 0.0f;
+	for (uint32_t i = 0; i < m_nodeCount; i++)
+	{
+		//unused padding node
+		if (i == 1)
+		{
+			continue;
+		}
+		CpuBvhNode& node = m_nodes[i];
+		float areaRatio = GetSurfaceArea(node.BoundsMin, node.BoundsMax) / rootArea;
+		cost += node.IsLeaf() ? INTERSECTION_COST * node.TriangleCount * areaRatio : TRAVERSAL_COST * areaRatio;
+	}
+	return cost;
+}
+
+uint32_t CpuBvh::GetLeafCount()
+{
+	uint32_t leafCount = 0;
+	for (uint32_t i = 0; i < m_nodeCount; i++)
+	{
+		leafCount += (i != 1 && m_nodes[i].IsLeaf()) ? 1 : 0;
+	}
+	return leafCount;
+}
+
+void CpuBvh::Subdivide(BuildContext& context, uint32_t nodeIndex)
+{
+	while (true)
+	{
+		CpuBvhNode& node = m_nodes[nodeIndex];
+		if (node.TriangleCount <= 1)
+		{
+			return;
+		}
+
+		int axis = 0;
+		uint32_t splitBin = 0;
+		float centroidMin = 0.0f;
+		float binScale = 0.0f;
+		if (!FindBestSplit(context, node, axis, splitBin, centroidMin, binScale))
+		{
+			return;
+		}
+
+		//partition by bin index, so the split matches the evaluated cost exactly
+		uint32_t* first = m_triangleIndices.data() + node.LeftFirst;
+		uint32_t* last = first + node.TriangleCount;
+		uint32_t* middle = std::partition
+		(
+			first,
+			last,
+			[&context, axis, splitBin, centroidMin, binScale](uint32_t triangleIndex)
+			{
+				uint32_t bin = static_cast<uint32_t>((context.Centroids[triangleIndex][axis] - centroidMin) * binScale);
+				bin = bin < BIN_COUNT - 1 ? bin : BIN_COUNT - 1;
+				return bin < splitBin;
+			}
+		);
+		uint32_t leftCount = static_cast<uint32_t>(middle - first);
+		if (leftCount == 0 || leftCount == node.TriangleCount)
+		{
+			return;
+		}
+
+		uint32_t childIndex = context.NodeCount.fetch_add(2);
+		CpuBvhNode& leftChild = m_nodes[childIndex];
+		CpuBvhNode& rightChild = m_nodes[childIndex + 1];
+		leftChild.LeftFirst = node.LeftFirst;
+		leftChild.TriangleCount = leftCount;
+		rightChild.LeftFirst = node.LeftFirst + leftCount;
+		rightChild.TriangleCount = node.TriangleCount - leftCount;
+		UpdateNodeBounds(context, leftChild);
+		UpdateNodeBounds(context, rightChild);
+
+		node.LeftFirst = childIndex;
+		node.TriangleCount = 0;
+
+		//large right subtree goes to another worker, left one continues on this thread
+		if (context.WorkerPool != nullptr && rightChild.TriangleCount >= PARALLEL_SUBTREE_TRIANGLE_COUNT)
+		{
+			uint32_t rightIndex = childIndex + 1;
+			context.WorkerPool->Enqueue
+			(
+				[this, &context, rightIndex]()
+				{
+					Subdivide(context, rightIndex);
+				}
+			);
+		}
+		else
+		{
+			Subdivide(context, childIndex + 1);
+		}
+		nodeIndex = childIndex;
+	}
+}
+
+void CpuBvh::UpdateNodeBounds(BuildContext& context, CpuBvhNode& node)
+{
+	node.BoundsMin = glm::vec3(FLT_MAX);
+	node.BoundsMax = glm::vec3(-FLT_MAX);
+	for (uint32_t i = 0; i < node.TriangleCount; i++)
+	{
+		CpuBvhTriangle& triangle = context.Triangles[m_triangleIndices[node.LeftFirst + i]];
+		node.BoundsMin = glm::min(node.BoundsMin, glm::min(triangle.V0, glm::min(triangle.V1, triangle.V2)));
+		node.BoundsMax = glm::max(node.BoundsMax, glm::max(triangle.V0, glm::max(triangle.V1, triangle.V2)));
+	}
+}
+
+bool CpuBvh::FindBestSplit(BuildContext& context, CpuBvhNode& node, int& outAxis, uint32_t& outSplitBin, float& outCentroidMin, float& outBinScale)
+{
+	struct Bin
+	{
+		glm::vec3 BoundsMin = glm::vec3(FLT_MAX);
+		glm::vec3 BoundsMax = glm::vec3(-FLT_MAX);
+		uint32_t Count = 0;
+	};
+
+	glm::vec3 centroidMin = glm::vec3(FLT_MAX);
+	glm::vec3 centroidMax = glm::vec3(-FLT_MAX);
+	for (uint32_t i = 0; i < node.TriangleCount; i++)
+	{
+		glm::vec3& centroid = context.Centroids[m_triangleIndices[node.LeftFirst + i]];
+		centroidMin = glm::min(centroidMin, centroid);
+		centroidMax = glm::max(centroidMax, centroid);
+	}
+
+	float bestCost = FLT_MAX;
+	for (int axis = 0; axis < 3; axis++)
+	{
+		float extent = centroidMax[axis] - centroidMin[axis];
+		if (extent <= 0.0f)
+		{
+			continue;
+		}
+
+		Bin bins[BIN_COUNT];
+		float binScale = BIN_COUNT / extent;
+		for (uint32_t i = 0; i < node.TriangleCount; i++)
+		{
+			uint32_t triangleIndex = m_triangleIndices[node.LeftFirst + i];
+			CpuBvhTriangle& triangle = context.Triangles[triangleIndex];
+			uint32_t binIndex = static_cast<uint32_t>((context.Centroids[triangleIndex][axis] - centroidMin[axis]) * binScale);
+			binIndex = binIndex < BIN_COUNT - 1 ? binIndex : BIN_COUNT - 1;
+			Bin& bin = bins[binIndex];
+			bin.Count++;
+			bin.BoundsMin = glm::min(bin.BoundsMin, glm::min(triangle.V0, glm::min(triangle.V1, triangle.V2)));
+			bin.BoundsMax = glm::max(bin.BoundsMax, glm::max(triangle.V0, glm::max(triangle.V1, triangle.V2)));
+		}
+
+		//sweep from both sides, split i puts bins below i to the left
+		float leftAreas[BIN_COUNT - 1];
+		float rightAreas[BIN_COUNT - 1];
+		uint32_t leftCounts[BIN_COUNT - 1];
+		uint32_t rightCounts[BIN_COUNT - 1];
+		glm::vec3 leftMin = glm::vec3(FLT_MAX);
+		glm::vec3 leftMax = glm::vec3(-FLT_MAX);
+		glm::vec3 rightMin = glm::vec3(FLT_MAX);
+		glm::vec3 rightMax = glm::vec3(-FLT_MAX);
+		uint32_t leftCount = 0;
+		uint32_t rightCount = 0;
+		for (uint32_t i = 0; i < BIN_COUNT - 1; i++)
+		{
+			leftCount += bins[i].Count;
+			leftMin = glm::min(leftMin, bins[i].BoundsMin);
+			leftMax = glm::max(leftMax, bins[i].BoundsMax);
+			leftCounts[i] = leftCount;
+			leftAreas[i] = leftCount > 0 ? GetSurfaceArea(leftMin, leftMax) : 0.0f;
+
+			uint32_t rightBin = BIN_COUNT - 1 - i;
+			rightCount += bins[rightBin].Count;
+			rightMin = glm::min(rightMin, bins[rightBin].BoundsMin);
+			rightMax = glm::max(rightMax, bins[rightBin].BoundsMax);
+			rightCounts[BIN_COUNT - 2 - i] = rightCount;
+			rightAreas[BIN_COUNT - 2 - i] = rightCount > 0 ? GetSurfaceArea(rightMin, rightMax) : 0.0f;
+		}
+
+		for (uint32_t i = 0; i < BIN_COUNT - 1; i++)
+		{
+			if (leftCounts[i] == 0 || rightCounts[i] == 0)
+			{
+				continue;
+			}
+			float cost = leftCounts[i] * leftAreas[i] + rightCounts[i] * rightAreas[i];
+			if (cost < bestCost)
+			{
+				bestCost = cost;
+				outAxis = axis;
+				outSplitBin = i + 1;
+				outCentroidMin = centroidMin[axis];
+				outBinScale = binScale;
+			}
+		}
+	}
+
+	if (bestCost == FLT_MAX)
+	{
+		return false;
+	}
+
+	//small leaves are kept when the split does not pay off
+	float nodeArea = GetSurfaceArea(node.BoundsMin, node.BoundsMax);
+	float splitCost = TRAVERSAL_COST + (nodeArea > 0.0f ? INTERSECTION_COST * bestCost / nodeArea : 0.0f);
+	float leafCost = INTERSECTION_COST * node.TriangleCount;
+	return splitCost < leafCost || node.TriangleCount > MAX_LEAF_TRIANGLE_COUNT;
+}
+
+float CpuBvh::GetSurfaceArea(const glm::vec3& boundsMin, const glm::vec3& boundsMax)
+{
+	glm::vec3 extent = boundsMax - boundsMin;
+	return 2.0f * (extent.x * extent.y + extent.y * extent.z + extent.z * extent.x);
+}
@@ -0,0 +1,86 @@
+#pragma once
+
+#include <atomic>
+
+#include "Utils.h"
+#include "WorkerThreadPool.h"
+
+class SimpleMeshData;
+
+//32 bytes, the two children of an inner node are placed next to each other so a sibling pair shares a cache line
+struct CpuBvhNode
+{
+	glm::vec3 BoundsMin = glm::vec3(0.0f);
+	//first triangle of a leaf, left child of an inner node and right child follows it
+	uint32_t LeftFirst = 0;
+	glm::vec3 BoundsMax = glm::vec3(0.0f);
+	//0 for inner node
+	uint32_t TriangleCount = 0;
+
+	bool IsLeaf() const { return TriangleCount > 0; }
+};
+static_assert(sizeof(CpuBvhNode) == 32, "CpuBvhNode must be 32 bytes.");
+
+struct CpuBvhTriangle
+{
+	glm::vec3 V0;
+	glm::vec3 V1;
+	glm::vec3 V2;
+};
+
+//binned sah bvh over triangles on cpu, for picking, collision queries, baking and validation of gpu results
+class CpuBvh
+{
+public:
+	//subtrees are built in parallel when a worker pool is given
+	bool Build(std::vector<glm::vec3>& positions, std::vector<uint32_t>& indices, WorkerThreadPool* workerPool = nullptr);
+	bool Build(FbxGeometryData& geometryData, WorkerThreadPool* workerPool = nullptr);
+	bool Build(SimpleMeshData* meshData, WorkerThreadPool* workerPool = nullptr);
+	void Clear();
+
+	//expected cost of a random ray relative to the root, traversal step and triangle test cost 1
+	float ComputeSahCost();
+
+	uint32_t GetNodeCount() { return m_nodeCount; }
+	CpuBvhNode& GetNode(uint32_t index) { return m_nodes[index]; }
+	CpuBvhNode* GetNodes() { return m_nodes.data(); }
+	uint32_t GetLeafCount();
+
+	//triangles are reordered in leaf order
+	uint32_t GetTriangleCount() { return static_cast<uint32_t>(m_triangles.size()); }
+	CpuBvhTriangle& GetTriangle(uint32_t index) { return m_triangles[index]; }
+	CpuBvhTriangle* GetTriangles() { return m_triangles.data(); }
+	//index of the triangle in the source index buffer
+	uint32_t GetSourceTriangleIndex(uint32_t index) { return m_triangleIndices[index]; }
+
+	bool IsBuilt() { return m_nodeCount > 0; }
+
+protected:
+	struct BuildContext
+	{
+		std::vector<CpuBvhTriangle> Triangles;
+		std::vector<glm::vec3> Centroids;
+		std::atomic<uint32_t> NodeCount;
+		WorkerThreadPool* WorkerPool = nullptr;
+	};
+
+	void Subdivide(BuildContext& context, uint32_t nodeIndex);
+	void UpdateNodeBounds(BuildContext& context, CpuBvhNode& node);
+	//returns false when splitting is more expensive than the leaf
+	bool FindBestSplit(BuildContext& context, CpuBvhNode& node, int& outAxis, uint32_t& outSplitBin, float& outCentroidMin, float& outBinScale);
+
+	static float GetSurfaceArea(const glm::vec3& boundsMin, const glm::vec3& boundsMax);
+
+protected:
+	static const uint32_t BIN_COUNT = 16;
+	static const uint32_t MAX_LEAF_TRIANGLE_COUNT = 4;
+	//smaller subtrees are built by the thread that split them
+	static const uint32_t PARALLEL_SUBTREE_TRIANGLE_COUNT = 4096;
+	static constexpr float TRAVERSAL_COST = 1.0f;
+	static constexpr float INTERSECTION_COST = 1.0f;
+
+	std::vector<CpuBvhNode> m_nodes;
+	uint32_t m_nodeCount = 0;
+	std::vector<CpuBvhTriangle> m_triangles;
+	std::vector<uint32_t> m_triangleIndices;
+};
@@ -0,0 +1,698 @@
+#include <intrin.h>
+#include <immintrin.h>
+
+#include "CpuBvhTraversal.h"
+
+namespace
+{
+	const uint32_t TRAVERSAL_STACK_SIZE = 256;
+	const float DETERMINANT_EPSILON = 1e-12f;
+	const float MIN_DIRECTION_COMPONENT = 1e-20f;
+
+	//zero components would give nan in the slab test
+	inline glm::vec3 GetSafeInverse(const glm::vec3& direction)
+	{
+		glm::vec3 inverse = glm::vec3(0.0f);
+		for (int i = 0; i < 3; i++)
+		{
+			float component = direction[i];
+			if (fabsf(component) < MIN_DIRECTION_COMPONENT)
+			{
+				component = component < 0.0f ? -MIN_DIRECTION_COMPONENT : MIN_DIRECTION_COMPONENT;
+			}
+			inverse[i] = 1.0f / component;
+		}
+		return inverse;
+	}
+
+	inline bool IntersectBounds(const CpuBvhNode& node, const glm::vec3& origin, const glm::vec3& invDirection, float tMin, float tMax, float& outTNear)
+	{
+		glm::vec3 t0 = (node.BoundsMin - origin) * invDirection;
+		glm::vec3 t1 = (node.BoundsMax - origin) * invDirection;
+		glm::vec3 tNear = glm::min(t0, t1);
+		glm::vec3 tFar = glm::max(t0, t1);
+		outTNear = glm::max(glm::max(tNear.x, tNear.y), glm::max(tNear.z, tMin));
+		return outTNear <= glm::min(glm::min(tFar.x, tFar.y), glm::min(tFar.z, tMax));
+	}
+
+	//moller trumbore, determinant is positive for front faces
+	inline bool IntersectTriangle(const CpuRay& ray, const CpuBvhTriangle& triangle, float tMax, bool cullBackFacing, float& outT, float& outU, float& outV)
+	{
+		glm::vec3 edge1 = triangle.V1 - triangle.V0;
+		glm::vec3 edge2 = triangle.V2 - triangle.V0;
+		glm::vec3 p = glm::cross(ray.Direction, edge2);
+		float determinant = glm::dot(edge1, p);
+		if ((cullBackFacing ? determinant : fabsf(determinant)) <= DETERMINANT_EPSILON)
+		{
+			return false;
+		}
+		float invDeterminant = 1.0f / determinant;
+		glm::vec3 toOrigin = ray.Origin - triangle.V0;
+		float u = glm::dot(toOrigin, p) * invDeterminant;
+		if (u < 0.0f || u > 1.0f)
+		{
+			return false;
+		}
+		glm::vec3 q = glm::cross(toOrigin, edge1);
+		float v = glm::dot(ray.Direction, q) * invDeterminant;
+		if (v < 0.0f || u + v > 1.0f)
+		{
+			return false;
+		}
+		float t = glm::dot(edge2, q) * invDeterminant;
+		if (t <= ray.TMin || t >= tMax)
+		{
+			return false;
+		}
+		outT = t;
+		outU = u;
+		outV = v;
+		return true;
+	}
+
+	struct SimdSse
+	{
+		typedef __m128 Float;
+		static const uint32_t Width = 4;
+
+		static Float Load(const float* source) { return _mm_loadu_ps(source); }
+		static void Store(float* dest, Float a) { _mm_storeu_ps(dest, a); }
+		static Float Set1(float a) { return _mm_set1_ps(a); }
+		static Float Add(Float a, Float b) { return _mm_add_ps(a, b); }
+		static Float Sub(Float a, Float b) { return _mm_sub_ps(a, b); }
+		static Float Mul(Float a, Float b) { return _mm_mul_ps(a, b); }
+		static Float Div(Float a, Float b) { return _mm_div_ps(a, b); }
+		static Float Min(Float a, Float b) { return _mm_min_ps(a, b); }
+		static Float Max(Float a, Float b) { return _mm_max_ps(a, b); }
+		static Float And(Float a, Float b) { return _mm_and_ps(a, b); }
+		static Float Or(Float a, Float b) { return _mm_or_ps(a, b); }
+		static Float CmpLt(Float a, Float b) { return _mm_cmplt_ps(a, b); }
+		static Float CmpLe(Float a, Float b) { return _mm_cmple_ps(a, b); }
+		static Float CmpGt(Float a, Float b) { return _mm_cmpgt_ps(a, b); }
+		static Float CmpGe(Float a, Float b) { return _mm_cmpge_ps(a, b); }
+		static uint32_t Mask(Float a) { return static_cast<uint32_t>(_mm_movemask_ps(a)); }
+		static void Finish() {}
+	};
+
+	struct SimdAvx2
+	{
+		typedef __m256 Float;
+		static const uint32_t Width = 8;
+
+		static Float Load(const float* source) { return _mm256_loadu_ps(source); }
+		static void Store(float* dest, Float a) { _mm256_storeu_ps(dest, a); }
+		static Float Set1(float a) { return _mm256_set1_ps(a); }
+		static Float Add(Float a, Float b) { return _mm256_add_ps(a, b); }
+		static Float Sub(Float a, Float b) { return _mm256_sub_ps(a, b); }
+		static Float Mul(Float a, Float b) { return _mm256_mul_ps(a, b); }
+		static Float Div(Float a, Float b) { return _mm256_div_ps(a, b); }
+		static Float Min(Float a, Float b) { return _mm256_min_ps(a, b); }
+		static Float Max(Float a, Float b) { return _mm256_max_ps(a, b); }
+		static Float And(Float a, Float b) { return _mm256_and_ps(a, b); }
+		static Float Or(Float a, Float b) { return _mm256_or_ps(a, b); }
+		static Float CmpLt(Float a, Float b) { return _mm256_cmp_ps(a, b, _CMP_LT_OQ); }
+		static Float CmpLe(Float a, Float b) { return _mm256_cmp_ps(a, b, _CMP_LE_OQ); }
+		static Float CmpGt(Float a, Float b) { return _mm256_cmp_ps(a, b, _CMP_GT_OQ); }
+		static Float CmpGe(Float a, Float b) { return _mm256_cmp_ps(a, b, _CMP_GE_OQ); }
+		static uint32_t Mask(Float a) { return static_cast<uint32_t>(_mm256_movemask_ps(a)); }
+		//avoids the transition penalty when sse code runs after the kernel
+		static void Finish() { _mm256_zeroupper(); }
+	};
+}
+
+ECpuSimdLevel CpuBvhTraversal::DetectSimdLevel()
+{
+	int cpuInfo[4] = {};
+	__cpuid(cpuInfo, 0);
+	int maxFunctionId = cpuInfo[0];
+
+	__cpuid(cpuInfo, 1);
+	bool isOsXsaveSupported = (cpuInfo[2] & (1 << 27)) != 0;
+	bool isAvxSupported = (cpuInfo[2] & (1 << 28)) != 0;
+	if (!isOsXsaveSupported || !isAvxSupported || maxFunctionId < 7)
+	{
+		//sse2 is part of x64
+		return ECpuSimdLevel::SSE;
+	}
+
+	//ymm state has to be saved by the os
+	unsigned long long xcrFeatureMask = _xgetbv(0);
+	if ((xcrFeatureMask & 0x6) != 0x6)
+	{
+		return ECpuSimdLevel::SSE;
+	}
+
+	__cpuidex(cpuInfo, 7, 0);
+	bool isAvx2Supported = (cpuInfo[1] & (1 << 5)) != 0;
+	return isAvx2Supported ? ECpuSimdLevel::AVX2 : ECpuSimdLevel::SSE;
+}
+
+const char* CpuBvhTraversal::GetSimdLevelName(ECpuSimdLevel simdLevel)
+{
+	switch (simdLevel)
+	{
+	case ECpuSimdLevel::SCALAR:
+		return "Scalar";
+	case ECpuSimdLevel::SSE:
+		return "SSE";
+	case ECpuSimdLevel::AVX2:
+		return "AVX2";
+	default:
+		return "Auto";
+	}
+}
+
+bool CpuBvhTraversal::Initialize(CpuBvh* bvh, ECpuSimdLevel simdLevel)
+{
+	Destroy();
+
+	if (bvh == nullptr || !bvh->IsBuilt())
+	{
+		REPORT(EReportType::REPORT_TYPE_ERROR, "Bvh traversal needs a built bvh.");
+		return false;
+	}
+
+	m_bvh = bvh;
+	m_supportedSimdLevel = DetectSimdLevel();
+
+	m_wideNodes.reserve(bvh->GetNodeCount() / 4 + 1);
+	m_triangleBlocks.reserve(bvh->GetTriangleCount() / 4 + 1);
+	CollapseNode(0);
+
+	SetSimdLevel(simdLevel);
+	return true;
+}
+
+void CpuBvhTraversal::Destroy()
+{
+	m_bvh = nullptr;
+	m_wideNodes.clear();
+	m_triangleBlocks.clear();
+	m_intersectFunc = nullptr;
+	m_occludedFunc = nullptr;
+}
+
+void CpuBvhTraversal::SetSimdLevel(ECpuSimdLevel simdLevel)
+{
+	if (simdLevel == ECpuSimdLevel::AUTO || simdLevel > m_supportedSimdLevel)
+	{
+		simdLevel = m_supportedSimdLevel;
+	}
+
+	m_simdLevel = simdLevel;
+	switch (simdLevel)
+	{
+	case ECpuSimdLevel::AVX2:
+		m_intersectFunc = &CpuBvhTraversal::TraverseWide<SimdAvx2, false>;
+		m_occludedFunc = &CpuBvhTraversal::TraverseWide<SimdAvx2, true>;
+		break;
+	case ECpuSimdLevel::SSE:
+		m_intersectFunc = &CpuBvhTraversal::TraverseWide<SimdSse, false>;
+		m_occludedFunc = &CpuBvhTraversal::TraverseWide<SimdSse, true>;
+		break;
+	default:
+		m_intersectFunc = &CpuBvhTraversal::TraverseScalar<false>;
+		m_occludedFunc = &CpuBvhTraversal::TraverseScalar<true>;
+		break;
+	}
+}
+
+bool CpuBvhTraversal::Intersect(const CpuRay& ray, CpuRayHit& outHit, bool cullBackFacing)
+{
+	outHit = CpuRayHit();
+	return m_intersectFunc != nullptr && (this->*m_intersectFunc)(ray, outHit, cullBackFacing);
+}
+
+bool CpuBvhTraversal::Occluded(const CpuRay& ray, bool cullBackFacing)
+{
+	CpuRayHit hit = {};
+	return m_occludedFunc != nullptr && (this->*m_occludedFunc)(ray, hit, cullBackFacing);
+}
+
+void CpuBvhTraversal::Intersect(const CpuRay* rays, CpuRayHit* outHits, uint32_t rayCount, WorkerThreadPool* workerPool, bool cullBackFacing)
+{
+	if (m_intersectFunc == nullptr)
+	{
+		return;
+	}
+
+	TraverseFunc intersectFunc = m_intersectFunc;
+	RunChunks
+	(
+		rayCount,
+		workerPool,
+		[this, intersectFunc, rays, outHits, cullBackFacing](uint32_t firstRay, uint32_t chunkRayCount)
+		{
+			for (uint32_t i = firstRay; i < firstRay + chunkRayCount; i++)
+			{
+				outHits[i] = CpuRayHit();
+				(this->*intersectFunc)(rays[i], outHits[i], cullBackFacing);
+			}
+		}
+	);
+}
+
+void CpuBvhTraversal::Occluded(const CpuRay* rays, uint8_t* outOccluded, uint32_t rayCount, WorkerThreadPool* workerPool, bool cullBackFacing)
+{
+	if (m_occludedFunc == nullptr)
+	{
+		return;
+	}
+
+	TraverseFunc occludedFunc = m_occludedFunc;
+	RunChunks
+	(
+		rayCount,
+		workerPool,
+		[this, occludedFunc, rays, outOccluded, cullBackFacing](uint32_t firstRay, uint32_t chunkRayCount)
+		{
+			CpuRayHit hit = {};
+			for (uint32_t i = firstRay; i < firstRay + chunkRayCount; i++)
+			{
+				outOccluded[i] = (this->*occludedFunc)(rays[i], hit, cullBackFacing) ? 1 : 0;
+			}
+		}
+	);
+}
+
+uint32_t CpuBvhTraversal::CollapseNode(uint32_t binaryNodeIndex)
+{
+	uint32_t wideNodeIndex = static_cast<uint32_t>(m_wideNodes.size());
+	m_wideNodes.push_back({});
+	for (uint32_t i = 0; i < CPU_BVH_WIDTH; i++)
+	{
+		for (uint32_t axis = 0; axis < 3; axis++)
+		{
+			m_wideNodes[wideNodeIndex].Bounds[axis][i] = FLT_MAX;
+			m_wideNodes[wideNodeIndex].Bounds[axis + 3][i] = -FLT_MAX;
+		}
+		m_wideNodes[wideNodeIndex].Children[i] = CpuBvhWideNode::INVALID_CHILD;
+		m_wideNodes[wideNodeIndex].BlockCounts[i] = 0;
+	}
+
+	//open the largest inner child until the node is full
+	uint32_t children[CPU_BVH_WIDTH] = {};
+	uint32_t childCount = 0;
+	CpuBvhNode& node = m_bvh->GetNode(binaryNodeIndex);
+	if (node.IsLeaf())
+	{
+		children[childCount++] = binaryNodeIndex;
+	}
+	else
+	{
+		children[childCount++] = node.LeftFirst;
+		children[childCount++] = node.LeftFirst + 1;
+		while (childCount < CPU_BVH_WIDTH)
+		{
+			int bestChild = -1;
+			float bestArea = -1.0f;
+			for (uint32_t i = 0; i < childCount; i++)
+			{
+				CpuBvhNode& child = m_bvh->GetNode(children[i]);
+				uint32_t firstTriangle = 0;
+				uint32_t triangleCount = 0;
+				GetSubtreeTriangleRange(children[i], firstTriangle, triangleCount);
+				if (child.IsLeaf() || triangleCount <= CPU_BVH_WIDTH)
+				{
+					continue;
+				}
+				glm::vec3 extent = child.BoundsMax - child.BoundsMin;
+				float area = extent.x * extent.y + extent.y * extent.z + extent.z * extent.x;
+				if (area > bestArea)
+				{
+					bestArea = area;
+					bestChild = static_cast<int>(i);
+				}
+			}
+			if (bestChild < 0)
+			{
+				break;
+			}
+			uint32_t leftIndex = m_bvh->GetNode(children[bestChild]).LeftFirst;
+			children[bestChild] = leftIndex;
+			children[childCount++] = leftIndex + 1;
+		}
+	}
+
+	//subtrees small enough for one triangle block become leaves
+	for (uint32_t i = 0; i < childCount; i++)
+	{
+		CpuBvhNode& child = m_bvh->GetNode(children[i]);
+		for (uint32_t axis = 0; axis < 3; axis++)
+		{
+			m_wideNodes[wideNodeIndex].Bounds[axis][i] = child.BoundsMin[axis];
+			m_wideNodes[wideNodeIndex].Bounds[axis + 3][i] = child.BoundsMax[axis];
+		}
+
+		uint32_t firstTriangle = 0;
+		uint32_t triangleCount = 0;
+		GetSubtreeTriangleRange(children[i], firstTriangle, triangleCount);
+		if (child.IsLeaf() || triangleCount <= CPU_BVH_WIDTH)
+		{
+			uint32_t firstBlock = AddTriangleBlocks(firstTriangle, triangleCount);
+			m_wideNodes[wideNodeIndex].Children[i] = firstBlock | CpuBvhWideNode::LEAF_FLAG;
+			m_wideNodes[wideNodeIndex].BlockCounts[i] = (triangleCount + CPU_BVH_WIDTH - 1) / CPU_BVH_WIDTH;
+		}
+		else
+		{
+			uint32_t childWideNodeIndex = CollapseNode(children[i]);
+			m_wideNodes[wideNodeIndex].Children[i] = childWideNodeIndex;
+		}
+	}
+
+	return wideNodeIndex;
+}
+
+uint32_t CpuBvhTraversal::AddTriangleBlocks(uint32_t firstTriangle, uint32_t triangleCount)
+{
+	uint32_t firstBlock = static_cast<uint32_t>(m_triangleBlocks.size());
+	for (uint32_t blockStart = 0; blockStart < triangleCount; blockStart += CPU_BVH_WIDTH)
+	{
+		CpuBvhTriangleBlock block = {};
+		for (uint32_t lane = 0; lane < CPU_BVH_WIDTH; lane++)
+		{
+			block.TriangleIndices[lane] = CpuRayHit::INVALID_TRIANGLE_INDEX;
+			if (blockStart + lane >= triangleCount)
+			{
+				continue;
+			}
+
+			uint32_t triangleIndex = firstTriangle + blockStart + lane;
+			CpuBvhTriangle& triangle = m_bvh->GetTriangle(triangleIndex);
+			glm::vec3 edge1 = triangle.V1 - triangle.V0;
+			glm::vec3 edge2 = triangle.V2 - triangle.V0;
+			for (uint32_t axis = 0; axis < 3; axis++)
+			{
+				block.V0[axis][lane] = triangle.V0[axis];
+				block.Edge1[axis][lane] = edge1[axis];
+				block.Edge2[axis][lane] = edge2[axis];
+			}
+			block.TriangleIndices[lane] = m_bvh->GetSourceTriangleIndex(triangleIndex);
+		}
+		m_triangleBlocks.push_back(block);
+	}
+	return firstBlock;
+}
+
+void CpuBvhTraversal::GetSubtreeTriangleRange(uint32_t binaryNodeIndex, uint32_t& outFirst, uint32_t& outCount)
+{
+	//subtree triangles are contiguous, from the leftmost leaf to the end of the rightmost leaf
+	uint32_t leftIndex = binaryNodeIndex;
+	while (!m_bvh->GetNode(leftIndex).IsLeaf())
+	{
+		leftIndex = m_bvh->GetNode(leftIndex).LeftFirst;
+	}
+	uint32_t rightIndex = binaryNodeIndex;
+	while (!m_bvh->GetNode(rightIndex).IsLeaf())
+	{
+		rightIndex = m_bvh->GetNode(rightIndex).LeftFirst + 1;
+	}
+	CpuBvhNode& rightLeaf = m_bvh->GetNode(rightIndex);
+	outFirst = m_bvh->GetNode(leftIndex).LeftFirst;
+	outCount = rightLeaf.LeftFirst + rightLeaf.TriangleCount - outFirst;
+}
+
+template<bool ANY_HIT>
+bool CpuBvhTraversal::TraverseScalar(const CpuRay& ray, CpuRayHit& hit, bool cullBackFacing) const
+{
+	glm::vec3 invDirection = GetSafeInverse(ray.Direction);
+	float closestT = ray.TMax;
+	bool isHit = false;
+
+	float rootTNear = 0.0f;
+	if (!IntersectBounds(m_bvh->GetNode(0), ray.Origin, invDirection, ray.TMin, closestT, rootTNear))
+	{
+		return false;
+	}
+
+	uint32_t stack[TRAVERSAL_STACK_SIZE];
+	uint32_t stackSize = 0;
+	uint32_t nodeIndex = 0;
+	while (true)
+	{
+		CpuBvhNode& node = m_bvh->GetNode(nodeIndex);
+		if (node.IsLeaf())
+		{
+			for (uint32_t i = 0; i < node.TriangleCount; i++)
+			{
+				float t = 0.0f;
+				float u = 0.0f;
+				float v = 0.0f;
+				if (IntersectTriangle(ray, m_bvh->GetTriangle(node.LeftFirst + i), closestT, cullBackFacing, t, u, v))
+				{
+					closestT = t;
+					isHit = true;
+					hit.T = t;
+					hit.U = u;
+					hit.V = v;
+					hit.TriangleIndex = m_bvh->GetSourceTriangleIndex(node.LeftFirst + i);
+					if (ANY_HIT)
+					{
+						return true;
+					}
+				}
+			}
+			if (stackSize == 0)
+			{
+				break;
+			}
+			nodeIndex = stack[--stackSize];
+			continue;
+		}
+
+		uint32_t nearIndex = node.LeftFirst;
+		uint32_t farIndex = node.LeftFirst + 1;
+		float nearTNear = 0.0f;
+		float farTNear = 0.0f;
+		bool isNearHit = IntersectBounds(m_bvh->GetNode(nearIndex), ray.Origin, invDirection, ray.TMin, closestT, nearTNear);
+		bool isFarHit = IntersectBounds(m_bvh->GetNode(farIndex), ray.Origin, invDirection, ray.TMin, closestT, farTNear);
+		if (isNearHit && isFarHit)
+		{
+			if (farTNear < nearTNear)
+			{
+				uint32_t temp = nearIndex;
+				nearIndex = farIndex;
+				farIndex = temp;
+			}
+			assert(stackSize < TRAVERSAL_STACK_SIZE);
+			stack[stackSize++] = farIndex;
+			nodeIndex = nearIndex;
+		}
+		else if (isNearHit || isFarHit)
+		{
+			nodeIndex = isNearHit ? nearIndex : farIndex;
+		}
+		else
+		{
+			if (stackSize == 0)
+			{
+				break;
+			}
+			nodeIndex = stack[--stackSize];
+		}
+	}
+	return isHit;
+}
+
+template<class SIMD, bool ANY_HIT>
+bool CpuBvhTraversal::TraverseWide(const CpuRay& ray, CpuRayHit& hit, bool cullBackFacing) const
+{
+	typedef typename SIMD::Float Float;
+
+	struct StackEntry
+	{
+		uint32_t Child;
+		uint32_t BlockCount;
+		float TNear;
+	};
+
+	glm::vec3 invDirection = GetSafeInverse(ray.Direction);
+	//bounds planes ordered by the ray direction, so empty slots with inverted bounds never hit
+	uint32_t nearPlanes[3] = {};
+	uint32_t farPlanes[3] = {};
+	for (uint32_t axis = 0; axis < 3; axis++)
+	{
+		nearPlanes[axis] = invDirection[axis] >= 0.0f ? axis : axis + 3;
+		farPlanes[axis] = invDirection[axis] >= 0.0f ? axis + 3 : axis;
+	}
+
+	Float originX = SIMD::Set1(ray.Origin.x);
+	Float originY = SIMD::Set1(ray.Origin.y);
+	Float originZ = SIMD::Set1(ray.Origin.z);
+	Float directionX = SIMD::Set1(ray.Direction.x);
+	Float directionY = SIMD::Set1(ray.Direction.y);
+	Float directionZ = SIMD::Set1(ray.Direction.z);
+	Float invDirectionX = SIMD::Set1(invDirection.x);
+	Float invDirectionY = SIMD::Set1(invDirection.y);
+	Float invDirectionZ = SIMD::Set1(invDirection.z);
+	Float rayTMin = SIMD::Set1(ray.TMin);
+	Float zero = SIMD::Set1(0.0f);
+	Float one = SIMD::Set1(1.0f);
+	Float epsilon = SIMD::Set1(DETERMINANT_EPSILON);
+	Float negativeEpsilon = SIMD::Set1(-DETERMINANT_EPSILON);
+
+	float closestT = ray.TMax;
+	bool isHit = false;
+
+	StackEntry stack[TRAVERSAL_STACK_SIZE];
+	uint32_t stackSize = 0;
+	stack[stackSize++] = { 0, 0, ray.TMin };
+	while (stackSize > 0)
+	{
+		StackEntry entry = stack[--stackSize];
+		if (entry.TNear > closestT)
+		{
+			continue;
+		}
+
+		if ((entry.Child & CpuBvhWideNode::LEAF_FLAG) != 0)
+		{
+			uint32_t firstBlock = entry.Child & ~CpuBvhWideNode::LEAF_FLAG;
+			for (uint32_t blockIndex = firstBlock; blockIndex < firstBlock + entry.BlockCount; blockIndex++)
+			{
+				const CpuBvhTriangleBlock& block = m_triangleBlocks[blockIndex];
+				for (uint32_t base = 0; base < CPU_BVH_WIDTH; base += SIMD::Width)
+				{
+					Float edge1X = SIMD::Load(block.Edge1[0] + base);
+					Float edge1Y = SIMD::Load(block.Edge1[1] + base);
+					Float edge1Z = SIMD::Load(block.Edge1[2] + base);
+					Float edge2X = SIMD::Load(block.Edge2[0] + base);
+					Float edge2Y = SIMD::Load(block.Edge2[1] + base);
+					Float edge2Z = SIMD::Load(block.Edge2[2] + base);
+
+					//p = cross(direction, edge2)
+					Float pX = SIMD::Sub(SIMD::Mul(directionY, edge2Z), SIMD::Mul(directionZ, edge2Y));
+					Float pY = SIMD::Sub(SIMD::Mul(directionZ, edge2X), SIMD::Mul(directionX, edge2Z));
+					Float pZ = SIMD::Sub(SIMD::Mul(directionX, edge2Y), SIMD::Mul(directionY, edge2X));
+					Float determinant = SIMD::Add(SIMD::Add(SIMD::Mul(edge1X, pX), SIMD::Mul(edge1Y, pY)), SIMD::Mul(edge1Z, pZ));
+					Float invDeterminant = SIMD::Div(one, determinant);
+
+					Float toOriginX = SIMD::Sub(originX, SIMD::Load(block.V0[0] + base));
+					Float toOriginY = SIMD::Sub(originY, SIMD::Load(block.V0[1] + base));
+					Float toOriginZ = SIMD::Sub(originZ, SIMD::Load(block.V0[2] + base));
+					Float u = SIMD::Mul(SIMD::Add(SIMD::Add(SIMD::Mul(toOriginX, pX), SIMD::Mul(toOriginY, pY)), SIMD::Mul(toOriginZ, pZ)), invDeterminant);
+
+					//q = cross(toOrigin, edge1)
+					Float qX = SIMD::Sub(SIMD::Mul(toOriginY, edge1Z), SIMD::Mul(toOriginZ, edge1Y));
+					Float qY = SIMD::Sub(SIMD::Mul(toOriginZ, edge1X), SIMD::Mul(toOriginX, edge1Z));
+					Float qZ = SIMD::Sub(SIMD::Mul(toOriginX, edge1Y), SIMD::Mul(toOriginY, edge1X));
+					Float v = SIMD::Mul(SIMD::Add(SIMD::Add(SIMD::Mul(directionX, qX), SIMD::Mul(directionY, qY)), SIMD::Mul(directionZ, qZ)), invDeterminant);
+					Float t = SIMD::Mul(SIMD::Add(SIMD::Add(SIMD::Mul(edge2X, qX), SIMD::Mul(edge2Y, qY)), SIMD::Mul(edge2Z, qZ)), invDeterminant);
+
+					Float valid = SIMD::CmpGt(determinant, epsilon);
+					if (!cullBackFacing)
+					{
+						valid = SIMD::Or(valid, SIMD::CmpLt(determinant, negativeEpsilon));
+					}
+					valid = SIMD::And(valid, SIMD::CmpGe(u, zero));
+					valid = SIMD::And(valid, SIMD::CmpGe(v, zero));
+					valid = SIMD::And(valid, SIMD::CmpLe(SIMD::Add(u, v), one));
+					valid = SIMD::And(valid, SIMD::CmpGt(t, rayTMin));
+					valid = SIMD::And(valid, SIMD::CmpLt(t, SIMD::Set1(closestT)));
+					uint32_t hitMask = SIMD::Mask(valid);
+					if (hitMask == 0)
+					{
+						continue;
+					}
+					if (ANY_HIT)
+					{
+						SIMD::Finish();
+						return true;
+					}
+
+					float hitT[CPU_BVH_WIDTH];
+					float hitU[CPU_BVH_WIDTH];
+					float hitV[CPU_BVH_WIDTH];
+					SIMD::Store(hitT, t);
+					SIMD::Store(hitU, u);
+					SIMD::Store(hitV, v);
+					while (hitMask != 0)
+					{
+						unsigned long lane = 0;
+						_BitScanForward(&lane, hitMask);
+						hitMask &= hitMask - 1;
+						if (hitT[lane] < closestT)
+						{
+							closestT = hitT[lane];
+							isHit = true;
+							hit.T = hitT[lane];
+							hit.U = hitU[lane];
+							hit.V = hitV[lane];
+							hit.TriangleIndex = block.TriangleIndices[base + lane];
+						}
+					}
+				}
+			}
+			continue;
+		}
+
+		const CpuBvhWideNode& node = m_wideNodes[entry.Child];
+		Float rayTMax = SIMD::Set1(closestT);
+		float childTNears[CPU_BVH_WIDTH];
+		uint32_t childHitMask = 0;
+		for (uint32_t base = 0; base < CPU_BVH_WIDTH; base += SIMD::Width)
+		{
+			Float tNearX = SIMD::Mul(SIMD::Sub(SIMD::Load(node.Bounds[nearPlanes[0]] + base), originX), invDirectionX);
+			Float tNearY = SIMD::Mul(SIMD::Sub(SIMD::Load(node.Bounds[nearPlanes[1]] + base), originY), invDirectionY);
+			Float tNearZ = SIMD::Mul(SIMD::Sub(SIMD::Load(node.Bounds[nearPlanes[2]] + base), originZ), invDirectionZ);
+			Float tFarX = SIMD::Mul(SIMD::Sub(SIMD::Load(node.Bounds[farPlanes[0]] + base), originX), invDirectionX);
+			Float tFarY = SIMD::Mul(SIMD::Sub(SIMD::Load(node.Bounds[farPlanes[1]] + base), originY), invDirectionY);
+			Float tFarZ = SIMD::Mul(SIMD::Sub(SIMD::Load(node.Bounds[farPlanes[2]] + base), originZ), invDirectionZ);
+			Float tNear = SIMD::Max(SIMD::Max(tNearX, tNearY), SIMD::Max(tNearZ, rayTMin));
+			Float tFar = SIMD::Min(SIMD::Min(tFarX, tFarY), SIMD::Min(tFarZ, rayTMax));
+			SIMD::Store(childTNears + base, tNear);
+			childHitMask |= SIMD::Mask(SIMD::CmpLe(tNear, tFar)) << base;
+		}
+
+		//sorted far to near, so the nearest child is popped first
+		StackEntry hitChildren[CPU_BVH_WIDTH];
+		uint32_t hitChildCount = 0;
+		while (childHitMask != 0)
+		{
+			unsigned long lane = 0;
+			_BitScanForward(&lane, childHitMask);
+			childHitMask &= childHitMask - 1;
+
+			StackEntry childEntry = { node.Children[lane], node.BlockCounts[lane], childTNears[lane] };
+			uint32_t insertIndex = hitChildCount++;
+			while (insertIndex > 0 && hitChildren[insertIndex - 1].TNear < childEntry.TNear)
+			{
+				hitChildren[insertIndex] = hitChildren[insertIndex - 1];
+				insertIndex--;
+			}
+			hitChildren[insertIndex] = childEntry;
+		}
+		assert(stackSize + hitChildCount <= TRAVERSAL_STACK_SIZE);
+		for (uint32_t i = 0; i < hitChildCount; i++)
+		{
+			stack[stackSize++] = hitChildren[i];
+		}
+	}
+
+	SIMD::Finish();
+	return isHit;
+}
+
+void CpuBvhTraversal::RunChunks(uint32_t rayCount, WorkerThreadPool* workerPool, std::function<void(uint32_t, uint32_t)> chunkFunc)
+{
+	if (workerPool == nullptr || !workerPool->IsInitialized() || rayCount <= CHUNK_RAY_COUNT)
+	{
+		chunkFunc(0, rayCount);
+		return;
+	}
+
+	//last chunk runs on the calling thread
+	uint32_t lastChunkFirstRay = ((rayCount - 1) / CHUNK_RAY_COUNT) * CHUNK_RAY_COUNT;
+	for (uint32_t firstRay = 0; firstRay < lastChunkFirstRay; firstRay += CHUNK_RAY_COUNT)
+	{
+		workerPool->Enqueue
+		(
+			[chunkFunc, firstRay]()
+			{
+				chunkFunc(firstRay, CHUNK_RAY_COUNT);
+			}
+		);
+	}
+	chunkFunc(lastChunkFirstRay, rayCount - lastChunkFirstRay);
+	workerPool->WaitIdle();
+}
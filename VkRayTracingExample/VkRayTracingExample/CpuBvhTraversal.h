@@ -0,0 +1,112 @@
+#pragma once
+
+#include <cfloat>
+
+#include "CpuBvh.h"
+
+enum class ECpuSimdLevel : uint8_t
+{
+	SCALAR,
+	SSE,
+	AVX2,
+	//highest level supported by the running cpu
+	AUTO
+};
+
+struct CpuRay
+{
+	glm::vec3 Origin = glm::vec3(0.0f);
+	float TMin = 0.0f;
+	glm::vec3 Direction = glm::vec3(0.0f, 0.0f, 1.0f);
+	float TMax = FLT_MAX;
+};
+
+struct CpuRayHit
+{
+	static const uint32_t INVALID_TRIANGLE_INDEX = 0xFFFFFFFF;
+
+	float T = FLT_MAX;
+	float U = 0.0f;
+	float V = 0.0f;
+	//index of the triangle in the source index buffer
+	uint32_t TriangleIndex = INVALID_TRIANGLE_INDEX;
+
+	bool IsHit() const { return TriangleIndex != INVALID_TRIANGLE_INDEX; }
+};
+
+static const uint32_t CPU_BVH_WIDTH = 8;
+
+//8 children in soa layout, bounds are minX, minY, minZ, maxX, maxY, maxZ
+struct CpuBvhWideNode
+{
+	static const uint32_t LEAF_FLAG = 0x80000000;
+	static const uint32_t INVALID_CHILD = 0xFFFFFFFF;
+
+	float Bounds[6][CPU_BVH_WIDTH];
+	//wide node index, or first triangle block index with LEAF_FLAG
+	uint32_t Children[CPU_BVH_WIDTH];
+	uint32_t BlockCounts[CPU_BVH_WIDTH];
+};
+
+//8 triangles in soa layout with precomputed edges, unused lanes have zero edges and never hit
+struct CpuBvhTriangleBlock
+{
+	float V0[3][CPU_BVH_WIDTH];
+	float Edge1[3][CPU_BVH_WIDTH];
+	float Edge2[3][CPU_BVH_WIDTH];
+	uint32_t TriangleIndices[CPU_BVH_WIDTH];
+};
+
+//ray queries over a CpuBvh, the binary bvh is collapsed into a 8 wide bvh for the simd kernels
+class CpuBvhTraversal
+{
+public:
+	static ECpuSimdLevel DetectSimdLevel();
+	static const char* GetSimdLevelName(ECpuSimdLevel simdLevel);
+
+	//bvh must stay alive while the traversal is used, scalar kernel reads it directly
+	bool Initialize(CpuBvh* bvh, ECpuSimdLevel simdLevel = ECpuSimdLevel::AUTO);
+	void Destroy();
+
+	//falls back to the highest supported level below the requested one
+	void SetSimdLevel(ECpuSimdLevel simdLevel);
+	ECpuSimdLevel GetSimdLevel() { return m_simdLevel; }
+
+	//front faces are counterclockwise seen from the ray origin, same as the tlas instances
+	bool Intersect(const CpuRay& ray, CpuRayHit& outHit, bool cullBackFacing = false);
+	bool Occluded(const CpuRay& ray, bool cullBackFacing = false);
+
+	//closest hit, rays are split into chunks over the worker pool when given
+	void Intersect(const CpuRay* rays, CpuRayHit* outHits, uint32_t rayCount, WorkerThreadPool* workerPool = nullptr, bool cullBackFacing = false);
+	//any hit, 1 when the ray is blocked between TMin and TMax
+	void Occluded(const CpuRay* rays, uint8_t* outOccluded, uint32_t rayCount, WorkerThreadPool* workerPool = nullptr, bool cullBackFacing = false);
+
+	uint32_t GetWideNodeCount() { return static_cast<uint32_t>(m_wideNodes.size()); }
+	uint32_t GetTriangleBlockCount() { return static_cast<uint32_t>(m_triangleBlocks.size()); }
+
+protected:
+	typedef bool (CpuBvhTraversal::*TraverseFunc)(const CpuRay& ray, CpuRayHit& hit, bool cullBackFacing) const;
+
+	uint32_t CollapseNode(uint32_t binaryNodeIndex);
+	uint32_t AddTriangleBlocks(uint32_t firstTriangle, uint32_t triangleCount);
+	void GetSubtreeTriangleRange(uint32_t binaryNodeIndex, uint32_t& outFirst, uint32_t& outCount);
+
+	template<bool ANY_HIT>
+	bool TraverseScalar(const CpuRay& ray, CpuRayHit& hit, bool cullBackFacing) const;
+	template<class SIMD, bool ANY_HIT>
+	bool TraverseWide(const CpuRay& ray, CpuRayHit& hit, bool cullBackFacing) const;
+
+	void RunChunks(uint32_t rayCount, WorkerThreadPool* workerPool, std::function<void(uint32_t, uint32_t)> chunkFunc);
+
+protected:
+	static const uint32_t CHUNK_RAY_COUNT = 4096;
+
+	CpuBvh* m_bvh = nullptr;
+	std::vector<CpuBvhWideNode> m_wideNodes;
+	std::vector<CpuBvhTriangleBlock> m_triangleBlocks;
+
+	ECpuSimdLevel m_simdLevel = ECpuSimdLevel::SCALAR;
+	ECpuSimdLevel m_supportedSimdLevel = ECpuSimdLevel::SCALAR;
+	TraverseFunc m_intersectFunc = nullptr;
+	TraverseFunc m_occludedFunc = nullptr;
+};
@@ -0,0 +1,663 @@
+#include <atomic>
+#include <chrono>
+#include <stb_image.h>
+
+#include "CpuReferenceRenderer.h"
+#include "GeometryContainer.h"
+#include "TextureContainer.h"
+#include "SimpleMaterial.h"
+
+namespace
+{
+	//ray ranges of RayGen.rgen and the hit shaders
+	const float PRIMARY_RAY_T_MIN = 0.0001f;
+	const float SECONDARY_RAY_T_MIN = 0.1f;
+	const float RAY_T_MAX = 10000.0f;
+	const uint32_t MAX_TRACE_DEPTH = 3;
+	const uint32_t MAX_REFRACT_TRACE_DEPTH = 5;
+	const float SHADOW_ATTENUATION = 0.7f;
+
+	//random functions of Common.glsl
+	uint32_t Tea(uint32_t value0, uint32_t value1)
+	{
+		uint32_t v0 = value0;
+		uint32_t v1 = value1;
+		uint32_t s0 = 0;
+		for (uint32_t n = 0; n < 16; n++)
+		{
+			s0 += 0x9e3779b9;
+			v0 += ((v1 << 4) + 0xa341316c) ^ (v1 + s0) ^ ((v1 >> 5) + 0xc8013ea4);
+			v1 += ((v0 << 4) + 0xad90777d) ^ (v0 + s0) ^ ((v0 >> 5) + 0x7e95761e);
+		}
+		return v0;
+	}
+
+	float Rnd(uint32_t& prev)
+	{
+		prev = 1664525u * prev + 1013904223u;
+		return static_cast<float>(prev & 0x00FFFFFF) / static_cast<float>(0x01000000);
+	}
+
+	glm::vec3 NormalSampleToWorldSpace(const glm::vec3& normalMapSample, const glm::vec3& unitNormalW, const glm::vec3& tangentW)
+	{
+		glm::vec3 normalT = 2.0f * normalMapSample - 1.0f;
+		glm::vec3 n = unitNormalW;
+		glm::vec3 t = glm::normalize(tangentW - glm::dot(tangentW, n) * n);
+		glm::vec3 b = glm::cross(n, t);
+		return glm::mat3(t, b, n) * normalT;
+	}
+
+	glm::vec3 SchlickFresnel(const glm::vec3& f0, float ldh)
+	{
+		float t = powf(1.0f - ldh, 5.0f);
+		return f0 + (1.0f - f0) * t;
+	}
+
+	float GGXNormalDistribution(float a2, float ndh)
+	{
+		float d = (ndh * a2 - ndh) * ndh + 1.0f;
+		return a2 / (PI * d * d);
+	}
+
+	float SchlickMaskingTerm(float a2, float ndl, float ndv)
+	{
+		float k = a2 / 2.0f;
+		float gv = ndv / (ndv * (1.0f - k) + k);
+		float gl = ndl / (ndl * (1.0f - k) + k);
+		return gv * gl;
+	}
+}
+
+bool CpuTexture::Load(const std::string& filePath)
+{
+	Unload();
+
+	int channels = 0;
+	stbi_uc* pixels = stbi_load(filePath.c_str(), &m_width, &m_height, &channels, STBI_rgb_alpha);
+	if (pixels == nullptr)
+	{
+		char message[256] = {};
+		sprintf_s(message, "Cpu texture load failed : %s", filePath.c_str());
+		REPORT(EReportType::REPORT_TYPE_WARN, message);
+		return false;
+	}
+	m_pixels.assign(pixels, pixels + static_cast<size_t>(m_width) * m_height * 4);
+	stbi_image_free(pixels);
+	return true;
+}
+
+void CpuTexture::Unload()
+{
+	m_pixels.clear();
+	m_width = 0;
+	m_height = 0;
+}
+
+glm::vec4 CpuTexture::SampleRepeat(glm::vec2 uv) const
+{
+	return Sample(uv, true);
+}
+
+glm::vec4 CpuTexture::SampleClamp(glm::vec2 uv) const
+{
+	return Sample(uv, false);
+}
+
+glm::vec4 CpuTexture::Sample(glm::vec2 uv, bool isRepeat) const
+{
+	if (m_pixels.empty())
+	{
+		return glm::vec4(1.0f);
+	}
+
+	glm::vec2 texel = uv * glm::vec2(static_cast<float>(m_width), static_cast<float>(m_height)) - 0.5f;
+	glm::vec2 texelFloor = glm::floor(texel);
+	glm::vec2 weight = texel - texelFloor;
+	int x = static_cast<int>(texelFloor.x);
+	int y = static_cast<int>(texelFloor.y);
+
+	glm::vec4 top = glm::mix(Fetch(x, y, isRepeat), Fetch(x + 1, y, isRepeat), weight.x);
+	glm::vec4 bottom = glm::mix(Fetch(x, y + 1, isRepeat), Fetch(x + 1, y + 1, isRepeat), weight.x);
+	return glm::mix(top, bottom, weight.y);
+}
+
+glm::vec4 CpuTexture::Fetch(int x, int y, bool isRepeat) const
+{
+	if (isRepeat)
+	{
+		x = ((x % m_width) + m_width) % m_width;
+		y = ((y % m_height) + m_height) % m_height;
+	}
+	else
+	{
+		x = glm::clamp(x, 0, m_width - 1);
+		y = glm::clamp(y, 0, m_height - 1);
+	}
+	const uint8_t* pixel = &m_pixels[(static_cast<size_t>(y) * m_width + x) * 4];
+	return glm::vec4(pixel[0], pixel[1], pixel[2], pixel[3]) * (1.0f / 255.0f);
+}
+
+bool CpuCubemap::Load(std::vector<std::string>& filePaths)
+{
+	if (filePaths.size() != 6)
+	{
+		REPORT(EReportType::REPORT_TYPE_WARN, "Cpu cubemap needs 6 faces.");
+		return false;
+	}
+
+	bool res = true;
+	for (uint32_t i = 0; i < 6; i++)
+	{
+		res &= m_faces[i].Load(filePaths[i]);
+	}
+	return res;
+}
+
+void CpuCubemap::Unload()
+{
+	for (uint32_t i = 0; i < 6; i++)
+	{
+		m_faces[i].Unload();
+	}
+}
+
+glm::vec4 CpuCubemap::Sample(const glm::vec3& direction) const
+{
+	//face selection of the vulkan cube map lookup
+	glm::vec3 absDirection = glm::abs(direction);
+	uint32_t face = 0;
+	float sc = 0.0f;
+	float tc = 0.0f;
+	float ma = 0.0f;
+	if (absDirection.x >= absDirection.y && absDirection.x >= absDirection.z)
+	{
+		face = direction.x >= 0.0f ? 0 : 1;
+		sc = direction.x >= 0.0f ? -direction.z : direction.z;
+		tc = -direction.y;
+		ma = absDirection.x;
+	}
+	else if (absDirection.y >= absDirection.z)
+	{
+		face = direction.y >= 0.0f ? 2 : 3;
+		sc = direction.x;
+		tc = direction.y >= 0.0f ? direction.z : -direction.z;
+		ma = absDirection.y;
+	}
+	else
+	{
+		face = direction.z >= 0.0f ? 4 : 5;
+		sc = direction.z >= 0.0f ? direction.x : -direction.x;
+		tc = -direction.y;
+		ma = absDirection.z;
+	}
+
+	if (ma <= 0.0f)
+	{
+		return glm::vec4(0.0f);
+	}
+	glm::vec2 uv = glm::vec2(sc / ma, tc / ma) * 0.5f + 0.5f;
+	return m_faces[face].SampleClamp(uv);
+}
+
+bool CpuReferenceRenderer::Initialize(RTPipelineResources* pipelineResources, SimpleCubmapTexture* envCubemap, WorkerThreadPool* workerPool)
+{
+	Destroy();
+
+	BottomLevelAsGroup* bottomLevelAsGroup = pipelineResources != nullptr ? pipelineResources->GetBottomLevelAsGroup() : nullptr;
+	if (bottomLevelAsGroup == nullptr)
+	{
+		REPORT(EReportType::REPORT_TYPE_ERROR, "Cpu reference renderer needs built pipeline resources.");
+		return false;
+	}
+
+	m_instanceConstants = pipelineResources->GetInstanceConstants();
+	m_geometryConstants = pipelineResources->GetGeometryConstants();
+	m_materialConstants = pipelineResources->GetMaterialConstants();
+	m_globalConstants = pipelineResources->GetGlobalConstants();
+
+	m_vertexBuffers.resize(gGeomContainer.GetMeshCount());
+	m_indexBuffers.resize(gGeomContainer.GetMeshCount());
+	for (uint32_t i = 0; i < gGeomContainer.GetMeshCount(); i++)
+	{
+		SimpleMeshData* meshData = gGeomContainer.GetMesh(i);
+		if (meshData != nullptr)
+		{
+			m_vertexBuffers[i] = meshData->GetHostVertices();
+			m_indexBuffers[i] = meshData->GetHostIndices();
+		}
+	}
+
+	m_textures.resize(gTexContainer.GetTextureCount());
+	for (uint32_t i = 0; i < gTexContainer.GetTextureCount(); i++)
+	{
+		SimpleTexture2D* texture = gTexContainer.GetTexture(i);
+		if (texture != nullptr)
+		{
+			m_textures[i].Load(texture->GetSrcFilePath());
+		}
+	}
+
+	if (envCubemap != nullptr)
+	{
+		m_envCubemap.Load(envCubemap->GetSrcFilePaths());
+	}
+
+	//every geometry of every tlas instance is transformed to world space
+	std::vector<glm::vec3> positions;
+	std::vector<uint32_t> indices;
+	uint32_t instanceCount = static_cast<uint32_t>(m_instanceConstants.size());
+	instanceCount = instanceCount < bottomLevelAsGroup->GetAsInstanceDescCount() ? instanceCount : bottomLevelAsGroup->GetAsInstanceDescCount();
+	for (uint32_t instanceIndex = 0; instanceIndex < instanceCount; instanceIndex++)
+	{
+		AsInstanceDesc& instanceDesc = bottomLevelAsGroup->GetAsInstanceDesc(instanceIndex);
+		glm::mat4& worldMat = m_instanceConstants[instanceIndex].WorldMat;
+		bool isFlipped = glm::determinant(glm::mat3(worldMat)) < 0.0f;
+
+		for (uint32_t geometryIndex = 0; geometryIndex < instanceDesc.GeometryCount; geometryIndex++)
+		{
+			uint32_t geometryTableIndex = instanceDesc.GeometryTableOffset + geometryIndex;
+			if (geometryTableIndex >= m_geometryConstants.size())
+			{
+				continue;
+			}
+			int geometryId = m_geometryConstants[geometryTableIndex].GeometryID;
+			if (geometryId < 0 || geometryId >= static_cast<int>(m_vertexBuffers.size()))
+			{
+				continue;
+			}
+
+			std::vector<DefaultVertex>& vertices = m_vertexBuffers[geometryId];
+			std::vector<uint32_t>& meshIndices = m_indexBuffers[geometryId];
+			uint32_t baseVertex = static_cast<uint32_t>(positions.size());
+			for (DefaultVertex& vertex : vertices)
+			{
+				positions.push_back(glm::vec3(worldMat * vertex.m_position));
+			}
+			for (uint32_t primitiveIndex = 0; primitiveIndex < meshIndices.size() / 3; primitiveIndex++)
+			{
+				indices.push_back(baseVertex + meshIndices[primitiveIndex * 3]);
+				indices.push_back(baseVertex + meshIndices[primitiveIndex * 3 + (isFlipped ? 2 : 1)]);
+				indices.push_back(baseVertex + meshIndices[primitiveIndex * 3 + (isFlipped ? 1 : 2)]);
+
+				TriangleSource source = {};
+				source.InstanceIndex = instanceIndex;
+				source.GeometryTableIndex = geometryTableIndex;
+				source.PrimitiveIndex = primitiveIndex;
+				source.IsFlipped = isFlipped;
+				m_triangleSources.push_back(source);
+			}
+		}
+	}
+
+	if (!m_bvh.Build(positions, indices, workerPool))
+	{
+		return false;
+	}
+	return m_traversal.Initialize(&m_bvh);
+}
+
+void CpuReferenceRenderer::Destroy()
+{
+	m_traversal.Destroy();
+	m_bvh.Clear();
+	m_triangleSources.clear();
+	m_instanceConstants.clear();
+	m_geometryConstants.clear();
+	m_materialConstants.clear();
+	m_vertexBuffers.clear();
+	m_indexBuffers.clear();
+	m_textures.clear();
+	m_envCubemap.Unload();
+}
+
+bool CpuReferenceRenderer::Render(uint32_t width, uint32_t height, std::vector<uint8_t>& outPixels, WorkerThreadPool* workerPool)
+{
+	if (!m_bvh.IsBuilt() || width == 0 || height == 0)
+	{
+		return false;
+	}
+
+	outPixels.resize(static_cast<size_t>(width) * height * 4);
+	uint32_t tileCountX = (width + TILE_SIZE - 1) / TILE_SIZE;
+	uint32_t tileCountY = (height + TILE_SIZE - 1) / TILE_SIZE;
+	uint32_t tileCount = tileCountX * tileCountY;
+
+	std::atomic<uint32_t> nextTile(0);
+	std::atomic<uint64_t> totalRayCount(0);
+	auto renderTiles = [this, &nextTile, &totalRayCount, tileCount, width, height, &outPixels]()
+	{
+		uint64_t rayCount = 0;
+		for (uint32_t tile = nextTile.fetch_add(1); tile < tileCount; tile = nextTile.fetch_add(1))
+		{
+			RenderTile(tile, width, height, outPixels, rayCount);
+		}
+		totalRayCount += rayCount;
+	};
+
+	std::chrono::high_resolution_clock::time_point startTime = std::chrono::high_resolution_clock::now();
+	uint32_t threadCount = 1;
+	if (workerPool != nullptr && workerPool->IsInitialized())
+	{
+		threadCount += workerPool->GetThreadCount();
+		for (uint32_t i = 0; i < workerPool->GetThreadCount(); i++)
+		{
+			workerPool->Enqueue(renderTiles);
+		}
+	}
+	renderTiles();
+	if (threadCount > 1)
+	{
+		workerPool->WaitIdle();
+	}
+	std::chrono::duration<double> elapsed = std::chrono::high_resolution_clock::now() - startTime;
+
+	double sampleCount = static_cast<double>(width) * height * NUM_SAMPLES;
+	char message[256] = {};
+	sprintf_s
+	(
+		message,
+		"Cpu reference render : %ux%u, %u samples per pixel, %.3f s, %.1f Ksamples/s per core on %u threads, %.2f Mrays/s.",
+		width,
+		height,
+		NUM_SAMPLES,
+		elapsed.count(),
+		sampleCount / elapsed.count() / threadCount / 1000.0,
+		threadCount,
+		static_cast<double>(totalRayCount) / elapsed.count() / 1000000.0
+	);
+	REPORT(EReportType::REPORT_TYPE_LOG, message);
+	return true;
+}
+
+void CpuReferenceRenderer::RenderTile(uint32_t tileIndex, uint32_t width, uint32_t height, std::vector<uint8_t>& outPixels, uint64_t& rayCount)
+{
+	uint32_t tileCountX = (width + TILE_SIZE - 1) / TILE_SIZE;
+	uint32_t startX = (tileIndex % tileCountX) * TILE_SIZE;
+	uint32_t startY = (tileIndex / tileCountX) * TILE_SIZE;
+	uint32_t endX = startX + TILE_SIZE < width ? startX + TILE_SIZE : width;
+	uint32_t endY = startY + TILE_SIZE < height ? startY + TILE_SIZE : height;
+	for (uint32_t y = startY; y < endY; y++)
+	{
+		for (uint32_t x = startX; x < endX; x++)
+		{
+			//stored to the rgba8 unorm target like imageStore
+			glm::vec3 color = glm::clamp(RenderPixel(x, y, width, height, rayCount), 0.0f, 1.0f);
+			uint8_t* pixel = &outPixels[(static_cast<size_t>(y) * width + x) * 4];
+			pixel[0] = static_cast<uint8_t>(color.r * 255.0f + 0.5f);
+			pixel[1] = static_cast<uint8_t>(color.g * 255.0f + 0.5f);
+			pixel[2] = static_cast<uint8_t>(color.b * 255.0f + 0.5f);
+			pixel[3] = 255;
+		}
+	}
+}
+
+glm::vec3 CpuReferenceRenderer::RenderPixel(uint32_t x, uint32_t y, uint32_t width, uint32_t height, uint64_t& rayCount)
+{
+	uint32_t randSeed = Tea(y * width + x, 1);
+	glm::vec3 accumulatedHitValue = glm::vec3(0.0f);
+	for (uint32_t i = 0; i < NUM_SAMPLES; i++)
+	{
+		float r1 = Rnd(randSeed);
+		float r2 = Rnd(randSeed);
+		glm::vec2 subPixelJitter = i == 0 ? glm::vec2(0.5f, 0.5f) : glm::vec2(r1, r2);
+
+		glm::vec2 pixelCenterPos = glm::vec2(static_cast<float>(x), static_cast<float>(y)) + subPixelJitter;
+		glm::vec2 uvSpacePos = pixelCenterPos / glm::vec2(static_cast<float>(width), static_cast<float>(height));
+		glm::vec2 clipSpaceCenter = uvSpacePos * 2.0f - 1.0f;
+
+		glm::vec4 origin = m_globalConstants.MatViewInv * glm::vec4(0.0f, 0.0f, 0.0f, 1.0f);
+		glm::vec4 target = m_globalConstants.MatProjInv * glm::vec4(clipSpaceCenter.x, clipSpaceCenter.y, 1.0f, 1.0f);
+		glm::vec4 direction = glm::normalize(m_globalConstants.MatViewInv * glm::vec4(glm::normalize(glm::vec3(target)), 0.0f));
+
+		RayPayload payload = {};
+		payload.HitColor = glm::vec3(1.0f, 0.0f, 0.0f);
+		payload.TraceDepth = 0;
+		payload.IndexOfRefraction = IOR_AIR;
+		TraceRay(glm::vec3(origin), glm::vec3(direction), PRIMARY_RAY_T_MIN, RAY_T_MAX, true, payload, rayCount);
+
+		accumulatedHitValue += payload.HitColor;
+	}
+	return accumulatedHitValue / static_cast<float>(NUM_SAMPLES);
+}
+
+void CpuReferenceRenderer::TraceRay(const glm::vec3& origin, const glm::vec3& direction, float tMin, float tMax, bool cullBackFacing, RayPayload& payload, uint64_t& rayCount)
+{
+	rayCount++;
+
+	CpuRay ray = {};
+	ray.Origin = origin;
+	ray.Direction = direction;
+	ray.TMin = tMin;
+	ray.TMax = tMax;
+	CpuRayHit hit = {};
+	if (!m_traversal.Intersect(ray, hit, cullBackFacing))
+	{
+		//Miss.rmiss
+		payload.HitColor = glm::vec3(m_envCubemap.Sample(direction));
+		return;
+	}
+
+	SurfaceData surface = {};
+	GetSurfaceData(ray, hit, surface);
+	switch (static_cast<EMaterialType>(surface.Material->MateiralTypeIndex))
+	{
+	case EMaterialType::SURFACE_TYPE_TRANSPARENT:
+		ShadeTransparent(ray, surface, payload, rayCount);
+		break;
+	case EMaterialType::MATERIAL_TYPE_TRANSPARENT_REFRACT:
+		ShadeRefract(ray, surface, payload, rayCount);
+		break;
+	default:
+		ShadeDefault(ray, surface, payload, rayCount);
+		break;
+	}
+}
+
+bool CpuReferenceRenderer::TraceShadowRay(const glm::vec3& origin, uint64_t& rayCount)
+{
+	rayCount++;
+
+	//terminate on first hit and cull back facing triangles, light direction is not normalized like the shaders
+	CpuRay ray = {};
+	ray.Origin = origin;
+	ray.Direction = -m_globalConstants.LightDir;
+	ray.TMin = SECONDARY_RAY_T_MIN;
+	ray.TMax = RAY_T_MAX;
+	return m_traversal.Occluded(ray, true);
+}
+
+void CpuReferenceRenderer::GetSurfaceData(const CpuRay& ray, const CpuRayHit& hit, SurfaceData& outSurface)
+{
+	TriangleSource& source = m_triangleSources[hit.TriangleIndex];
+	RTPipelineResources::InstanceConstants& instanceConstants = m_instanceConstants[source.InstanceIndex];
+	RTPipelineResources::GeometryConstants& geometryConstants = m_geometryConstants[source.GeometryTableIndex];
+	outSurface.Material = &m_materialConstants[geometryConstants.MaterialID];
+
+	std::vector<DefaultVertex>& vertices = m_vertexBuffers[geometryConstants.GeometryID];
+	std::vector<uint32_t>& indices = m_indexBuffers[geometryConstants.GeometryID];
+	DefaultVertex& vert0 = vertices[indices[source.PrimitiveIndex * 3]];
+	DefaultVertex& vert1 = vertices[indices[source.PrimitiveIndex * 3 + 1]];
+	DefaultVertex& vert2 = vertices[indices[source.PrimitiveIndex * 3 + 2]];
+
+	float u = source.IsFlipped ? hit.V : hit.U;
+	float v = source.IsFlipped ? hit.U : hit.V;
+	glm::vec3 barycentricCoords = glm::vec3(1.0f - u - v, u, v);
+
+	glm::mat3 worldMat = glm::mat3(instanceConstants.WorldMat);
+	outSurface.WorldPos = ray.Origin + ray.Direction * hit.T;
+	outSurface.VertexNormal = glm::normalize(worldMat * glm::normalize(glm::vec3(vert0.m_normal) * barycentricCoords.x + glm::vec3(vert1.m_normal) * barycentricCoords.y + glm::vec3(vert2.m_normal) * barycentricCoords.z));
+	glm::vec3 vertexTangent = glm::normalize(worldMat * glm::normalize(glm::vec3(vert0.m_tangent) * barycentricCoords.x + glm::vec3(vert1.m_tangent) * barycentricCoords.y + glm::vec3(vert2.m_tangent) * barycentricCoords.z));
+	outSurface.Uv = (glm::vec2(vert0.m_texcoord) * barycentricCoords.x + glm::vec2(vert1.m_texcoord) * barycentricCoords.y + glm::vec2(vert2.m_texcoord) * barycentricCoords.z) * outSurface.Material->uvScale;
+
+	//missing normal map keeps the vertex normal
+	glm::vec3 normalSample = glm::vec3(SampleTexture(outSurface.Material->NormalTexIndex, outSurface.Uv, glm::vec4(0.5f, 0.5f, 1.0f, 1.0f)));
+	outSurface.Diffuse = SampleTexture(outSurface.Material->DiffuseTexIndex, outSurface.Uv, glm::vec4(1.0f));
+	outSurface.Roughness = SampleTexture(outSurface.Material->RoughnessTexIndex, outSurface.Uv, glm::vec4(outSurface.Material->Roughness)).x;
+	outSurface.Metallic = SampleTexture(outSurface.Material->MetallicTexIndex, outSurface.Uv, glm::vec4(outSurface.Material->Metallic)).x;
+	outSurface.Normal = glm::normalize(NormalSampleToWorldSpace(normalSample, outSurface.VertexNormal, vertexTangent));
+}
+
+glm::vec4 CpuReferenceRenderer::SampleTexture(int textureIndex, const glm::vec2& uv, const glm::vec4& fallback) const
+{
+	if (textureIndex < 0 || textureIndex >= static_cast<int>(m_textures.size()) || !m_textures[textureIndex].IsLoaded())
+	{
+		return fallback;
+	}
+	return m_textures[textureIndex].SampleRepeat(uv);
+}
+
+glm::vec3 CpuReferenceRenderer::ComputeLighting(const SurfaceData& surface, const glm::vec3& rayDirection, const glm::vec3& reflectColor, const glm::vec3* refractColor) const
+{
+	RTPipelineResources::MaterialConstants& material = *surface.Material;
+	glm::vec3 negWorldRayDirection = glm::normalize(-rayDirection);
+	glm::vec3 negLightDir = glm::normalize(-m_globalConstants.LightDir);
+	float ndv = glm::clamp(glm::dot(surface.Normal, negWorldRayDirection), 0.0001f, 1.0f);
+	float ndl = glm::clamp(glm::dot(surface.Normal, negLightDir), 0.0001f, 1.0f);
+
+	glm::vec3 specularColor = glm::vec3(0.0f);
+	glm::vec3 f = glm::vec3(0.0f);
+	if (ndv * ndl != 0.0f)
+	{
+		float reflectiveIndex = powf((IOR_AIR - material.IndexOfRefraction) / (IOR_AIR + material.IndexOfRefraction), 2.0f);
+		glm::vec3 halfVec = glm::normalize(negWorldRayDirection + negLightDir);
+		float a2 = powf(surface.Roughness, 2.0f);
+		float ndh = glm::clamp(glm::dot(surface.Normal, halfVec), 0.0001f, 1.0f);
+		float ldh = glm::dot(negLightDir, halfVec);
+
+		f = SchlickFresnel(glm::vec3(reflectiveIndex), ldh);
+		float d = GGXNormalDistribution(a2, ndh);
+		float g = SchlickMaskingTerm(a2, ndl, ndv);
+		specularColor = (d * g * f) / (4.0f * ldh);
+	}
+
+	float ks = glm::mix(0.0f, 1.0f - f.x, surface.Metallic);
+	float kd = 1.0f - ks;
+	glm::vec3 diffuse = glm::vec3(surface.Diffuse);
+	specularColor = specularColor * diffuse * ks;
+
+	glm::vec3 diffuseColor = glm::vec3(0.0f);
+	if (refractColor != nullptr)
+	{
+		diffuseColor = *refractColor;
+	}
+	else
+	{
+		diffuseColor = ndl * glm::vec3(material.m_color) * diffuse * kd;
+		//index 0 is skipped as in the shaders
+		int ambientOcclusionTexIndex = static_cast<int>(material.m_ambientOcclusionTexIndex);
+		if (ambientOcclusionTexIndex > 0)
+		{
+			diffuseColor = diffuseColor * glm::vec3(SampleTexture(ambientOcclusionTexIndex, surface.Uv, glm::vec4(1.0f)));
+		}
+	}
+	return diffuseColor + specularColor + ks * diffuse * reflectColor;
+}
+
+void CpuReferenceRenderer::ShadeDefault(const CpuRay& ray, const SurfaceData& surface, RayPayload& payload, uint64_t& rayCount)
+{
+	payload.HitColor = glm::vec3(1.0f);
+	glm::vec3 reflectColor = glm::vec3(0.0f);
+	if (payload.TraceDepth < MAX_TRACE_DEPTH)
+	{
+		payload.TraceDepth++;
+		TraceRay(surface.WorldPos, glm::reflect(ray.Direction, surface.Normal), SECONDARY_RAY_T_MIN, RAY_T_MAX, true, payload, rayCount);
+		payload.TraceDepth--;
+		reflectColor = payload.HitColor;
+	}
+
+	glm::vec3 resColor = ComputeLighting(surface, ray.Direction, reflectColor, nullptr);
+	if (TraceShadowRay(surface.WorldPos, rayCount))
+	{
+		resColor = resColor * SHADOW_ATTENUATION;
+	}
+	payload.HitColor = resColor;
+}
+
+void CpuReferenceRenderer::ShadeTransparent(const CpuRay& ray, const SurfaceData& surface, RayPayload& payload, uint64_t& rayCount)
+{
+	payload.HitColor = glm::vec3(1.0f);
+	glm::vec3 reflectColor = glm::vec3(0.0f);
+	if (payload.TraceDepth < MAX_TRACE_DEPTH)
+	{
+		payload.TraceDepth++;
+		TraceRay(surface.WorldPos, glm::reflect(ray.Direction, surface.Normal), SECONDARY_RAY_T_MIN, RAY_T_MAX, true, payload, rayCount);
+		payload.TraceDepth--;
+		reflectColor = payload.HitColor;
+	}
+
+	glm::vec3 resColor = ComputeLighting(surface, ray.Direction, reflectColor, nullptr);
+	if (TraceShadowRay(surface.WorldPos, rayCount))
+	{
+		resColor = resColor * SHADOW_ATTENUATION;
+	}
+
+	//without the continuation trace the color left in the payload is blended, same as the shader
+	if (payload.TraceDepth < MAX_TRACE_DEPTH)
+	{
+		payload.TraceDepth++;
+		TraceRay(surface.WorldPos, ray.Direction, SECONDARY_RAY_T_MIN, RAY_T_MAX, true, payload, rayCount);
+		payload.TraceDepth--;
+	}
+	glm::vec3 transparentColor = payload.HitColor;
+	payload.HitColor = glm::mix(transparentColor, resColor, surface.Material->m_color.w * surface.Diffuse.w);
+}
+
+void CpuReferenceRenderer::ShadeRefract(const CpuRay& ray, const SurfaceData& surface, RayPayload& payload, uint64_t& rayCount)
+{
+	RTPipelineResources::MaterialConstants& material = *surface.Material;
+	glm::vec3 negWorldRayDirection = glm::normalize(-ray.Direction);
+
+	//front face
+	if (glm::dot(surface.VertexNormal, negWorldRayDirection) > 0.0f)
+	{
+		payload.HitColor = glm::vec3(1.0f);
+		glm::vec3 reflectColor = glm::vec3(0.0f);
+		if (payload.TraceDepth < MAX_TRACE_DEPTH)
+		{
+			payload.TraceDepth++;
+			TraceRay(surface.WorldPos, glm::reflect(ray.Direction, surface.Normal), SECONDARY_RAY_T_MIN, RAY_T_MAX, true, payload, rayCount);
+			payload.TraceDepth--;
+			reflectColor = payload.HitColor;
+		}
+
+		glm::vec3 refractColor = glm::vec3(0.0f);
+		if (payload.TraceDepth < MAX_REFRACT_TRACE_DEPTH)
+		{
+			glm::vec3 negLightDir = glm::normalize(-m_globalConstants.LightDir);
+			glm::vec3 halfVec = glm::normalize(negWorldRayDirection + negLightDir);
+			float ldh = glm::clamp(glm::dot(negLightDir, halfVec), 0.0001f, 1.0f);
+			float reflectiveIndex = powf((IOR_AIR - material.IndexOfRefraction) / (IOR_AIR + material.IndexOfRefraction), 2.0f);
+			float r = 1.0f - SchlickFresnel(glm::vec3(reflectiveIndex), ldh).x;
+
+			//total internal reflection gives no refracted ray, the payload color is kept
+			glm::vec3 refractDirection = glm::refract(ray.Direction, surface.Normal, payload.IndexOfRefraction / material.IndexOfRefraction);
+			payload.IndexOfRefraction = material.IndexOfRefraction;
+			if (glm::dot(refractDirection, refractDirection) > 0.0f)
+			{
+				payload.TraceDepth++;
+				TraceRay(surface.WorldPos, glm::normalize(refractDirection), SECONDARY_RAY_T_MIN, RAY_T_MAX, false, payload, rayCount);
+				payload.TraceDepth--;
+			}
+			refractColor = payload.HitColor * r;
+		}
+
+		glm::vec3 resColor = ComputeLighting(surface, ray.Direction, reflectColor, &refractColor);
+		if (TraceShadowRay(surface.WorldPos, rayCount))
+		{
+			resColor = resColor * SHADOW_ATTENUATION;
+		}
+		payload.HitColor = resColor;
+	}
+	//back face
+	else if (payload.TraceDepth < MAX_TRACE_DEPTH)
+	{
+		glm::vec3 refractDirection = glm::refract(ray.Direction, -surface.Normal, payload.IndexOfRefraction / IOR_AIR);
+		payload.IndexOfRefraction = IOR_AIR;
+		if (glm::dot(refractDirection, refractDirection) > 0.0f)
+		{
+			payload.TraceDepth++;
+			TraceRay(surface.WorldPos, glm::normalize(refractDirection), SECONDARY_RAY_T_MIN, RAY_T_MAX, false, payload, rayCount);
+			payload.TraceDepth--;
+		}
+	}
+}
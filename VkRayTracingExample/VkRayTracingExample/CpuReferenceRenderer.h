@@ -0,0 +1,117 @@
+#pragma once
+
+#include "CpuBvhTraversal.h"
+#include "RTPipelineResources.h"
+
+//rgba8 image sampled like the gpu samplers, bilinear on the base level
+class CpuTexture
+{
+public:
+	bool Load(const std::string& filePath);
+	void Unload();
+
+	glm::vec4 SampleRepeat(glm::vec2 uv) const;
+	glm::vec4 SampleClamp(glm::vec2 uv) const;
+
+	bool IsLoaded() const { return !m_pixels.empty(); }
+
+protected:
+	glm::vec4 Sample(glm::vec2 uv, bool isRepeat) const;
+	glm::vec4 Fetch(int x, int y, bool isRepeat) const;
+
+protected:
+	int m_width = 0;
+	int m_height = 0;
+	std::vector<uint8_t> m_pixels;
+};
+
+class CpuCubemap
+{
+public:
+	//faces in layer order, +x, -x, +y, -y, +z, -z
+	bool Load(std::vector<std::string>& filePaths);
+	void Unload();
+
+	glm::vec4 Sample(const glm::vec3& direction) const;
+
+protected:
+	CpuTexture m_faces[6];
+};
+
+//renders the uploaded scene on cpu with the shading of the closest hit shaders, reference for gpu output
+class CpuReferenceRenderer
+{
+public:
+	//scene is copied from the host side of the pipeline resources, call after the resources are updated
+	bool Initialize(RTPipelineResources* pipelineResources, SimpleCubmapTexture* envCubemap, WorkerThreadPool* workerPool = nullptr);
+	void Destroy();
+
+	//image rows are tiled and the tiles are taken by the worker pool and the calling thread
+	bool Render(uint32_t width, uint32_t height, std::vector<uint8_t>& outPixels, WorkerThreadPool* workerPool = nullptr);
+
+protected:
+	//same as RayPayloadData of the shaders, shared by the nested traces
+	struct RayPayload
+	{
+		glm::vec3 HitColor = glm::vec3(0.0f);
+		uint32_t TraceDepth = 0;
+		float IndexOfRefraction = 1.0f;
+	};
+
+	struct TriangleSource
+	{
+		uint32_t InstanceIndex = 0;
+		uint32_t GeometryTableIndex = 0;
+		uint32_t PrimitiveIndex = 0;
+		//winding is swapped for mirrored instances, so barycentrics are swapped back
+		bool IsFlipped = false;
+	};
+
+	struct SurfaceData
+	{
+		glm::vec3 WorldPos = glm::vec3(0.0f);
+		glm::vec3 VertexNormal = glm::vec3(0.0f);
+		glm::vec3 Normal = glm::vec3(0.0f);
+		glm::vec2 Uv = glm::vec2(0.0f);
+		glm::vec4 Diffuse = glm::vec4(1.0f);
+		float Roughness = 1.0f;
+		float Metallic = 0.0f;
+		RTPipelineResources::MaterialConstants* Material = nullptr;
+	};
+
+	void RenderTile(uint32_t tileIndex, uint32_t width, uint32_t height, std::vector<uint8_t>& outPixels, uint64_t& rayCount);
+	glm::vec3 RenderPixel(uint32_t x, uint32_t y, uint32_t width, uint32_t height, uint64_t& rayCount);
+
+	void TraceRay(const glm::vec3& origin, const glm::vec3& direction, float tMin, float tMax, bool cullBackFacing, RayPayload& payload, uint64_t& rayCount);
+	bool TraceShadowRay(const glm::vec3& origin, uint64_t& rayCount);
+
+	void GetSurfaceData(const CpuRay& ray, const CpuRayHit& hit, SurfaceData& outSurface);
+	glm::vec4 SampleTexture(int textureIndex, const glm::vec2& uv, const glm::vec4& fallback) const;
+	glm::vec3 ComputeLighting(const SurfaceData& surface, const glm::vec3& rayDirection, const glm::vec3& reflectColor, const glm::vec3* refractColor) const;
+
+	//Hit_Default.rchit, Hit_Transparent.rchit and Hit_Refract.rchit
+	void ShadeDefault(const CpuRay& ray, const SurfaceData& surface, RayPayload& payload, uint64_t& rayCount);
+	void ShadeTransparent(const CpuRay& ray, const SurfaceData& surface, RayPayload& payload, uint64_t& rayCount);
+	void ShadeRefract(const CpuRay& ray, const SurfaceData& surface, RayPayload& payload, uint64_t& rayCount);
+
+protected:
+	static const uint32_t TILE_SIZE = 16;
+	//same as RayGen.rgen
+	static const uint32_t NUM_SAMPLES = 8;
+
+	std::vector<RTPipelineResources::InstanceConstants> m_instanceConstants;
+	std::vector<RTPipelineResources::GeometryConstants> m_geometryConstants;
+	std::vector<RTPipelineResources::MaterialConstants> m_materialConstants;
+	GlobalConstants m_globalConstants = {};
+
+	//indexed by geometry id like the vertex and index buffer arrays of the shaders
+	std::vector<std::vector<DefaultVertex>> m_vertexBuffers;
+	std::vector<std::vector<uint32_t>> m_indexBuffers;
+	std::vector<CpuTexture> m_textures;
+	CpuCubemap m_envCubemap;
+
+	//instances are flattened into one world space bvh
+	std::vector<TriangleSource> m_triangleSources;
+	CpuBvh m_bvh;
+	CpuBvhTraversal m_traversal;
+};
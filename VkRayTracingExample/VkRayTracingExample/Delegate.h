@@ -0,0 +1,235 @@
+#pragma once
+
+#include <cstddef>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+#include "Commands.h"
+#include "SlotMap.h"
+
+//captures up to this size are stored inside the delegate, larger ones are allocated on the heap
+#define DELEGATE_INLINE_STORAGE_SIZE 32
+
+enum class EDelegateOp
+{
+	DELEGATE_OP_COPY,
+	DELEGATE_OP_MOVE,
+	DELEGATE_OP_DESTROY
+};
+
+template <typename SignatureType>
+class TDelegate;
+
+//copyable callable like std::function, but small lambdas never allocate
+template <typename RetType, typename... ArgTypes>
+class TDelegate<RetType(ArgTypes...)>
+{
+public:
+	TDelegate() {}
+	template <typename FunctionType, typename = typename std::enable_if<!std::is_same<typename std::decay<FunctionType>::type, TDelegate>::value>::type>
+	TDelegate(FunctionType&& func)
+	{
+		Bind(std::forward<FunctionType>(func));
+	}
+	TDelegate(const TDelegate& other)
+	{
+		CopyFrom(other);
+	}
+	TDelegate(TDelegate&& other)
+	{
+		MoveFrom(other);
+	}
+	~TDelegate()
+	{
+		Unbind();
+	}
+
+	TDelegate& operator=(const TDelegate& other)
+	{
+		if (this != &other)
+		{
+			Unbind();
+			CopyFrom(other);
+		}
+		return *this;
+	}
+	TDelegate& operator=(TDelegate&& other)
+	{
+		if (this != &other)
+		{
+			Unbind();
+			MoveFrom(other);
+		}
+		return *this;
+	}
+
+public:
+	template <typename FunctionType>
+	void Bind(FunctionType&& func)
+	{
+		typedef typename std::decay<FunctionType>::type StoredType;
+		Unbind();
+		Construct<StoredType>(std::forward<FunctionType>(func), std::integral_constant<bool, IsInline<StoredType>()>());
+	}
+	void Unbind()
+	{
+		if (m_manage != nullptr)
+		{
+			m_manage(EDelegateOp::DELEGATE_OP_DESTROY, &m_storage, nullptr);
+		}
+		m_invoke = nullptr;
+		m_manage = nullptr;
+	}
+	bool IsBinded() const { return m_invoke != nullptr; }
+
+	RetType operator()(ArgTypes... args) const
+	{
+		Assert(m_invoke != nullptr, "delegate is not binded");
+		return m_invoke(const_cast<void*>(static_cast<const void*>(&m_storage)), std::forward<ArgTypes>(args)...);
+	}
+
+protected:
+	template <typename StoredType>
+	static constexpr bool IsInline()
+	{
+		return sizeof(StoredType) <= DELEGATE_INLINE_STORAGE_SIZE &&
+			   alignof(StoredType) <= alignof(StorageType) &&
+			   std::is_nothrow_move_constructible<StoredType>::value;
+	}
+
+	template <typename StoredType, typename FunctionType>
+	void Construct(FunctionType&& func, std::true_type)
+	{
+		new (&m_storage) StoredType(std::forward<FunctionType>(func));
+		m_invoke = &InvokeInline<StoredType>;
+		m_manage = &ManageInline<StoredType>;
+	}
+	template <typename StoredType, typename FunctionType>
+	void Construct(FunctionType&& func, std::false_type)
+	{
+		*reinterpret_cast<StoredType**>(&m_storage) = new StoredType(std::forward<FunctionType>(func));
+		m_invoke = &InvokeHeap<StoredType>;
+		m_manage = &ManageHeap<StoredType>;
+	}
+
+	template <typename StoredType>
+	static RetType InvokeInline(void* storage, ArgTypes... args)
+	{
+		return (*static_cast<StoredType*>(storage))(std::forward<ArgTypes>(args)...);
+	}
+	template <typename StoredType>
+	static RetType InvokeHeap(void* storage, ArgTypes... args)
+	{
+		return (**static_cast<StoredType**>(storage))(std::forward<ArgTypes>(args)...);
+	}
+
+	//src is only used by copy and move, a moved inline capture is destroyed in src
+	template <typename StoredType>
+	static void ManageInline(EDelegateOp op, void* dst, void* src)
+	{
+		switch (op)
+		{
+		case EDelegateOp::DELEGATE_OP_COPY:
+			new (dst) StoredType(*static_cast<const StoredType*>(src));
+			break;
+		case EDelegateOp::DELEGATE_OP_MOVE:
+			new (dst) StoredType(std::move(*static_cast<StoredType*>(src)));
+			static_cast<StoredType*>(src)->~StoredType();
+			break;
+		case EDelegateOp::DELEGATE_OP_DESTROY:
+			static_cast<StoredType*>(dst)->~StoredType();
+			break;
+		}
+	}
+	template <typename StoredType>
+	static void ManageHeap(EDelegateOp op, void* dst, void* src)
+	{
+		switch (op)
+		{
+		case EDelegateOp::DELEGATE_OP_COPY:
+			*static_cast<StoredType**>(dst) = new StoredType(**static_cast<StoredType**>(src));
+			break;
+		case EDelegateOp::DELEGATE_OP_MOVE:
+			*static_cast<StoredType**>(dst) = *static_cast<StoredType**>(src);
+			*static_cast<StoredType**>(src) = nullptr;
+			break;
+		case EDelegateOp::DELEGATE_OP_DESTROY:
+			delete *static_cast<StoredType**>(dst);
+			break;
+		}
+	}
+
+	void CopyFrom(const TDelegate& other)
+	{
+		if (other.m_manage != nullptr)
+		{
+			other.m_manage(EDelegateOp::DELEGATE_OP_COPY, &m_storage, const_cast<void*>(static_cast<const void*>(&other.m_storage)));
+		}
+		m_invoke = other.m_invoke;
+		m_manage = other.m_manage;
+	}
+	void MoveFrom(TDelegate& other)
+	{
+		if (other.m_manage != nullptr)
+		{
+			other.m_manage(EDelegateOp::DELEGATE_OP_MOVE, &m_storage, &other.m_storage);
+		}
+		m_invoke = other.m_invoke;
+		m_manage = other.m_manage;
+		other.m_invoke = nullptr;
+		other.m_manage = nullptr;
+	}
+
+private:
+	typedef typename std::aligned_storage<DELEGATE_INLINE_STORAGE_SIZE, alignof(std::max_align_t)>::type StorageType;
+
+	StorageType m_storage;
+	RetType (*m_invoke)(void* storage, ArgTypes... args) = nullptr;
+	void (*m_manage)(EDelegateOp op, void* dst, void* src) = nullptr;
+};
+
+template <typename SignatureType>
+class TDelegateList;
+
+//replaces the lambda command lists for event listeners, the delegates are invoked from one contiguous array
+//a removed delegate is replaced by the last one, so the invocation order is not the order of Add
+//delegates must not be added or removed by a delegate of the same list while it is executed
+template <typename... ArgTypes>
+class TDelegateList<void(ArgTypes...)>
+{
+public:
+	typedef TDelegate<void(ArgTypes...)> DelegateType;
+
+	template <typename FunctionType>
+	CommandHandle Add(FunctionType&& func)
+	{
+		return PackSlotHandle(m_delegates.Insert(DelegateType(std::forward<FunctionType>(func))));
+	}
+	//O(1), stale and invalid handles are ignored, INVALID_COMMAND_HANDLE never matches a slot
+	void Remove(CommandHandle handle)
+	{
+		m_delegates.SwapRemove(UnpackSlotHandle(handle));
+	}
+	void Exec(ArgTypes... args)
+	{
+		DelegateType* delegates = m_delegates.GetData();
+		uint32_t delegateCount = m_delegates.GetCount();
+		for (uint32_t i = 0; i < delegateCount; i++)
+		{
+			delegates[i](args...);
+		}
+	}
+	void Clear()
+	{
+		m_delegates.Clear();
+	}
+	void Reserve(uint32_t count)
+	{
+		m_delegates.Reserve(count);
+	}
+	uint32_t GetCommandCount() { return m_delegates.GetCount(); }
+
+private:
+	TSlotMap<DelegateType> m_delegates;
+};
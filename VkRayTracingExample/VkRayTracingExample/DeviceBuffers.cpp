@@ -106,7 +106,7 @@ bool BufferData::CreateBuffer()
 	bufferCreateInfo.flags = 0;
 	bufferCreateInfo.size = m_size;
 	bufferCreateInfo.usage = m_bufferUsage;
-	bufferCreateInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+	gVkDeviceRes.SetBufferSharingMode(bufferCreateInfo);
 
 	VkResult res = vkCreateBuffer(gLogicalDevice, &bufferCreateInfo, nullptr, &m_buffer);
 	if (res != VkResult::VK_SUCCESS)
@@ -153,9 +153,9 @@ bool BufferData::AllocateMemory()
 	return true;
 }
 
-bool VertexBuffer::Initialzie(std::vector<DefaultVertex>& verts)
+bool VertexBuffer::Initialzie(const DefaultVertex* verts, uint32_t vertexCount)
 {
-	m_vertexCount = static_cast<uint32_t>(verts.size());
+	m_vertexCount = vertexCount;
 	m_stride = sizeof(DefaultVertex);
 	m_byteSize = m_vertexCount * m_stride;
 
@@ -263,7 +263,7 @@ bool VertexBuffer::AllocateMemory()
 	return true;
 }
 
-bool VertexBuffer::UploadData(std::vector<DefaultVertex>& verts)
+bool VertexBuffer::UploadData(const DefaultVertex* verts)
 {
 	if (m_buffer == VK_NULL_HANDLE && m_memory == VK_NULL_HANDLE)
 	{
@@ -274,7 +274,7 @@ bool VertexBuffer::UploadData(std::vector<DefaultVertex>& verts)
 	VkResult res = vkMapMemory(gLogicalDevice, m_memory, 0, m_byteSize, 0, (void**)&data);
 	if (res == VkResult::VK_SUCCESS)
 	{
-		memcpy(data, verts.data(), m_byteSize);
+		memcpy(data, verts, m_byteSize);
 		vkUnmapMemory(gLogicalDevice, m_memory);
 	}
 	else
@@ -297,9 +297,9 @@ void VertexBuffer::Destroy()
 	}
 }
 
-bool AsVertexBuffer::Initialzie(std::vector<DefaultVertex>& verts)
+bool AsVertexBuffer::Initialzie(const DefaultVertex* verts, uint32_t vertexCount)
 {
-	if (!VertexBuffer::Initialzie(verts))
+	if (!VertexBuffer::Initialzie(verts, vertexCount))
 	{
 		return false;
 	}
@@ -335,6 +335,7 @@ bool AsVertexBuffer::CreateBuffer()
 
 	VkBufferCreateInfo bufferCreateInfo = stagingBuifferCreateInfo;
 	bufferCreateInfo.usage = VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT;
+	gVkDeviceRes.SetBufferSharingMode(bufferCreateInfo);
 	
 	if (vkCreateBuffer(gLogicalDevice, &stagingBuifferCreateInfo, nullptr, &m_stagingBuffer) != VkResult::VK_SUCCESS)
 	{
@@ -416,7 +417,7 @@ bool AsVertexBuffer::AllocateMemory()
 	return true;
 }
 
-bool AsVertexBuffer::UploadData(std::vector<DefaultVertex>& verts)
+bool AsVertexBuffer::UploadData(const DefaultVertex* verts)
 {
 	if (m_buffer == VK_NULL_HANDLE || m_memory == VK_NULL_HANDLE || m_stagingBuffer == VK_NULL_HANDLE || m_stagingMemory == VK_NULL_HANDLE)
 	{
@@ -427,7 +428,7 @@ bool AsVertexBuffer::UploadData(std::vector<DefaultVertex>& verts)
 	VkResult res = vkMapMemory(gLogicalDevice, m_stagingMemory, 0, m_byteSize, 0, (void**)&data);
 	if (res == VkResult::VK_SUCCESS)
 	{
-		memcpy(data, verts.data(), m_byteSize);
+		memcpy(data, verts, m_byteSize);
 		vkUnmapMemory(gLogicalDevice, m_stagingMemory);
 	}
 	else
@@ -446,9 +447,9 @@ bool AsVertexBuffer::UploadData(std::vector<DefaultVertex>& verts)
 	return true;
 }
 
-bool IndexBuffer::Initialzie(std::vector<uint32_t>& indices)
+bool IndexBuffer::Initialzie(const uint32_t* indices, uint32_t indexCount)
 {
-	m_indexCount = static_cast<uint32_t>(indices.size());
+	m_indexCount = indexCount;
 	m_byteSize = m_indexCount * sizeof(uint32_t);
 
 	if (!CreateBuffer() || !AllocateMemory())
@@ -525,7 +526,7 @@ bool IndexBuffer::AllocateMemory()
 	return true;
 }
 
-bool IndexBuffer::UploadData(std::vector<uint32_t>& indices)
+bool IndexBuffer::UploadData(const uint32_t* indices)
 {
 	if (m_buffer == VK_NULL_HANDLE || m_memory == VK_NULL_HANDLE)
 	{
@@ -536,7 +537,7 @@ bool IndexBuffer::UploadData(std::vector<uint32_t>& indices)
 	VkResult res = vkMapMemory(gLogicalDevice, m_memory, 0, m_byteSize, 0, (void**)&data);
 	if (res == VkResult::VK_SUCCESS)
 	{
-		memcpy(data, indices.data(), m_byteSize);
+		memcpy(data, indices, m_byteSize);
 
 		vkUnmapMemory(gLogicalDevice, m_memory);
 	}
@@ -560,9 +561,9 @@ void IndexBuffer::Destroy()
 	}
 }
 
-bool AsIndexBuffer::Initialzie(std::vector<uint32_t>& indices)
+bool AsIndexBuffer::Initialzie(const uint32_t* indices, uint32_t indexCount)
 {
-	if (!IndexBuffer::Initialzie(indices))
+	if (!IndexBuffer::Initialzie(indices, indexCount))
 	{
 		return false;
 	}
@@ -606,7 +607,7 @@ bool AsIndexBuffer::CreateBuffer()
 	deviceBufferCreateInfo.flags = 0;
 	deviceBufferCreateInfo.usage = VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT;
 	deviceBufferCreateInfo.size = sizeof(uint32_t) * m_indexCount;
-	deviceBufferCreateInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+	gVkDeviceRes.SetBufferSharingMode(deviceBufferCreateInfo);
 
 	if (vkCreateBuffer(gLogicalDevice, &deviceBufferCreateInfo, nullptr, &m_buffer) != VkResult::VK_SUCCESS)
 	{
@@ -681,7 +682,7 @@ bool AsIndexBuffer::AllocateMemory()
 	return true;
 }
 
-bool AsIndexBuffer::UploadData(std::vector<uint32_t>& indices)
+bool AsIndexBuffer::UploadData(const uint32_t* indices)
 {
 	if (m_buffer == VK_NULL_HANDLE || m_stagingBuffer == VK_NULL_HANDLE || m_memory == VK_NULL_HANDLE || m_stagingMemory == VK_NULL_HANDLE)
 	{
@@ -692,7 +693,7 @@ bool AsIndexBuffer::UploadData(std::vector<uint32_t>& indices)
 	VkResult res = vkMapMemory(gLogicalDevice, m_stagingMemory, 0, m_byteSize, 0, (void**)&data);
 	if (res == VkResult::VK_SUCCESS)
 	{
-		memcpy(data, indices.data(), m_byteSize);
+		memcpy(data, indices, m_byteSize);
 
 		vkUnmapMemory(gLogicalDevice, m_stagingMemory);
 	}
@@ -722,6 +723,288 @@ bool RayTracingScratchBuffer::Initialize(uint32_t size, VkBufferUsageFlags buffe
 	return false;
 }
 
+bool RayTracingScratchArena::Reserve(VkDeviceSize size)
+{
+	if (m_scratchBuffer != nullptr && m_offset + size <= m_capacity)
+	{
+		return true;
+	}
+
+	if (m_scratchBuffer != nullptr)
+	{
+		m_retiredBuffers[m_frameIndex].push_back(m_scratchBuffer);
+		m_scratchBuffer = nullptr;
+	}
+
+	VkDeviceSize alignment = GetAlignedSize(1);
+	m_scratchBuffer = new RayTracingScratchBuffer();
+	if (!m_scratchBuffer->Initialize(static_cast<uint32_t>(size + alignment), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT))
+	{
+		REPORT(EReportType::REPORT_TYPE_ERROR, "Scratch arena create failed.");
+		delete m_scratchBuffer;
+		m_scratchBuffer = nullptr;
+		m_capacity = 0;
+		return false;
+	}
+
+	VkDeviceAddress bufferAddress = m_scratchBuffer->GetDeviceMemoryAddress();
+	m_baseAddress = (bufferAddress + alignment - 1) / alignment * alignment;
+	m_capacity = size;
+	m_offset = 0;
+
+	return true;
+}
+
+VkDeviceAddress RayTracingScratchArena::Allocate(VkDeviceSize size)
+{
+	VkDeviceSize alignedSize = GetAlignedSize(size);
+	if (m_scratchBuffer == nullptr || m_offset + alignedSize > m_capacity)
+	{
+		REPORT(EReportType::REPORT_TYPE_ERROR, "Scratch arena is not enough.");
+		return 0;
+	}
+
+	VkDeviceAddress address = m_baseAddress + m_offset;
+	m_offset += alignedSize;
+	return address;
+}
+
+void RayTracingScratchArena::BeginFrame(uint32_t frameIndex)
+{
+	if (frameIndex >= m_retiredBuffers.size())
+	{
+		return;
+	}
+
+	//builds recorded in the frame are completed on either queue, so nothing reads its buffers anymore
+	for (auto& cur : m_retiredBuffers[frameIndex])
+	{
+		cur->Destroy();
+		delete cur;
+	}
+	m_retiredBuffers[frameIndex].clear();
+	m_frameIndex = frameIndex;
+}
+
+void RayTracingScratchArena::ReleaseRetiredBuffers()
+{
+	for (uint32_t i = 0; i < m_retiredBuffers.size(); i++)
+	{
+		for (auto& cur : m_retiredBuffers[i])
+		{
+			cur->Destroy();
+			delete cur;
+		}
+		m_retiredBuffers[i].clear();
+	}
+}
+
+void RayTracingScratchArena::SetFrameCount(uint32_t frameCount)
+{
+	ReleaseRetiredBuffers();
+	m_retiredBuffers.resize(frameCount > 0 ? frameCount : 1);
+	m_frameIndex = 0;
+}
+
+void RayTracingScratchArena::Destroy()
+{
+	ReleaseRetiredBuffers();
+	if (m_scratchBuffer != nullptr)
+	{
+		m_scratchBuffer->Destroy();
+		delete m_scratchBuffer;
+		m_scratchBuffer = nullptr;
+	}
+	m_baseAddress = 0;
+	m_capacity = 0;
+	m_offset = 0;
+}
+
+VkDeviceSize RayTracingScratchArena::GetAlignedSize(VkDeviceSize size)
+{
+	VkDeviceSize alignment = gVkDeviceRes.GetPhysicalDeviceAccelerationStructureProperties().minAccelerationStructureScratchOffsetAlignment;
+	if (alignment == 0)
+	{
+		alignment = 1;
+	}
+	return (size + alignment - 1) / alignment * alignment;
+}
+
+bool AccelerationStructureMemoryPool::Allocate(VkDeviceSize size, AsMemoryRange& outRange)
+{
+	VkDeviceSize alignedSize = (size + AS_OFFSET_ALIGNMENT - 1) / AS_OFFSET_ALIGNMENT * AS_OFFSET_ALIGNMENT;
+	for (uint32_t i = 0; i < m_pages.size(); i++)
+	{
+		if (AllocateFromPage(i, alignedSize, outRange))
+		{
+			return true;
+		}
+	}
+
+	//structures larger than a page get their own page
+	uint32_t pageIndex = 0;
+	VkDeviceSize pageSize = alignedSize > PAGE_SIZE ? alignedSize : PAGE_SIZE;
+	if (!CreatePage(pageSize, pageIndex))
+	{
+		return false;
+	}
+	return AllocateFromPage(pageIndex, alignedSize, outRange);
+}
+
+void AccelerationStructureMemoryPool::Free(AsMemoryRange& range, VkAccelerationStructureKHR accelerationStructure)
+{
+	if (!range.IsValid() && accelerationStructure == VK_NULL_HANDLE)
+	{
+		return;
+	}
+
+	RetiredRange retiredRange = {};
+	retiredRange.Range = range;
+	retiredRange.AccelerationStructure = accelerationStructure;
+	range = {};
+
+	if (m_retiredRanges.empty())
+	{
+		Release(retiredRange);
+		return;
+	}
+	m_retiredRanges[m_frameIndex].push_back(retiredRange);
+}
+
+void AccelerationStructureMemoryPool::BeginFrame(uint32_t frameIndex)
+{
+	if (frameIndex >= m_retiredRanges.size())
+	{
+		return;
+	}
+
+	//submits of the frame and of the frames before it are completed, so nothing reads its ranges anymore
+	ReleaseRetiredRanges(frameIndex);
+	m_frameIndex = frameIndex;
+}
+
+void AccelerationStructureMemoryPool::SetFrameCount(uint32_t frameCount)
+{
+	for (uint32_t i = 0; i < m_retiredRanges.size(); i++)
+	{
+		ReleaseRetiredRanges(i);
+	}
+	m_retiredRanges.resize(frameCount);
+	m_frameIndex = 0;
+}
+
+void AccelerationStructureMemoryPool::ReleaseRetiredRanges(uint32_t frameIndex)
+{
+	for (auto& cur : m_retiredRanges[frameIndex])
+	{
+		Release(cur);
+	}
+	m_retiredRanges[frameIndex].clear();
+}
+
+void AccelerationStructureMemoryPool::Release(RetiredRange& retiredRange)
+{
+	if (retiredRange.AccelerationStructure != VK_NULL_HANDLE)
+	{
+		vkDestroyAccelerationStructureKHR(gLogicalDevice, retiredRange.AccelerationStructure, nullptr);
+		retiredRange.AccelerationStructure = VK_NULL_HANDLE;
+	}
+
+	AsMemoryRange& range = retiredRange.Range;
+	if (!range.IsValid() || range.PageIndex >= m_pages.size())
+	{
+		return;
+	}
+
+	Page* page = m_pages[range.PageIndex];
+	VkDeviceSize offset = range.Offset;
+	VkDeviceSize size = range.Size;
+	m_allocatedSize -= size;
+
+	//merge with next free range
+	auto iterNext = page->FreeRanges.lower_bound(offset);
+	if (iterNext != page->FreeRanges.end() && offset + size == iterNext->first)
+	{
+		size += iterNext->second;
+		iterNext = page->FreeRanges.erase(iterNext);
+	}
+	//merge with previous free range
+	if (iterNext != page->FreeRanges.begin())
+	{
+		auto iterPrev = std::prev(iterNext);
+		if (iterPrev->first + iterPrev->second == offset)
+		{
+			offset = iterPrev->first;
+			size += iterPrev->second;
+			page->FreeRanges.erase(iterPrev);
+		}
+	}
+	page->FreeRanges[offset] = size;
+
+	//pages are kept until destroy
+	range = {};
+}
+
+void AccelerationStructureMemoryPool::Destroy()
+{
+	//device is idle on destroy, retired structures are destroyed before their pages
+	for (uint32_t i = 0; i < m_retiredRanges.size(); i++)
+	{
+		ReleaseRetiredRanges(i);
+	}
+	m_frameIndex = 0;
+	for (auto& cur : m_pages)
+	{
+		cur->Buffer.Destroy();
+		delete cur;
+	}
+	m_pages.clear();
+	m_allocatedSize = 0;
+}
+
+bool AccelerationStructureMemoryPool::AllocateFromPage(uint32_t pageIndex, VkDeviceSize size, AsMemoryRange& outRange)
+{
+	Page* page = m_pages[pageIndex];
+	for (auto iter = page->FreeRanges.begin(); iter != page->FreeRanges.end(); iter++)
+	{
+		if (iter->second >= size)
+		{
+			VkDeviceSize offset = iter->first;
+			VkDeviceSize remainSize = iter->second - size;
+			page->FreeRanges.erase(iter);
+			if (remainSize > 0)
+			{
+				page->FreeRanges[offset + size] = remainSize;
+			}
+
+			outRange.Buffer = page->Buffer.GetBuffer();
+			outRange.Offset = offset;
+			outRange.Size = size;
+			outRange.PageIndex = pageIndex;
+			m_allocatedSize += size;
+			return true;
+		}
+	}
+	return false;
+}
+
+bool AccelerationStructureMemoryPool::CreatePage(VkDeviceSize size, uint32_t& outPageIndex)
+{
+	Page* page = new Page();
+	if (!page->Buffer.Initialize(static_cast<uint32_t>(size), VK_BUFFER_USAGE_ACCELERATION_STRUCTURE_STORAGE_BIT_KHR | VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT, m_memoryProperty))
+	{
+		REPORT(EReportType::REPORT_TYPE_ERROR, "Acceleration structure memory page create failed.");
+		delete page;
+		return false;
+	}
+	page->Size = size;
+	page->FreeRanges[0] = size;
+
+	m_pages.push_back(page);
+	outPageIndex = static_cast<uint32_t>(m_pages.size() - 1);
+	return true;
+}
+
 /*
 bool RayTracingScratchBuffer::Initialize(VkAccelerationStructureKHR as)
 {
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <stdlib.h>
+#include <map>
 
 #include "VulkanDeviceResources.h"
 #include "CommandBuffers.h"
@@ -59,6 +60,13 @@ public:
 	virtual void UpdateResource(ResourceType& srcData, uint32_t index = 0);
 	virtual void UpdateResource(ResourceType& srcData, std::vector<uint32_t>& updateIndices);
 
+	//persistent mapping, memory stays mapped until Unmap or Destroy
+	bool Map();
+	void Unmap();
+	//ranges are counted in elements, non coherent memory needs explicit flush
+	void WriteMappedRange(ResourceType* srcData, uint32_t firstIndex, uint32_t count);
+	bool FlushMappedRanges(std::vector<BufferResouceRange>& ranges);
+
 public:
 	VkBuffer&				GetBuffer()			{ return m_buffer; }
 	VkDeviceMemory&			GetMemory()			{ return m_memory; }
@@ -67,12 +75,15 @@ public:
 	uint32_t				GetNumDatas()		{ return m_numDatas; }
 	uint32_t				GetByteSize()		{ return m_byteSize; }
 	VkDeviceAddress			GetDeviceMemoryAddress() { return m_memoryAddress; }
+	ResourceType*			GetMappedData()		{ return m_mappedData; }
 
 	bool IsAllocated() { return m_isAllocated; }
+	bool IsMapped() { return m_mappedData != nullptr; }
 
 protected:
 	VkBuffer				m_buffer = VK_NULL_HANDLE;
 	VkDeviceMemory			m_memory = VK_NULL_HANDLE;
+	ResourceType*			m_mappedData = nullptr;
 	VkDescriptorBufferInfo	m_bufferInfo = {};
 	VkBufferUsageFlags		m_bufferUsage = 0;
 	VkFlags					m_memRequirementsMask = 0;
@@ -148,6 +159,7 @@ bool StructuredBufferData<ResourceType>::Resize(uint32_t numDatas)
 template <typename ResourceType>
 void StructuredBufferData<ResourceType>::Destroy()
 {
+	Unmap();
 	if (m_buffer != VK_NULL_HANDLE)
 	{
 		vkDestroyBuffer(gLogicalDevice, m_buffer, nullptr);
@@ -170,9 +182,7 @@ bool StructuredBufferData<ResourceType>::CreateBuffer()
 	bufferCreateInfo.flags = 0;
 	bufferCreateInfo.size = static_cast<VkDeviceSize>(m_byteSize);
 	bufferCreateInfo.usage = m_bufferUsage;
-	bufferCreateInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
-	bufferCreateInfo.queueFamilyIndexCount = 0;
-	bufferCreateInfo.pQueueFamilyIndices = nullptr;
+	gVkDeviceRes.SetBufferSharingMode(bufferCreateInfo);
 
 	VkResult res = vkCreateBuffer(gLogicalDevice, &bufferCreateInfo, nullptr, &m_buffer);
 	if (res != VkResult::VK_SUCCESS)
@@ -302,6 +312,78 @@ void StructuredBufferData<ResourceType>::UpdateResource(ResourceType& srcData, s
 
 }
 
+template <typename ResourceType>
+bool StructuredBufferData<ResourceType>::Map()
+{
+	if (m_mappedData != nullptr)
+	{
+		return true;
+	}
+
+	VkResult res = vkMapMemory(gLogicalDevice, m_memory, 0, VK_WHOLE_SIZE, 0, (void**)&m_mappedData);
+	if (res != VkResult::VK_SUCCESS)
+	{
+		REPORT(EReportType::REPORT_TYPE_WARN, "Buffer memory map failed");
+		m_mappedData = nullptr;
+		return false;
+	}
+	return true;
+}
+
+template <typename ResourceType>
+void StructuredBufferData<ResourceType>::Unmap()
+{
+	if (m_mappedData != nullptr)
+	{
+		vkUnmapMemory(gLogicalDevice, m_memory);
+		m_mappedData = nullptr;
+	}
+}
+
+template <typename ResourceType>
+void StructuredBufferData<ResourceType>::WriteMappedRange(ResourceType* srcData, uint32_t firstIndex, uint32_t count)
+{
+	if (m_mappedData == nullptr || firstIndex + count > m_numDatas)
+	{
+		REPORT(EReportType::REPORT_TYPE_WARN, "An invalid range was requested.");
+		return;
+	}
+	memcpy(m_mappedData + firstIndex, srcData, static_cast<size_t>(m_stride) * count);
+}
+
+template <typename ResourceType>
+bool StructuredBufferData<ResourceType>::FlushMappedRanges(std::vector<BufferResouceRange>& ranges)
+{
+	if (m_mappedData == nullptr || ranges.empty())
+	{
+		return false;
+	}
+
+	//flush range must be aligned to nonCoherentAtomSize
+	VkDeviceSize atomSize = gVkDeviceRes.GetPhysicalDeviceProperty().limits.nonCoherentAtomSize;
+	if (atomSize == 0)
+	{
+		atomSize = 1;
+	}
+
+	std::vector<VkMappedMemoryRange> mappedRanges;
+	mappedRanges.reserve(ranges.size());
+	for (auto& cur : ranges)
+	{
+		VkDeviceSize begin = cur.Offset / atomSize * atomSize;
+		VkDeviceSize end = (cur.Offset + cur.Size + atomSize - 1) / atomSize * atomSize;
+
+		VkMappedMemoryRange mappedRange = {};
+		mappedRange.sType = VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE;
+		mappedRange.memory = m_memory;
+		mappedRange.offset = begin;
+		mappedRange.size = end >= m_byteSize ? VK_WHOLE_SIZE : end - begin;
+		mappedRanges.push_back(mappedRange);
+	}
+
+	return vkFlushMappedMemoryRanges(gLogicalDevice, static_cast<uint32_t>(mappedRanges.size()), mappedRanges.data()) == VkResult::VK_SUCCESS;
+}
+
 struct DefaultVertex
 {
 	glm::vec4 m_position;
@@ -314,13 +396,13 @@ struct DefaultVertex
 class VertexBuffer
 {
 public:
-	virtual bool Initialzie(std::vector<DefaultVertex>& verts);
+	virtual bool Initialzie(const DefaultVertex* verts, uint32_t vertexCount);
 	virtual void Destroy();
 
 protected:
 	virtual bool CreateBuffer();
 	virtual bool AllocateMemory();
-	virtual bool UploadData(std::vector<DefaultVertex>& verts);
+	virtual bool UploadData(const DefaultVertex* verts);
 
 public:
 
@@ -356,12 +438,12 @@ protected:
 class AsVertexBuffer : public VertexBuffer
 {
 public:
-	virtual bool Initialzie(std::vector<DefaultVertex>& verts);
+	virtual bool Initialzie(const DefaultVertex* verts, uint32_t vertexCount);
 	virtual void Destroy() override;
 protected:
 	virtual bool CreateBuffer();
 	virtual bool AllocateMemory();
-	virtual bool UploadData(std::vector<DefaultVertex>& verts) override;
+	virtual bool UploadData(const DefaultVertex* verts) override;
 public:
 	VkDeviceAddress GetDeviceAddress() { return m_deviceAddress; }
 protected:
@@ -378,13 +460,13 @@ public:
 	~IndexBuffer() {};
 
 public:
-	virtual bool Initialzie(std::vector<uint32_t>& indices);
+	virtual bool Initialzie(const uint32_t* indices, uint32_t indexCount);
 	virtual void Destroy();
 
 protected:
 	virtual bool CreateBuffer();
 	virtual bool AllocateMemory();
-	virtual bool UploadData(std::vector<uint32_t>& indices);
+	virtual bool UploadData(const uint32_t* indices);
 
 public:
 	VkBuffer& GetBuffer() { return m_buffer; }
@@ -410,13 +492,13 @@ protected:
 class AsIndexBuffer : public IndexBuffer
 {
 public:
-	virtual bool Initialzie(std::vector<uint32_t>& indices);
+	virtual bool Initialzie(const uint32_t* indices, uint32_t indexCount);
 	virtual void Destroy() override;
 
 protected:
 	virtual bool CreateBuffer() override;
 	virtual bool AllocateMemory() override;
-	virtual bool UploadData(std::vector<uint32_t>& indices) override;
+	virtual bool UploadData(const uint32_t* indices) override;
 public:
 	VkDeviceAddress GetDeviceAddress() { return m_deviceAddress; }
 protected:
@@ -434,4 +516,93 @@ public:
 	VkDeviceAddress GetDeviceMemoryAddress() { return m_memoryAddress; }
 private:
 	VkDeviceAddress	m_memoryAddress = 0;
+};
+
+//scratch memory shared by acceleration structure builds, every build of a batch gets its own aligned range
+//ranges are reused by the next batch, so each batch must end with a acceleration structure build barrier
+class RayTracingScratchArena
+{
+public:
+	bool Reserve(VkDeviceSize size);
+	void Reset() { m_offset = 0; }
+	VkDeviceAddress Allocate(VkDeviceSize size);
+	//buffers replaced by Reserve can be still in use by submitted commands, they are queued to the frame recording the build
+	//call after the fences of the frame are waited, buffers retired while the frame was recorded last time are destroyed
+	void BeginFrame(uint32_t frameIndex);
+	//destroys every retired buffer, call when no submitted build reads them
+	void ReleaseRetiredBuffers();
+	void SetFrameCount(uint32_t frameCount);
+	void Destroy();
+
+	VkDeviceSize GetAlignedSize(VkDeviceSize size);
+	VkDeviceSize GetCapacity() { return m_capacity; }
+
+private:
+	RayTracingScratchBuffer* m_scratchBuffer = nullptr;
+	std::vector<std::vector<RayTracingScratchBuffer*>> m_retiredBuffers = std::vector<std::vector<RayTracingScratchBuffer*>>(1);
+	uint32_t m_frameIndex = 0;
+
+	VkDeviceAddress m_baseAddress = 0;
+	VkDeviceSize m_capacity = 0;
+	VkDeviceSize m_offset = 0;
+};
+
+struct AsMemoryRange
+{
+	VkBuffer		Buffer		= VK_NULL_HANDLE;
+	VkDeviceSize	Offset		= 0;
+	VkDeviceSize	Size		= 0;
+	uint32_t		PageIndex	= UINT32_MAX;
+
+	bool IsValid() { return Buffer != VK_NULL_HANDLE; }
+};
+
+//places many acceleration structures in few large buffers to avoid one memory allocation per structure
+//freed ranges can be read by the frames in flight, they are queued to the frame and reused after its fence is signaled
+class AccelerationStructureMemoryPool
+{
+public:
+	bool Allocate(VkDeviceSize size, AsMemoryRange& outRange);
+	//the structure placed in the range is destroyed together when the range is released
+	void Free(AsMemoryRange& range, VkAccelerationStructureKHR accelerationStructure = VK_NULL_HANDLE);
+	//call after the fence of the frame is waited, ranges freed while the frame was recorded last time are released
+	void BeginFrame(uint32_t frameIndex);
+	void Destroy();
+
+	//ranges are released at once while the frame count is 0
+	void SetFrameCount(uint32_t frameCount);
+	VkDeviceSize GetAllocatedSize() { return m_allocatedSize; }
+	//structures built on host need host visible memory, set before the first allocation
+	void SetMemoryProperty(VkFlags memoryProperty) { m_memoryProperty = memoryProperty; }
+
+protected:
+	struct Page
+	{
+		BufferData Buffer = {};
+		VkDeviceSize Size = 0;
+		std::map<VkDeviceSize, VkDeviceSize> FreeRanges = {};
+	};
+
+	struct RetiredRange
+	{
+		AsMemoryRange Range = {};
+		VkAccelerationStructureKHR AccelerationStructure = VK_NULL_HANDLE;
+	};
+
+	bool AllocateFromPage(uint32_t pageIndex, VkDeviceSize size, AsMemoryRange& outRange);
+	bool CreatePage(VkDeviceSize size, uint32_t& outPageIndex);
+	void Release(RetiredRange& retiredRange);
+	void ReleaseRetiredRanges(uint32_t frameIndex);
+
+protected:
+	std::vector<Page*> m_pages;
+	//indexed by frame, filled while the frame is recorded
+	std::vector<std::vector<RetiredRange>> m_retiredRanges;
+	uint32_t m_frameIndex = 0;
+	VkDeviceSize m_allocatedSize = 0;
+	VkFlags m_memoryProperty = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT;
+
+	//acceleration structure offset must be multiple of 256
+	static const VkDeviceSize AS_OFFSET_ALIGNMENT = 256;
+	static const VkDeviceSize PAGE_SIZE = 32 * 1024 * 1024;
 };
\ No newline at end of file
@@ -0,0 +1,104 @@
+#pragma once
+
+#include <unordered_map>
+#include <vector>
+
+#include "Delegate.h"
+
+//events posted between two flushes are merged per key and dispatched once by Flush
+//without a merge function the last posted event of a key replaces the pending one
+template <typename KeyType, typename EventType>
+class TEventQueue
+{
+public:
+	//merge function receives the pending event and the newly posted one
+	template <typename MergeFunctionType>
+	void SetMergeFunction(MergeFunctionType&& func)
+	{
+		m_merge.Bind(std::forward<MergeFunctionType>(func));
+	}
+
+	void Post(const KeyType& key, const EventType& event)
+	{
+		auto iterFind = m_pendingIndices.find(key);
+		if (iterFind == m_pendingIndices.end())
+		{
+			m_pendingIndices.insert(std::make_pair(key, static_cast<uint32_t>(m_pendingKeys.size())));
+			m_pendingKeys.push_back(key);
+			m_pendingEvents.push_back(event);
+		}
+		else if (m_merge.IsBinded())
+		{
+			m_merge(m_pendingEvents[iterFind->second], event);
+		}
+		else
+		{
+			m_pendingEvents[iterFind->second] = event;
+		}
+	}
+
+	//drops the pending event of the key, for keys destroyed before the flush
+	void Cancel(const KeyType& key)
+	{
+		auto iterFind = m_pendingIndices.find(key);
+		if (iterFind == m_pendingIndices.end())
+		{
+			return;
+		}
+
+		//last pending event takes the place of the canceled one
+		uint32_t index = iterFind->second;
+		m_pendingIndices.erase(iterFind);
+		uint32_t lastIndex = static_cast<uint32_t>(m_pendingKeys.size()) - 1;
+		if (index != lastIndex)
+		{
+			m_pendingKeys[index] = m_pendingKeys[lastIndex];
+			m_pendingEvents[index] = m_pendingEvents[lastIndex];
+			m_pendingIndices[m_pendingKeys[index]] = index;
+		}
+		m_pendingKeys.pop_back();
+		m_pendingEvents.pop_back();
+	}
+
+	//events posted by the listeners are dispatched by the next flush
+	void Flush()
+	{
+		if (m_pendingKeys.empty())
+		{
+			return;
+		}
+
+		m_dispatchKeys.swap(m_pendingKeys);
+		m_dispatchEvents.swap(m_pendingEvents);
+		m_pendingIndices.clear();
+		for (uint32_t i = 0; i < m_dispatchKeys.size(); i++)
+		{
+			OnEvent.Exec(m_dispatchKeys[i], m_dispatchEvents[i]);
+		}
+		m_dispatchKeys.clear();
+		m_dispatchEvents.clear();
+	}
+
+	void Clear()
+	{
+		m_pendingIndices.clear();
+		m_pendingKeys.clear();
+		m_pendingEvents.clear();
+	}
+
+	uint32_t GetPendingCount() { return static_cast<uint32_t>(m_pendingKeys.size()); }
+
+	TDelegateList<void(const KeyType&, const EventType&)> OnEvent;
+
+private:
+	TDelegate<void(EventType&, const EventType&)> m_merge;
+
+	//position of the pending event of each key
+	std::unordered_map<KeyType, uint32_t> m_pendingIndices;
+	std::vector<KeyType> m_pendingKeys;
+	std::vector<EventType> m_pendingEvents;
+
+	//swapped with the pending events while they are dispatched, kept to reuse the allocations
+	std::vector<KeyType> m_dispatchKeys;
+	std::vector<EventType> m_dispatchEvents;
+};
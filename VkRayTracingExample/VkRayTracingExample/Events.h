@@ -114,6 +114,8 @@ struct MouseEvent : public EventBase
 
 	int m_dx = 0;
 	int m_dy = 0;
+	//wheel notches, positive when rolled up, summed like the deltas when events are merged
+	int m_wheelDelta = 0;
 
 	int m_posX = 0;
 	int m_posY = 0;
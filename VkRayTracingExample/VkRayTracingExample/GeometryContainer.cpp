@@ -9,11 +9,7 @@ SimpleGeometry* GeometryContainer::CreateGeometry(std::string& fbxFilePath)
 	auto iterKeyFinded = m_geomKeyTable.find(fbxFilePath);
 	if(iterKeyFinded != m_geomKeyTable.end())
 	{
-		auto iterGeomFinded = m_geomDatas.find(iterKeyFinded->second);
-		if (iterGeomFinded != m_geomDatas.end())
-		{
-			geomData = iterGeomFinded->second;
-		}
+		geomData = m_geomDatas.Find(iterKeyFinded->second);
 	}
 
 	//ε Ǿ ʴٸ εѴ
@@ -41,22 +37,17 @@ int GeometryContainer::GetMeshBindIndex(SimpleMeshData* meshData)
 
 int GeometryContainer::GetMeshBindIndexFromUID(UID uid)
 {
-	auto iterFind = m_meshDatas.find(uid);
-	if (iterFind != m_meshDatas.end())
-	{
-		return static_cast<int>(std::distance(m_meshDatas.begin(), iterFind));
-	}
-	return INVALID_INDEX_INT;
+	return m_meshDatas.GetIndex(uid);
 }
 
 void GeometryContainer::RemoveUnusedGeometries()
 {
 	std::vector<SimpleGeometry*> m_removeList;
-	for (auto& cur : m_geomDatas)
+	for (SimpleGeometry* cur : m_geomDatas)
 	{
-		if (cur.second->GetRefCount() == 0)
+		if (cur->GetRefCount() == 0)
 		{
-			m_removeList.push_back(cur.second);
+			m_removeList.push_back(cur);
 		}
 	}
 
@@ -68,50 +59,33 @@ void GeometryContainer::RemoveUnusedGeometries()
 
 void GeometryContainer::Clear()
 {
-	for (auto& cur : m_geomDatas)
+	for (SimpleGeometry* cur : m_geomDatas)
 	{
-		if (cur.second->GetRefCount() == 0)
+		if (cur->GetRefCount() == 0)
 		{
-			if (cur.second != nullptr)
+			if (cur != nullptr)
 			{
-				cur.second->Unload();
-				delete cur.second;
+				cur->Unload();
+				delete cur;
 			}
 		}
 	}
-	m_geomDatas.clear();
+	m_geomDatas.Clear();
 }
 
 SimpleGeometry* GeometryContainer::GetGeometry(uint32_t index)
 {
-	if (index < m_geomDatas.size())
-	{
-		auto pos = m_geomDatas.begin();
-		std::advance(pos, index);
-		return pos->second;
-	}
-	return nullptr;
+	return m_geomDatas.GetAt(index);
 }
 
 SimpleMeshData* GeometryContainer::GetMesh(uint32_t index)
 {
-	if (index < m_meshDatas.size())
-	{
-		auto pos = m_meshDatas.begin();
-		std::advance(pos, index);
-		return pos->second;
-	}
-	return nullptr;
+	return m_meshDatas.GetAt(index);
 }
 
 SimpleMeshData* GeometryContainer::GetMeshFromUID(UID uid)
 {
-	auto iterFind = m_meshDatas.find(uid);
-	if (iterFind != m_meshDatas.end())
-	{
-		return iterFind->second;
-	}
-	return nullptr;
+	return m_meshDatas.Find(uid);
 }
 
 SimpleGeometry* GeometryContainer::LoadGeometry(std::string& filePath)
@@ -119,7 +93,7 @@ SimpleGeometry* GeometryContainer::LoadGeometry(std::string& filePath)
 	SimpleGeometry* geometry = new SimpleGeometry();
 	geometry->Load(filePath);
 	UID uid = geometry->GetUID();
-	m_geomDatas.insert(std::make_pair(uid, geometry));
+	m_geomDatas.Insert(geometry);
 	m_geomKeyTable.insert(std::make_pair(filePath, uid));
 	return geometry;
 }
@@ -127,15 +101,10 @@ SimpleGeometry* GeometryContainer::LoadGeometry(std::string& filePath)
 void GeometryContainer::UnloadGeometry(SimpleGeometry* geomData)
 {
 	m_geomKeyTable.erase(geomData->GetSrcFilePath());
-	auto iterFind = m_geomDatas.find(geomData->GetUID());
-	if (iterFind != m_geomDatas.end())
+	if (m_geomDatas.Remove(geomData->GetUID()) != INVALID_INDEX_INT)
 	{
-		if (iterFind->second != nullptr)
-		{
-			iterFind->second->Unload();
-			delete iterFind->second;
-		}
-		m_geomDatas.erase(iterFind);
+		geomData->Unload();
+		delete geomData;
 	}
 }
 
@@ -143,25 +112,32 @@ SimpleMeshData* GeometryContainer::LoadMesh(FbxGeometryData& fbxGeomData)
 {
 	SimpleMeshData* meshData = new SimpleMeshData();
 	meshData->Load(fbxGeomData);
-	m_meshDatas.insert(std::make_pair(meshData->GetUID(), meshData));
+	m_meshDatas.Insert(meshData);
+
+	OnMeshLoaded.Exec(m_meshDatas.GetCount() - 1);
+
+	return meshData;
+}
 
-	OnMeshLoaded.Exec(GetMeshBindIndex(meshData));
+SimpleMeshData* GeometryContainer::LoadMesh(MeshCache& meshCache, uint32_t meshIndex)
+{
+	SimpleMeshData* meshData = new SimpleMeshData();
+	meshData->Load(meshCache, meshIndex);
+	m_meshDatas.Insert(meshData);
+
+	OnMeshLoaded.Exec(m_meshDatas.GetCount() - 1);
 
 	return meshData;
 }
 
 void GeometryContainer::UnloadMesh(SimpleMeshData* geomData)
 {
-	auto iterFind = m_meshDatas.find(geomData->GetUID());
-	if (iterFind != m_meshDatas.end())
+	//meshes behind the removed one move down by one, same as the erase of the listeners
+	int removeIndex = m_meshDatas.Remove(geomData->GetUID());
+	if (removeIndex != INVALID_INDEX_INT)
 	{
-		uint32_t removeIndex = GetMeshBindIndex(geomData);
-		if (iterFind->second != nullptr)
-		{
-			iterFind->second->Unload();
-			delete iterFind->second;
-			m_meshDatas.erase(iterFind);
-		}
-		OnMeshUnloaded.Exec(removeIndex);
+		geomData->Unload();
+		delete geomData;
+		OnMeshUnloaded.Exec(static_cast<uint32_t>(removeIndex));
 	}
 }
\ No newline at end of file
@@ -6,7 +6,8 @@
 #include "DeviceBuffers.h"
 #include "Singleton.h"
 #include "SimpleGeometry.h"
-#include "Commands.h"
+#include "Delegate.h"
+#include "SlotMap.h"
 
 class GeometryContainer : public TSingleton<GeometryContainer>
 {
@@ -25,10 +26,10 @@ public:
 	void Clear();
 
 public:
-	uint32_t GetGeometryCount() { return static_cast<uint32_t>(m_geomDatas.size()); }
+	uint32_t GetGeometryCount() { return m_geomDatas.GetCount(); }
 	SimpleGeometry* GetGeometry(uint32_t index);
 
-	uint32_t GetMeshCount() { return static_cast<uint32_t>(m_meshDatas.size()); }
+	uint32_t GetMeshCount() { return m_meshDatas.GetCount(); }
 	SimpleMeshData* GetMesh(uint32_t index);
 	SimpleMeshData* GetMeshFromUID(UID uid);
 
@@ -39,17 +40,19 @@ protected:
 	void UnloadGeometry(SimpleGeometry* geomData);
 
 	SimpleMeshData* LoadMesh(FbxGeometryData& fbxGeomData);
+	SimpleMeshData* LoadMesh(MeshCache& meshCache, uint32_t meshIndex);
 	void UnloadMesh(SimpleMeshData* geomData);
 
 public:
 
-	LambdaCommandListWithOneParam<std::function<void(uint32_t)>, uint32_t> OnMeshLoaded;
-	LambdaCommandListWithOneParam<std::function<void(uint32_t)>, uint32_t> OnMeshUnloaded;
+	TDelegateList<void(uint32_t)> OnMeshLoaded;
+	TDelegateList<void(uint32_t)> OnMeshUnloaded;
 	
 private:
 	std::map<std::string, UID> m_geomKeyTable;
-	std::unordered_map<UID, SimpleGeometry*> m_geomDatas;
-	std::unordered_map<UID, SimpleMeshData*> m_meshDatas;
+	TUidSlotMap<SimpleGeometry> m_geomDatas;
+	//dense in load order, the position of a mesh is its bind index
+	TUidSlotMap<SimpleMeshData> m_meshDatas;
 };
 
 #define gGeomContainer GeometryContainer::Instance()
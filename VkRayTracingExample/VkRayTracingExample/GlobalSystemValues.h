@@ -1,5 +1,6 @@
 #pragma once
 
+#include <string>
 #include "Singleton.h"
 
 class GlobalSystemValues : public TSingleton<GlobalSystemValues>
@@ -21,4 +22,32 @@ public:
 	float FovAngleY				= 0.785398163375f;
 	float ViewportNearDistance	= 1.0f;
 	float ViewportFarDistance	= 1000000.0f;
+
+	//offscreen mode, no window and no swapchain
+	bool UseHeadless				= false;
+	uint32_t HeadlessFrameCount		= 1;
+	//if empty, rendered frames are dropped
+	std::string HeadlessOutputPath	= "";
+
+	//device and host blas build benchmark iterations run after the scene is built, 0 disables it
+	uint32_t AsBuildBenchmarkIterations = 0;
+	//cpu bvh build benchmark iterations, runs instead of the example when not 0
+	uint32_t BvhBenchmarkIterations = 0;
+	//cpu ray traversal benchmark iterations, runs instead of the example when not 0
+	uint32_t RayBenchmarkIterations = 0;
+	//event delegate benchmark iterations, runs instead of the example when not 0
+	uint32_t DelegateBenchmarkIterations = 0;
+	//asset decode benchmark iterations on 1 thread up to every hardware thread, runs instead of the example when not 0
+	uint32_t AssetBenchmarkIterations = 0;
+	//fbx against mesh cache load benchmark iterations, runs instead of the example when not 0
+	uint32_t MeshCacheBenchmarkIterations = 0;
+
+	//cpu reference image of the first frame is written to this path with .png, if empty it is not rendered
+	std::string CpuReferenceOutputPath = "";
+
+	//example meshes are twisted by two bones and inflated by a morph target on gpu
+	bool UseDeformationDemo = false;
+
+	//.json authoring file or cooked binary scene loaded at start
+	std::string ScenePath = "../Resources/Scenes/Example.json";
 };
\ No newline at end of file
@@ -0,0 +1,51 @@
+#include "GlobalTimer.h"
+#include "ExampleAppBase.h"
+
+#include "HeadlessApplication.h"
+#include "VulkanDeviceResources.h"
+
+#include "Utils.h"
+
+int HeadlessApplication::Run(ExampleAppBase* pExample, uint32_t frameCount)
+{
+	Reporter::Instance().SetUsePopup(false);
+
+	if (!gVkDeviceRes.InitializeHeadless(pExample->GetWidth(), pExample->GetHeight(), pExample->UseRayTracing()))
+	{
+		REPORT_WITH_SHUTDOWN(EReportType::REPORT_TYPE_ERROR, "Device resource create failed.");
+	}
+
+	GlobalTimer::Instance().Initialize();
+
+	if (!pExample->Initialize())
+	{
+		REPORT_WITH_SHUTDOWN(EReportType::REPORT_TYPE_ERROR, "Example app create failed.");
+	}
+
+	std::chrono::high_resolution_clock::time_point startTime = std::chrono::high_resolution_clock::now();
+	for (uint32_t i = 0; i < frameCount; i++)
+	{
+		GlobalTimer::Instance().Tick();
+		pExample->Update(GlobalTimer::Instance().GetDeltaTime());
+		pExample->PreRender();
+		pExample->Render();
+	}
+	gVkDeviceRes.WaitForAllDeviceAction();
+	std::chrono::duration<double, std::milli> elapsed = std::chrono::high_resolution_clock::now() - startTime;
+
+	char message[256] = {};
+	sprintf_s
+	(
+		message,
+		"Headless run : %u frames, %.3f ms total, %.3f ms per frame.",
+		frameCount,
+		elapsed.count(),
+		frameCount > 0 ? elapsed.count() / frameCount : 0.0
+	);
+	REPORT(EReportType::REPORT_TYPE_LOG, message);
+
+	pExample->Destroy();
+	gVkDeviceRes.Destroy();
+
+	return 0;
+}
@@ -0,0 +1,12 @@
+#pragma once
+
+#include <stdint.h>
+
+class ExampleAppBase;
+
+//runs the example without window and swapchain, for benchmark and software rasterizer (lavapipe) environments
+class HeadlessApplication
+{
+public:
+	static int Run(ExampleAppBase* pExample, uint32_t frameCount);
+};
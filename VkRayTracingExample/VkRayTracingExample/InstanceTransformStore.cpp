@@ -0,0 +1,128 @@
+#include <algorithm>
+#include <xmmintrin.h>
+
+#include "InstanceTransformStore.h"
+
+void InstanceTransformStore::Reserve(uint32_t count)
+{
+	m_rows.reserve(count);
+	m_dirtyBits.reserve((count + 63) / 64);
+}
+
+uint32_t InstanceTransformStore::Allocate(const glm::mat4& worldMat)
+{
+	uint32_t slot = 0;
+	if (!m_freeSlots.empty())
+	{
+		slot = m_freeSlots.back();
+		m_freeSlots.pop_back();
+	}
+	else
+	{
+		slot = static_cast<uint32_t>(m_rows.size());
+		m_rows.push_back(InstanceTransformRows());
+		if (m_dirtyBits.size() * 64 < m_rows.size())
+		{
+			m_dirtyBits.push_back(0);
+		}
+	}
+
+	ToRows(worldMat, m_rows[slot]);
+	MarkDirty(slot);
+	return slot;
+}
+
+void InstanceTransformStore::Free(uint32_t slot)
+{
+	if (slot >= m_rows.size())
+	{
+		return;
+	}
+	if (IsDirty(slot))
+	{
+		m_dirtyBits[slot >> 6] &= ~(1ull << (slot & 63));
+		m_dirtyCount--;
+	}
+	m_freeSlots.push_back(slot);
+}
+
+void InstanceTransformStore::Clear()
+{
+	m_rows.clear();
+	m_dirtyBits.clear();
+	m_freeSlots.clear();
+	m_dirtyCount = 0;
+}
+
+void InstanceTransformStore::SetTransform(uint32_t slot, const glm::mat4& worldMat, bool markDirty)
+{
+	if (slot >= m_rows.size())
+	{
+		return;
+	}
+	ToRows(worldMat, m_rows[slot]);
+	if (markDirty)
+	{
+		MarkDirty(slot);
+	}
+}
+
+glm::mat4 InstanceTransformStore::GetTransform(uint32_t slot)
+{
+	glm::mat4 worldMat = glm::mat4(1.0f);
+	if (slot < m_rows.size())
+	{
+		ToMatrix(m_rows[slot], worldMat);
+	}
+	return worldMat;
+}
+
+void InstanceTransformStore::ClearDirty()
+{
+	std::fill(m_dirtyBits.begin(), m_dirtyBits.end(), 0);
+	m_dirtyCount = 0;
+}
+
+void InstanceTransformStore::MarkDirty(uint32_t slot)
+{
+	uint64_t mask = 1ull << (slot & 63);
+	uint64_t& word = m_dirtyBits[slot >> 6];
+	if ((word & mask) == 0)
+	{
+		word |= mask;
+		m_dirtyCount++;
+	}
+}
+
+void InstanceTransformStore::ToRows(const glm::mat4& worldMat, InstanceTransformRows& outRows)
+{
+	//columns of the glm matrix are transposed to rows, the last row is always 0, 0, 0, 1 and dropped
+	__m128 col0 = _mm_loadu_ps(&worldMat[0][0]);
+	__m128 col1 = _mm_loadu_ps(&worldMat[1][0]);
+	__m128 col2 = _mm_loadu_ps(&worldMat[2][0]);
+	__m128 col3 = _mm_loadu_ps(&worldMat[3][0]);
+	_MM_TRANSPOSE4_PS(col0, col1, col2, col3);
+	_mm_storeu_ps(&outRows.Rows[0][0], col0);
+	_mm_storeu_ps(&outRows.Rows[1][0], col1);
+	_mm_storeu_ps(&outRows.Rows[2][0], col2);
+}
+
+void InstanceTransformStore::ToMatrix(const InstanceTransformRows& rows, glm::mat4& outWorldMat)
+{
+	__m128 row0 = _mm_loadu_ps(&rows.Rows[0][0]);
+	__m128 row1 = _mm_loadu_ps(&rows.Rows[1][0]);
+	__m128 row2 = _mm_loadu_ps(&rows.Rows[2][0]);
+	__m128 row3 = _mm_set_ps(1.0f, 0.0f, 0.0f, 0.0f);
+	_MM_TRANSPOSE4_PS(row0, row1, row2, row3);
+	_mm_storeu_ps(&outWorldMat[0][0], row0);
+	_mm_storeu_ps(&outWorldMat[1][0], row1);
+	_mm_storeu_ps(&outWorldMat[2][0], row2);
+	_mm_storeu_ps(&outWorldMat[3][0], row3);
+}
+
+void InstanceTransformStore::CopyRows(const InstanceTransformRows& rows, float* dst)
+{
+	_mm_storeu_ps(dst, _mm_loadu_ps(&rows.Rows[0][0]));
+	_mm_storeu_ps(dst + 4, _mm_loadu_ps(&rows.Rows[1][0]));
+	_mm_storeu_ps(dst + 8, _mm_loadu_ps(&rows.Rows[2][0]));
+}
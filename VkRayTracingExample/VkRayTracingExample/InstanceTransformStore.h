@@ -0,0 +1,75 @@
+#pragma once
+
+#include <vector>
+#include <intrin.h>
+
+#include "Utils.h"
+#include "SlotMap.h"
+
+//rows of a row major 3x4 affine transform, same layout as VkTransformMatrixKHR
+struct InstanceTransformRows
+{
+	glm::vec4 Rows[3];
+};
+
+//world transforms of every render object instance stored apart from the instances, instances keep their slot
+//slots are reused after free, changed slots are tracked with one bit each until the next transform pass
+class InstanceTransformStore
+{
+public:
+	void Reserve(uint32_t count);
+	uint32_t Allocate(const glm::mat4& worldMat);
+	void Free(uint32_t slot);
+	void Clear();
+
+	//dirty slot is picked up by the next transform pass
+	void SetTransform(uint32_t slot, const glm::mat4& worldMat, bool markDirty = true);
+	glm::mat4 GetTransform(uint32_t slot);
+	InstanceTransformRows& GetRows(uint32_t slot) { return m_rows[slot]; }
+	uint32_t GetCapacity() { return static_cast<uint32_t>(m_rows.size()); }
+
+	bool HasDirty() { return m_dirtyCount > 0; }
+	bool IsDirty(uint32_t slot) { return (m_dirtyBits[slot >> 6] & (1ull << (slot & 63))) != 0; }
+	//calls func with every dirty slot in ascending order, dirty bits are cleared
+	template <typename Func>
+	void ConsumeDirty(Func func);
+	void ClearDirty();
+
+	static void ToRows(const glm::mat4& worldMat, InstanceTransformRows& outRows);
+	static void ToMatrix(const InstanceTransformRows& rows, glm::mat4& outWorldMat);
+	//dst is 12 floats, VkTransformMatrixKHR::matrix
+	static void CopyRows(const InstanceTransformRows& rows, float* dst);
+
+protected:
+	void MarkDirty(uint32_t slot);
+
+private:
+	std::vector<InstanceTransformRows> m_rows;
+	std::vector<uint64_t> m_dirtyBits;
+	std::vector<uint32_t> m_freeSlots;
+	uint32_t m_dirtyCount = 0;
+};
+
+template <typename Func>
+void InstanceTransformStore::ConsumeDirty(Func func)
+{
+	if (m_dirtyCount == 0)
+	{
+		return;
+	}
+
+	uint32_t wordCount = static_cast<uint32_t>(m_dirtyBits.size());
+	for (uint32_t i = 0; i < wordCount; i++)
+	{
+		uint64_t bits = m_dirtyBits[i];
+		m_dirtyBits[i] = 0;
+		while (bits != 0)
+		{
+			unsigned long bit = 0;
+			_BitScanForward64(&bit, bits);
+			bits &= bits - 1;
+			func((i << 6) + bit);
+		}
+	}
+	m_dirtyCount = 0;
+}
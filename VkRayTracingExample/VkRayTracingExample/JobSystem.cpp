@@ -0,0 +1,176 @@
+#include "JobSystem.h"
+
+//worker of the running thread, set once when the worker starts
+static thread_local JobSystem* g_workerJobSystem = nullptr;
+static thread_local uint32_t g_workerIndex = 0;
+
+bool JobSystem::Initialize(uint32_t threadCount)
+{
+	if (!m_threads.empty())
+	{
+		return false;
+	}
+
+	if (threadCount == 0)
+	{
+		uint32_t hardwareThreadCount = std::thread::hardware_concurrency();
+		threadCount = hardwareThreadCount > 1 ? hardwareThreadCount - 1 : 1;
+	}
+
+	m_isStopping = false;
+	m_queuedJobCount = 0;
+	m_nextQueueIndex = 0;
+	for (uint32_t i = 0; i < threadCount; i++)
+	{
+		m_queues.push_back(std::unique_ptr<WorkerQueue>(new WorkerQueue()));
+	}
+	for (uint32_t i = 0; i < threadCount; i++)
+	{
+		m_threads.push_back(std::thread(&JobSystem::WorkerLoop, this, i));
+	}
+	return true;
+}
+
+void JobSystem::Destroy()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_sleepMutex);
+		m_isStopping = true;
+	}
+	m_sleepCondition.notify_all();
+
+	for (auto& cur : m_threads)
+	{
+		if (cur.joinable())
+		{
+			cur.join();
+		}
+	}
+	m_threads.clear();
+	m_queues.clear();
+}
+
+void JobSystem::Run(const Job& job, JobCounter* counter)
+{
+	if (m_threads.empty())
+	{
+		//not initialized, the job runs in place
+		QueuedJob queuedJob;
+		queuedJob.Func = job;
+		Execute(queuedJob);
+		return;
+	}
+
+	if (counter != nullptr)
+	{
+		counter->m_pendingCount++;
+	}
+
+	//threads outside the system spread their jobs over the workers
+	int workerIndex = GetCurrentWorkerIndex();
+	uint32_t queueIndex = workerIndex != INVALID_INDEX_INT ? static_cast<uint32_t>(workerIndex) : m_nextQueueIndex++ % static_cast<uint32_t>(m_queues.size());
+	{
+		WorkerQueue& queue = *m_queues[queueIndex];
+		std::lock_guard<std::mutex> lock(queue.Mutex);
+		queue.Jobs.push_back(QueuedJob());
+		queue.Jobs.back().Func = job;
+		queue.Jobs.back().Counter = counter;
+
+		//counted before the queue is unlocked, a thief can not pop the job and decrement the count first
+		//lock order is the same as TryGetJob, queue first and then the sleep mutex
+		std::lock_guard<std::mutex> sleepLock(m_sleepMutex);
+		m_queuedJobCount++;
+	}
+	m_sleepCondition.notify_one();
+}
+
+void JobSystem::Wait(JobCounter& counter)
+{
+	int workerIndex = GetCurrentWorkerIndex();
+	uint32_t queueIndex = workerIndex != INVALID_INDEX_INT ? static_cast<uint32_t>(workerIndex) : 0;
+	while (!counter.IsCompleted())
+	{
+		QueuedJob job;
+		if (!m_queues.empty() && TryGetJob(queueIndex, job))
+		{
+			Execute(job);
+		}
+		else
+		{
+			//the remaining jobs of the counter are running on other threads
+			std::this_thread::yield();
+		}
+	}
+}
+
+void JobSystem::WorkerLoop(uint32_t workerIndex)
+{
+	g_workerJobSystem = this;
+	g_workerIndex = workerIndex;
+	while (true)
+	{
+		{
+			std::unique_lock<std::mutex> lock(m_sleepMutex);
+			m_sleepCondition.wait(lock, [this]() { return m_isStopping || m_queuedJobCount > 0; });
+			if (m_isStopping && m_queuedJobCount == 0)
+			{
+				break;
+			}
+		}
+
+		QueuedJob job;
+		if (TryGetJob(workerIndex, job))
+		{
+			Execute(job);
+		}
+	}
+	g_workerJobSystem = nullptr;
+}
+
+bool JobSystem::TryGetJob(uint32_t queueIndex, QueuedJob& outJob)
+{
+	uint32_t queueCount = static_cast<uint32_t>(m_queues.size());
+	for (uint32_t i = 0; i < queueCount; i++)
+	{
+		WorkerQueue& queue = *m_queues[(queueIndex + i) % queueCount];
+		std::lock_guard<std::mutex> lock(queue.Mutex);
+		if (queue.Jobs.empty())
+		{
+			continue;
+		}
+
+		//newest of the own deque is hot in cache, oldest of another deque is likely the largest piece of work
+		if (i == 0)
+		{
+			outJob = std::move(queue.Jobs.back());
+			queue.Jobs.pop_back();
+		}
+		else
+		{
+			outJob = std::move(queue.Jobs.front());
+			queue.Jobs.pop_front();
+		}
+
+		std::lock_guard<std::mutex> sleepLock(m_sleepMutex);
+		m_queuedJobCount--;
+		return true;
+	}
+	return false;
+}
+
+void JobSystem::Execute(QueuedJob& job)
+{
+	if (job.Func.IsBinded())
+	{
+		job.Func();
+	}
+	if (job.Counter != nullptr)
+	{
+		job.Counter->m_pendingCount--;
+	}
+}
+
+int JobSystem::GetCurrentWorkerIndex()
+{
+	return g_workerJobSystem == this ? static_cast<int>(g_workerIndex) : INVALID_INDEX_INT;
+}
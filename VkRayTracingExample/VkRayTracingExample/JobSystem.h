@@ -0,0 +1,76 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "Delegate.h"
+
+typedef TDelegate<void()> Job;
+
+//number of jobs of a group which are not completed yet
+class JobCounter
+{
+friend class JobSystem;
+public:
+	JobCounter() : m_pendingCount(0) {}
+
+	bool IsCompleted() { return m_pendingCount.load() == 0; }
+
+private:
+	std::atomic<uint32_t> m_pendingCount;
+};
+
+//worker threads with one job deque each, a worker pops the newest job of its own deque and steals the oldest job of the others
+//jobs run by a job are pushed to the deque of its worker, so nested work stays on the thread that produced it
+class JobSystem
+{
+public:
+	//0 uses one thread less than the hardware threads, the thread waiting the jobs runs jobs too
+	bool Initialize(uint32_t threadCount = 0);
+	//queued jobs are completed before the workers stop
+	void Destroy();
+
+	//counter may be null, it is decremented after the job returns
+	void Run(const Job& job, JobCounter* counter = nullptr);
+	//runs queued jobs on the calling thread until every job of the counter is completed
+	void Wait(JobCounter& counter);
+
+	uint32_t GetThreadCount() { return static_cast<uint32_t>(m_threads.size()); }
+	bool IsInitialized() { return !m_threads.empty(); }
+
+protected:
+	struct QueuedJob
+	{
+		Job Func;
+		JobCounter* Counter = nullptr;
+	};
+
+	struct WorkerQueue
+	{
+		std::mutex Mutex;
+		std::deque<QueuedJob> Jobs;
+	};
+
+	void WorkerLoop(uint32_t workerIndex);
+	//own deque first, then the other deques starting from the next one
+	bool TryGetJob(uint32_t queueIndex, QueuedJob& outJob);
+	void Execute(QueuedJob& job);
+	//INVALID_INDEX_INT for threads which are not a worker of this system
+	int GetCurrentWorkerIndex();
+
+private:
+	std::vector<std::thread> m_threads;
+	std::vector<std::unique_ptr<WorkerQueue>> m_queues;
+
+	//queued jobs of every deque, sleeping workers wake up when it is not 0
+	uint32_t m_queuedJobCount = 0;
+	std::atomic<uint32_t> m_nextQueueIndex;
+	std::mutex m_sleepMutex;
+	std::condition_variable m_sleepCondition;
+	bool m_isStopping = false;
+};
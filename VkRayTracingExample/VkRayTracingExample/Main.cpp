@@ -1,8 +1,11 @@
 
 #define WIN32_LEAN_AND_MEAN 
 #include "Win32Application.h"
+#include "HeadlessApplication.h"
+#include <shellapi.h>
 #include "GlobalSystemValues.h"
 #include "VulkanRayTracingExample.h"
+#include "CpuBenchmark.h"
 
 #if _DEBUG
 #define _CRTDBG_MAP_ALLOC
@@ -16,7 +19,99 @@ int APIENTRY WinMain(HINSTANCE hInstance, HINSTANCE, LPSTR, int nCmdShow)
 	_CrtSetDbgFlag(_CRTDBG_ALLOC_MEM_DF | _CRTDBG_LEAK_CHECK_DF);
 	//_CrtSetBreakAlloc(1112);
 #endif
+	// -headless [-frames N] [-output path_prefix] [-as-benchmark N] [-bvh-benchmark N] [-ray-benchmark N] [-delegate-benchmark N] [-asset-benchmark N] [-mesh-cache-benchmark N] [-cpu-reference path_prefix] [-deform] [-scene path]
+	int argc = 0;
+	LPWSTR* argv = CommandLineToArgvW(GetCommandLineW(), &argc);
+	for (int i = 1; i < argc; i++)
+	{
+		if (wcscmp(argv[i], L"-headless") == 0)
+		{
+			GlobalSystemValues::Instance().UseHeadless = true;
+		}
+		else if (wcscmp(argv[i], L"-frames") == 0 && i + 1 < argc)
+		{
+			GlobalSystemValues::Instance().HeadlessFrameCount = static_cast<uint32_t>(_wtoi(argv[++i]));
+		}
+		else if (wcscmp(argv[i], L"-output") == 0 && i + 1 < argc)
+		{
+			std::wstring outputPath = argv[++i];
+			GlobalSystemValues::Instance().HeadlessOutputPath = std::string(outputPath.begin(), outputPath.end());
+		}
+		else if (wcscmp(argv[i], L"-as-benchmark") == 0 && i + 1 < argc)
+		{
+			GlobalSystemValues::Instance().AsBuildBenchmarkIterations = static_cast<uint32_t>(_wtoi(argv[++i]));
+		}
+		else if (wcscmp(argv[i], L"-bvh-benchmark") == 0 && i + 1 < argc)
+		{
+			GlobalSystemValues::Instance().BvhBenchmarkIterations = static_cast<uint32_t>(_wtoi(argv[++i]));
+		}
+		else if (wcscmp(argv[i], L"-cpu-reference") == 0 && i + 1 < argc)
+		{
+			std::wstring referencePath = argv[++i];
+			GlobalSystemValues::Instance().CpuReferenceOutputPath = std::string(referencePath.begin(), referencePath.end());
+		}
+		else if (wcscmp(argv[i], L"-ray-benchmark") == 0 && i + 1 < argc)
+		{
+			GlobalSystemValues::Instance().RayBenchmarkIterations = static_cast<uint32_t>(_wtoi(argv[++i]));
+		}
+		else if (wcscmp(argv[i], L"-delegate-benchmark") == 0 && i + 1 < argc)
+		{
+			GlobalSystemValues::Instance().DelegateBenchmarkIterations = static_cast<uint32_t>(_wtoi(argv[++i]));
+		}
+		else if (wcscmp(argv[i], L"-asset-benchmark") == 0 && i + 1 < argc)
+		{
+			GlobalSystemValues::Instance().AssetBenchmarkIterations = static_cast<uint32_t>(_wtoi(argv[++i]));
+		}
+		else if (wcscmp(argv[i], L"-mesh-cache-benchmark") == 0 && i + 1 < argc)
+		{
+			GlobalSystemValues::Instance().MeshCacheBenchmarkIterations = static_cast<uint32_t>(_wtoi(argv[++i]));
+		}
+		else if (wcscmp(argv[i], L"-deform") == 0)
+		{
+			GlobalSystemValues::Instance().UseDeformationDemo = true;
+		}
+		else if (wcscmp(argv[i], L"-scene") == 0 && i + 1 < argc)
+		{
+			std::wstring scenePath = argv[++i];
+			GlobalSystemValues::Instance().ScenePath = std::string(scenePath.begin(), scenePath.end());
+		}
+	}
+	LocalFree(argv);
+
+	if (GlobalSystemValues::Instance().BvhBenchmarkIterations > 0 || GlobalSystemValues::Instance().RayBenchmarkIterations > 0 || GlobalSystemValues::Instance().DelegateBenchmarkIterations > 0 ||
+		GlobalSystemValues::Instance().AssetBenchmarkIterations > 0 || GlobalSystemValues::Instance().MeshCacheBenchmarkIterations > 0)
+	{
+		Reporter::Instance().SetUsePopup(false);
+		gFbxGeomLoader.Initialize();
+		if (GlobalSystemValues::Instance().BvhBenchmarkIterations > 0)
+		{
+			CpuBenchmark::RunBvhBuild(GlobalSystemValues::Instance().BvhBenchmarkIterations);
+		}
+		if (GlobalSystemValues::Instance().RayBenchmarkIterations > 0)
+		{
+			CpuBenchmark::RunRayTraversal(GlobalSystemValues::Instance().RayBenchmarkIterations);
+		}
+		if (GlobalSystemValues::Instance().DelegateBenchmarkIterations > 0)
+		{
+			CpuBenchmark::RunDelegates(GlobalSystemValues::Instance().DelegateBenchmarkIterations);
+		}
+		if (GlobalSystemValues::Instance().AssetBenchmarkIterations > 0)
+		{
+			CpuBenchmark::RunAssetLoading(GlobalSystemValues::Instance().AssetBenchmarkIterations);
+		}
+		if (GlobalSystemValues::Instance().MeshCacheBenchmarkIterations > 0)
+		{
+			CpuBenchmark::RunMeshCache(GlobalSystemValues::Instance().MeshCacheBenchmarkIterations);
+		}
+		gFbxGeomLoader.Destory();
+		return 0;
+	}
+
 	VulkanRayTracingExample example(L"helloVulkanApp", GlobalSystemValues::Instance().ScreenWidth, GlobalSystemValues::Instance().ScreenHeight, true);
 
+	if (GlobalSystemValues::Instance().UseHeadless)
+	{
+		return HeadlessApplication::Run(&example, GlobalSystemValues::Instance().HeadlessFrameCount);
+	}
 	return Win32Application::Run(&example, hInstance, nCmdShow);
 }
\ No newline at end of file
@@ -0,0 +1,76 @@
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+
+#include "MappedFile.h"
+#include "Utils.h"
+
+bool MappedFile::Open(const std::string& filePath)
+{
+	Close();
+
+	HANDLE fileHandle = CreateFileA(filePath.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+	if (fileHandle == INVALID_HANDLE_VALUE)
+	{
+		return false;
+	}
+
+	LARGE_INTEGER fileSize = {};
+	if (!GetFileSizeEx(fileHandle, &fileSize) || fileSize.QuadPart == 0)
+	{
+		CloseHandle(fileHandle);
+		return false;
+	}
+
+	HANDLE mappingHandle = CreateFileMappingA(fileHandle, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	if (mappingHandle == nullptr)
+	{
+		REPORT(EReportType::REPORT_TYPE_WARN, "File mapping create failed.");
+		CloseHandle(fileHandle);
+		return false;
+	}
+
+	void* data = MapViewOfFile(mappingHandle, FILE_MAP_READ, 0, 0, 0);
+	if (data == nullptr)
+	{
+		REPORT(EReportType::REPORT_TYPE_WARN, "File map failed.");
+		CloseHandle(mappingHandle);
+		CloseHandle(fileHandle);
+		return false;
+	}
+
+	m_fileHandle = fileHandle;
+	m_mappingHandle = mappingHandle;
+	m_data = static_cast<const uint8_t*>(data);
+	m_size = static_cast<uint64_t>(fileSize.QuadPart);
+	return true;
+}
+
+void MappedFile::Close()
+{
+	if (m_data != nullptr)
+	{
+		UnmapViewOfFile(m_data);
+		m_data = nullptr;
+	}
+	if (m_mappingHandle != nullptr)
+	{
+		CloseHandle(m_mappingHandle);
+		m_mappingHandle = nullptr;
+	}
+	if (m_fileHandle != nullptr)
+	{
+		CloseHandle(m_fileHandle);
+		m_fileHandle = nullptr;
+	}
+	m_size = 0;
+}
+
+uint64_t MappedFile::GetLastWriteTime(const std::string& filePath)
+{
+	WIN32_FILE_ATTRIBUTE_DATA attributeData = {};
+	if (!GetFileAttributesExA(filePath.c_str(), GetFileExInfoStandard, &attributeData))
+	{
+		return 0;
+	}
+	return (static_cast<uint64_t>(attributeData.ftLastWriteTime.dwHighDateTime) << 32) | attributeData.ftLastWriteTime.dwLowDateTime;
+}
@@ -0,0 +1,31 @@
+#pragma once
+
+#include <string>
+#include <stdint.h>
+
+//read only view of a whole file, pages are loaded by the os when they are first touched
+class MappedFile
+{
+public:
+	MappedFile() {}
+	~MappedFile() { Close(); }
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+
+public:
+	bool Open(const std::string& filePath);
+	void Close();
+
+	bool IsOpened() { return m_data != nullptr; }
+	const uint8_t* GetData() { return m_data; }
+	uint64_t GetSize() { return m_size; }
+
+	//0 if the file does not exist
+	static uint64_t GetLastWriteTime(const std::string& filePath);
+
+private:
+	void* m_fileHandle = nullptr;
+	void* m_mappingHandle = nullptr;
+	const uint8_t* m_data = nullptr;
+	uint64_t m_size = 0;
+};
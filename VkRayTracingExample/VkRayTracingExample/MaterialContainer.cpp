@@ -9,11 +9,7 @@ SimpleMaterial* MaterialContainer::CreateMaterial(ExampleMaterialType matType)
 	auto iterUidFind = m_materialUidTable.find(matType);
 	if (iterUidFind != m_materialUidTable.end())
 	{
-		auto iterFind = m_materialDatas.find(iterUidFind->second);
-		if (iterFind != m_materialDatas.end())
-		{
-			material = iterFind->second;
-		}
+		material = m_materialDatas.Find(iterUidFind->second);
 	}
 
 	if (material == nullptr)
@@ -21,62 +17,96 @@ SimpleMaterial* MaterialContainer::CreateMaterial(ExampleMaterialType matType)
 		material = new SimpleMaterial();
 		UID uid = material->GetUID();
 		ExampleMaterialCreateCode::Instance().CreateExampleMaterial(matType, material);
-		m_materialDatas.insert(std::make_pair(uid, material));
+		m_materialDatas.Insert(material);
 		m_materialUidTable.insert(std::make_pair(matType, uid));
 	}
 
 	return material;
 }
 
+SimpleMaterial* MaterialContainer::CreateMaterial(const SimpleMaterialDesc& desc)
+{
+	SimpleMaterial* material = nullptr;
+
+	auto iterUidFind = m_materialNameTable.find(desc.Name);
+	if (iterUidFind != m_materialNameTable.end())
+	{
+		material = m_materialDatas.Find(iterUidFind->second);
+	}
+
+	if (material == nullptr)
+	{
+		material = new SimpleMaterial();
+		material->m_name = desc.Name;
+		material->m_color = desc.Color;
+		material->m_mateiralTypeIndex = static_cast<uint32_t>(desc.SurfaceType);
+		material->m_indexOfRefraction = desc.IndexOfRefraction;
+		material->m_metallic = desc.Metallic;
+		material->m_roughness = desc.Roughness;
+		material->m_uvScale = desc.UvScale;
+		material->m_diffuseTex = desc.DiffuseTexPath.empty() ? nullptr : gTexContainer.CreateTexture(desc.DiffuseTexPath.c_str());
+		material->m_normalTex = desc.NormalTexPath.empty() ? nullptr : gTexContainer.CreateTexture(desc.NormalTexPath.c_str());
+		material->m_roughnessTex = desc.RoughnessTexPath.empty() ? nullptr : gTexContainer.CreateTexture(desc.RoughnessTexPath.c_str());
+		material->m_metallicTex = desc.MetallicTexPath.empty() ? nullptr : gTexContainer.CreateTexture(desc.MetallicTexPath.c_str());
+		material->m_ambientOcclusionTex = desc.AmbientOcclusionTexPath.empty() ? nullptr : gTexContainer.CreateTexture(desc.AmbientOcclusionTexPath.c_str());
+
+		std::string closestHitShaderPath = desc.ClosestHitShaderPath;
+		std::string anyHitShaderPath = desc.AnyHitShaderPath;
+		std::string intersectionShaderPath = desc.IntersectionShaderPath;
+		material->m_hitShaderGroup = gHitGroupContainer.CreateHitGroup(closestHitShaderPath, anyHitShaderPath, intersectionShaderPath);
+
+		m_materialDatas.Insert(material);
+		m_materialNameTable.insert(std::make_pair(desc.Name, material->GetUID()));
+	}
+
+	return material;
+}
+
 void MaterialContainer::RemoveMaterial(SimpleMaterial* material)
 {
-	auto iterFind = m_materialDatas.find(material->GetUID());
-	if (iterFind != m_materialDatas.end())
+	if (m_materialDatas.Remove(material->GetUID()) != INVALID_INDEX_INT)
 	{
-		if (iterFind->second != nullptr)
+		if (material->m_materialType != ExampleMaterialType::EXAMPLE_MAT_TYPE_INVALID)
+		{
+			m_materialUidTable.erase(material->m_materialType);
+		}
+		else
 		{
-			m_materialUidTable.erase(iterFind->second->m_materialType);
-			iterFind->second->Destory();
-			delete iterFind->second;
+			m_materialNameTable.erase(material->m_name);
 		}
-		m_materialDatas.erase(iterFind);
+		material->Destory();
+		delete material;
 	}
 }
 
 int MaterialContainer::GetBindIndex(SimpleMaterial* material)
 {
-	auto iterFind = m_materialDatas.find(material->GetUID());
-	if (iterFind != m_materialDatas.end())
-	{
-		return static_cast<int>(std::distance(m_materialDatas.begin(), iterFind));
-	}
-	return INVALID_INDEX_INT;
+	return m_materialDatas.GetIndex(material->GetUID());
 }
 
 void MaterialContainer::Clear()
 {
-	for (auto& cur : m_materialDatas)
+	for (SimpleMaterial* cur : m_materialDatas)
 	{
-		if (cur.second != nullptr)
+		if (cur != nullptr)
 		{
-			cur.second->Destory();
+			cur->Destory();
 		}
-		delete cur.second;
+		delete cur;
 	}
 
-	m_materialDatas.clear();
+	m_materialDatas.Clear();
 	m_materialUidTable.clear();
+	m_materialNameTable.clear();
 }
 
 SimpleMaterial* MaterialContainer::GetMaterial(int index)
 {
-	if (index < m_materialDatas.size())
+	if (index < 0)
 	{
-		auto pos = m_materialDatas.begin();
-		std::advance(pos, index);
-		return pos->second;
+		return nullptr;
 	}
-	return nullptr;
+	return m_materialDatas.GetAt(static_cast<uint32_t>(index));
 }
 
 //Ʈ ϵڵ ۼ
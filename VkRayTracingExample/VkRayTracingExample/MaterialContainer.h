@@ -2,6 +2,29 @@
 
 #include "SimpleMaterial.h"
 #include "Singleton.h"
+#include "SlotMap.h"
+
+//material described by data instead of ExampleMaterialType, empty paths are not used
+struct SimpleMaterialDesc
+{
+	std::string Name = "";
+	glm::vec4 Color = glm::vec4(1.0f);
+	EMaterialType SurfaceType = EMaterialType::SURFACE_TYPE_DEFAULT;
+	float IndexOfRefraction = 1.0f;
+	float Metallic = 0.0f;
+	float Roughness = 1.0f;
+	float UvScale = 1.0f;
+
+	std::string DiffuseTexPath = "";
+	std::string NormalTexPath = "";
+	std::string RoughnessTexPath = "";
+	std::string MetallicTexPath = "";
+	std::string AmbientOcclusionTexPath = "";
+
+	std::string ClosestHitShaderPath = "";
+	std::string AnyHitShaderPath = "";
+	std::string IntersectionShaderPath = "";
+};
 
 class MaterialContainer : public TSingleton<MaterialContainer>
 {
@@ -12,17 +35,21 @@ public:
 
 public:
 	SimpleMaterial* CreateMaterial(ExampleMaterialType matType);
+	//materials with the same name are shared like the ones of the same example type
+	SimpleMaterial* CreateMaterial(const SimpleMaterialDesc& desc);
 	void RemoveMaterial(SimpleMaterial* material);
 	int GetBindIndex(SimpleMaterial* material);
 
 	void Clear();
 
-	uint32_t GetMaterialCount() { return static_cast<uint32_t>(m_materialDatas.size()); }
+	uint32_t GetMaterialCount() { return m_materialDatas.GetCount(); }
 	SimpleMaterial* GetMaterial(int index);
 
 private:
 	std::map<ExampleMaterialType, UID> m_materialUidTable;
-	std::map<UID, SimpleMaterial*> m_materialDatas;
+	std::unordered_map<std::string, UID> m_materialNameTable;
+	//dense in creation order, the position of a material is its bind index
+	TUidSlotMap<SimpleMaterial> m_materialDatas;
 };
 
 #define gMaterialContainer MaterialContainer::Instance()
@@ -0,0 +1,140 @@
+#include "MeshCache.h"
+#include "SimpleGeometry.h"
+
+bool MeshCache::Open(const std::string& sourceFilePath)
+{
+	Close();
+	if (!m_file.Open(GetCachePath(sourceFilePath)))
+	{
+		return false;
+	}
+
+	m_header = reinterpret_cast<const MeshCacheFileHeader*>(m_file.GetData());
+	m_meshes = reinterpret_cast<const MeshCacheFileMesh*>(m_file.GetData() + sizeof(MeshCacheFileHeader));
+	if (!Validate(sourceFilePath))
+	{
+		Close();
+		return false;
+	}
+	return true;
+}
+
+void MeshCache::Close()
+{
+	m_file.Close();
+	m_header = nullptr;
+	m_meshes = nullptr;
+}
+
+std::string MeshCache::GetCachePath(const std::string& sourceFilePath)
+{
+	size_t extensionPos = sourceFilePath.find_last_of('.');
+	return (extensionPos != std::string::npos ? sourceFilePath.substr(0, extensionPos) : sourceFilePath) + MESH_CACHE_EXTENSION;
+}
+
+bool MeshCache::IsUpToDate(const std::string& sourceFilePath)
+{
+	MeshCache meshCache;
+	return meshCache.Open(sourceFilePath);
+}
+
+bool MeshCache::Write(const std::string& sourceFilePath, std::vector<FbxGeometryData>& geometries)
+{
+	MeshCacheFileHeader header = {};
+	header.MeshCount = static_cast<uint32_t>(geometries.size());
+	header.VertexStride = sizeof(DefaultVertex);
+	header.SourceWriteTime = MappedFile::GetLastWriteTime(sourceFilePath);
+	if (header.SourceWriteTime == 0)
+	{
+		return false;
+	}
+
+	std::vector<MeshCacheFileMesh> meshes(geometries.size());
+	std::vector<std::vector<DefaultVertex>> vertices(geometries.size());
+	uint64_t offset = sizeof(MeshCacheFileHeader) + sizeof(MeshCacheFileMesh) * meshes.size();
+	for (uint32_t i = 0; i < geometries.size(); i++)
+	{
+		FbxGeometryData& geometry = geometries[i];
+		MeshCacheFileMesh& mesh = meshes[i];
+
+		glm::vec3 boundsMin = glm::vec3(0.0f);
+		glm::vec3 boundsMax = glm::vec3(0.0f);
+		SimpleMeshData::BuildVertices(geometry, vertices[i], boundsMin, boundsMax);
+
+		mesh.VertexCount = static_cast<uint32_t>(geometry.m_positions.size());
+		mesh.IndexCount = static_cast<uint32_t>(geometry.m_indices.size());
+		for (uint32_t j = 0; j < 3; j++)
+		{
+			mesh.BoundsMin[j] = boundsMin[j];
+			mesh.BoundsMax[j] = boundsMax[j];
+		}
+		mesh.ContentHash = SimpleMeshData::ComputeContentHash(geometry.m_positions.data(), mesh.VertexCount, geometry.m_indices.data(), mesh.IndexCount);
+
+		uint64_t* blobOffsets[] = { &mesh.VertexOffset, &mesh.PositionOffset, &mesh.IndexOffset };
+		uint64_t blobSizes[] = { sizeof(DefaultVertex) * mesh.VertexCount, sizeof(glm::vec3) * mesh.VertexCount, sizeof(uint32_t) * mesh.IndexCount };
+		for (uint32_t j = 0; j < 3; j++)
+		{
+			offset = (offset + MESH_CACHE_FILE_BLOB_ALIGNMENT - 1) & ~static_cast<uint64_t>(MESH_CACHE_FILE_BLOB_ALIGNMENT - 1);
+			*blobOffsets[j] = offset;
+			offset += blobSizes[j];
+		}
+	}
+	header.FileSize = offset;
+
+	std::ofstream cacheFile(GetCachePath(sourceFilePath), std::ios::binary | std::ios::trunc);
+	if (!cacheFile.is_open())
+	{
+		return false;
+	}
+
+	static const char PADDING[MESH_CACHE_FILE_BLOB_ALIGNMENT] = {};
+	cacheFile.write(reinterpret_cast<const char*>(&header), sizeof(MeshCacheFileHeader));
+	cacheFile.write(reinterpret_cast<const char*>(meshes.data()), static_cast<std::streamsize>(sizeof(MeshCacheFileMesh) * meshes.size()));
+	uint64_t written = sizeof(MeshCacheFileHeader) + sizeof(MeshCacheFileMesh) * meshes.size();
+	for (uint32_t i = 0; i < geometries.size(); i++)
+	{
+		const void* blobs[] = { vertices[i].data(), geometries[i].m_positions.data(), geometries[i].m_indices.data() };
+		uint64_t blobOffsets[] = { meshes[i].VertexOffset, meshes[i].PositionOffset, meshes[i].IndexOffset };
+		uint64_t blobSizes[] = { sizeof(DefaultVertex) * meshes[i].VertexCount, sizeof(glm::vec3) * meshes[i].VertexCount, sizeof(uint32_t) * meshes[i].IndexCount };
+		for (uint32_t j = 0; j < 3; j++)
+		{
+			cacheFile.write(PADDING, static_cast<std::streamsize>(blobOffsets[j] - written));
+			cacheFile.write(static_cast<const char*>(blobs[j]), static_cast<std::streamsize>(blobSizes[j]));
+			written = blobOffsets[j] + blobSizes[j];
+		}
+	}
+	return cacheFile.good();
+}
+
+bool MeshCache::Validate(const std::string& sourceFilePath)
+{
+	uint64_t fileSize = m_file.GetSize();
+	if (fileSize < sizeof(MeshCacheFileHeader) ||
+		m_header->Magic != MESH_CACHE_FILE_MAGIC ||
+		m_header->Version != MESH_CACHE_FILE_VERSION ||
+		m_header->VertexStride != sizeof(DefaultVertex) ||
+		m_header->FileSize != fileSize ||
+		m_header->SourceWriteTime != MappedFile::GetLastWriteTime(sourceFilePath))
+	{
+		return false;
+	}
+
+	if (m_header->MeshCount > (fileSize - sizeof(MeshCacheFileHeader)) / sizeof(MeshCacheFileMesh))
+	{
+		return false;
+	}
+	for (uint32_t i = 0; i < m_header->MeshCount; i++)
+	{
+		const MeshCacheFileMesh& mesh = m_meshes[i];
+		uint64_t blobOffsets[] = { mesh.VertexOffset, mesh.PositionOffset, mesh.IndexOffset };
+		uint64_t blobSizes[] = { sizeof(DefaultVertex) * static_cast<uint64_t>(mesh.VertexCount), sizeof(glm::vec3) * static_cast<uint64_t>(mesh.VertexCount), sizeof(uint32_t) * static_cast<uint64_t>(mesh.IndexCount) };
+		for (uint32_t j = 0; j < 3; j++)
+		{
+			if (blobOffsets[j] % MESH_CACHE_FILE_BLOB_ALIGNMENT != 0 || blobOffsets[j] > fileSize || blobSizes[j] > fileSize - blobOffsets[j])
+			{
+				return false;
+			}
+		}
+	}
+	return true;
+}
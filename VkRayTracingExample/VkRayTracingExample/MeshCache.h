@@ -0,0 +1,39 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "MeshCacheFile.h"
+#include "MappedFile.h"
+#include "DeviceBuffers.h"
+
+//cooked meshes of a source file read in place through a file mapping
+//Open and Write do not report, they are called from the decode jobs of the asset loader too
+class MeshCache
+{
+public:
+	//false if the cache is missing, written by another version or older than the source
+	bool Open(const std::string& sourceFilePath);
+	void Close();
+	bool IsOpened() { return m_header != nullptr; }
+
+	uint32_t GetMeshCount() { return m_header != nullptr ? m_header->MeshCount : 0; }
+	const MeshCacheFileMesh& GetMesh(uint32_t index) { return m_meshes[index]; }
+	const DefaultVertex* GetVertices(uint32_t index) { return reinterpret_cast<const DefaultVertex*>(m_file.GetData() + m_meshes[index].VertexOffset); }
+	const glm::vec3* GetPositions(uint32_t index) { return reinterpret_cast<const glm::vec3*>(m_file.GetData() + m_meshes[index].PositionOffset); }
+	const uint32_t* GetIndices(uint32_t index) { return reinterpret_cast<const uint32_t*>(m_file.GetData() + m_meshes[index].IndexOffset); }
+
+	//the source file name with MESH_CACHE_EXTENSION
+	static std::string GetCachePath(const std::string& sourceFilePath);
+	static bool IsUpToDate(const std::string& sourceFilePath);
+	//converts the geometries to the uploaded vertex layout and writes them with their bounds and content hashes
+	static bool Write(const std::string& sourceFilePath, std::vector<FbxGeometryData>& geometries);
+
+protected:
+	bool Validate(const std::string& sourceFilePath);
+
+private:
+	MappedFile m_file;
+	const MeshCacheFileHeader* m_header = nullptr;
+	const MeshCacheFileMesh* m_meshes = nullptr;
+};
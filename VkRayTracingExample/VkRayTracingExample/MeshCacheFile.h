@@ -0,0 +1,39 @@
+#pragma once
+
+#include <stdint.h>
+
+//binary layout of the meshes of one source file, written by MeshCache on the first load of the source and mapped by later loads
+//the header is followed by one MeshCacheFileMesh per mesh, blobs start at a MESH_CACHE_FILE_BLOB_ALIGNMENT boundary
+#define MESH_CACHE_FILE_MAGIC 0x48534D43
+#define MESH_CACHE_FILE_VERSION 1
+#define MESH_CACHE_FILE_BLOB_ALIGNMENT 64
+#define MESH_CACHE_EXTENSION ".meshb"
+
+struct MeshCacheFileHeader
+{
+	uint32_t Magic = MESH_CACHE_FILE_MAGIC;
+	uint32_t Version = MESH_CACHE_FILE_VERSION;
+	uint32_t MeshCount = 0;
+	//sizeof(DefaultVertex) of the writer, vertex blobs are copied to the vertex buffers as they are
+	uint32_t VertexStride = 0;
+	//last write time of the source file, the cache is stale when the source has another one
+	uint64_t SourceWriteTime = 0;
+	//end of the last blob, a shorter file was not completely written
+	uint64_t FileSize = 0;
+};
+
+struct MeshCacheFileMesh
+{
+	//DefaultVertex blob in the uploaded layout
+	uint64_t VertexOffset = 0;
+	//glm::vec3 source positions, read by host acceleration structure builds
+	uint64_t PositionOffset = 0;
+	//uint32_t triangle list
+	uint64_t IndexOffset = 0;
+	uint32_t VertexCount = 0;
+	uint32_t IndexCount = 0;
+	float BoundsMin[3] = { 0.0f, 0.0f, 0.0f };
+	float BoundsMax[3] = { 0.0f, 0.0f, 0.0f };
+	//same as SimpleMeshData::GetContentHash, so the positions and indices are not hashed again on load
+	uint64_t ContentHash = 0;
+};
@@ -5,11 +5,45 @@
 
 void RayTracingAccelerationStructureBase::Destroy()
 {
-	m_asMemory.Destroy();
-	m_scratchBuffer.Destroy();
-	if (m_accelerationStructure != VK_NULL_HANDLE)
+	DestroyAccelerationStructure(m_asMemory, m_accelerationStructure);
+}
+
+bool RayTracingAccelerationStructureBase::CreateAccelerationStructure(VkDeviceSize size, VkAccelerationStructureTypeKHR type, AsMemoryRange& outMemory, VkAccelerationStructureKHR& outAccelerationStructure)
+{
+	if (m_memoryPool == nullptr || !m_memoryPool->Allocate(size, outMemory))
+	{
+		REPORT(EReportType::REPORT_TYPE_ERROR, "Acceleration structure memory allocation failed.");
+		return false;
+	}
+
+	VkAccelerationStructureCreateInfoKHR asCreateInfo = {};
+	asCreateInfo.sType = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_CREATE_INFO_KHR;
+	asCreateInfo.buffer = outMemory.Buffer;
+	asCreateInfo.offset = outMemory.Offset;
+	asCreateInfo.size = size;
+	asCreateInfo.type = type;
+
+	if (vkCreateAccelerationStructureKHR(gLogicalDevice, &asCreateInfo, nullptr, &outAccelerationStructure) != VkResult::VK_SUCCESS)
 	{
-		vkDestroyAccelerationStructureKHR(gLogicalDevice, m_accelerationStructure, nullptr);
+		m_memoryPool->Free(outMemory);
+		return false;
+	}
+	return true;
+}
+
+void RayTracingAccelerationStructureBase::DestroyAccelerationStructure(AsMemoryRange& memory, VkAccelerationStructureKHR& accelerationStructure)
+{
+	if (m_memoryPool != nullptr)
+	{
+		//structure may be traced by the frames in flight, the pool destroys it with its range after their fences
+		m_memoryPool->Free(memory, accelerationStructure);
+		accelerationStructure = VK_NULL_HANDLE;
+		return;
+	}
+	if (accelerationStructure != VK_NULL_HANDLE)
+	{
+		vkDestroyAccelerationStructureKHR(gLogicalDevice, accelerationStructure, nullptr);
+		accelerationStructure = VK_NULL_HANDLE;
 	}
 }
 
@@ -21,105 +55,508 @@ void RayTracingAccelerationStructureBase::Reset()
 	m_isBuilded = false;
 }
 
-bool BottomLevelAS::Build(VkCommandBuffer commandBuffer, bool update)
+bool BottomLevelAS::Build(VkCommandBuffer commandBuffer, RayTracingScratchArena* scratchArena, bool update)
 {
-	if (m_sourceMesh == nullptr)
+	std::vector<BottomLevelAS*> blasList = { this };
+	std::vector<bool> updateList = { update };
+	return BuildBatch(commandBuffer, blasList, updateList, scratchArena);
+}
+
+bool BottomLevelAS::BuildBatch(VkCommandBuffer commandBuffer, std::vector<BottomLevelAS*>& blasList, std::vector<bool>& updateList, RayTracingScratchArena* scratchArena)
+{
+	std::vector<VkAccelerationStructureBuildGeometryInfoKHR> asBuildGeomInfos;
+	std::vector<VkAccelerationStructureBuildRangeInfoKHR*> asBuildRangeInfoPtrs;
+	std::vector<BottomLevelAS*> builtBlasList;
+	std::vector<bool> builtUpdateList;
+	std::vector<VkDeviceSize> scratchSizes;
+	asBuildGeomInfos.reserve(blasList.size());
+	asBuildRangeInfoPtrs.reserve(blasList.size());
+	builtBlasList.reserve(blasList.size());
+
+	bool result = true;
+	for (uint32_t i = 0; i < blasList.size(); i++)
+	{
+		//host built structure can not be refitted on device
+		bool update = updateList[i] && !blasList[i]->m_isHostBuilt;
+		VkAccelerationStructureBuildGeometryInfoKHR asBuildGeomInfo = {};
+		if (!blasList[i]->PrepareBuild(asBuildGeomInfo, update))
+		{
+			result = false;
+			continue;
+		}
+		asBuildGeomInfos.push_back(asBuildGeomInfo);
+		asBuildRangeInfoPtrs.push_back(blasList[i]->m_buildRangeInfos.data());
+		builtBlasList.push_back(blasList[i]);
+		builtUpdateList.push_back(update);
+		scratchSizes.push_back(blasList[i]->GetScratchSize(update));
+	}
+
+	if (asBuildGeomInfos.empty())
+	{
+		return result;
+	}
+
+	VkDeviceSize batchScratchSize = 0;
+	for (auto& cur : scratchSizes)
+	{
+		batchScratchSize += scratchArena->GetAlignedSize(cur);
+	}
+	scratchArena->Reset();
+	if (!scratchArena->Reserve(batchScratchSize))
 	{
 		return false;
 	}
+	for (uint32_t i = 0; i < asBuildGeomInfos.size(); i++)
+	{
+		asBuildGeomInfos[i].scratchData.deviceAddress = scratchArena->Allocate(scratchSizes[i]);
+	}
 
-	if (!update)
+	//each blas has its own scratch range, so all of them can be built in one command without barriers between them
+	vkCmdBuildAccelerationStructuresKHR
+	(
+		commandBuffer,
+		static_cast<uint32_t>(asBuildGeomInfos.size()),
+		asBuildGeomInfos.data(),
+		asBuildRangeInfoPtrs.data()
+	);
+
+	WriteBuildBarrier(commandBuffer);
+
+	for (uint32_t i = 0; i < builtBlasList.size(); i++)
 	{
-		VkDeviceOrHostAddressConstKHR vertexDataDeviceAddress = {};
-		VkDeviceOrHostAddressConstKHR indexDataDeviceAddress = {};
+		builtBlasList[i]->OnBuildCommandWritten(builtUpdateList[i]);
+	}
+
+	return result;
+}
 
-		AsVertexBuffer* vertexBuffer = m_sourceMesh->GetVertexBuffer();
-		AsIndexBuffer* indexBuffer = m_sourceMesh->GetIndexBuffer();
-		if (vertexBuffer == nullptr || indexBuffer == nullptr)
+bool BottomLevelAS::BuildBatchOnHost(std::vector<BottomLevelAS*>& blasList, std::vector<bool>& updateList, WorkerThreadPool* workerPool)
+{
+	std::vector<VkAccelerationStructureBuildGeometryInfoKHR> asBuildGeomInfos;
+	std::vector<VkAccelerationStructureBuildRangeInfoKHR*> asBuildRangeInfoPtrs;
+	std::vector<BottomLevelAS*> builtBlasList;
+	std::vector<bool> builtUpdateList;
+	std::vector<VkDeviceSize> scratchOffsets;
+	asBuildGeomInfos.reserve(blasList.size());
+	asBuildRangeInfoPtrs.reserve(blasList.size());
+	builtBlasList.reserve(blasList.size());
+
+	bool result = true;
+	VkDeviceSize batchScratchSize = 0;
+	for (uint32_t i = 0; i < blasList.size(); i++)
+	{
+		//device built structure can not be refitted on host
+		bool update = updateList[i] && blasList[i]->m_isHostBuilt;
+		VkAccelerationStructureBuildGeometryInfoKHR asBuildGeomInfo = {};
+		if (!blasList[i]->PrepareBuild(asBuildGeomInfo, update, true))
 		{
-			return false;
+			result = false;
+			continue;
+		}
+		asBuildGeomInfos.push_back(asBuildGeomInfo);
+		asBuildRangeInfoPtrs.push_back(blasList[i]->m_buildRangeInfos.data());
+		builtBlasList.push_back(blasList[i]);
+		builtUpdateList.push_back(update);
+		scratchOffsets.push_back(batchScratchSize);
+		batchScratchSize += (blasList[i]->GetScratchSize(update) + 15) / 16 * 16;
+	}
+
+	if (asBuildGeomInfos.empty())
+	{
+		return result;
+	}
+
+	std::vector<uint8_t> hostScratch(static_cast<size_t>(batchScratchSize) + 16);
+	for (uint32_t i = 0; i < asBuildGeomInfos.size(); i++)
+	{
+		asBuildGeomInfos[i].scratchData.hostAddress = hostScratch.data() + scratchOffsets[i];
+	}
+
+	VkDeferredOperationKHR deferredOperation = VK_NULL_HANDLE;
+	if (workerPool != nullptr && workerPool->IsInitialized())
+	{
+		vkCreateDeferredOperationKHR(gLogicalDevice, nullptr, &deferredOperation);
+	}
+
+	VkResult res = vkBuildAccelerationStructuresKHR
+	(
+		gLogicalDevice,
+		deferredOperation,
+		static_cast<uint32_t>(asBuildGeomInfos.size()),
+		asBuildGeomInfos.data(),
+		asBuildRangeInfoPtrs.data()
+	);
+
+	if (res == VkResult::VK_OPERATION_DEFERRED_KHR)
+	{
+		//the calling thread joins too, so one job less than the reported concurrency is queued
+		uint32_t maxConcurrency = vkGetDeferredOperationMaxConcurrencyKHR(gLogicalDevice, deferredOperation);
+		uint32_t jobCount = maxConcurrency > 1 ? maxConcurrency - 1 : 0;
+		if (jobCount > workerPool->GetThreadCount())
+		{
+			jobCount = workerPool->GetThreadCount();
 		}
+		for (uint32_t i = 0; i < jobCount; i++)
+		{
+			workerPool->Enqueue
+			(
+				[deferredOperation]()
+				{
+					JoinDeferredOperation(deferredOperation);
+				}
+			);
+		}
+		JoinDeferredOperation(deferredOperation);
+		workerPool->WaitIdle();
+
+		res = vkGetDeferredOperationResultKHR(gLogicalDevice, deferredOperation);
+	}
+	else if (res == VkResult::VK_OPERATION_NOT_DEFERRED_KHR)
+	{
+		res = VkResult::VK_SUCCESS;
+	}
+
+	if (deferredOperation != VK_NULL_HANDLE)
+	{
+		vkDestroyDeferredOperationKHR(gLogicalDevice, deferredOperation, nullptr);
+	}
+
+	if (res != VkResult::VK_SUCCESS)
+	{
+		REPORT(EReportType::REPORT_TYPE_ERROR, "Host blas build failed.");
+		return false;
+	}
+
+	for (uint32_t i = 0; i < builtBlasList.size(); i++)
+	{
+		builtBlasList[i]->OnBuildCommandWritten(builtUpdateList[i]);
+	}
+
+	return result;
+}
+
+void BottomLevelAS::JoinDeferredOperation(VkDeferredOperationKHR deferredOperation)
+{
+	//idle means no work is left for this thread but others are still running, joining again waits them
+	VkResult res = VkResult::VK_THREAD_IDLE_KHR;
+	while (res == VkResult::VK_THREAD_IDLE_KHR)
+	{
+		res = vkDeferredOperationJoinKHR(gLogicalDevice, deferredOperation);
+		if (res == VkResult::VK_THREAD_IDLE_KHR)
+		{
+			std::this_thread::yield();
+		}
+	}
+}
+
+bool BottomLevelAS::IsHostBuildSupported()
+{
+	return gVkDeviceRes.GetPhysicalDeviceAccelerationStructureFeatures().accelerationStructureHostCommands == VK_TRUE &&
+		   vkCreateDeferredOperationKHR != nullptr;
+}
+
+uint32_t BottomLevelAS::GetSourcePrimitiveCount()
+{
+	uint32_t primitiveCount = 0;
+	for (auto& cur : m_sourceMeshes)
+	{
+		if (cur != nullptr)
+		{
+			primitiveCount += cur->GetIndexBuffer()->GetIndexCount() / 3;
+		}
+	}
+	return primitiveCount;
+}
+
+void BottomLevelAS::SetMemoryPools(AccelerationStructureMemoryPool* deviceMemoryPool, AccelerationStructureMemoryPool* hostMemoryPool)
+{
+	m_deviceMemoryPool = deviceMemoryPool;
+	m_hostMemoryPool = hostMemoryPool;
+	if (m_accelerationStructure == VK_NULL_HANDLE)
+	{
+		m_memoryPool = deviceMemoryPool;
+	}
+}
+
+bool BottomLevelAS::PrepareBuild(VkAccelerationStructureBuildGeometryInfoKHR& outBuildGeomInfo, bool update, bool hostBuild)
+{
+	if (m_sourceMeshes.empty() || m_sourceMeshes[0] == nullptr)
+	{
+		return false;
+	}
 
-		vertexDataDeviceAddress.deviceAddress = GetBufferDeviceAddress(vertexBuffer->GetBuffer());
-		indexDataDeviceAddress.deviceAddress = GetBufferDeviceAddress(indexBuffer->GetBuffer());
+	if (!update)
+	{
+		//every source mesh is one geometry of the blas, profile of the first mesh is used
+		m_buildProfile = m_sourceMeshes[0]->GetBuildProfile();
+
+		uint32_t geometryCount = static_cast<uint32_t>(m_sourceMeshes.size());
+		m_bottomLevelAsGeometries.resize(geometryCount);
+		m_buildRangeInfos.resize(geometryCount);
+		m_primitiveCounts.resize(geometryCount);
+		for (uint32_t i = 0; i < geometryCount; i++)
+		{
+			if (m_sourceMeshes[i] == nullptr)
+			{
+				return false;
+			}
 
-		m_primitiveCount = indexBuffer->GetIndexCount() / 3;
+			AsVertexBuffer* vertexBuffer = m_sourceMeshes[i]->GetVertexBuffer();
+			AsIndexBuffer* indexBuffer = m_sourceMeshes[i]->GetIndexBuffer();
+			if (vertexBuffer == nullptr || indexBuffer == nullptr)
+			{
+				return false;
+			}
 
-		m_bottomLevelAsGeometry.sType = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_GEOMETRY_KHR;
-		m_bottomLevelAsGeometry.geometryType = VK_GEOMETRY_TYPE_TRIANGLES_KHR;
-		m_bottomLevelAsGeometry.geometry.triangles.sType = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_GEOMETRY_TRIANGLES_DATA_KHR;
-		m_bottomLevelAsGeometry.geometry.triangles.vertexFormat = vertexBuffer->GetVertexFormat();
-		m_bottomLevelAsGeometry.geometry.triangles.vertexData.deviceAddress = vertexBuffer->GetDeviceAddress();
-		m_bottomLevelAsGeometry.geometry.triangles.vertexStride = vertexBuffer->GetStride();
-		m_bottomLevelAsGeometry.geometry.triangles.maxVertex = vertexBuffer->GetVertexCount();
-		m_bottomLevelAsGeometry.geometry.triangles.indexType = indexBuffer->GetIndexType();
-		m_bottomLevelAsGeometry.geometry.triangles.indexData.deviceAddress = indexBuffer->GetDeviceAddress();
-		m_bottomLevelAsGeometry.flags = VK_GEOMETRY_OPAQUE_BIT_KHR;
+			m_primitiveCounts[i] = indexBuffer->GetIndexCount() / 3;
+			if (hostBuild && m_sourceMeshes[i]->GetHostPositions().empty())
+			{
+				return false;
+			}
+
+			VkAccelerationStructureGeometryKHR& asGeometry = m_bottomLevelAsGeometries[i];
+			asGeometry = {};
+			asGeometry.sType = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_GEOMETRY_KHR;
+			asGeometry.geometryType = VK_GEOMETRY_TYPE_TRIANGLES_KHR;
+			asGeometry.geometry.triangles.sType = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_GEOMETRY_TRIANGLES_DATA_KHR;
+			asGeometry.geometry.triangles.maxVertex = vertexBuffer->GetVertexCount();
+			if (hostBuild)
+			{
+				//host build reads the host copies of the mesh
+				asGeometry.geometry.triangles.vertexFormat = VK_FORMAT_R32G32B32_SFLOAT;
+				asGeometry.geometry.triangles.vertexData.hostAddress = m_sourceMeshes[i]->GetHostPositions().data();
+				asGeometry.geometry.triangles.vertexStride = sizeof(glm::vec3);
+				asGeometry.geometry.triangles.indexType = VK_INDEX_TYPE_UINT32;
+				asGeometry.geometry.triangles.indexData.hostAddress = m_sourceMeshes[i]->GetHostIndices().data();
+			}
+			else
+			{
+				asGeometry.geometry.triangles.vertexFormat = vertexBuffer->GetVertexFormat();
+				asGeometry.geometry.triangles.vertexData.deviceAddress = vertexBuffer->GetDeviceAddress();
+				asGeometry.geometry.triangles.vertexStride = vertexBuffer->GetStride();
+				asGeometry.geometry.triangles.indexType = indexBuffer->GetIndexType();
+				asGeometry.geometry.triangles.indexData.deviceAddress = indexBuffer->GetDeviceAddress();
+			}
+			asGeometry.flags = VK_GEOMETRY_OPAQUE_BIT_KHR;
+
+			VkAccelerationStructureBuildRangeInfoKHR& buildRangeInfo = m_buildRangeInfos[i];
+			buildRangeInfo = {};
+			buildRangeInfo.primitiveCount = m_primitiveCounts[i];
+			buildRangeInfo.primitiveOffset = 0;
+			buildRangeInfo.firstVertex = 0;
+			buildRangeInfo.transformOffset = 0;
+		}
 
 		VkAccelerationStructureBuildGeometryInfoKHR asBuildGeomInfo{};
 		asBuildGeomInfo.sType = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_BUILD_GEOMETRY_INFO_KHR;
 		asBuildGeomInfo.type = VK_ACCELERATION_STRUCTURE_TYPE_BOTTOM_LEVEL_KHR;
-		asBuildGeomInfo.flags = VK_BUILD_ACCELERATION_STRUCTURE_PREFER_FAST_TRACE_BIT_KHR;
-		asBuildGeomInfo.geometryCount = 1;
-		asBuildGeomInfo.pGeometries = &m_bottomLevelAsGeometry;
+		asBuildGeomInfo.flags = GetBuildFlags();
+		asBuildGeomInfo.geometryCount = geometryCount;
+		asBuildGeomInfo.pGeometries = m_bottomLevelAsGeometries.data();
 
 		VkAccelerationStructureBuildSizesInfoKHR asBuildSizeInfo{};
 		asBuildSizeInfo.sType = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_BUILD_SIZES_INFO_KHR;
 		vkGetAccelerationStructureBuildSizesKHR
 		(
 			gLogicalDevice,
-			VK_ACCELERATION_STRUCTURE_BUILD_TYPE_DEVICE_KHR,
+			hostBuild ? VK_ACCELERATION_STRUCTURE_BUILD_TYPE_HOST_KHR : VK_ACCELERATION_STRUCTURE_BUILD_TYPE_DEVICE_KHR,
 			&asBuildGeomInfo,
-			&m_primitiveCount,
+			m_primitiveCounts.data(),
 			&asBuildSizeInfo
 		);
 
-		if (!m_asMemory.Initialize(static_cast<uint32_t>(asBuildSizeInfo.accelerationStructureSize), VK_BUFFER_USAGE_ACCELERATION_STRUCTURE_STORAGE_BIT_KHR | VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT))
+		//compacted structure, changed profile or changed build side may not fit, it is created again
+		//host writes the structure immediately, so a host rebuild always goes to a fresh one instead of the traced one
+		//old structure is still referenced by the tlas of the frames in flight, the pool destroys it after their fences
+		if (m_accelerationStructure != VK_NULL_HANDLE && 
+			(m_isCompacted || asBuildSizeInfo.accelerationStructureSize > m_asMemory.Size || m_isHostBuilt || hostBuild))
 		{
-			return false;
+			Destroy();
+			m_isCompacted = false;
 		}
 
-		VkAccelerationStructureCreateInfoKHR asCreateInfo{};
-		asCreateInfo.sType = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_CREATE_INFO_KHR;
-		asCreateInfo.buffer = m_asMemory.GetBuffer();
-		asCreateInfo.size = asBuildSizeInfo.accelerationStructureSize;
-		asCreateInfo.type = VK_ACCELERATION_STRUCTURE_TYPE_BOTTOM_LEVEL_KHR;
-
-		if (vkCreateAccelerationStructureKHR(gLogicalDevice, &asCreateInfo, nullptr, &m_accelerationStructure) != VkResult::VK_SUCCESS)
+		if (m_accelerationStructure == VK_NULL_HANDLE)
 		{
-			REPORT(EReportType::REPORT_TYPE_ERROR, "Blas create failed.");
-			return false;
+			if (hostBuild && m_hostMemoryPool == nullptr)
+			{
+				return false;
+			}
+			m_memoryPool = hostBuild ? m_hostMemoryPool : (m_deviceMemoryPool != nullptr ? m_deviceMemoryPool : m_memoryPool);
+			m_isHostBuilt = hostBuild;
 		}
 
-		if (!m_scratchBuffer.Initialize(static_cast<uint32_t>(asBuildSizeInfo.buildScratchSize), VK_BUFFER_USAGE_ACCELERATION_STRUCTURE_STORAGE_BIT_KHR | VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT))
+		//device rebuild of an existing blas is written into the same structure
+		if (m_accelerationStructure == VK_NULL_HANDLE && 
+			!CreateAccelerationStructure(asBuildSizeInfo.accelerationStructureSize, VK_ACCELERATION_STRUCTURE_TYPE_BOTTOM_LEVEL_KHR, m_asMemory, m_accelerationStructure))
 		{
+			REPORT(EReportType::REPORT_TYPE_ERROR, "Blas create failed.");
 			return false;
 		}
+
+		m_buildScratchSize = asBuildSizeInfo.buildScratchSize;
+		m_updateScratchSize = asBuildSizeInfo.updateScratchSize;
 	}
 
-	VkAccelerationStructureBuildGeometryInfoKHR asBuildGeomInfo = {};
-	asBuildGeomInfo.sType = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_BUILD_GEOMETRY_INFO_KHR;
-	asBuildGeomInfo.type = VK_ACCELERATION_STRUCTURE_TYPE_BOTTOM_LEVEL_KHR;
-	asBuildGeomInfo.flags = VK_BUILD_ACCELERATION_STRUCTURE_PREFER_FAST_TRACE_BIT_KHR | VK_BUILD_ACCELERATION_STRUCTURE_ALLOW_UPDATE_BIT_KHR;
+	outBuildGeomInfo = {};
+	outBuildGeomInfo.sType = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_BUILD_GEOMETRY_INFO_KHR;
+	outBuildGeomInfo.type = VK_ACCELERATION_STRUCTURE_TYPE_BOTTOM_LEVEL_KHR;
+	outBuildGeomInfo.flags = GetBuildFlags();
 	if (update)
 	{	
-		asBuildGeomInfo.srcAccelerationStructure = m_accelerationStructure;
+		outBuildGeomInfo.srcAccelerationStructure = m_accelerationStructure;
 	}
-	asBuildGeomInfo.dstAccelerationStructure = m_accelerationStructure;
-	asBuildGeomInfo.geometryCount = 1;
-	asBuildGeomInfo.pGeometries = &m_bottomLevelAsGeometry;
-	asBuildGeomInfo.scratchData.deviceAddress = m_scratchBuffer.GetDeviceMemoryAddress();
+	outBuildGeomInfo.dstAccelerationStructure = m_accelerationStructure;
+	outBuildGeomInfo.geometryCount = static_cast<uint32_t>(m_bottomLevelAsGeometries.size());
+	outBuildGeomInfo.pGeometries = m_bottomLevelAsGeometries.data();
 
-	VkAccelerationStructureBuildRangeInfoKHR asBuildRangeInfo = {};
-	asBuildRangeInfo.primitiveCount = m_primitiveCount;
-	asBuildRangeInfo.primitiveOffset = 0;
-	asBuildRangeInfo.firstVertex = 0;
-	asBuildRangeInfo.transformOffset = 0;
+	return true;
+}
 
-	std::vector<VkAccelerationStructureBuildRangeInfoKHR*> asBuildRangeInfos = { &asBuildRangeInfo };
+void BottomLevelAS::OnBuildCommandWritten(bool update)
+{
+	m_refitCount = update ? m_refitCount + 1 : 0;
 
-	vkCmdBuildAccelerationStructuresKHR(commandBuffer, 1, &asBuildGeomInfo, asBuildRangeInfos.data());
+	VkAccelerationStructureDeviceAddressInfoKHR asDeviceAddressInfo = {};
+	asDeviceAddressInfo.sType = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_DEVICE_ADDRESS_INFO_KHR;
+	asDeviceAddressInfo.accelerationStructure = m_accelerationStructure;
+	m_handle = vkGetAccelerationStructureDeviceAddressKHR(gLogicalDevice, &asDeviceAddressInfo);
+
+	m_buildState = EBlasBuildState::BUILDED;
+}
+
+VkBuildAccelerationStructureFlagsKHR BottomLevelAS::GetBuildFlags()
+{
+	//size query and build must use same flags
+	VkBuildAccelerationStructureFlagsKHR buildFlags = 0;
+	switch (m_buildProfile)
+	{
+	case EAsBuildProfile::STATIC:
+		buildFlags = VK_BUILD_ACCELERATION_STRUCTURE_PREFER_FAST_TRACE_BIT_KHR;
+		if (m_allowCompaction)
+		{
+			buildFlags |= VK_BUILD_ACCELERATION_STRUCTURE_ALLOW_COMPACTION_BIT_KHR;
+		}
+		break;
+	case EAsBuildProfile::DYNAMIC:
+		buildFlags = VK_BUILD_ACCELERATION_STRUCTURE_PREFER_FAST_BUILD_BIT_KHR | VK_BUILD_ACCELERATION_STRUCTURE_ALLOW_UPDATE_BIT_KHR;
+		break;
+	case EAsBuildProfile::DEFORMING:
+		buildFlags = VK_BUILD_ACCELERATION_STRUCTURE_PREFER_FAST_TRACE_BIT_KHR | VK_BUILD_ACCELERATION_STRUCTURE_ALLOW_UPDATE_BIT_KHR;
+		break;
+	}
+	return buildFlags;
+}
+
+bool BottomLevelAS::CanRefit()
+{
+	if (m_accelerationStructure == VK_NULL_HANDLE || m_buildProfile == EAsBuildProfile::STATIC)
+	{
+		return false;
+	}
+	return !m_sourceMeshes.empty() && m_sourceMeshes[0]->GetBuildProfile() == m_buildProfile;
+}
+
+bool BottomLevelAS::WriteCompactCommand(VkCommandBuffer commandBuffer, VkDeviceSize compactedSize)
+{
+	if (compactedSize == 0 || compactedSize >= m_asMemory.Size)
+	{
+		return false;
+	}
+
+	if (!CreateAccelerationStructure(compactedSize, VK_ACCELERATION_STRUCTURE_TYPE_BOTTOM_LEVEL_KHR, m_compactedAsMemory, m_compactedAccelerationStructure))
+	{
+		REPORT(EReportType::REPORT_TYPE_ERROR, "Compacted blas create failed.");
+		return false;
+	}
+
+	VkCopyAccelerationStructureInfoKHR copyInfo = {};
+	copyInfo.sType = VK_STRUCTURE_TYPE_COPY_ACCELERATION_STRUCTURE_INFO_KHR;
+	copyInfo.src = m_accelerationStructure;
+	copyInfo.dst = m_compactedAccelerationStructure;
+	copyInfo.mode = VK_COPY_ACCELERATION_STRUCTURE_MODE_COMPACT_KHR;
+	vkCmdCopyAccelerationStructureKHR(commandBuffer, &copyInfo);
+
+	return true;
+}
+
+void BottomLevelAS::OnCompacted()
+{
+	if (m_compactedAccelerationStructure == VK_NULL_HANDLE)
+	{
+		return;
+	}
+
+	char message[256] = {};
+	sprintf_s
+	(
+		message,
+		"Blas compaction : mesh %llu, %llu bytes -> %llu bytes.",
+		m_sourceMeshes[0]->GetUID(),
+		static_cast<unsigned long long>(m_asMemory.Size),
+		static_cast<unsigned long long>(m_compactedAsMemory.Size)
+	);
+	REPORT(EReportType::REPORT_TYPE_LOG, message);
+
+	//source structure is retired to the pool, its range is reused once the frames in flight are completed
+	DestroyAccelerationStructure(m_asMemory, m_accelerationStructure);
+
+	m_accelerationStructure = m_compactedAccelerationStructure;
+	m_asMemory = m_compactedAsMemory;
+	m_compactedAccelerationStructure = VK_NULL_HANDLE;
+	m_compactedAsMemory = {};
+	m_isCompacted = true;
+
+	OnBuildCommandWritten();
+}
+
+bool BottomLevelAS::WriteSerializeCommand(VkCommandBuffer commandBuffer, VkDeviceAddress dstAddress)
+{
+	if (m_accelerationStructure == VK_NULL_HANDLE || m_buildState != EBlasBuildState::BUILDED)
+	{
+		return false;
+	}
+
+	VkCopyAccelerationStructureToMemoryInfoKHR copyInfo = {};
+	copyInfo.sType = VK_STRUCTURE_TYPE_COPY_ACCELERATION_STRUCTURE_TO_MEMORY_INFO_KHR;
+	copyInfo.src = m_accelerationStructure;
+	copyInfo.dst.deviceAddress = dstAddress;
+	copyInfo.mode = VK_COPY_ACCELERATION_STRUCTURE_MODE_SERIALIZE_KHR;
+	vkCmdCopyAccelerationStructureToMemoryKHR(commandBuffer, &copyInfo);
+
+	return true;
+}
+
+bool BottomLevelAS::WriteDeserializeCommand(VkCommandBuffer commandBuffer, VkDeviceAddress srcAddress, VkDeviceSize deserializedSize)
+{
+	if (m_sourceMeshes.empty() || m_sourceMeshes[0] == nullptr || m_accelerationStructure != VK_NULL_HANDLE)
+	{
+		return false;
+	}
+
+	if (!CreateAccelerationStructure(deserializedSize, VK_ACCELERATION_STRUCTURE_TYPE_BOTTOM_LEVEL_KHR, m_asMemory, m_accelerationStructure))
+	{
+		REPORT(EReportType::REPORT_TYPE_ERROR, "Cached blas create failed.");
+		return false;
+	}
+
+	VkCopyMemoryToAccelerationStructureInfoKHR copyInfo = {};
+	copyInfo.sType = VK_STRUCTURE_TYPE_COPY_MEMORY_TO_ACCELERATION_STRUCTURE_INFO_KHR;
+	copyInfo.src.deviceAddress = srcAddress;
+	copyInfo.dst = m_accelerationStructure;
+	copyInfo.mode = VK_COPY_ACCELERATION_STRUCTURE_MODE_DESERIALIZE_KHR;
+	vkCmdCopyMemoryToAccelerationStructureKHR(commandBuffer, &copyInfo);
+
+	//cached blas is stored after compaction, a later full build creates the structure again
+	m_buildProfile = m_sourceMeshes[0]->GetBuildProfile();
+	m_isCompacted = true;
+	m_isLoadedFromCache = true;
+	OnBuildCommandWritten();
+
+	return true;
+}
 
+void BottomLevelAS::WriteBuildBarrier(VkCommandBuffer commandBuffer)
+{
 	VkMemoryBarrier memoryBarrier;
 	memoryBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
 	memoryBarrier.pNext = nullptr;
@@ -138,15 +575,6 @@ bool BottomLevelAS::Build(VkCommandBuffer commandBuffer, bool update)
 		0, 
 		nullptr
 	);
-
-	VkAccelerationStructureDeviceAddressInfoKHR asDeviceAddressInfo = {};
-	asDeviceAddressInfo.sType = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_DEVICE_ADDRESS_INFO_KHR;
-	asDeviceAddressInfo.accelerationStructure = m_accelerationStructure;
-	m_handle = vkGetAccelerationStructureDeviceAddressKHR(gLogicalDevice, &asDeviceAddressInfo);
-
-	m_buildState = EBlasBuildState::BUILDED;
-
-	return true;
 }
 
 
@@ -161,170 +589,658 @@ void BottomLevelAsGroup::Clear()
 		}
 	}
 	m_instancesDeviceBuffer.Destroy();
+	m_dirtyInstanceIndices.clear();
+	m_instanceDirtyFlags.clear();
+	m_asInstanceDescs.clear();
+	m_instanceIndexTable.clear();
+	m_geometryTable.clear();
+	m_slotInstanceOffsets.clear();
+	m_slotInstanceIndices.clear();
+	m_transformUpdatedInstances.clear();
+}
+
+void BottomLevelAsGroup::Build(VkCommandBuffer commandBuffer)
+{
+	if (!m_isBuilded)
+	{
+		uint32_t meshCount = gGeomContainer.GetMeshCount();
+		m_blasList.resize(meshCount);
+		for (uint32_t i = 0; i < meshCount; i++)
+		{
+			SimpleMeshData* mesh = gGeomContainer.GetMesh(i);
+			BindMeshUpdatedCallback(mesh);
+			SimpleGeometry* parentGeometry = mesh->GetParentGeometry();
+			if (parentGeometry != nullptr && parentGeometry->IsMergeMeshes() && parentGeometry->GetMeshCount() > 1)
+			{
+				//merged blas is built once at the first mesh of the geometry
+				if (parentGeometry->GetMesh(0) != mesh)
+				{
+					m_blasList[i] = nullptr;
+					continue;
+				}
+
+				std::vector<SimpleMeshData*> sourceMeshes;
+				for (uint32_t j = 0; j < parentGeometry->GetMeshCount(); j++)
+				{
+					sourceMeshes.push_back(parentGeometry->GetMesh(j));
+				}
+				m_blasList[i] = new BottomLevelAS();
+				m_blasList[i]->SetSourceMeshes(sourceMeshes);
+			}
+			else
+			{
+				m_blasList[i] = new BottomLevelAS();
+				m_blasList[i]->SetSourceMesh(mesh);
+			}
+			m_blasList[i]->SetMemoryPools(m_memoryPool, m_hostMemoryPool);
+			m_blasList[i]->SetAllowCompaction(m_useCompaction);
+		}
+
+		if (m_asCache != nullptr && m_asCache->IsEnabled())
+		{
+			for (auto& cur : m_blasList)
+			{
+				if (cur != nullptr)
+				{
+					m_asCache->Load(commandBuffer, cur);
+				}
+			}
+		}
+		BuildPendingBlas(commandBuffer);
+		WriteCompactionQuery(commandBuffer);
+
+		m_meshLoadedCallbackHandle = gGeomContainer.OnMeshLoaded.Add
+		(
+			[this](UID uid)
+			{
+				OnMeshAdded(uid);
+			}
+		);
+
+		m_meshUnloadedCallbackHandle = gGeomContainer.OnMeshUnloaded.Add
+		(
+			[this](UID uid)
+			{
+				OnMeshRemoved(uid);
+			}
+		);
+
+		m_instPreMeshAddedCallbackHandle = gRenderObjContainer.OnInstPerMeshAdded.Add
+		(
+			[this](RenderObjectIndexRange range)
+			{
+				OnInstPerMeshAdded(range);
+			}
+		);
+
+		m_instPerMeshRemovedCallbackHandle = gRenderObjContainer.OnInstPerMeshRemoved.Add
+		(
+			[this](RenderObjectIndexRange range)
+			{
+				OnInstPerMeshRemoved(range);
+			}
+		);
+	}
+}
+
+void BottomLevelAsGroup::Update(VkCommandBuffer commandBuffer)
+{
+	if (commandBuffer != VK_NULL_HANDLE)
+	{
+		BuildPendingBlas(commandBuffer);
+	}
+
+	if (m_instanceLayoutChanged)
+	{
+		RefreshBlasList();
+	}
+	else
+	{
+		UpdateInstanceTransforms();
+		UploadDirtyInstances();
+	}
+}
+
+bool BottomLevelAsGroup::IsInstanceTransformChanged()
+{
+	return gRenderObjContainer.GetTransformStore().HasDirty();
+}
+
+bool BottomLevelAsGroup::HasPendingBlas()
+{
+	for (auto& cur : m_blasList)
+	{
+		if (cur != nullptr && cur->GetBuildState() != EBlasBuildState::BUILDED)
+		{
+			return true;
+		}
+	}
+	return false;
+}
+
+void BottomLevelAsGroup::BuildPendingBlas(VkCommandBuffer commandBuffer)
+{
+	std::vector<BottomLevelAS*> pendingBlasList;
+	std::vector<bool> updateList;
+	std::vector<VkDeviceAddress> prevHandles;
+	for (auto& cur : m_blasList)
+	{
+		if (cur != nullptr && cur->GetBuildState() != EBlasBuildState::BUILDED)
+		{
+			//static blas and blas of changed profile are rebuilt instead of refitted
+			bool update = cur->GetBuildState() == EBlasBuildState::NEED_UPDATE_BUILD && cur->CanRefit();
+			if (update && 
+				cur->GetBuildProfile() == EAsBuildProfile::DEFORMING && 
+				m_rebuildPolicy != nullptr && 
+				m_rebuildPolicy->ShouldRebuildBlas(cur->GetRefitCount()))
+			{
+				update = false;
+			}
+			pendingBlasList.push_back(cur);
+			updateList.push_back(update);
+			prevHandles.push_back(cur->GetAsHandle());
+		}
+	}
+
+	if (pendingBlasList.empty())
+	{
+		return;
+	}
+
+	uint32_t batchPrimitiveCount = 0;
+	bool hasUpdatedMesh = false;
+	for (auto& cur : pendingBlasList)
+	{
+		batchPrimitiveCount += cur->GetSourcePrimitiveCount();
+		hasUpdatedMesh |= cur->GetBuildState() == EBlasBuildState::NEED_UPDATE_BUILD;
+	}
+
+	//updated vertices are written on device, host copies of the meshes are the rest pose
+	bool buildOnHost = !hasUpdatedMesh &&
+					   m_hostMemoryPool != nullptr && 
+					   m_hostWorkerPool != nullptr && 
+					   m_rebuildPolicy != nullptr && 
+					   m_rebuildPolicy->ShouldBuildOnHost(batchPrimitiveCount);
+	if (buildOnHost)
+	{
+		//existing structures may still be read by traces in flight, host builds write fresh ones and retire them
+		if (!BottomLevelAS::BuildBatchOnHost(pendingBlasList, updateList, m_hostWorkerPool))
+		{
+			REPORT(EReportType::REPORT_TYPE_WARN, "Some of host blas build failed.");
+		}
+	}
+	else if (!BottomLevelAS::BuildBatch(commandBuffer, pendingBlasList, updateList, m_scratchArena))
+	{
+		REPORT(EReportType::REPORT_TYPE_WARN, "Some of blas build failed.");
+	}
+
+	//recreated blas has a new address, instances referencing it must be refreshed
+	for (uint32_t i = 0; i < pendingBlasList.size(); i++)
+	{
+		if (prevHandles[i] != 0 && prevHandles[i] != pendingBlasList[i]->GetAsHandle())
+		{
+			m_instanceLayoutChanged = true;
+		}
+	}
+}
+
+void BottomLevelAsGroup::WriteCompactionQuery(VkCommandBuffer commandBuffer)
+{
+	m_compactionCandidates.clear();
+	std::vector<VkAccelerationStructureKHR> asList;
+	for (auto& cur : m_blasList)
+	{
+		if (cur != nullptr && cur->IsAllowCompaction() && !cur->IsCompacted() && !cur->IsHostBuilt() && cur->GetBuildState() == EBlasBuildState::BUILDED)
+		{
+			m_compactionCandidates.push_back(cur);
+			asList.push_back(cur->GetAccelerationStructure());
+		}
+	}
+	if (m_compactionCandidates.empty())
+	{
+		return;
+	}
+
+	VkQueryPoolCreateInfo queryPoolCreateInfo = {};
+	queryPoolCreateInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+	queryPoolCreateInfo.queryType = VK_QUERY_TYPE_ACCELERATION_STRUCTURE_COMPACTED_SIZE_KHR;
+	queryPoolCreateInfo.queryCount = static_cast<uint32_t>(asList.size());
+	if (vkCreateQueryPool(gLogicalDevice, &queryPoolCreateInfo, nullptr, &m_compactionQueryPool) != VkResult::VK_SUCCESS)
+	{
+		REPORT(EReportType::REPORT_TYPE_WARN, "Compaction query pool create failed.");
+		m_compactionCandidates.clear();
+		return;
+	}
+
+	vkCmdResetQueryPool(commandBuffer, m_compactionQueryPool, 0, static_cast<uint32_t>(asList.size()));
+	vkCmdWriteAccelerationStructuresPropertiesKHR
+	(
+		commandBuffer,
+		static_cast<uint32_t>(asList.size()),
+		asList.data(),
+		VK_QUERY_TYPE_ACCELERATION_STRUCTURE_COMPACTED_SIZE_KHR,
+		m_compactionQueryPool,
+		0
+	);
+}
+
+bool BottomLevelAsGroup::CompactBlas()
+{
+	if (m_compactionQueryPool == VK_NULL_HANDLE)
+	{
+		return true;
+	}
+
+	uint32_t candidateCount = static_cast<uint32_t>(m_compactionCandidates.size());
+	std::vector<VkDeviceSize> compactedSizes(candidateCount, 0);
+	VkResult res = vkGetQueryPoolResults
+	(
+		gLogicalDevice,
+		m_compactionQueryPool,
+		0,
+		candidateCount,
+		sizeof(VkDeviceSize) * candidateCount,
+		compactedSizes.data(),
+		sizeof(VkDeviceSize),
+		VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WAIT_BIT
+	);
+	vkDestroyQueryPool(gLogicalDevice, m_compactionQueryPool, nullptr);
+	m_compactionQueryPool = VK_NULL_HANDLE;
+
+	if (res != VkResult::VK_SUCCESS)
+	{
+		REPORT(EReportType::REPORT_TYPE_WARN, "Compacted size query failed.");
+		m_compactionCandidates.clear();
+		return false;
+	}
+
+	SingleTimeCommandBuffer singleTimeCmdBuffer;
+	singleTimeCmdBuffer.Begin();
+	for (uint32_t i = 0; i < candidateCount; i++)
+	{
+		m_compactionCandidates[i]->WriteCompactCommand(singleTimeCmdBuffer.GetCommandBuffer(), compactedSizes[i]);
+	}
+	singleTimeCmdBuffer.End();
+
+	VkDeviceSize sizeBefore = 0;
+	VkDeviceSize sizeAfter = 0;
+	for (auto& cur : m_compactionCandidates)
+	{
+		sizeBefore += cur->GetMemorySize();
+		cur->OnCompacted();
+		sizeAfter += cur->GetMemorySize();
+	}
+	m_compactionCandidates.clear();
+
+	char message[256] = {};
+	sprintf_s(message, "Blas compaction total : %llu bytes -> %llu bytes.", static_cast<unsigned long long>(sizeBefore), static_cast<unsigned long long>(sizeAfter));
+	REPORT(EReportType::REPORT_TYPE_LOG, message);
+
+	return true;
+}
+
+void BottomLevelAsGroup::StoreCachedBlas()
+{
+	if (m_asCache == nullptr || !m_asCache->IsEnabled())
+	{
+		return;
+	}
+
+	std::vector<BottomLevelAS*> storeList;
+	for (auto& cur : m_blasList)
+	{
+		if (cur != nullptr && !cur->IsLoadedFromCache() && !cur->IsHostBuilt() && cur->GetBuildState() == EBlasBuildState::BUILDED)
+		{
+			storeList.push_back(cur);
+		}
+	}
+	m_asCache->Store(storeList);
+}
+
+void BottomLevelAsGroup::SetInstanceData(uint32_t index)
+{
+	AsInstanceDesc& instanceDesc = m_asInstanceDescs[index];
+	SampleRenderObjectInstancePerMesh* curInstPerMesh = gRenderObjContainer.GetRenderObjectInstancePerMesh(instanceDesc.InstPerMeshIndex);
+
+	//sbt stride is zero, every geometry of a merged instance uses the hit group of the first one
+	SimpleMaterial* material = curInstPerMesh->GetMaterial();
+
+	BottomLevelAS* blas = GetBlas(curInstPerMesh->GetMeshData());
+	uint32_t hitGroupIndex = gHitGroupContainer.GetBindIndex(material->m_hitShaderGroup);
+	m_asInstances[index].accelerationStructureReference = blas->GetAsHandle();
+	m_asInstances[index].instanceCustomIndex = index;
+	m_asInstances[index].mask = 0xFF;
+	m_asInstances[index].instanceShaderBindingTableRecordOffset = hitGroupIndex;
+	if (material->m_mateiralTypeIndex == static_cast<uint32_t>(EMaterialType::SURFACE_TYPE_TRANSPARENT))
+	{
+		m_asInstances[index].flags = VK_GEOMETRY_INSTANCE_TRIANGLE_FRONT_COUNTERCLOCKWISE_BIT_KHR | VK_GEOMETRY_INSTANCE_FORCE_NO_OPAQUE_BIT_KHR;
+	}
+	else
+	{
+		m_asInstances[index].flags = VK_GEOMETRY_INSTANCE_TRIANGLE_FRONT_COUNTERCLOCKWISE_BIT_KHR;
+	}
+
+	SimpleMeshData* firstMeshData = m_geometryTable[instanceDesc.GeometryTableOffset]->GetMeshData();
+	glm::vec3 boundsMin = firstMeshData->GetBoundsMin();
+	glm::vec3 boundsMax = firstMeshData->GetBoundsMax();
+	for (uint32_t i = 1; i < instanceDesc.GeometryCount; i++)
+	{
+		SimpleMeshData* meshData = m_geometryTable[instanceDesc.GeometryTableOffset + i]->GetMeshData();
+		boundsMin = glm::min(boundsMin, meshData->GetBoundsMin());
+		boundsMax = glm::max(boundsMax, meshData->GetBoundsMax());
+	}
+	m_instanceLocalCenters[index] = (boundsMin + boundsMax) * 0.5f;
+	m_instanceLocalHalfExtents[index] = (boundsMax - boundsMin) * 0.5f;
+
+	WriteInstanceTransform(index, gRenderObjContainer.GetTransformStore().GetRows(instanceDesc.TransformSlot));
+}
+
+void BottomLevelAsGroup::WriteInstanceTransform(uint32_t index, InstanceTransformRows& rows)
+{
+	InstanceTransformStore::CopyRows(rows, &m_asInstances[index].transform.matrix[0][0]);
+	MarkInstanceDirty(index);
+
+	//bounds are moved with the rows directly, no world matrix is built
+	glm::vec4 localCenter = glm::vec4(m_instanceLocalCenters[index], 1.0f);
+	glm::vec3& localHalfExtent = m_instanceLocalHalfExtents[index];
+	glm::vec3 worldCenter = glm::vec3(glm::dot(rows.Rows[0], localCenter), glm::dot(rows.Rows[1], localCenter), glm::dot(rows.Rows[2], localCenter));
+	glm::vec3 worldHalfExtent = glm::vec3
+	(
+		glm::dot(glm::abs(glm::vec3(rows.Rows[0])), localHalfExtent),
+		glm::dot(glm::abs(glm::vec3(rows.Rows[1])), localHalfExtent),
+		glm::dot(glm::abs(glm::vec3(rows.Rows[2])), localHalfExtent)
+	);
+	UpdateInstanceMovement(index, worldCenter, glm::length(worldHalfExtent) * 2.0f);
+}
+
+void BottomLevelAsGroup::UpdateInstanceTransforms()
+{
+	InstanceTransformStore& transformStore = gRenderObjContainer.GetTransformStore();
+	if (!transformStore.HasDirty())
+	{
+		return;
+	}
+
+	//only dirty slots are visited, each writes the tlas instances mapped to it
+	uint32_t slotCount = m_slotInstanceOffsets.empty() ? 0 : static_cast<uint32_t>(m_slotInstanceOffsets.size()) - 1;
+	transformStore.ConsumeDirty
+	(
+		[this, &transformStore, slotCount](uint32_t slot)
+		{
+			//slots allocated after the last layout refresh are written by the refresh of their instances
+			if (slot >= slotCount)
+			{
+				return;
+			}
+			InstanceTransformRows& rows = transformStore.GetRows(slot);
+			for (uint32_t i = m_slotInstanceOffsets[slot]; i < m_slotInstanceOffsets[slot + 1]; i++)
+			{
+				uint32_t instanceIndex = m_slotInstanceIndices[i];
+				WriteInstanceTransform(instanceIndex, rows);
+				m_transformUpdatedInstances.push_back(instanceIndex);
+			}
+		}
+	);
+}
+
+void BottomLevelAsGroup::BindMeshUpdatedCallback(SimpleMeshData* meshData)
+{
+	UID meshUID = meshData->GetUID();
+	meshData->OnMeshUpdated.Bind
+	(
+		[this, meshUID](uint32_t index)
+		{
+			OnMeshUpdated(meshUID);
+		}
+	);
 }
 
-void BottomLevelAsGroup::Build(VkCommandBuffer commandBuffer)
+void BottomLevelAsGroup::RefreshInstanceIndexTable()
 {
-	if (!m_isBuilded)
+	uint32_t instPerMeshCount = gRenderObjContainer.GetRenderObjectInstancePerMeshCount();
+	m_instanceIndexTable.assign(instPerMeshCount, INVALID_INDEX_INT);
+	m_asInstanceDescs.clear();
+	m_geometryTable.clear();
+	for (uint32_t i = 0; i < instPerMeshCount; i++)
 	{
-		uint32_t meshCount = gGeomContainer.GetMeshCount();
-		m_blasList.resize(meshCount);
-		for (uint32_t i = 0; i < meshCount; i++)
+		SampleRenderObjectInstancePerMesh* curInstPerMesh = gRenderObjContainer.GetRenderObjectInstancePerMesh(i);
+		BottomLevelAS* blas = GetBlas(curInstPerMesh->GetMeshData());
+		if (blas == nullptr)
 		{
-			SimpleMeshData* mesh = gGeomContainer.GetMesh(i);
-			m_blasList[i] = new BottomLevelAS();
-			m_blasList[i]->SetSourceMesh(mesh);
-			m_blasList[i]->Build(commandBuffer);
+			continue;
 		}
 
-		RefreshBlasList();
-
-		m_meshLoadedCallbackHandle = gGeomContainer.OnMeshLoaded.Add
-		(
-			[this](UID uid)
+		AsInstanceDesc instanceDesc = {};
+		instanceDesc.InstPerMeshIndex = i;
+		instanceDesc.TransformSlot = curInstPerMesh->GetParentInstance()->GetTransformSlot();
+		instanceDesc.GeometryTableOffset = static_cast<uint32_t>(m_geometryTable.size());
+		if (blas->GetSourceMeshCount() > 1)
+		{
+			//instances per mesh are created in the mesh order of the geometry, the first one makes the merged instance
+			SampleRenderObjectInstance* parentInst = curInstPerMesh->GetParentInstance();
+			if (parentInst->GetInstancePerMesh(0) != curInstPerMesh)
 			{
-				OnMeshAdded(uid);
+				continue;
 			}
-		);
-
-		m_meshUnloadedCallbackHandle = gGeomContainer.OnMeshUnloaded.Add
-		(
-			[this](UID uid)
+			for (uint32_t j = 0; j < blas->GetSourceMeshCount(); j++)
 			{
-				OnMeshRemoved(uid);
+				m_geometryTable.push_back(parentInst->GetInstancePerMesh(j));
 			}
-		);
+		}
+		else
+		{
+			m_geometryTable.push_back(curInstPerMesh);
+		}
+		instanceDesc.GeometryCount = static_cast<uint32_t>(m_geometryTable.size()) - instanceDesc.GeometryTableOffset;
 
-		m_instPreMeshAddedCallbackHandle = gRenderObjContainer.OnInstPerMeshAdded.Add
-		(
-			[this](uint32_t index)
-			{
-				OnInstPerMeshAdded(index);
-			}
-		);
+		m_instanceIndexTable[i] = static_cast<int>(m_asInstanceDescs.size());
+		m_asInstanceDescs.push_back(instanceDesc);
+	}
 
-		m_instPerMeshRemovedCallbackHandle = gRenderObjContainer.OnInstPerMeshRemoved.Add
-		(
-			[this](uint32_t index)
-			{
-				OnInstPerMeshRemoved(index);
-			}
-		);
+	//counting sort of the instances by transform slot
+	uint32_t slotCount = gRenderObjContainer.GetTransformStore().GetCapacity();
+	uint32_t instanceCount = static_cast<uint32_t>(m_asInstanceDescs.size());
+	m_slotInstanceOffsets.assign(slotCount + 1, 0);
+	for (auto& cur : m_asInstanceDescs)
+	{
+		m_slotInstanceOffsets[cur.TransformSlot + 1]++;
+	}
+	for (uint32_t i = 0; i < slotCount; i++)
+	{
+		m_slotInstanceOffsets[i + 1] += m_slotInstanceOffsets[i];
+	}
+	std::vector<uint32_t> slotCursors(m_slotInstanceOffsets.begin(), m_slotInstanceOffsets.end() - 1);
+	m_slotInstanceIndices.resize(instanceCount);
+	for (uint32_t i = 0; i < instanceCount; i++)
+	{
+		m_slotInstanceIndices[slotCursors[m_asInstanceDescs[i].TransformSlot]++] = i;
 	}
 }
 
-void BottomLevelAsGroup::Update(VkCommandBuffer commandBuffer)
+BottomLevelAS* BottomLevelAsGroup::GetBlas(SimpleMeshData* meshData)
 {
-	if (commandBuffer != VK_NULL_HANDLE)
+	if (meshData == nullptr)
 	{
-		for (auto& cur : m_blasList)
-		{
-			if (cur->GetBuildState() != EBlasBuildState::BUILDED)
-			{
-				cur->Build(commandBuffer, true);
-			}
-		}
+		return nullptr;
+	}
+
+	int index = gGeomContainer.GetMeshBindIndex(meshData);
+	if (index == INVALID_INDEX_INT || index >= static_cast<int>(m_blasList.size()))
+	{
+		return nullptr;
 	}
 
-	if (m_instanceListChanged)
+	//other meshes of a merged geometry refer the blas at the first mesh
+	if (m_blasList[index] == nullptr && meshData->GetParentGeometry() != nullptr)
 	{
-		RefreshInstanceBufferDatas();
-		RefreshBlasList(true);
+		index = gGeomContainer.GetMeshBindIndex(meshData->GetParentGeometry()->GetMesh(0));
+		if (index == INVALID_INDEX_INT || index >= static_cast<int>(m_blasList.size()))
+		{
+			return nullptr;
+		}
 	}
+
+	return m_blasList[index];
 }
 
-void BottomLevelAsGroup::SetInstanceData(int index, bool update)
+void BottomLevelAsGroup::UpdateInstanceMovement(uint32_t index, glm::vec3& center, float extent)
 {
-	SampleRenderObjectInstancePerMesh* curInstPerMesh = gRenderObjContainer.GetRenderObjectInstancePerMesh(index);
-	if (!update)
+	if (index >= m_instanceCenters.size())
 	{
-		curInstPerMesh->GetParentInstance()->OnInstanceUpdated.Add
-		(
-			[this](uint32_t index)
-			{
-				OnInstPerMeshUpdated(index);
-			}
-		);
-		
-		UID meshUID = curInstPerMesh->GetMeshData()->GetUID();
-		curInstPerMesh->OnMeshUpdated.Add
-		(
-			[this, meshUID](VkCommandBuffer cmdBuffer)
-			{
-				OnMeshUpdated(meshUID);
-			}
-		);
+		m_instanceCenters.resize(index + 1, center);
+		m_instanceExtents.resize(index + 1, 0.0f);
+		for (uint32_t i = 0; i < m_instanceRebuildCenters.size(); i++)
+		{
+			m_instanceRebuildCenters[i].resize(index + 1, center);
+			m_instanceMovements[i].resize(index + 1, 0.0f);
+		}
 	}
 
-	glm::mat3x4 curMat = glm::mat3x4(glm::transpose(curInstPerMesh->GetParentInstance()->GetWorldMatrix()));
-	m_asInstances[index].transform = 
+	for (uint32_t i = 0; i < m_instanceRebuildCenters.size(); i++)
 	{
-		curMat[0].x, curMat[0].y, curMat[0].z, curMat[0].w,
-		curMat[1].x, curMat[1].y, curMat[1].z, curMat[1].w,
-		curMat[2].x, curMat[2].y, curMat[2].z, curMat[2].w
-	};
+		float movement = glm::length(center - m_instanceRebuildCenters[i][index]);
+		m_totalInstanceMovements[i] += movement - m_instanceMovements[i][index];
+		m_instanceMovements[i][index] = movement;
+	}
+	m_totalInstanceExtent += extent - m_instanceExtents[index];
 
-	SimpleMaterial* material = curInstPerMesh->GetMaterial();
+	m_instanceCenters[index] = center;
+	m_instanceExtents[index] = extent;
+}
 
-	uint32_t meshIndex = gGeomContainer.GetMeshBindIndex(curInstPerMesh->GetMeshData());
-	uint32_t hitGroupIndex = gHitGroupContainer.GetBindIndex(material->m_hitShaderGroup);
-	m_asInstances[index].accelerationStructureReference = m_blasList[meshIndex]->GetAsHandle();
-	m_asInstances[index].instanceCustomIndex = index;
-	m_asInstances[index].mask = 0xFF;
-	m_asInstances[index].instanceShaderBindingTableRecordOffset = hitGroupIndex;
-	if (material->m_mateiralTypeIndex == static_cast<uint32_t>(EMaterialType::SURFACE_TYPE_TRANSPARENT))
+void BottomLevelAsGroup::SetTlasCount(uint32_t tlasCount)
+{
+	m_instanceRebuildCenters.resize(tlasCount, m_instanceCenters);
+	m_instanceMovements.resize(tlasCount, std::vector<float>(m_instanceCenters.size(), 0.0f));
+	m_totalInstanceMovements.resize(tlasCount, 0.0f);
+}
+
+void BottomLevelAsGroup::ResetInstanceMovement(uint32_t tlasIndex)
+{
+	m_instanceRebuildCenters[tlasIndex] = m_instanceCenters;
+	m_instanceMovements[tlasIndex].assign(m_instanceCenters.size(), 0.0f);
+	m_totalInstanceMovements[tlasIndex] = 0.0f;
+}
+
+void BottomLevelAsGroup::MarkInstanceDirty(uint32_t index)
+{
+	if (m_instanceDirtyFlags.size() < m_asInstances.size())
 	{
-		m_asInstances[index].flags = VK_GEOMETRY_INSTANCE_TRIANGLE_FRONT_COUNTERCLOCKWISE_BIT_KHR | VK_GEOMETRY_INSTANCE_FORCE_NO_OPAQUE_BIT_KHR;
+		m_instanceDirtyFlags.resize(m_asInstances.size(), false);
 	}
-	else
+	if (!m_instanceDirtyFlags[index])
 	{
-		m_asInstances[index].flags = VK_GEOMETRY_INSTANCE_TRIANGLE_FRONT_COUNTERCLOCKWISE_BIT_KHR;
+		m_instanceDirtyFlags[index] = true;
+		m_dirtyInstanceIndices.push_back(index);
 	}
 }
 
-void BottomLevelAsGroup::RefreshInstanceDatas(bool update)
+void BottomLevelAsGroup::RefreshInstanceDatas()
 {
-	uint32_t instPerMeshCount = gRenderObjContainer.GetRenderObjectInstancePerMeshCount();
-	m_asInstances.resize(instPerMeshCount);
-	for (uint32_t i = 0; i < instPerMeshCount; i++)
+	//mesh updates are bound once per mesh, instances need no callback of their own
+	RefreshInstanceIndexTable();
+
+	//instance indices are remapped, movement is tracked again from the current positions
+	uint32_t instanceCount = static_cast<uint32_t>(m_asInstanceDescs.size());
+	m_asInstances.resize(instanceCount);
+	m_instanceLocalCenters.resize(instanceCount);
+	m_instanceLocalHalfExtents.resize(instanceCount);
+	m_instanceCenters.clear();
+	m_instanceExtents.clear();
+	m_totalInstanceExtent = 0.0f;
+	for (uint32_t i = 0; i < m_instanceRebuildCenters.size(); i++)
+	{
+		m_instanceRebuildCenters[i].clear();
+		m_instanceMovements[i].clear();
+		m_totalInstanceMovements[i] = 0.0f;
+	}
+	m_dirtyInstanceIndices.clear();
+	m_instanceDirtyFlags.assign(instanceCount, false);
+	for (uint32_t i = 0; i < instanceCount; i++)
 	{
-		SetInstanceData(i, update);
+		SetInstanceData(i);
 	}
+	//every transform is written above, constants are rewritten with the new layout
+	gRenderObjContainer.GetTransformStore().ClearDirty();
+	m_transformUpdatedInstances.clear();
+	m_instanceLayoutVersion++;
 
 	RefreshInstanceBufferDatas();
 }
 
 void BottomLevelAsGroup::RefreshInstanceBufferDatas()
 {
-	if (m_instanceCount != m_asInstances.size())
+	if (m_instanceCount != m_asInstances.size() || !m_instancesDeviceBuffer.IsMapped())
 	{
 		m_instanceCount = static_cast<uint32_t>(m_asInstances.size());
 
-		if (m_instancesDeviceBuffer.IsAllocated())
+		//host coherent is not required, written ranges are flushed explicitly
+		m_instancesDeviceBuffer.Destroy();
+		m_instancesDeviceBuffer.Initialzie
+		(
+			VK_BUFFER_USAGE_ACCELERATION_STRUCTURE_BUILD_INPUT_READ_ONLY_BIT_KHR | VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT,
+			VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT,
+			static_cast<int>(m_asInstances.size())
+		);
+		if (!m_instancesDeviceBuffer.Map())
 		{
-			m_instancesDeviceBuffer.Reset
-			(
-				VK_BUFFER_USAGE_ACCELERATION_STRUCTURE_BUILD_INPUT_READ_ONLY_BIT_KHR | VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT,
-				VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-				static_cast<int>(m_asInstances.size())
-			);
+			return;
 		}
-		else
+
+		m_instancesDeviceBuffer.WriteMappedRange(m_asInstances.data(), 0, m_instanceCount);
+		std::vector<BufferResouceRange> ranges = { { 0, m_instancesDeviceBuffer.GetByteSize() } };
+		m_instancesDeviceBuffer.FlushMappedRanges(ranges);
+
+		m_dirtyInstanceIndices.clear();
+		m_instanceDirtyFlags.assign(m_asInstances.size(), false);
+		return;
+	}
+
+	UploadDirtyInstances();
+}
+
+void BottomLevelAsGroup::UploadDirtyInstances()
+{
+	if (m_dirtyInstanceIndices.empty() || !m_instancesDeviceBuffer.IsMapped())
+	{
+		return;
+	}
+
+	//merge adjacent dirty instances into one range
+	std::sort(m_dirtyInstanceIndices.begin(), m_dirtyInstanceIndices.end());
+	std::vector<BufferResouceRange> ranges;
+	uint32_t stride = m_instancesDeviceBuffer.GetStride();
+	uint32_t rangeBegin = m_dirtyInstanceIndices[0];
+	uint32_t rangeEnd = rangeBegin + 1;
+	for (uint32_t i = 1; i <= m_dirtyInstanceIndices.size(); i++)
+	{
+		if (i < m_dirtyInstanceIndices.size() && m_dirtyInstanceIndices[i] == rangeEnd)
 		{
-			m_instancesDeviceBuffer.Initialzie
-			(
-				VK_BUFFER_USAGE_ACCELERATION_STRUCTURE_BUILD_INPUT_READ_ONLY_BIT_KHR | VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT,
-				VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-				static_cast<int>(m_asInstances.size())
-			);
+			rangeEnd++;
+			continue;
+		}
+
+		m_instancesDeviceBuffer.WriteMappedRange(&m_asInstances[rangeBegin], rangeBegin, rangeEnd - rangeBegin);
+		ranges.push_back({ static_cast<VkDeviceSize>(rangeBegin) * stride, static_cast<VkDeviceSize>(rangeEnd - rangeBegin) * stride });
+
+		if (i < m_dirtyInstanceIndices.size())
+		{
+			rangeBegin = m_dirtyInstanceIndices[i];
+			rangeEnd = rangeBegin + 1;
 		}
 	}
-	m_instancesDeviceBuffer.UpdateResource(m_asInstances.data(), static_cast<int>(m_asInstances.size()));
+	m_instancesDeviceBuffer.FlushMappedRanges(ranges);
+
+	for (auto& cur : m_dirtyInstanceIndices)
+	{
+		m_instanceDirtyFlags[cur] = false;
+	}
+	m_dirtyInstanceIndices.clear();
 }
 
-void BottomLevelAsGroup::RefreshBlasList(bool update)
+void BottomLevelAsGroup::RefreshBlasList()
 {
-	RefreshInstanceDatas(update);
+	RefreshInstanceDatas();
 
 	m_asGeometry.sType = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_GEOMETRY_KHR;
 	m_asGeometry.flags = VK_GEOMETRY_OPAQUE_BIT_KHR;
@@ -337,8 +1253,10 @@ void BottomLevelAsGroup::RefreshBlasList(bool update)
 void BottomLevelAsGroup::OnMeshAdded(UID uid)
 {
 	SimpleMeshData* meshData = gGeomContainer.GetMeshFromUID(uid);
+	BindMeshUpdatedCallback(meshData);
 	BottomLevelAS* blas = new BottomLevelAS();
 	blas->SetSourceMesh(meshData);
+	blas->SetMemoryPools(m_memoryPool, m_hostMemoryPool);
 	m_blasList.push_back(blas);
 	
 	m_meshListChanged = true;
@@ -364,31 +1282,27 @@ void BottomLevelAsGroup::OnMeshRemoved(UID uid)
 	m_meshListChanged = true;
 }
 
-void BottomLevelAsGroup::OnInstPerMeshAdded(uint32_t index)
-{
-	m_asInstances.emplace_back();
-	SetInstanceData(index, false);
-
-	m_instanceListChanged = true;
-}
-
-void BottomLevelAsGroup::OnInstPerMeshUpdated(uint32_t index)
+void BottomLevelAsGroup::OnInstPerMeshAdded(RenderObjectIndexRange range)
 {
-	SetInstanceData(index, true);
-
+	//the whole range is mapped by the next layout refresh
 	m_instanceListChanged = true;
+	m_instanceLayoutChanged = true;
 }
 
-void BottomLevelAsGroup::OnInstPerMeshRemoved(uint32_t index)
+void BottomLevelAsGroup::OnInstPerMeshRemoved(RenderObjectIndexRange range)
 {
-	m_asInstances.erase(m_asInstances.begin() + index);
 	m_instanceListChanged = true;
+	m_instanceLayoutChanged = true;
 }
 
 void BottomLevelAsGroup::OnMeshUpdated(UID uid)
 {
-	int index = gGeomContainer.GetMeshBindIndexFromUID(uid);
-	m_blasList[index]->SetBuildState(EBlasBuildState::NEED_UPDATE_BUILD);
+	BottomLevelAS* blas = GetBlas(gGeomContainer.GetMeshFromUID(uid));
+	if (blas != nullptr)
+	{
+		blas->SetBuildState(EBlasBuildState::NEED_UPDATE_BUILD);
+		m_meshUpdated = true;
+	}
 }
 
 void BottomLevelAsGroup::Destroy()
@@ -397,6 +1311,14 @@ void BottomLevelAsGroup::Destroy()
 	gGeomContainer.OnMeshUnloaded.Remove(m_meshUnloadedCallbackHandle);
 	gRenderObjContainer.OnInstPerMeshAdded.Remove(m_instPreMeshAddedCallbackHandle);
 	gRenderObjContainer.OnInstPerMeshRemoved.Remove(m_instPerMeshRemovedCallbackHandle);
+	for (uint32_t i = 0; i < gGeomContainer.GetMeshCount(); i++)
+	{
+		SimpleMeshData* mesh = gGeomContainer.GetMesh(i);
+		if (mesh != nullptr)
+		{
+			mesh->OnMeshUpdated.Unbind();
+		}
+	}
 
 	Clear();
 }
@@ -416,18 +1338,16 @@ bool TopLevelAS::Build(VkCommandBuffer commandBuffer, std::vector<BottomLevelAsG
 	}
 	VkAccelerationStructureGeometryKHR* asGeomListPtr = asGeomList.data();
 
-	if (!updateBuild)
+	m_isRecreated = false;
+	//rebuild with the same instance count is written into the existing structure
+	if (!updateBuild && (m_accelerationStructure == VK_NULL_HANDLE || instanceCount != m_builtInstanceCount))
 	{
-		if (m_accelerationStructure != VK_NULL_HANDLE)
-		{
-			vkDestroyAccelerationStructureKHR(gLogicalDevice, m_accelerationStructure, nullptr);
-			m_accelerationStructure = VK_NULL_HANDLE;
-		}
+		DestroyAccelerationStructure(m_asMemory, m_accelerationStructure);
 
 		VkAccelerationStructureBuildGeometryInfoKHR asBuildGeomInfo = {};
 		asBuildGeomInfo.sType = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_BUILD_GEOMETRY_INFO_KHR;
 		asBuildGeomInfo.type = VK_ACCELERATION_STRUCTURE_TYPE_TOP_LEVEL_KHR;
-		asBuildGeomInfo.flags = VK_BUILD_ACCELERATION_STRUCTURE_PREFER_FAST_TRACE_BIT_KHR;
+		asBuildGeomInfo.flags = GetBuildFlags();
 		asBuildGeomInfo.geometryCount = static_cast<uint32_t>(asGeomList.size());
 		asBuildGeomInfo.ppGeometries = &asGeomListPtr;
 
@@ -442,41 +1362,29 @@ bool TopLevelAS::Build(VkCommandBuffer commandBuffer, std::vector<BottomLevelAsG
 			&asBuildSizeInfo
 		);
 
-		if (m_asMemory.IsAllocated())
-		{
-			m_asMemory.Destroy();
-		}
-		if (!m_asMemory.Initialize(static_cast<uint32_t>(asBuildSizeInfo.accelerationStructureSize), VK_BUFFER_USAGE_ACCELERATION_STRUCTURE_STORAGE_BIT_KHR | VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT))
-		{
-			return false;
-		}
-
-		VkAccelerationStructureCreateInfoKHR asCreateInfo = {};
-		asCreateInfo.sType = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_CREATE_INFO_KHR;
-		asCreateInfo.buffer = m_asMemory.GetBuffer();
-		asCreateInfo.size = asBuildSizeInfo.accelerationStructureSize;
-		asCreateInfo.type = VK_ACCELERATION_STRUCTURE_TYPE_TOP_LEVEL_KHR;
-		
-		if (vkCreateAccelerationStructureKHR(gLogicalDevice, &asCreateInfo, nullptr, &m_accelerationStructure) != VkResult::VK_SUCCESS)
+		if (!CreateAccelerationStructure(asBuildSizeInfo.accelerationStructureSize, VK_ACCELERATION_STRUCTURE_TYPE_TOP_LEVEL_KHR, m_asMemory, m_accelerationStructure))
 		{
 			REPORT(EReportType::REPORT_TYPE_ERROR, "tlas create failed.");
 			return false;
 		}
+		m_builtInstanceCount = instanceCount;
+		m_isRecreated = true;
 
-		if (m_scratchBuffer.IsAllocated())
-		{
-			m_scratchBuffer.Destroy();
-		}
-		if (!m_scratchBuffer.Initialize(static_cast<uint32_t>(asBuildSizeInfo.buildScratchSize), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT))
-		{
-			return false;
-		}
+		m_buildScratchSize = asBuildSizeInfo.buildScratchSize;
+		m_updateScratchSize = asBuildSizeInfo.updateScratchSize;
+	}
+
+	VkDeviceSize scratchSize = GetScratchSize(updateBuild);
+	m_scratchArena->Reset();
+	if (!m_scratchArena->Reserve(m_scratchArena->GetAlignedSize(scratchSize)))
+	{
+		return false;
 	}
 
 	VkAccelerationStructureBuildGeometryInfoKHR asBuildGeomInfo = {};
 	asBuildGeomInfo.sType = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_BUILD_GEOMETRY_INFO_KHR;
 	asBuildGeomInfo.type = VK_ACCELERATION_STRUCTURE_TYPE_TOP_LEVEL_KHR;
-	asBuildGeomInfo.flags = VK_BUILD_ACCELERATION_STRUCTURE_PREFER_FAST_TRACE_BIT_KHR | VK_BUILD_ACCELERATION_STRUCTURE_ALLOW_UPDATE_BIT_KHR;
+	asBuildGeomInfo.flags = GetBuildFlags();
 	if (updateBuild)
 	{
 		asBuildGeomInfo.srcAccelerationStructure = m_accelerationStructure;
@@ -484,7 +1392,7 @@ bool TopLevelAS::Build(VkCommandBuffer commandBuffer, std::vector<BottomLevelAsG
 	asBuildGeomInfo.dstAccelerationStructure = m_accelerationStructure;
 	asBuildGeomInfo.geometryCount = static_cast<uint32_t>(asGeomList.size());
 	asBuildGeomInfo.ppGeometries = &asGeomListPtr;
-	asBuildGeomInfo.scratchData.deviceAddress = m_scratchBuffer.GetDeviceMemoryAddress();
+	asBuildGeomInfo.scratchData.deviceAddress = m_scratchArena->Allocate(scratchSize);
 
 	VkAccelerationStructureBuildRangeInfoKHR asBuildRangeInfo;
 	asBuildRangeInfo.primitiveCount = instanceCount;
@@ -518,51 +1426,211 @@ bool TopLevelAS::Build(VkCommandBuffer commandBuffer, std::vector<BottomLevelAsG
 	return true;
 }
 
-bool RTAccelerationStructure::Initialize(VkCommandPool cmdPool)
+bool RTAccelerationStructure::Initialize(VkCommandPool cmdPool, uint32_t frameCount)
 {
-	return m_commandBufferContainer.Initialize(cmdPool);
+	m_bottomLevelAsGroup.SetScratchArena(&m_scratchArena);
+	m_bottomLevelAsGroup.SetMemoryPool(&m_memoryPool);
+	m_bottomLevelAsGroup.SetRebuildPolicy(&m_rebuildPolicy);
+	if (m_asCache.Initialize())
+	{
+		m_bottomLevelAsGroup.SetCache(&m_asCache);
+	}
+	//workers also propagate the scene graph, host builds are enabled only where supported
+	m_hostWorkerPool.Initialize();
+	if (BottomLevelAS::IsHostBuildSupported() && m_hostWorkerPool.IsInitialized())
+	{
+		m_hostMemoryPool.SetMemoryProperty(VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+		m_bottomLevelAsGroup.SetHostMemoryPool(&m_hostMemoryPool);
+		m_bottomLevelAsGroup.SetHostWorkerPool(&m_hostWorkerPool);
+		m_rebuildPolicy.SetHostBuildSupported(true);
+	}
+	//ranges and scratch buffers freed while a frame is recorded are reused when the frame comes around again
+	m_scratchArena.SetFrameCount(frameCount);
+	m_memoryPool.SetFrameCount(frameCount);
+	m_hostMemoryPool.SetFrameCount(frameCount);
+	m_topLevelAsList.resize(frameCount);
+	m_rebuildPolicy.SetTlasCount(frameCount);
+	m_bottomLevelAsGroup.SetTlasCount(frameCount);
+	for (auto& cur : m_topLevelAsList)
+	{
+		cur.SetScratchArena(&m_scratchArena);
+		cur.SetMemoryPool(&m_memoryPool);
+	}
+	m_tlasBuildPendings.assign(frameCount, false);
+	m_tlasRebuildPendings.assign(frameCount, false);
+	//without the compiled shader meshes are not deformed, the rest of the build works as before
+	m_meshDeformer.Initialize(frameCount);
+
+	if (!gVkDeviceRes.HasAsyncComputeQueue())
+	{
+		return m_commandBufferContainer.Initialize(cmdPool);
+	}
+
+	VkCommandPoolCreateInfo commandPoolCreateInfo = {};
+	commandPoolCreateInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+	commandPoolCreateInfo.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+	commandPoolCreateInfo.queueFamilyIndex = gVkDeviceRes.GetComputeQueueFamilyIndex();
+	if (vkCreateCommandPool(gLogicalDevice, &commandPoolCreateInfo, nullptr, &m_computeCommandPool) != VkResult::VK_SUCCESS)
+	{
+		REPORT(EReportType::REPORT_TYPE_WARN, "Compute command pool create failed, acceleration structures are built on the graphics queue.");
+		m_computeCommandPool = VK_NULL_HANDLE;
+		return m_commandBufferContainer.Initialize(cmdPool);
+	}
+
+	m_buildFences.resize(frameCount);
+	m_buildCompleteSemaphores.resize(frameCount, VK_NULL_HANDLE);
+	for (uint32_t i = 0; i < frameCount; i++)
+	{
+		if (!m_buildFences[i].Initialize())
+		{
+			return false;
+		}
+
+		VkSemaphoreCreateInfo semaphoreCreateInfo = {};
+		semaphoreCreateInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+		if (vkCreateSemaphore(gLogicalDevice, &semaphoreCreateInfo, nullptr, &m_buildCompleteSemaphores[i]) != VkResult::VK_SUCCESS)
+		{
+			REPORT(EReportType::REPORT_TYPE_ERROR, "Acceleration structure build semaphore create failed.");
+			return false;
+		}
+	}
+
+	return m_commandBufferContainer.Initialize(m_computeCommandPool);
 }
 
 
 void RTAccelerationStructure::Clear()
 {
 	m_commandBufferContainer.Clear();
-	m_topLevelAs.Destroy();
+	for (auto& cur : m_topLevelAsList)
+	{
+		cur.Destroy();
+	}
 	m_bottomLevelAsGroup.Clear();
+	m_scratchArena.Destroy();
+	m_memoryPool.Destroy();
+	m_hostMemoryPool.Destroy();
 }
 
 bool RTAccelerationStructure::Build()
 {
 	// ü϶   Ѵ
+	SingleTimeCommandBuffer blasBuildCmdBuffer;
+	blasBuildCmdBuffer.Begin();
+	m_bottomLevelAsGroup.Build(blasBuildCmdBuffer.GetCommandBuffer());
+	blasBuildCmdBuffer.End();
+
+	m_asCache.ReleaseStagingBuffers();
+
+	m_bottomLevelAsGroup.CompactBlas();
+	m_bottomLevelAsGroup.StoreCachedBlas();
+	m_bottomLevelAsGroup.RefreshBlasList();
+
 	SingleTimeCommandBuffer singleTimeCmdBuffer;
 	singleTimeCmdBuffer.Begin();
-	m_bottomLevelAsGroup.Build(singleTimeCmdBuffer.GetCommandBuffer());
 	std::vector<BottomLevelAsGroup*> bottomLevelAsGroups = { &m_bottomLevelAsGroup };
-	if (!m_topLevelAs.Build(singleTimeCmdBuffer.GetCommandBuffer(), bottomLevelAsGroups))
+	for (auto& cur : m_topLevelAsList)
 	{
-		//top level as зα
-		return false;
+		if (!cur.Build(singleTimeCmdBuffer.GetCommandBuffer(), bottomLevelAsGroups))
+		{
+			//top level as зα
+			return false;
+		}
 	}
 	singleTimeCmdBuffer.End();
+
+	for (uint32_t i = 0; i < m_topLevelAsList.size(); i++)
+	{
+		m_rebuildPolicy.OnTlasRebuilt(i);
+		m_bottomLevelAsGroup.ResetInstanceMovement(i);
+	}
+
+	m_tlasBuildPendings.assign(m_topLevelAsList.size(), false);
+	m_tlasRebuildPendings.assign(m_topLevelAsList.size(), false);
+
+	m_scratchArena.ReleaseRetiredBuffers();
+
 	return true;
 }
 
-void RTAccelerationStructure::Update()
+void RTAccelerationStructure::Update(uint32_t frameIndex)
 {
-	if (m_bottomLevelAsGroup.IsInstanceListChanged() || m_bottomLevelAsGroup.IsMeshListChanged())
+	//instance buffer and scratch memory written below are still read by the builds in flight
+	for (auto& cur : m_buildFences)
+	{
+		cur.WaitForFence();
+	}
+	m_scratchArena.BeginFrame(frameIndex);
+	m_memoryPool.BeginFrame(frameIndex);
+	m_hostMemoryPool.BeginFrame(frameIndex);
+
+	m_isPipelineResourceUpdated = false;
+	//world transforms of the attached instances are written to the store before the transform pass reads it
+	gRenderObjContainer.GetSceneGraph().Update
+	(
+		gRenderObjContainer.GetTransformStore(), 
+		m_hostWorkerPool.IsInitialized() ? &m_hostWorkerPool : nullptr
+	);
+	bool listChanged = m_bottomLevelAsGroup.IsInstanceListChanged() || 
+					   m_bottomLevelAsGroup.IsMeshListChanged() || 
+					   m_bottomLevelAsGroup.IsInstanceTransformChanged();
+	//refitted blas change the bounds seen by every tlas
+	bool meshDeformed = m_meshDeformer.HasPendingDeformation();
+	bool meshUpdated = m_bottomLevelAsGroup.IsMeshUpdated() || meshDeformed;
+	if (listChanged || meshUpdated)
+	{
+		//every tlas must take the changes before it is traced again
+		m_tlasBuildPendings.assign(m_topLevelAsList.size(), true);
+	}
+
+	if (m_tlasBuildPendings[frameIndex])
 	{
 		m_asBuildCommandBuffer = m_commandBufferContainer.GetCommandBuffer();
 		if (m_asBuildCommandBuffer->Begin())
 		{
-			m_bottomLevelAsGroup.Update(m_asBuildCommandBuffer->GetCommandBuffer());
+			bool meshListChanged = m_bottomLevelAsGroup.IsMeshListChanged();
+			//blas and deformed vertices are shared by every tlas and written in place, only the trace of the other frame is waited
+			if (IsAsyncBuild() && (meshDeformed || ((listChanged || meshUpdated) && m_bottomLevelAsGroup.HasPendingBlas())))
+			{
+				WaitForFramesInFlight(frameIndex);
+			}
+			if (meshDeformed)
+			{
+				//blas of the deformed meshes are marked for refit and written in one batch below
+				m_meshDeformer.WriteDispatchCommands(m_asBuildCommandBuffer->GetCommandBuffer(), frameIndex);
+			}
+			if (listChanged || meshUpdated)
+			{
+				m_bottomLevelAsGroup.Update(m_asBuildCommandBuffer->GetCommandBuffer());
+				if (meshListChanged || m_bottomLevelAsGroup.IsInstanceLayoutChanged())
+				{
+					m_tlasRebuildPendings.assign(m_topLevelAsList.size(), true);
+				}
+			}
 
 			//instance Ʈ blas Ʈ Ǿٸ ü 
 			std::vector<BottomLevelAsGroup*> bottomLevelAsGroups = { &m_bottomLevelAsGroup };
-			m_topLevelAs.Build(m_asBuildCommandBuffer->GetCommandBuffer(), bottomLevelAsGroups, !m_bottomLevelAsGroup.IsMeshListChanged());
+			//changed instance count can not be refitted, long refitted tlas is rebuilt by policy
+			TopLevelAS& topLevelAs = m_topLevelAsList[frameIndex];
+			bool rebuildTlas = m_tlasRebuildPendings[frameIndex] || 
+							   m_rebuildPolicy.ShouldRebuildTlas(frameIndex, m_bottomLevelAsGroup.GetInstanceMovementRatio(frameIndex));
+			topLevelAs.Build(m_asBuildCommandBuffer->GetCommandBuffer(), bottomLevelAsGroups, !rebuildTlas);
+			if (rebuildTlas)
+			{
+				m_rebuildPolicy.OnTlasRebuilt(frameIndex);
+				m_bottomLevelAsGroup.ResetInstanceMovement(frameIndex);
+			}
+			else
+			{
+				m_rebuildPolicy.OnTlasRefitted(frameIndex);
+			}
 
 			m_asBuildCommandBuffer->End();
 
-			m_isPipelineResourceUpdated = m_bottomLevelAsGroup.IsMeshListChanged();
+			m_tlasBuildPendings[frameIndex] = false;
+			m_tlasRebuildPendings[frameIndex] = false;
+			m_buildFrameIndex = frameIndex;
+			m_isPipelineResourceUpdated = meshListChanged || topLevelAs.IsRecreated();
 			m_hasWaitingCommandToBuild = true;
 		}
 	}
@@ -573,9 +1641,157 @@ void RTAccelerationStructure::Update()
 	m_bottomLevelAsGroup.OnUpdateComplete();
 }
 
+bool RTAccelerationStructure::SubmitBuildCommand(VkSemaphore& outSignalSemaphore)
+{
+	if (!IsAsyncBuild() || !m_hasWaitingCommandToBuild || m_asBuildCommandBuffer == nullptr)
+	{
+		return false;
+	}
+
+	Fence& buildFence = m_buildFences[m_buildFrameIndex];
+	buildFence.Reset();
+
+	VkCommandBuffer vkCmdBuf = m_asBuildCommandBuffer->GetCommandBuffer();
+	VkSemaphore signalSemaphore = m_buildCompleteSemaphores[m_buildFrameIndex];
+	VkSubmitInfo submitInfo = {};
+	submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+	submitInfo.commandBufferCount = 1;
+	submitInfo.pCommandBuffers = &vkCmdBuf;
+	submitInfo.signalSemaphoreCount = 1;
+	submitInfo.pSignalSemaphores = &signalSemaphore;
+	if (vkQueueSubmit(gVkDeviceRes.GetComputeQueue(), 1, &submitInfo, buildFence.GetFence()) != VkResult::VK_SUCCESS)
+	{
+		REPORT(EReportType::REPORT_TYPE_ERROR, "Acceleration structure build submit failed.");
+		return false;
+	}
+	m_asBuildCommandBuffer->OnSubmitted();
+	buildFence.AddSubmittedCommandBuffer(m_asBuildCommandBuffer);
+	m_hasWaitingCommandToBuild = false;
+
+	outSignalSemaphore = signalSemaphore;
+	return true;
+}
+
+void RTAccelerationStructure::WaitForFramesInFlight(uint32_t frameIndex)
+{
+	if (m_frameFences == nullptr)
+	{
+		gVkDeviceRes.GraphicsQueueWaitIdle();
+		return;
+	}
+	for (uint32_t i = 0; i < m_frameFences->size(); i++)
+	{
+		if (i != frameIndex)
+		{
+			(*m_frameFences)[i].WaitForFence();
+		}
+	}
+}
+
 void RTAccelerationStructure::Destroy()
 {
+	if (IsAsyncBuild())
+	{
+		for (auto& cur : m_buildFences)
+		{
+			cur.WaitForFence();
+			cur.Destory();
+		}
+		m_buildFences.clear();
+		for (auto& cur : m_buildCompleteSemaphores)
+		{
+			vkDestroySemaphore(gLogicalDevice, cur, nullptr);
+		}
+		m_buildCompleteSemaphores.clear();
+	}
 	m_commandBufferContainer.Clear();
-	m_topLevelAs.Destroy();
+	if (m_computeCommandPool != VK_NULL_HANDLE)
+	{
+		vkDestroyCommandPool(gLogicalDevice, m_computeCommandPool, nullptr);
+		m_computeCommandPool = VK_NULL_HANDLE;
+	}
+	for (auto& cur : m_topLevelAsList)
+	{
+		cur.Destroy();
+	}
+	m_meshDeformer.Destroy();
 	m_bottomLevelAsGroup.Destroy();
+	m_asCache.Destroy();
+	m_hostWorkerPool.Destroy();
+	m_scratchArena.Destroy();
+	m_memoryPool.Destroy();
+	m_hostMemoryPool.Destroy();
+}
+
+void RTAccelerationStructure::RunBuildBenchmark(uint32_t iterationCount)
+{
+	if (iterationCount == 0)
+	{
+		return;
+	}
+
+	//temporary blas of every mesh, not referenced by the scene
+	std::vector<BottomLevelAS*> blasList;
+	uint32_t primitiveCount = 0;
+	for (uint32_t i = 0; i < gGeomContainer.GetMeshCount(); i++)
+	{
+		BottomLevelAS* blas = new BottomLevelAS();
+		blas->SetSourceMesh(gGeomContainer.GetMesh(i));
+		blas->SetMemoryPools(&m_memoryPool, m_rebuildPolicy.IsHostBuildSupported() ? &m_hostMemoryPool : nullptr);
+		primitiveCount += blas->GetSourcePrimitiveCount();
+		blasList.push_back(blas);
+	}
+	std::vector<bool> updateList(blasList.size(), false);
+
+	//first iteration of each side creates the structures and is not measured
+	double deviceBuildTime = 0.0;
+	for (uint32_t i = 0; i <= iterationCount; i++)
+	{
+		std::chrono::high_resolution_clock::time_point startTime = std::chrono::high_resolution_clock::now();
+		SingleTimeCommandBuffer singleTimeCmdBuffer;
+		singleTimeCmdBuffer.Begin();
+		BottomLevelAS::BuildBatch(singleTimeCmdBuffer.GetCommandBuffer(), blasList, updateList, &m_scratchArena);
+		singleTimeCmdBuffer.End();
+		std::chrono::duration<double, std::milli> elapsed = std::chrono::high_resolution_clock::now() - startTime;
+		deviceBuildTime += i > 0 ? elapsed.count() : 0.0;
+	}
+	deviceBuildTime /= iterationCount;
+
+	double hostBuildTime = 0.0;
+	if (m_rebuildPolicy.IsHostBuildSupported())
+	{
+		for (uint32_t i = 0; i <= iterationCount; i++)
+		{
+			std::chrono::high_resolution_clock::time_point startTime = std::chrono::high_resolution_clock::now();
+			BottomLevelAS::BuildBatchOnHost(blasList, updateList, &m_hostWorkerPool);
+			std::chrono::duration<double, std::milli> elapsed = std::chrono::high_resolution_clock::now() - startTime;
+			hostBuildTime += i > 0 ? elapsed.count() : 0.0;
+		}
+		hostBuildTime /= iterationCount;
+	}
+
+	char message[256] = {};
+	sprintf_s
+	(
+		message,
+		"Blas build benchmark : %u blas, %u triangles, device %.3f ms, host %.3f ms with %u workers.",
+		static_cast<uint32_t>(blasList.size()),
+		primitiveCount,
+		deviceBuildTime,
+		hostBuildTime,
+		m_hostWorkerPool.GetThreadCount()
+	);
+	REPORT(EReportType::REPORT_TYPE_LOG, message);
+	if (!m_rebuildPolicy.IsHostBuildSupported())
+	{
+		REPORT(EReportType::REPORT_TYPE_LOG, "Host acceleration structure commands are not supported, host build is skipped.");
+	}
+
+	gVkDeviceRes.GraphicsQueueWaitIdle();
+	for (auto& cur : blasList)
+	{
+		cur->Destroy();
+		delete cur;
+	}
+	m_scratchArena.ReleaseRetiredBuffers();
 }
\ No newline at end of file
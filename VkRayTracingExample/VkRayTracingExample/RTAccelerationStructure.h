@@ -1,12 +1,18 @@
 #pragma once
 
 #include <map>
+#include <algorithm>
 
 #include "DeviceBuffers.h"
 #include "SimpleMaterial.h"
 #include "RenderObjectContainer.h"
 #include "GeometryContainer.h"
 #include "CommandBuffers.h"
+#include "Fence.h"
+#include "RTAsRebuildPolicy.h"
+#include "RTAsCache.h"
+#include "WorkerThreadPool.h"
+#include "RTMeshDeformer.h"
 
 class RayTracingAccelerationStructureBase
 {
@@ -20,12 +26,22 @@ public:
 	virtual VkAccelerationStructureKHR& GetAccelerationStructure() { return m_accelerationStructure; }
 
 	VkDeviceAddress GetAsHandle() { return m_handle; }
+	VkDeviceSize GetMemorySize() { return m_asMemory.Size; }
+	VkDeviceSize GetScratchSize(bool update) { return update ? m_updateScratchSize : m_buildScratchSize; }
+	void SetMemoryPool(AccelerationStructureMemoryPool* memoryPool) { m_memoryPool = memoryPool; }
+
+protected:
+	bool CreateAccelerationStructure(VkDeviceSize size, VkAccelerationStructureTypeKHR type, AsMemoryRange& outMemory, VkAccelerationStructureKHR& outAccelerationStructure);
+	void DestroyAccelerationStructure(AsMemoryRange& memory, VkAccelerationStructureKHR& accelerationStructure);
 
 protected:
 	VkAccelerationStructureKHR	m_accelerationStructure = VK_NULL_HANDLE;
 	VkTransformMatrixKHR		m_transformMatrix = {};
-	RayTracingScratchBuffer		m_scratchBuffer;
-	BufferData					m_asMemory;
+	AsMemoryRange				m_asMemory;
+	AccelerationStructureMemoryPool* m_memoryPool = nullptr;
+
+	VkDeviceSize m_buildScratchSize = 0;
+	VkDeviceSize m_updateScratchSize = 0;
 
 	VkDeviceAddress m_handle = 0;
 	bool m_isBuilded = false;
@@ -44,21 +60,86 @@ public:
 	BottomLevelAS() {};
 	virtual ~BottomLevelAS() {};
 public:
-	bool Build(VkCommandBuffer commandBuffer, bool update = false);
+	bool Build(VkCommandBuffer commandBuffer, RayTracingScratchArena* scratchArena, bool update = false);
+	//writes every blas of the list in one build command with one barrier at the end
+	static bool BuildBatch(VkCommandBuffer commandBuffer, std::vector<BottomLevelAS*>& blasList, std::vector<bool>& updateList, RayTracingScratchArena* scratchArena);
+	//builds on cpu with a deferred operation joined by the workers and the calling thread, returns when the build is completed
+	static bool BuildBatchOnHost(std::vector<BottomLevelAS*>& blasList, std::vector<bool>& updateList, WorkerThreadPool* workerPool);
+	static bool IsHostBuildSupported();
 
 	VkAccelerationStructureKHR GetBottomLevelAs() { return m_accelerationStructure; }
 	
 	void SetBuildState(EBlasBuildState state) { m_buildState = state; }
 	EBlasBuildState GetBuildState() { return m_buildState; }
 
-	void SetSourceMesh(SimpleMeshData* sourceMesh) { m_sourceMesh = sourceMesh; }
+	void SetSourceMesh(SimpleMeshData* sourceMesh) { m_sourceMeshes = { sourceMesh }; }
+	//every mesh becomes one geometry of the blas, in the given order
+	void SetSourceMeshes(std::vector<SimpleMeshData*>& sourceMeshes) { m_sourceMeshes = sourceMeshes; }
+	uint32_t GetSourceMeshCount() { return static_cast<uint32_t>(m_sourceMeshes.size()); }
+	SimpleMeshData* GetSourceMesh(uint32_t index) { return m_sourceMeshes[index]; }
+	uint32_t GetSourcePrimitiveCount();
+
+	//host built structures are placed in host visible memory, changing the build side recreates the structure
+	void SetMemoryPools(AccelerationStructureMemoryPool* deviceMemoryPool, AccelerationStructureMemoryPool* hostMemoryPool);
+	bool IsHostBuilt() { return m_isHostBuilt; }
+
+	void SetAllowCompaction(bool allowCompaction) { m_allowCompaction = allowCompaction; }
+	bool IsAllowCompaction() { return m_allowCompaction && m_buildProfile == EAsBuildProfile::STATIC; }
+	VkBuildAccelerationStructureFlagsKHR GetBuildFlags();
+
+	//profile of the last full build, refit is possible only when the source mesh profile is unchanged
+	EAsBuildProfile GetBuildProfile() { return m_buildProfile; }
+	bool CanRefit();
+
+	bool WriteCompactCommand(VkCommandBuffer commandBuffer, VkDeviceSize compactedSize);
+	void OnCompacted();
+	bool IsCompacted() { return m_isCompacted; }
+
+	uint32_t GetRefitCount() { return m_refitCount; }
+
+	//src and dst addresses must be 256 byte aligned
+	bool WriteSerializeCommand(VkCommandBuffer commandBuffer, VkDeviceAddress dstAddress);
+	bool WriteDeserializeCommand(VkCommandBuffer commandBuffer, VkDeviceAddress srcAddress, VkDeviceSize deserializedSize);
+	bool IsLoadedFromCache() { return m_isLoadedFromCache; }
 	
+protected:
+	bool PrepareBuild(VkAccelerationStructureBuildGeometryInfoKHR& outBuildGeomInfo, bool update, bool hostBuild = false);
+	static void JoinDeferredOperation(VkDeferredOperationKHR deferredOperation);
+	void OnBuildCommandWritten(bool update = false);
+	static void WriteBuildBarrier(VkCommandBuffer commandBuffer);
+
 protected:
 
-	SimpleMeshData* m_sourceMesh = nullptr;
-	VkAccelerationStructureGeometryKHR m_bottomLevelAsGeometry = {};
-	uint32_t m_primitiveCount = 0;
+	std::vector<SimpleMeshData*> m_sourceMeshes;
+	std::vector<VkAccelerationStructureGeometryKHR> m_bottomLevelAsGeometries;
+	std::vector<VkAccelerationStructureBuildRangeInfoKHR> m_buildRangeInfos;
+	std::vector<uint32_t> m_primitiveCounts;
 	EBlasBuildState m_buildState = EBlasBuildState::NEED_BUILD;
+
+	VkAccelerationStructureKHR	m_compactedAccelerationStructure = VK_NULL_HANDLE;
+	AsMemoryRange				m_compactedAsMemory;
+	bool m_allowCompaction = false;
+	bool m_isCompacted = false;
+
+	EAsBuildProfile m_buildProfile = EAsBuildProfile::STATIC;
+	uint32_t m_refitCount = 0;
+	bool m_isLoadedFromCache = false;
+
+	AccelerationStructureMemoryPool* m_deviceMemoryPool = nullptr;
+	AccelerationStructureMemoryPool* m_hostMemoryPool = nullptr;
+	bool m_isHostBuilt = false;
+};
+
+//one tlas instance, meshes of a merged geometry share a single instance
+struct AsInstanceDesc
+{
+	//instance per mesh of the first geometry, its transform and material are used for the whole instance
+	uint32_t InstPerMeshIndex = 0;
+	//first entry of the instance in the geometry table, indexed with gl_GeometryIndexEXT in the hit shaders
+	uint32_t GeometryTableOffset = 0;
+	uint32_t GeometryCount = 0;
+	//slot of the parent instance in the transform store of the render object container
+	uint32_t TransformSlot = 0;
 };
 
 class BottomLevelAsGroup
@@ -69,50 +150,139 @@ public:
 	void Update(VkCommandBuffer commandBuffer = VK_NULL_HANDLE);
 	void Destroy();
 
-protected:
-	void SetInstanceData(int index, bool update = false);
+	//compaction needs the compacted sizes on host, so the command buffer written by Build must be completed before call
+	bool CompactBlas();
+	void SetUseCompaction(bool useCompaction) { m_useCompaction = useCompaction; }
+	void SetScratchArena(RayTracingScratchArena* scratchArena) { m_scratchArena = scratchArena; }
+	void SetMemoryPool(AccelerationStructureMemoryPool* memoryPool) { m_memoryPool = memoryPool; }
+	//host builds are available only when both are set
+	void SetHostMemoryPool(AccelerationStructureMemoryPool* hostMemoryPool) { m_hostMemoryPool = hostMemoryPool; }
+	void SetHostWorkerPool(WorkerThreadPool* hostWorkerPool) { m_hostWorkerPool = hostWorkerPool; }
+	void SetRebuildPolicy(AsRebuildPolicy* rebuildPolicy) { m_rebuildPolicy = rebuildPolicy; }
+	//static blas are loaded from the cache on the first build, built ones are stored by StoreCachedBlas
+	void SetCache(AccelerationStructureCache* asCache) { m_asCache = asCache; }
+	//built blas must be completed and compacted before call
+	void StoreCachedBlas();
+
+	//movement is measured from the last rebuild of each tlas, one baseline per tlas
+	void SetTlasCount(uint32_t tlasCount);
+	//movement of instances since last rebuild of the tlas relative to their sizes
+	float GetInstanceMovementRatio(uint32_t tlasIndex) { return m_totalInstanceExtent > 0.0f ? m_totalInstanceMovements[tlasIndex] / m_totalInstanceExtent : 0.0f; }
+	void ResetInstanceMovement(uint32_t tlasIndex);
 
-	void RefreshInstanceDatas(bool update = false);
+protected:
+	void BuildPendingBlas(VkCommandBuffer commandBuffer);
+	void WriteCompactionQuery(VkCommandBuffer commandBuffer);
+	void SetInstanceData(uint32_t index);
+	void WriteInstanceTransform(uint32_t index, InstanceTransformRows& rows);
+	//writes the dirty transforms of the store to the tlas instances which reference them
+	void UpdateInstanceTransforms();
+	void BindMeshUpdatedCallback(SimpleMeshData* meshData);
+	//maps instances per mesh to tlas instances and fills the geometry table
+	void RefreshInstanceIndexTable();
+	BottomLevelAS* GetBlas(SimpleMeshData* meshData);
+
+	void RefreshInstanceDatas();
 	void RefreshInstanceBufferDatas();
-	void RefreshBlasList(bool update = false);
+	//writes and flushes only the instances changed since last upload
+	void UploadDirtyInstances();
+	void MarkInstanceDirty(uint32_t index);
+	void UpdateInstanceMovement(uint32_t index, glm::vec3& center, float extent);
+
+public:
+	void RefreshBlasList();
+	bool HasPendingBlas();
 
 public:
 	VkAccelerationStructureGeometryKHR& GetVkAccelerationStructureGeometryKHR() { return m_asGeometry; }
 	StructuredBufferData<VkAccelerationStructureInstanceKHR>& GetAsInstancesDeviceBuffer() { return m_instancesDeviceBuffer; }
 
 	int GetInstanceCount()			{ return m_instanceCount; }
+	uint32_t GetAsInstanceDescCount()	{ return static_cast<uint32_t>(m_asInstanceDescs.size()); }
+	AsInstanceDesc& GetAsInstanceDesc(uint32_t index) { return m_asInstanceDescs[index]; }
+	uint32_t GetGeometryTableSize()	{ return static_cast<uint32_t>(m_geometryTable.size()); }
+	SampleRenderObjectInstancePerMesh* GetGeometryTableEntry(uint32_t index) { return m_geometryTable[index]; }
 	bool IsBuilded()				{ return m_isBuilded; }
 	bool IsInstanceListChanged()	{ return m_instanceListChanged; }
+	bool IsInstanceLayoutChanged()	{ return m_instanceLayoutChanged; }
 	bool IsMeshListChanged()		{ return m_meshListChanged; }
+	//vertices of some mesh are rewritten, its blas waits a refit
+	bool IsMeshUpdated()			{ return m_meshUpdated; }
+	//some instance moved since the last transform pass
+	bool IsInstanceTransformChanged();
+
+	//incremented whenever the tlas instances are remapped, every instance constant must be rewritten
+	uint32_t GetInstanceLayoutVersion() { return m_instanceLayoutVersion; }
+	//tlas instances moved by the transform passes since the last clear, world matrices of their constants must be rewritten
+	std::vector<uint32_t>& GetTransformUpdatedInstances() { return m_transformUpdatedInstances; }
+	void ClearTransformUpdatedInstances() { m_transformUpdatedInstances.clear(); }
 	void OnUpdateComplete()	
 	{
 		m_meshListChanged = false; 
 		m_instanceListChanged = false;
+		m_instanceLayoutChanged = false;
+		m_meshUpdated = false;
 	}
 
 public:
 	void OnMeshAdded(UID uid);
 	void OnMeshRemoved(UID uid);
 
-	void OnInstPerMeshAdded(uint32_t index);
-	void OnInstPerMeshUpdated(uint32_t index);
-	void OnInstPerMeshRemoved(uint32_t index);
+	void OnInstPerMeshAdded(RenderObjectIndexRange range);
+	void OnInstPerMeshRemoved(RenderObjectIndexRange range);
 
 	void OnMeshUpdated(UID uid);
 
 private:
+	//indexed by mesh bind index, merged blas is placed at its first mesh and other meshes of it are null
 	std::vector<BottomLevelAS*> m_blasList;
+
+	std::vector<AsInstanceDesc> m_asInstanceDescs;
+	//tlas instance index of each instance per mesh, INVALID_INDEX_INT if it is a part of a merged instance
+	std::vector<int> m_instanceIndexTable;
+	std::vector<SampleRenderObjectInstancePerMesh*> m_geometryTable;
+	//tlas instances of each transform slot, instances of slot i are m_slotInstanceIndices[m_slotInstanceOffsets[i] ... m_slotInstanceOffsets[i + 1]]
+	std::vector<uint32_t> m_slotInstanceOffsets;
+	std::vector<uint32_t> m_slotInstanceIndices;
+	std::vector<uint32_t> m_transformUpdatedInstances;
+	uint32_t m_instanceLayoutVersion = 0;
 	
 //	VkAccelerationStructureCreateGeometryTypeInfoKHR m_topLevelAsCreateGeomTypeInfo = {};
 	std::vector<VkAccelerationStructureInstanceKHR> m_asInstances;
 	StructuredBufferData<VkAccelerationStructureInstanceKHR> m_instancesDeviceBuffer = {};
 	VkAccelerationStructureGeometryKHR m_asGeometry = {};
+	std::vector<uint32_t> m_dirtyInstanceIndices;
+	std::vector<bool> m_instanceDirtyFlags;
+
+	//object space bounds of the merged geometries of each instance, moved with the transform
+	std::vector<glm::vec3> m_instanceLocalCenters;
+	std::vector<glm::vec3> m_instanceLocalHalfExtents;
+	std::vector<glm::vec3> m_instanceCenters;
+	std::vector<float> m_instanceExtents;
+	float m_totalInstanceExtent = 0.0f;
+	//indexed by tlas, then by instance
+	std::vector<std::vector<glm::vec3>> m_instanceRebuildCenters;
+	std::vector<std::vector<float>> m_instanceMovements;
+	std::vector<float> m_totalInstanceMovements;
 
 	uint32_t m_instanceCount = -1;
 
+	RayTracingScratchArena* m_scratchArena = nullptr;
+	AccelerationStructureMemoryPool* m_memoryPool = nullptr;
+	AsRebuildPolicy* m_rebuildPolicy = nullptr;
+	AccelerationStructureCache* m_asCache = nullptr;
+	AccelerationStructureMemoryPool* m_hostMemoryPool = nullptr;
+	WorkerThreadPool* m_hostWorkerPool = nullptr;
+	VkQueryPool m_compactionQueryPool = VK_NULL_HANDLE;
+	std::vector<BottomLevelAS*> m_compactionCandidates;
+
 	bool m_isBuilded = false;
+	bool m_useCompaction = true;
 	bool m_instanceListChanged = false;
+	//instance added or removed or blas recreated, every instance is refreshed and tlas is rebuilt
+	bool m_instanceLayoutChanged = false;
 	bool m_meshListChanged = false;
+	bool m_meshUpdated = false;
 
 	CommandHandle m_meshLoadedCallbackHandle = INVALID_COMMAND_HANDLE;
 	CommandHandle m_meshUnloadedCallbackHandle = INVALID_COMMAND_HANDLE;
@@ -124,8 +294,17 @@ class TopLevelAS : public RayTracingAccelerationStructureBase
 {
 public:
 	bool Build(VkCommandBuffer commandBuffer, std::vector<BottomLevelAsGroup*>& bottomLevelAsGroupList, bool updateBuild = false);
+	void SetScratchArena(RayTracingScratchArena* scratchArena) { m_scratchArena = scratchArena; }
+
+	//true when the last build created a new structure, descriptors referencing it must be updated
+	bool IsRecreated() { return m_isRecreated; }
+	//tlas is refitted every frame with moving instances
+	VkBuildAccelerationStructureFlagsKHR GetBuildFlags() { return VK_BUILD_ACCELERATION_STRUCTURE_PREFER_FAST_TRACE_BIT_KHR | VK_BUILD_ACCELERATION_STRUCTURE_ALLOW_UPDATE_BIT_KHR; }
 
 protected:
+	RayTracingScratchArena* m_scratchArena = nullptr;
+	uint32_t m_builtInstanceCount = 0;
+	bool m_isRecreated = false;
 	uint64_t m_handle = 0;
 	bool m_isBuilded = false;
 };
@@ -134,13 +313,25 @@ class RTAccelerationStructure
 {
 public:
 	
-	bool Initialize(VkCommandPool cmdPool);
+	//one tlas is kept per frame in flight, the build of a frame does not touch the tlas traced by the other frame
+	bool Initialize(VkCommandPool cmdPool, uint32_t frameCount);
 	void Clear();
 	bool Build();
-	void Update();
+	void Update(uint32_t frameIndex);
 	void Destroy();
 
-	TopLevelAS& GetTopLevelAs() { return m_topLevelAs; }
+	//submits the recorded build to the compute queue, the trace of the frame must wait the signaled semaphore
+	bool SubmitBuildCommand(VkSemaphore& outSignalSemaphore);
+	bool IsAsyncBuild() { return m_computeCommandPool != VK_NULL_HANDLE; }
+
+	//fences signaled by the frame submits, resources shared by every frame wait them instead of the queue
+	void SetFrameFences(std::vector<Fence>* frameFences) { m_frameFences = frameFences; }
+	//waits the frames in flight other than frameIndex, whose fence is waited by the caller before the update
+	void WaitForFramesInFlight(uint32_t frameIndex);
+
+	TopLevelAS& GetTopLevelAs(uint32_t frameIndex) { return m_topLevelAsList[frameIndex]; }
+	uint32_t GetTopLevelAsCount() { return static_cast<uint32_t>(m_topLevelAsList.size()); }
+	BottomLevelAsGroup& GetBottomLevelAsGroup() { return m_bottomLevelAsGroup; }
 	CommandBuffer* GetBuildCommandBuffer() { return m_asBuildCommandBuffer; }
 
 	bool HasWaitingCommandToBuild() { return m_hasWaitingCommandToBuild; }
@@ -148,13 +339,36 @@ public:
 
 	bool IsPipelineResourceUpdated() { return m_isPipelineResourceUpdated; }
 
+	AsRebuildPolicy& GetRebuildPolicy() { return m_rebuildPolicy; }
+	//deformations are dispatched in the build command of the frame before the blas refits
+	RTMeshDeformer& GetMeshDeformer() { return m_meshDeformer; }
+
+	//builds blas of every mesh from scratch on device and on host, averaged build times are logged
+	void RunBuildBenchmark(uint32_t iterationCount);
+
 public:
 
 	BottomLevelAsGroup	m_bottomLevelAsGroup;
-	TopLevelAS			m_topLevelAs;
+	std::vector<TopLevelAS> m_topLevelAsList;
+	std::vector<bool>	m_tlasBuildPendings;
+	std::vector<bool>	m_tlasRebuildPendings;
+	RayTracingScratchArena m_scratchArena;
+	AccelerationStructureMemoryPool m_memoryPool;
+	AccelerationStructureMemoryPool m_hostMemoryPool;
+	WorkerThreadPool	m_hostWorkerPool;
+	AsRebuildPolicy		m_rebuildPolicy;
+	AccelerationStructureCache m_asCache;
+	RTMeshDeformer		m_meshDeformer;
 	CommandBuffer*		m_asBuildCommandBuffer;
 	DynamicCommandBufferContainer m_commandBufferContainer;
 
+	//async build resources, created only when the device has a dedicated compute queue
+	VkCommandPool		m_computeCommandPool = VK_NULL_HANDLE;
+	std::vector<Fence>	m_buildFences;
+	std::vector<VkSemaphore> m_buildCompleteSemaphores;
+	uint32_t			m_buildFrameIndex = 0;
+	std::vector<Fence>*	m_frameFences = nullptr;
+
 	bool m_hasWaitingCommandToBuild = false;
 	bool m_isPipelineResourceUpdated = false;
 };
@@ -0,0 +1,297 @@
+#include <windows.h>
+
+#include "RTAsCache.h"
+#include "RTAccelerationStructure.h"
+#include "VulkanDeviceResources.h"
+
+bool AccelerationStructureCache::Initialize(std::string cacheDirectory)
+{
+	m_cacheDirectory = cacheDirectory;
+	memcpy(m_driverUuid, gVkDeviceRes.GetPhysicalDeviceIdProperties().driverUUID, VK_UUID_SIZE);
+
+	if (!CreateDirectoryA(m_cacheDirectory.c_str(), nullptr) && GetLastError() != ERROR_ALREADY_EXISTS)
+	{
+		REPORT(EReportType::REPORT_TYPE_WARN, "Acceleration structure cache directory create failed, cache is disabled.");
+		return false;
+	}
+
+	m_isEnabled = true;
+	return true;
+}
+
+void AccelerationStructureCache::Destroy()
+{
+	ReleaseStagingBuffers();
+	m_isEnabled = false;
+}
+
+bool AccelerationStructureCache::Load(VkCommandBuffer commandBuffer, BottomLevelAS* blas)
+{
+	if (!m_isEnabled || !IsCacheable(blas))
+	{
+		return false;
+	}
+
+	uint64_t key = GetCacheKey(blas);
+	std::ifstream cacheFile(GetCacheFilePath(key), std::ios::binary);
+	if (!cacheFile.is_open())
+	{
+		m_missCount++;
+		return false;
+	}
+
+	//driver writes two uuids, serialized size, deserialized size and handle count at the beginning of the blob
+	const uint64_t blobHeaderSize = VK_UUID_SIZE * 2 + sizeof(uint64_t) * 3;
+	AsCacheFileHeader header = {};
+	cacheFile.read(reinterpret_cast<char*>(&header), sizeof(AsCacheFileHeader));
+	if (!cacheFile ||
+		header.Magic != AS_CACHE_MAGIC ||
+		header.Version != AS_CACHE_VERSION ||
+		header.Key != key ||
+		memcmp(header.DriverUuid, m_driverUuid, VK_UUID_SIZE) != 0 ||
+		header.SerializedSize < blobHeaderSize)
+	{
+		m_missCount++;
+		return false;
+	}
+
+	std::vector<uint8_t> serializedData(static_cast<size_t>(header.SerializedSize));
+	cacheFile.read(reinterpret_cast<char*>(serializedData.data()), serializedData.size());
+	if (!cacheFile)
+	{
+		REPORT(EReportType::REPORT_TYPE_WARN, "Acceleration structure cache file is truncated.");
+		m_missCount++;
+		return false;
+	}
+
+	VkAccelerationStructureVersionInfoKHR versionInfo = {};
+	versionInfo.sType = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_VERSION_INFO_KHR;
+	versionInfo.pVersionData = serializedData.data();
+	VkAccelerationStructureCompatibilityKHR compatibility = VK_ACCELERATION_STRUCTURE_COMPATIBILITY_INCOMPATIBLE_KHR;
+	vkGetDeviceAccelerationStructureCompatibilityKHR(gLogicalDevice, &versionInfo, &compatibility);
+	if (compatibility != VK_ACCELERATION_STRUCTURE_COMPATIBILITY_COMPATIBLE_KHR)
+	{
+		REPORT(EReportType::REPORT_TYPE_LOG, "Cached blas is not compatible with the device, it is rebuilt.");
+		m_missCount++;
+		return false;
+	}
+
+	uint64_t deserializedSize = 0;
+	memcpy(&deserializedSize, serializedData.data() + VK_UUID_SIZE * 2 + sizeof(uint64_t), sizeof(uint64_t));
+
+	BufferData stagingBuffer = {};
+	if (!stagingBuffer.Initialize
+		(
+			static_cast<uint32_t>(header.SerializedSize + AS_SERIALIZATION_ALIGNMENT),
+			VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT | VK_BUFFER_USAGE_ACCELERATION_STRUCTURE_BUILD_INPUT_READ_ONLY_BIT_KHR,
+			VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT
+		))
+	{
+		m_missCount++;
+		return false;
+	}
+
+	VkDeviceAddress bufferAddress = stagingBuffer.GetDeviceMemoryAddress();
+	VkDeviceAddress alignedAddress = (bufferAddress + AS_SERIALIZATION_ALIGNMENT - 1) & ~static_cast<VkDeviceAddress>(AS_SERIALIZATION_ALIGNMENT - 1);
+	uint32_t alignOffset = static_cast<uint32_t>(alignedAddress - bufferAddress);
+	if (!stagingBuffer.UpdateResource(serializedData.data(), alignOffset, static_cast<uint32_t>(serializedData.size())) ||
+		!blas->WriteDeserializeCommand(commandBuffer, alignedAddress, deserializedSize))
+	{
+		stagingBuffer.Destroy();
+		m_missCount++;
+		return false;
+	}
+
+	m_stagingBuffers.push_back(stagingBuffer);
+	m_hitCount++;
+	return true;
+}
+
+void AccelerationStructureCache::ReleaseStagingBuffers()
+{
+	for (auto& cur : m_stagingBuffers)
+	{
+		cur.Destroy();
+	}
+	m_stagingBuffers.clear();
+}
+
+bool AccelerationStructureCache::Store(std::vector<BottomLevelAS*>& blasList)
+{
+	if (!m_isEnabled)
+	{
+		return false;
+	}
+
+	std::vector<BottomLevelAS*> storeList;
+	std::vector<VkAccelerationStructureKHR> asList;
+	for (auto& cur : blasList)
+	{
+		if (cur != nullptr && IsCacheable(cur))
+		{
+			storeList.push_back(cur);
+			asList.push_back(cur->GetAccelerationStructure());
+		}
+	}
+	uint32_t storeCount = static_cast<uint32_t>(storeList.size());
+	if (storeCount == 0)
+	{
+		return true;
+	}
+
+	VkQueryPoolCreateInfo queryPoolCreateInfo = {};
+	queryPoolCreateInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+	queryPoolCreateInfo.queryType = VK_QUERY_TYPE_ACCELERATION_STRUCTURE_SERIALIZATION_SIZE_KHR;
+	queryPoolCreateInfo.queryCount = storeCount;
+	VkQueryPool serializationQueryPool = VK_NULL_HANDLE;
+	if (vkCreateQueryPool(gLogicalDevice, &queryPoolCreateInfo, nullptr, &serializationQueryPool) != VkResult::VK_SUCCESS)
+	{
+		REPORT(EReportType::REPORT_TYPE_WARN, "Serialization size query pool create failed.");
+		return false;
+	}
+
+	SingleTimeCommandBuffer sizeQueryCmdBuffer;
+	sizeQueryCmdBuffer.Begin();
+	vkCmdResetQueryPool(sizeQueryCmdBuffer.GetCommandBuffer(), serializationQueryPool, 0, storeCount);
+	vkCmdWriteAccelerationStructuresPropertiesKHR
+	(
+		sizeQueryCmdBuffer.GetCommandBuffer(),
+		storeCount,
+		asList.data(),
+		VK_QUERY_TYPE_ACCELERATION_STRUCTURE_SERIALIZATION_SIZE_KHR,
+		serializationQueryPool,
+		0
+	);
+	sizeQueryCmdBuffer.End();
+
+	std::vector<VkDeviceSize> serializedSizes(storeCount, 0);
+	VkResult res = vkGetQueryPoolResults
+	(
+		gLogicalDevice,
+		serializationQueryPool,
+		0,
+		storeCount,
+		sizeof(VkDeviceSize) * storeCount,
+		serializedSizes.data(),
+		sizeof(VkDeviceSize),
+		VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WAIT_BIT
+	);
+	vkDestroyQueryPool(gLogicalDevice, serializationQueryPool, nullptr);
+	if (res != VkResult::VK_SUCCESS)
+	{
+		REPORT(EReportType::REPORT_TYPE_WARN, "Serialization size query failed.");
+		return false;
+	}
+
+	std::vector<BufferData> readbackBuffers(storeCount);
+	std::vector<uint32_t> alignOffsets(storeCount, 0);
+	std::vector<bool> serialized(storeCount, false);
+	SingleTimeCommandBuffer serializeCmdBuffer;
+	serializeCmdBuffer.Begin();
+	for (uint32_t i = 0; i < storeCount; i++)
+	{
+		if (serializedSizes[i] == 0 ||
+			!readbackBuffers[i].Initialize
+			(
+				static_cast<uint32_t>(serializedSizes[i] + AS_SERIALIZATION_ALIGNMENT),
+				VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+				VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT
+			))
+		{
+			continue;
+		}
+
+		VkDeviceAddress bufferAddress = readbackBuffers[i].GetDeviceMemoryAddress();
+		VkDeviceAddress alignedAddress = (bufferAddress + AS_SERIALIZATION_ALIGNMENT - 1) & ~static_cast<VkDeviceAddress>(AS_SERIALIZATION_ALIGNMENT - 1);
+		alignOffsets[i] = static_cast<uint32_t>(alignedAddress - bufferAddress);
+		serialized[i] = storeList[i]->WriteSerializeCommand(serializeCmdBuffer.GetCommandBuffer(), alignedAddress);
+	}
+
+	VkMemoryBarrier memoryBarrier = {};
+	memoryBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+	memoryBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+	memoryBarrier.dstAccessMask = VK_ACCESS_HOST_READ_BIT;
+	vkCmdPipelineBarrier
+	(
+		serializeCmdBuffer.GetCommandBuffer(),
+		VK_PIPELINE_STAGE_ACCELERATION_STRUCTURE_BUILD_BIT_KHR,
+		VK_PIPELINE_STAGE_HOST_BIT,
+		0,
+		1,
+		&memoryBarrier,
+		0,
+		nullptr,
+		0,
+		nullptr
+	);
+	serializeCmdBuffer.End();
+
+	uint32_t storedCount = 0;
+	for (uint32_t i = 0; i < storeCount; i++)
+	{
+		if (serialized[i])
+		{
+			uint8_t* data = nullptr;
+			if (vkMapMemory(gLogicalDevice, readbackBuffers[i].GetMemory(), 0, VK_WHOLE_SIZE, 0, (void**)&data) == VkResult::VK_SUCCESS)
+			{
+				AsCacheFileHeader header = {};
+				header.Key = GetCacheKey(storeList[i]);
+				memcpy(header.DriverUuid, m_driverUuid, VK_UUID_SIZE);
+				header.SerializedSize = serializedSizes[i];
+
+				std::ofstream cacheFile(GetCacheFilePath(header.Key), std::ios::binary | std::ios::trunc);
+				if (cacheFile.is_open())
+				{
+					cacheFile.write(reinterpret_cast<char*>(&header), sizeof(AsCacheFileHeader));
+					cacheFile.write(reinterpret_cast<char*>(data + alignOffsets[i]), static_cast<std::streamsize>(serializedSizes[i]));
+					storedCount += cacheFile.good() ? 1 : 0;
+				}
+				vkUnmapMemory(gLogicalDevice, readbackBuffers[i].GetMemory());
+			}
+		}
+		readbackBuffers[i].Destroy();
+	}
+
+	char message[256] = {};
+	sprintf_s(message, "Blas cache : %u loaded, %u missed, %u stored.", m_hitCount, m_missCount, storedCount);
+	REPORT(EReportType::REPORT_TYPE_LOG, message);
+
+	return storedCount == storeCount;
+}
+
+bool AccelerationStructureCache::IsCacheable(BottomLevelAS* blas)
+{
+	if (blas->GetSourceMeshCount() == 0)
+	{
+		return false;
+	}
+	for (uint32_t i = 0; i < blas->GetSourceMeshCount(); i++)
+	{
+		if (blas->GetSourceMesh(i) == nullptr)
+		{
+			return false;
+		}
+	}
+	return blas->GetSourceMesh(0)->GetBuildProfile() == EAsBuildProfile::STATIC;
+}
+
+uint64_t AccelerationStructureCache::GetCacheKey(BottomLevelAS* blas)
+{
+	//same meshes give a different structure with other build flags or on other driver
+	uint64_t key = HashBytes(m_driverUuid, VK_UUID_SIZE);
+	for (uint32_t i = 0; i < blas->GetSourceMeshCount(); i++)
+	{
+		uint64_t contentHash = blas->GetSourceMesh(i)->GetContentHash();
+		key = HashBytes(&contentHash, sizeof(uint64_t), key);
+	}
+	VkBuildAccelerationStructureFlagsKHR buildFlags = blas->GetBuildFlags();
+	key = HashBytes(&buildFlags, sizeof(VkBuildAccelerationStructureFlagsKHR), key);
+	return key;
+}
+
+std::string AccelerationStructureCache::GetCacheFilePath(uint64_t key)
+{
+	char fileName[32] = {};
+	sprintf_s(fileName, "%016llx.blas", key);
+	return m_cacheDirectory + fileName;
+}
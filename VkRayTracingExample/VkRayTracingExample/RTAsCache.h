@@ -0,0 +1,57 @@
+#pragma once
+
+#include <string>
+
+#include "DeviceBuffers.h"
+
+class BottomLevelAS;
+
+#define AS_CACHE_MAGIC 0x53414C42
+#define AS_CACHE_VERSION 1
+//serialization and deserialization addresses must be aligned to 256 bytes
+#define AS_SERIALIZATION_ALIGNMENT 256
+
+struct AsCacheFileHeader
+{
+	uint32_t Magic = AS_CACHE_MAGIC;
+	uint32_t Version = AS_CACHE_VERSION;
+	uint64_t Key = 0;
+	uint8_t DriverUuid[VK_UUID_SIZE] = {};
+	//serialized blob written by the driver follows the header
+	uint64_t SerializedSize = 0;
+};
+
+//serialized static blas on disk, one file per blas keyed by source mesh contents, build flags and driver uuid
+class AccelerationStructureCache
+{
+public:
+	bool Initialize(std::string cacheDirectory = "../Resources/AsCache/");
+	void Destroy();
+
+	//reads the serialized blas and writes the deserialize command, staging memory is kept until ReleaseStagingBuffers
+	bool Load(VkCommandBuffer commandBuffer, BottomLevelAS* blas);
+	//call after the command buffer written by Load is completed
+	void ReleaseStagingBuffers();
+
+	//serializes every cacheable blas of the list, builds of them must be completed before call
+	bool Store(std::vector<BottomLevelAS*>& blasList);
+
+	bool IsEnabled() { return m_isEnabled; }
+	uint32_t GetHitCount() { return m_hitCount; }
+	uint32_t GetMissCount() { return m_missCount; }
+
+protected:
+	//refitted blas change every frame, only static ones are cached
+	bool IsCacheable(BottomLevelAS* blas);
+	uint64_t GetCacheKey(BottomLevelAS* blas);
+	std::string GetCacheFilePath(uint64_t key);
+
+protected:
+	std::string m_cacheDirectory = "";
+	uint8_t m_driverUuid[VK_UUID_SIZE] = {};
+	std::vector<BufferData> m_stagingBuffers;
+
+	uint32_t m_hitCount = 0;
+	uint32_t m_missCount = 0;
+	bool m_isEnabled = false;
+};
@@ -0,0 +1,82 @@
+#include "RTAsRebuildPolicy.h"
+
+void AsRebuildPolicy::OnTlasRebuilt(uint32_t tlasIndex)
+{
+	//baseline is measured again with the new bvh, the other tlas keep their refit chains
+	m_tlasStates[tlasIndex] = TlasRebuildState();
+}
+
+bool AsRebuildPolicy::ShouldRebuildTlas(uint32_t tlasIndex, float instanceMovementRatio)
+{
+	TlasRebuildState& state = m_tlasStates[tlasIndex];
+	if (state.RefitCount >= m_thresholds.MaxTlasRefitCount)
+	{
+		return true;
+	}
+
+	if (instanceMovementRatio >= m_thresholds.MaxInstanceMovementRatio)
+	{
+		return true;
+	}
+
+	if (state.HasBaseline && state.BaselineTraceTime > 0.0f && state.AverageTraceTime >= state.BaselineTraceTime * m_thresholds.MaxTraceTimeGrowthRatio)
+	{
+		return true;
+	}
+
+	return false;
+}
+
+bool AsRebuildPolicy::ShouldBuildOnHost(uint32_t batchPrimitiveCount)
+{
+	if (!m_hostBuildSupported)
+	{
+		return false;
+	}
+
+	switch (m_buildTarget)
+	{
+	case EAsBuildTarget::HOST:
+		return true;
+	case EAsBuildTarget::AUTO:
+		//cpu cores take the batch while the gpu is saturated by tracing
+		return m_deviceTraceTime >= m_thresholds.DeviceBusyTraceTimeMs && batchPrimitiveCount <= m_thresholds.MaxHostBatchPrimitiveCount;
+	default:
+		return false;
+	}
+}
+
+void AsRebuildPolicy::AddTraceTime(uint32_t tlasIndex, float traceTimeMs)
+{
+	if (tlasIndex >= m_tlasStates.size())
+	{
+		return;
+	}
+
+	TlasRebuildState& state = m_tlasStates[tlasIndex];
+	uint32_t sampleCount = m_thresholds.TraceTimeSampleCount > 0 ? m_thresholds.TraceTimeSampleCount : 1;
+	if (state.TraceTimeSamples.size() < sampleCount)
+	{
+		state.TraceTimeSamples.push_back(traceTimeMs);
+	}
+	else
+	{
+		state.TraceTimeSamples[state.TraceTimeSampleIndex] = traceTimeMs;
+		state.TraceTimeSampleIndex = (state.TraceTimeSampleIndex + 1) % sampleCount;
+	}
+
+	float total = 0.0f;
+	for (auto& cur : state.TraceTimeSamples)
+	{
+		total += cur;
+	}
+	state.AverageTraceTime = total / static_cast<float>(state.TraceTimeSamples.size());
+	m_deviceTraceTime = state.AverageTraceTime;
+
+	//first full window after rebuild becomes the baseline
+	if (!state.HasBaseline && state.TraceTimeSamples.size() == sampleCount)
+	{
+		state.BaselineTraceTime = state.AverageTraceTime;
+		state.HasBaseline = true;
+	}
+}
@@ -0,0 +1,81 @@
+#pragma once
+
+#include <vector>
+#include <stdint.h>
+
+//where blas batches are built
+enum class EAsBuildTarget
+{
+	DEVICE,
+	HOST,
+	AUTO,	//host while the device is busy tracing and the batch is small enough, device until a trace time is measured
+};
+
+struct AsRebuildThresholds
+{
+	//refit count of tlas before full rebuild
+	uint32_t MaxTlasRefitCount = 240;
+	//refit count of deforming blas before full rebuild
+	uint32_t MaxBlasRefitCount = 120;
+	//summed instance movement since last rebuild divided by summed instance extents
+	float MaxInstanceMovementRatio = 0.5f;
+	//averaged trace time divided by the baseline measured right after last rebuild
+	float MaxTraceTimeGrowthRatio = 1.3f;
+	//frame count averaged for trace time baseline and current trace time
+	uint32_t TraceTimeSampleCount = 16;
+	//averaged trace time regarded as a busy device, used by auto build target
+	//the initial scene build runs before any trace, so auto applies only to the rebuilds at runtime
+	float DeviceBusyTraceTimeMs = 8.0f;
+	//largest triangle count of a batch built on host by auto build target
+	uint32_t MaxHostBatchPrimitiveCount = 256 * 1024;
+};
+
+//refit chain of one tlas, each tlas of the frames in flight is refitted and rebuilt on its own
+struct TlasRebuildState
+{
+	uint32_t RefitCount = 0;
+
+	std::vector<float> TraceTimeSamples;
+	uint32_t TraceTimeSampleIndex = 0;
+	float AverageTraceTime = 0.0f;
+	float BaselineTraceTime = 0.0f;
+	bool HasBaseline = false;
+};
+
+//decides when repeated refits have degraded bvh quality enough to do a full rebuild
+class AsRebuildPolicy
+{
+public:
+	void SetThresholds(AsRebuildThresholds& thresholds) { m_thresholds = thresholds; }
+	AsRebuildThresholds& GetThresholds() { return m_thresholds; }
+
+	//one state per tlas, indexed by the frame index
+	void SetTlasCount(uint32_t tlasCount) { m_tlasStates.resize(tlasCount); }
+	void OnTlasRebuilt(uint32_t tlasIndex);
+	void OnTlasRefitted(uint32_t tlasIndex) { m_tlasStates[tlasIndex].RefitCount++; }
+	bool ShouldRebuildTlas(uint32_t tlasIndex, float instanceMovementRatio);
+
+	bool ShouldRebuildBlas(uint32_t blasRefitCount) { return blasRefitCount >= m_thresholds.MaxBlasRefitCount; }
+
+	void SetBuildTarget(EAsBuildTarget buildTarget) { m_buildTarget = buildTarget; }
+	EAsBuildTarget GetBuildTarget() { return m_buildTarget; }
+	void SetHostBuildSupported(bool hostBuildSupported) { m_hostBuildSupported = hostBuildSupported; }
+	bool IsHostBuildSupported() { return m_hostBuildSupported; }
+	bool ShouldBuildOnHost(uint32_t batchPrimitiveCount);
+
+	//trace time is measured with gpu timestamps, camera changes also affect it so it is averaged over the frames tracing the tlas
+	void AddTraceTime(uint32_t tlasIndex, float traceTimeMs);
+
+	uint32_t GetTlasRefitCount(uint32_t tlasIndex) { return m_tlasStates[tlasIndex].RefitCount; }
+	float GetAverageTraceTime(uint32_t tlasIndex) { return m_tlasStates[tlasIndex].AverageTraceTime; }
+	float GetBaselineTraceTime(uint32_t tlasIndex) { return m_tlasStates[tlasIndex].BaselineTraceTime; }
+
+protected:
+	AsRebuildThresholds m_thresholds = {};
+	EAsBuildTarget m_buildTarget = EAsBuildTarget::DEVICE;
+	bool m_hostBuildSupported = false;
+
+	std::vector<TlasRebuildState> m_tlasStates;
+	//last averaged trace time of any tlas, kept across tlas rebuilds for the auto build target
+	float m_deviceTraceTime = 0.0f;
+};
@@ -0,0 +1,504 @@
+#include "RTMeshDeformer.h"
+
+#include <fstream>
+#include <algorithm>
+
+#define MESH_DEFORM_BINDING_COUNT 6
+
+template <typename ResourceType>
+static bool UploadSourceBuffer(StructuredBufferData<ResourceType>& buffer, ResourceType* srcData, uint32_t count)
+{
+	//source data is written once, empty sources keep a single element to stay bindable
+	uint32_t bufferCount = count > 0 ? count : 1;
+	if (!buffer.Initialzie(VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT, bufferCount))
+	{
+		return false;
+	}
+	if (count == 0)
+	{
+		return true;
+	}
+	if (!buffer.Map())
+	{
+		return false;
+	}
+	buffer.WriteMappedRange(srcData, 0, count);
+	std::vector<BufferResouceRange> ranges = { { 0, buffer.GetByteSize() } };
+	bool res = buffer.FlushMappedRanges(ranges);
+	buffer.Unmap();
+	return res;
+}
+
+void MeshDeformation::SetBoneMatrices(std::vector<glm::mat4>& boneMatrices)
+{
+	//bones after the last referenced one are not uploaded
+	if (boneMatrices.size() < m_boneCount)
+	{
+		REPORT(EReportType::REPORT_TYPE_WARN, "Bone matrices are fewer than the bones referenced by the skin data.");
+		return;
+	}
+	m_boneMatrices.assign(boneMatrices.begin(), boneMatrices.begin() + m_boneCount);
+	m_isDirty = true;
+}
+
+void MeshDeformation::SetMorphWeights(std::vector<float>& morphWeights)
+{
+	if (morphWeights.size() != m_morphTargetCount)
+	{
+		REPORT(EReportType::REPORT_TYPE_WARN, "Morph weight count does not match the morph targets.");
+		return;
+	}
+	m_morphWeights = morphWeights;
+	m_isDirty = true;
+}
+
+bool MeshDeformation::Initialize(SimpleMeshData* mesh, std::vector<VertexSkinData>& skinData, std::vector<MorphTargetData>& morphTargets, VkDescriptorSetLayout descLayout, uint32_t frameCount)
+{
+	m_mesh = mesh;
+	m_vertexCount = mesh->GetVertexBuffer()->GetVertexCount();
+
+	//rest pose is the uploaded vertices, the vertex buffer itself is overwritten by every dispatch
+	std::vector<DefaultVertex>& restVertices = mesh->GetHostVertices();
+	if (restVertices.size() != m_vertexCount)
+	{
+		REPORT(EReportType::REPORT_TYPE_WARN, "Rest vertices of the deformed mesh are not available.");
+		return false;
+	}
+	if (!skinData.empty() && skinData.size() != m_vertexCount)
+	{
+		REPORT(EReportType::REPORT_TYPE_WARN, "Skin data count does not match the vertex count.");
+		return false;
+	}
+
+	m_boneCount = 0;
+	for (auto& cur : skinData)
+	{
+		for (uint32_t i = 0; i < 4; i++)
+		{
+			if (cur.BoneWeights[i] > 0.0f && cur.BoneIndices[i] + 1 > m_boneCount)
+			{
+				m_boneCount = cur.BoneIndices[i] + 1;
+			}
+		}
+	}
+	m_morphTargetCount = static_cast<uint32_t>(morphTargets.size());
+
+	//position deltas of a target are followed by its normal deltas
+	std::vector<glm::vec4> morphDeltas(static_cast<size_t>(m_morphTargetCount) * 2 * m_vertexCount, glm::vec4(0.0f));
+	for (uint32_t i = 0; i < m_morphTargetCount; i++)
+	{
+		MorphTargetData& target = morphTargets[i];
+		if (target.PositionDeltas.size() != m_vertexCount || (!target.NormalDeltas.empty() && target.NormalDeltas.size() != m_vertexCount))
+		{
+			REPORT(EReportType::REPORT_TYPE_WARN, "Morph target delta count does not match the vertex count.");
+			return false;
+		}
+		glm::vec4* positionDeltas = &morphDeltas[static_cast<size_t>(i) * 2 * m_vertexCount];
+		glm::vec4* normalDeltas = positionDeltas + m_vertexCount;
+		for (uint32_t j = 0; j < m_vertexCount; j++)
+		{
+			positionDeltas[j] = glm::vec4(target.PositionDeltas[j], 0.0f);
+			if (!target.NormalDeltas.empty())
+			{
+				normalDeltas[j] = glm::vec4(target.NormalDeltas[j], 0.0f);
+			}
+		}
+	}
+
+	if (!UploadSourceBuffer(m_restVertexBuffer, restVertices.data(), m_vertexCount) ||
+		!UploadSourceBuffer(m_skinBuffer, skinData.data(), static_cast<uint32_t>(skinData.size())) ||
+		!UploadSourceBuffer(m_morphDeltaBuffer, morphDeltas.data(), static_cast<uint32_t>(morphDeltas.size())))
+	{
+		REPORT(EReportType::REPORT_TYPE_ERROR, "Deformation source buffer create failed.");
+		return false;
+	}
+
+	m_boneMatrixBuffers.resize(frameCount);
+	m_morphWeightBuffers.resize(frameCount);
+	for (uint32_t i = 0; i < frameCount; i++)
+	{
+		if (!m_boneMatrixBuffers[i].Initialzie(VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT, m_boneCount > 0 ? m_boneCount : 1) ||
+			!m_morphWeightBuffers[i].Initialzie(VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT, m_morphTargetCount > 0 ? m_morphTargetCount : 1) ||
+			!m_boneMatrixBuffers[i].Map() ||
+			!m_morphWeightBuffers[i].Map())
+		{
+			REPORT(EReportType::REPORT_TYPE_ERROR, "Deformation input buffer create failed.");
+			return false;
+		}
+	}
+
+	//rest pose until the inputs are set
+	m_boneMatrices.assign(m_boneCount, glm::mat4(1.0f));
+	m_morphWeights.assign(m_morphTargetCount, 0.0f);
+	m_isDirty = false;
+
+	return CreateDescriptorSets(descLayout, frameCount);
+}
+
+void MeshDeformation::Destroy()
+{
+	if (m_descPool != VK_NULL_HANDLE)
+	{
+		vkDestroyDescriptorPool(gLogicalDevice, m_descPool, nullptr);
+		m_descPool = VK_NULL_HANDLE;
+	}
+	m_descSets.clear();
+
+	m_restVertexBuffer.Destroy();
+	m_skinBuffer.Destroy();
+	m_morphDeltaBuffer.Destroy();
+	for (auto& cur : m_boneMatrixBuffers)
+	{
+		cur.Destroy();
+	}
+	m_boneMatrixBuffers.clear();
+	for (auto& cur : m_morphWeightBuffers)
+	{
+		cur.Destroy();
+	}
+	m_morphWeightBuffers.clear();
+
+	m_mesh = nullptr;
+}
+
+bool MeshDeformation::CreateDescriptorSets(VkDescriptorSetLayout descLayout, uint32_t frameCount)
+{
+	VkDescriptorPoolSize descPoolSize = {};
+	descPoolSize.type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+	descPoolSize.descriptorCount = MESH_DEFORM_BINDING_COUNT * frameCount;
+
+	VkDescriptorPoolCreateInfo descPoolCreateInfo = {};
+	descPoolCreateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+	descPoolCreateInfo.maxSets = frameCount;
+	descPoolCreateInfo.poolSizeCount = 1;
+	descPoolCreateInfo.pPoolSizes = &descPoolSize;
+	if (vkCreateDescriptorPool(gLogicalDevice, &descPoolCreateInfo, nullptr, &m_descPool) != VkResult::VK_SUCCESS)
+	{
+		REPORT(EReportType::REPORT_TYPE_ERROR, "Descriptor pool create failed.");
+		return false;
+	}
+
+	std::vector<VkDescriptorSetLayout> setLayouts(frameCount, descLayout);
+	VkDescriptorSetAllocateInfo descSetAllocateInfo = {};
+	descSetAllocateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+	descSetAllocateInfo.descriptorPool = m_descPool;
+	descSetAllocateInfo.descriptorSetCount = frameCount;
+	descSetAllocateInfo.pSetLayouts = setLayouts.data();
+
+	m_descSets.resize(frameCount);
+	if (vkAllocateDescriptorSets(gLogicalDevice, &descSetAllocateInfo, m_descSets.data()) != VkResult::VK_SUCCESS)
+	{
+		REPORT(EReportType::REPORT_TYPE_ERROR, "Descriptor sets create failed.");
+		return false;
+	}
+
+	for (uint32_t i = 0; i < frameCount; i++)
+	{
+		VkDescriptorBufferInfo bufferInfos[MESH_DEFORM_BINDING_COUNT] =
+		{
+			m_restVertexBuffer.GetBufferInfo(),
+			m_skinBuffer.GetBufferInfo(),
+			m_morphDeltaBuffer.GetBufferInfo(),
+			m_morphWeightBuffers[i].GetBufferInfo(),
+			m_boneMatrixBuffers[i].GetBufferInfo(),
+			m_mesh->GetVertexBuffer()->GetBufferInfo(),
+		};
+
+		std::vector<VkWriteDescriptorSet> writeDescs(MESH_DEFORM_BINDING_COUNT);
+		for (uint32_t j = 0; j < MESH_DEFORM_BINDING_COUNT; j++)
+		{
+			writeDescs[j] = {};
+			writeDescs[j].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+			writeDescs[j].dstSet = m_descSets[i];
+			writeDescs[j].dstBinding = j;
+			writeDescs[j].descriptorCount = 1;
+			writeDescs[j].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+			writeDescs[j].pBufferInfo = &bufferInfos[j];
+		}
+		vkUpdateDescriptorSets(gLogicalDevice, static_cast<uint32_t>(writeDescs.size()), writeDescs.data(), 0, nullptr);
+	}
+	return true;
+}
+
+void MeshDeformation::WriteDispatchCommand(VkCommandBuffer commandBuffer, VkPipelineLayout pipelineLayout, uint32_t frameIndex)
+{
+	//input buffers of the frame are not read by the commands in flight
+	if (m_boneCount > 0)
+	{
+		StructuredBufferData<glm::mat4>& boneMatrixBuffer = m_boneMatrixBuffers[frameIndex];
+		boneMatrixBuffer.WriteMappedRange(m_boneMatrices.data(), 0, m_boneCount);
+		std::vector<BufferResouceRange> ranges = { { 0, boneMatrixBuffer.GetByteSize() } };
+		boneMatrixBuffer.FlushMappedRanges(ranges);
+	}
+	if (m_morphTargetCount > 0)
+	{
+		StructuredBufferData<float>& morphWeightBuffer = m_morphWeightBuffers[frameIndex];
+		morphWeightBuffer.WriteMappedRange(m_morphWeights.data(), 0, m_morphTargetCount);
+		std::vector<BufferResouceRange> ranges = { { 0, morphWeightBuffer.GetByteSize() } };
+		morphWeightBuffer.FlushMappedRanges(ranges);
+	}
+
+	MeshDeformConstants constants = {};
+	constants.VertexCount = m_vertexCount;
+	constants.BoneCount = m_boneCount;
+	constants.MorphTargetCount = m_morphTargetCount;
+
+	vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, pipelineLayout, 0, 1, &m_descSets[frameIndex], 0, nullptr);
+	vkCmdPushConstants(commandBuffer, pipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(MeshDeformConstants), &constants);
+	vkCmdDispatch(commandBuffer, (m_vertexCount + MESH_DEFORM_GROUP_SIZE - 1) / MESH_DEFORM_GROUP_SIZE, 1, 1);
+
+	m_isDirty = false;
+}
+
+bool RTMeshDeformer::Initialize(uint32_t frameCount, std::string shaderFilePath)
+{
+	m_frameCount = frameCount;
+	if (!CreatePipeline(shaderFilePath))
+	{
+		REPORT(EReportType::REPORT_TYPE_WARN, "Mesh deformation pipeline create failed, meshes are not deformed.");
+		Destroy();
+		return false;
+	}
+	return true;
+}
+
+void RTMeshDeformer::Destroy()
+{
+	for (auto& cur : m_deformations)
+	{
+		cur->Destroy();
+		delete cur;
+	}
+	m_deformations.clear();
+
+	if (m_pipeline != VK_NULL_HANDLE)
+	{
+		vkDestroyPipeline(gLogicalDevice, m_pipeline, nullptr);
+		m_pipeline = VK_NULL_HANDLE;
+	}
+	if (m_pipelineLayout != VK_NULL_HANDLE)
+	{
+		vkDestroyPipelineLayout(gLogicalDevice, m_pipelineLayout, nullptr);
+		m_pipelineLayout = VK_NULL_HANDLE;
+	}
+	if (m_descLayout != VK_NULL_HANDLE)
+	{
+		vkDestroyDescriptorSetLayout(gLogicalDevice, m_descLayout, nullptr);
+		m_descLayout = VK_NULL_HANDLE;
+	}
+	if (m_shaderModule != VK_NULL_HANDLE)
+	{
+		vkDestroyShaderModule(gLogicalDevice, m_shaderModule, nullptr);
+		m_shaderModule = VK_NULL_HANDLE;
+	}
+}
+
+MeshDeformation* RTMeshDeformer::CreateDeformation(SimpleMeshData* mesh, std::vector<VertexSkinData>& skinData, std::vector<MorphTargetData>& morphTargets)
+{
+	if (!IsAvailable() || mesh == nullptr)
+	{
+		return nullptr;
+	}
+	if (skinData.empty() && morphTargets.empty())
+	{
+		REPORT(EReportType::REPORT_TYPE_WARN, "Deformation needs skin data or morph targets.");
+		return nullptr;
+	}
+
+	MeshDeformation* deformation = new MeshDeformation();
+	if (!deformation->Initialize(mesh, skinData, morphTargets, m_descLayout, m_frameCount))
+	{
+		deformation->Destroy();
+		delete deformation;
+		return nullptr;
+	}
+
+	//refitted after every dispatch and rebuilt by the rebuild policy, the next full build takes the profile
+	mesh->SetBuildProfile(EAsBuildProfile::DEFORMING);
+	m_deformations.push_back(deformation);
+
+	return deformation;
+}
+
+void RTMeshDeformer::RemoveDeformation(MeshDeformation* deformation)
+{
+	auto iterFind = std::find(m_deformations.begin(), m_deformations.end(), deformation);
+	if (iterFind == m_deformations.end())
+	{
+		return;
+	}
+
+	//the dispatch of a frame in flight may still read the buffers
+	gVkDeviceRes.WaitForAllDeviceAction();
+
+	deformation->Destroy();
+	delete deformation;
+	m_deformations.erase(iterFind);
+}
+
+bool RTMeshDeformer::HasPendingDeformation()
+{
+	for (auto& cur : m_deformations)
+	{
+		if (cur->IsDirty())
+		{
+			return true;
+		}
+	}
+	return false;
+}
+
+void RTMeshDeformer::WriteDispatchCommands(VkCommandBuffer commandBuffer, uint32_t frameIndex)
+{
+	if (!IsAvailable() || !HasPendingDeformation())
+	{
+		return;
+	}
+
+	//vertex buffers are written in place, previous traces and builds reading them must be finished
+	WriteBarrier
+	(
+		commandBuffer,
+		VK_PIPELINE_STAGE_RAY_TRACING_SHADER_BIT_KHR | VK_PIPELINE_STAGE_ACCELERATION_STRUCTURE_BUILD_BIT_KHR,
+		0,
+		VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+		0
+	);
+
+	vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, m_pipeline);
+
+	std::vector<SimpleMeshData*> deformedMeshes;
+	for (auto& cur : m_deformations)
+	{
+		if (cur->IsDirty())
+		{
+			cur->WriteDispatchCommand(commandBuffer, m_pipelineLayout, frameIndex);
+			deformedMeshes.push_back(cur->GetMesh());
+		}
+	}
+
+	//one barrier for every dispatch, blas builds read positions and hit shaders read the whole vertices
+	WriteBarrier
+	(
+		commandBuffer,
+		VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+		VK_ACCESS_SHADER_WRITE_BIT,
+		VK_PIPELINE_STAGE_ACCELERATION_STRUCTURE_BUILD_BIT_KHR | VK_PIPELINE_STAGE_RAY_TRACING_SHADER_BIT_KHR,
+		VK_ACCESS_SHADER_READ_BIT
+	);
+
+	//blas of the meshes are marked for refit and built together after the dispatches
+	for (auto& cur : deformedMeshes)
+	{
+		cur->OnUpdated();
+	}
+}
+
+bool RTMeshDeformer::CreatePipeline(std::string& shaderFilePath)
+{
+	std::ifstream shaderFile(shaderFilePath, std::ios::binary);
+	if (!shaderFile.is_open())
+	{
+		char message[256];
+		sprintf_s
+		(
+			message,
+			"Mesh deformation shader is not found : %s",
+			shaderFilePath.c_str()
+		);
+		REPORT(EReportType::REPORT_TYPE_WARN, message);
+		return false;
+	}
+	shaderFile.seekg(0, std::ios_base::end);
+	uint32_t shaderFileSize = static_cast<uint32_t>(shaderFile.tellg());
+	if (shaderFileSize == 0)
+	{
+		return false;
+	}
+	std::vector<char> binaryData(shaderFileSize);
+	shaderFile.seekg(0, std::ios_base::beg);
+	shaderFile.read(binaryData.data(), shaderFileSize);
+	shaderFile.close();
+
+	VkShaderModuleCreateInfo shaderModuleCreateInfo = {};
+	shaderModuleCreateInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+	shaderModuleCreateInfo.codeSize = shaderFileSize;
+	shaderModuleCreateInfo.pCode = reinterpret_cast<std::uint32_t const*>(binaryData.data());
+	if (vkCreateShaderModule(gLogicalDevice, &shaderModuleCreateInfo, nullptr, &m_shaderModule) != VkResult::VK_SUCCESS)
+	{
+		return false;
+	}
+
+	//rest vertices, skin, morph deltas, morph weights, bone matrices, deformed vertices
+	std::vector<VkDescriptorSetLayoutBinding> descSetLayoutBindings(MESH_DEFORM_BINDING_COUNT);
+	for (uint32_t i = 0; i < MESH_DEFORM_BINDING_COUNT; i++)
+	{
+		descSetLayoutBindings[i] = {};
+		descSetLayoutBindings[i].binding = i;
+		descSetLayoutBindings[i].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+		descSetLayoutBindings[i].descriptorCount = 1;
+		descSetLayoutBindings[i].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+	}
+
+	VkDescriptorSetLayoutCreateInfo layoutCreateInfo = {};
+	layoutCreateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+	layoutCreateInfo.bindingCount = static_cast<uint32_t>(descSetLayoutBindings.size());
+	layoutCreateInfo.pBindings = descSetLayoutBindings.data();
+	if (vkCreateDescriptorSetLayout(gLogicalDevice, &layoutCreateInfo, nullptr, &m_descLayout) != VkResult::VK_SUCCESS)
+	{
+		REPORT(EReportType::REPORT_TYPE_ERROR, "Descriptor set layout create failed.");
+		return false;
+	}
+
+	VkPushConstantRange pushConstantRange = {};
+	pushConstantRange.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+	pushConstantRange.offset = 0;
+	pushConstantRange.size = sizeof(MeshDeformConstants);
+
+	VkPipelineLayoutCreateInfo pipelineLayoutCreateInfo = {};
+	pipelineLayoutCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+	pipelineLayoutCreateInfo.setLayoutCount = 1;
+	pipelineLayoutCreateInfo.pSetLayouts = &m_descLayout;
+	pipelineLayoutCreateInfo.pushConstantRangeCount = 1;
+	pipelineLayoutCreateInfo.pPushConstantRanges = &pushConstantRange;
+	if (vkCreatePipelineLayout(gLogicalDevice, &pipelineLayoutCreateInfo, nullptr, &m_pipelineLayout) != VkResult::VK_SUCCESS)
+	{
+		REPORT(EReportType::REPORT_TYPE_ERROR, "Pipeline layout create failed.");
+		return false;
+	}
+
+	VkComputePipelineCreateInfo computePipelineCreateInfo = {};
+	computePipelineCreateInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+	computePipelineCreateInfo.stage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+	computePipelineCreateInfo.stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+	computePipelineCreateInfo.stage.module = m_shaderModule;
+	computePipelineCreateInfo.stage.pName = "main";
+	computePipelineCreateInfo.layout = m_pipelineLayout;
+	if (vkCreateComputePipelines(gLogicalDevice, VK_NULL_HANDLE, 1, &computePipelineCreateInfo, nullptr, &m_pipeline) != VkResult::VK_SUCCESS)
+	{
+		REPORT(EReportType::REPORT_TYPE_ERROR, "Pipeline create failed.");
+		return false;
+	}
+	return true;
+}
+
+void RTMeshDeformer::WriteBarrier(VkCommandBuffer commandBuffer, VkPipelineStageFlags srcStageMask, VkAccessFlags srcAccessMask, VkPipelineStageFlags dstStageMask, VkAccessFlags dstAccessMask)
+{
+	VkMemoryBarrier memoryBarrier = {};
+	memoryBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+	memoryBarrier.srcAccessMask = srcAccessMask;
+	memoryBarrier.dstAccessMask = dstAccessMask;
+	vkCmdPipelineBarrier
+	(
+		commandBuffer,
+		srcStageMask,
+		dstStageMask,
+		0,
+		1,
+		&memoryBarrier,
+		0,
+		nullptr,
+		0,
+		nullptr
+	);
+}
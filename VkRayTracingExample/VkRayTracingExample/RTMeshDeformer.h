@@ -0,0 +1,104 @@
+#pragma once
+
+#include <string>
+
+#include "DeviceBuffers.h"
+#include "SimpleGeometry.h"
+
+#define MESH_DEFORM_GROUP_SIZE 64
+
+//four bone influences per vertex, weights of a vertex sum to one
+struct VertexSkinData
+{
+	glm::uvec4 BoneIndices = glm::uvec4(0);
+	glm::vec4 BoneWeights = glm::vec4(0.0f);
+};
+
+//offsets added to the rest vertices with the target weight, one entry per vertex
+struct MorphTargetData
+{
+	std::vector<glm::vec3> PositionDeltas;
+	std::vector<glm::vec3> NormalDeltas;
+};
+
+struct MeshDeformConstants
+{
+	uint32_t VertexCount = 0;
+	uint32_t BoneCount = 0;
+	uint32_t MorphTargetCount = 0;
+	uint32_t Padding0 = 0;
+};
+
+//source data of a deformed mesh and its inputs, inputs are copied to the buffers of the frame on dispatch
+class MeshDeformation
+{
+	friend class RTMeshDeformer;
+public:
+	//object space skinning matrices indexed by the skin data, inverse bind pose must be applied already
+	void SetBoneMatrices(std::vector<glm::mat4>& boneMatrices);
+	void SetMorphWeights(std::vector<float>& morphWeights);
+
+	SimpleMeshData* GetMesh() { return m_mesh; }
+	uint32_t GetBoneCount() { return m_boneCount; }
+	uint32_t GetMorphTargetCount() { return m_morphTargetCount; }
+	bool IsDirty() { return m_isDirty; }
+
+protected:
+	bool Initialize(SimpleMeshData* mesh, std::vector<VertexSkinData>& skinData, std::vector<MorphTargetData>& morphTargets, VkDescriptorSetLayout descLayout, uint32_t frameCount);
+	void Destroy();
+
+	bool CreateDescriptorSets(VkDescriptorSetLayout descLayout, uint32_t frameCount);
+	void WriteDispatchCommand(VkCommandBuffer commandBuffer, VkPipelineLayout pipelineLayout, uint32_t frameIndex);
+
+private:
+	SimpleMeshData* m_mesh = nullptr;
+
+	StructuredBufferData<DefaultVertex> m_restVertexBuffer;
+	StructuredBufferData<VertexSkinData> m_skinBuffer;
+	StructuredBufferData<glm::vec4> m_morphDeltaBuffer;
+	//written on dispatch, one per frame in flight
+	std::vector<StructuredBufferData<glm::mat4>> m_boneMatrixBuffers;
+	std::vector<StructuredBufferData<float>> m_morphWeightBuffers;
+
+	std::vector<glm::mat4> m_boneMatrices;
+	std::vector<float> m_morphWeights;
+
+	VkDescriptorPool m_descPool = VK_NULL_HANDLE;
+	std::vector<VkDescriptorSet> m_descSets;
+
+	uint32_t m_vertexCount = 0;
+	uint32_t m_boneCount = 0;
+	uint32_t m_morphTargetCount = 0;
+	bool m_isDirty = false;
+};
+
+//skinning and morph target compute pass writing the acceleration structure vertex buffers in place
+class RTMeshDeformer
+{
+public:
+	bool Initialize(uint32_t frameCount, std::string shaderFilePath = "../Resources/Shaders/Deform.spr");
+	void Destroy();
+
+	//mesh is switched to the deforming build profile, skin data and morph targets may be empty but not both
+	MeshDeformation* CreateDeformation(SimpleMeshData* mesh, std::vector<VertexSkinData>& skinData, std::vector<MorphTargetData>& morphTargets);
+	void RemoveDeformation(MeshDeformation* deformation);
+
+	bool IsAvailable() { return m_pipeline != VK_NULL_HANDLE; }
+	bool HasPendingDeformation();
+
+	//dispatches every changed deformation with one barrier before the blas builds, deformed meshes are notified as updated
+	void WriteDispatchCommands(VkCommandBuffer commandBuffer, uint32_t frameIndex);
+
+protected:
+	bool CreatePipeline(std::string& shaderFilePath);
+	static void WriteBarrier(VkCommandBuffer commandBuffer, VkPipelineStageFlags srcStageMask, VkAccessFlags srcAccessMask, VkPipelineStageFlags dstStageMask, VkAccessFlags dstAccessMask);
+
+private:
+	VkShaderModule m_shaderModule = VK_NULL_HANDLE;
+	VkDescriptorSetLayout m_descLayout = VK_NULL_HANDLE;
+	VkPipelineLayout m_pipelineLayout = VK_NULL_HANDLE;
+	VkPipeline m_pipeline = VK_NULL_HANDLE;
+
+	std::vector<MeshDeformation*> m_deformations;
+	uint32_t m_frameCount = 0;
+};
@@ -3,10 +3,13 @@
 #include "RenderObjectContainer.h"
 #include "MaterialContainer.h"
 #include "GeometryContainer.h"
+#include "RTAccelerationStructure.h"
 
 
-bool RTPipelineResources::Build(VkAccelerationStructureKHR tlasHandle, RtTargetImageBuffer* targetImageBuffer, SimpleCubmapTexture* cubeMap)
+bool RTPipelineResources::Build(std::vector<VkAccelerationStructureKHR>& tlasHandles, RtTargetImageBuffer* targetImageBuffer, SimpleCubmapTexture* cubeMap)
 {
+	m_numDescriptorSet = static_cast<uint32_t>(tlasHandles.size());
+
 	if (!CreateBuffers())
 	{
 		return false;
@@ -17,7 +20,7 @@ bool RTPipelineResources::Build(VkAccelerationStructureKHR tlasHandle, RtTargetI
 		return false;
 	}
 
-	if (!RefreshResourceBind(tlasHandle, targetImageBuffer, cubeMap))
+	if (!RefreshResourceBind(tlasHandles, targetImageBuffer, cubeMap))
 	{
 		return false;
 	}
@@ -25,14 +28,19 @@ bool RTPipelineResources::Build(VkAccelerationStructureKHR tlasHandle, RtTargetI
 	return true;
 }
 
-bool RTPipelineResources::RefreshResourceBind(VkAccelerationStructureKHR tlasHandle, RtTargetImageBuffer* targetImageBuffer, SimpleCubmapTexture* cubeMap)
+bool RTPipelineResources::RefreshResourceBind(std::vector<VkAccelerationStructureKHR>& tlasHandles, RtTargetImageBuffer* targetImageBuffer, SimpleCubmapTexture* cubeMap)
 {
-	if (m_tlasHandle != VK_NULL_HANDLE)
+	if (!m_tlasHandles.empty())
 	{
 		DestoryBindLayouts();
 	}
 
-	m_tlasHandle = tlasHandle;
+	if (tlasHandles.size() != m_numDescriptorSet)
+	{
+		REPORT(EReportType::REPORT_TYPE_ERROR, "Tlas count does not match the descriptor set count.");
+		return false;
+	}
+	m_tlasHandles = tlasHandles;
 	m_targetImageBuffer = targetImageBuffer;
 	m_skyCubeMap = cubeMap;
 
@@ -45,22 +53,24 @@ bool RTPipelineResources::RefreshResourceBind(VkAccelerationStructureKHR tlasHan
 	return true;
 }
 
-void RTPipelineResources::Update(GlobalConstants& globalConstnats, VkAccelerationStructureKHR tlasHandle)
+void RTPipelineResources::Update(GlobalConstants& globalConstnats, std::vector<VkAccelerationStructureKHR>* tlasHandles)
 {
 	//Ʈ ũ  ŵ ε 
 	UpdateInstanceConstants();
+	UpdateGeometryConstants();
 	UpdateMaterialConstants();
 	UpdateGlobalConstants(globalConstnats);
 
-	if (tlasHandle != VK_NULL_HANDLE)
+	if (tlasHandles != nullptr)
 	{
-		RefreshResourceBind(tlasHandle, m_targetImageBuffer, m_skyCubeMap);
+		RefreshResourceBind(*tlasHandles, m_targetImageBuffer, m_skyCubeMap);
 	}
 }
 
 void RTPipelineResources::Destroy()
 {
 	m_instanceConstantsBuffer.Destroy();
+	m_geometryConstantsBuffer.Destroy();
 	m_materialConstantsBuffer.Destroy();
 	m_globalConstantsBuffer.Destroy();
 
@@ -74,7 +84,13 @@ void RTPipelineResources::Destroy()
 
 bool RTPipelineResources::CreateBuffers()
 {
-	m_instanceConstants.resize(gRenderObjContainer.GetRenderObjectInstancePerMeshCount());
+	if (m_bottomLevelAsGroup == nullptr)
+	{
+		REPORT(EReportType::REPORT_TYPE_ERROR, "Bottom level as group is not set.");
+		return false;
+	}
+
+	m_instanceConstants.resize(m_bottomLevelAsGroup->GetAsInstanceDescCount());
 	bool res = m_instanceConstantsBuffer.Initialzie
 	(
 		VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
@@ -86,6 +102,18 @@ bool RTPipelineResources::CreateBuffers()
 		return false;
 	}
 
+	m_geometryConstants.resize(m_bottomLevelAsGroup->GetGeometryTableSize());
+	res = m_geometryConstantsBuffer.Initialzie
+	(
+		VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+		VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+		static_cast<uint32_t>(m_geometryConstants.size())
+	);
+	if (!res)
+	{
+		return false;
+	}
+
 	m_materialConstants.resize(gMaterialContainer.GetMaterialCount());
 	res = m_materialConstantsBuffer.Initialzie
 	(
@@ -114,17 +142,17 @@ bool RTPipelineResources::CreateDescriptorPool()
 {
 	std::vector<VkDescriptorPoolSize> descPoolSize(4);
 	descPoolSize[0].type = VK_DESCRIPTOR_TYPE_ACCELERATION_STRUCTURE_KHR;
-	descPoolSize[0].descriptorCount = 1;
+	descPoolSize[0].descriptorCount = 1 * m_numDescriptorSet;
 	descPoolSize[1].type = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
-	descPoolSize[1].descriptorCount = 1;
+	descPoolSize[1].descriptorCount = 1 * m_numDescriptorSet;
 	descPoolSize[2].type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
-	descPoolSize[2].descriptorCount = 4; // instance, material, vb, ib
+	descPoolSize[2].descriptorCount = 5 * m_numDescriptorSet; // instance, material, vb, ib, geometry
 	descPoolSize[3].type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-	descPoolSize[3].descriptorCount = 2;
+	descPoolSize[3].descriptorCount = 2 * m_numDescriptorSet;
 
 	VkDescriptorPoolCreateInfo descPoolCreateInfo = {};
 	descPoolCreateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
-	descPoolCreateInfo.maxSets = 1;
+	descPoolCreateInfo.maxSets = m_numDescriptorSet;
 	descPoolCreateInfo.poolSizeCount = static_cast<uint32_t>(descPoolSize.size());
 	descPoolCreateInfo.pPoolSizes = descPoolSize.data();
 
@@ -159,7 +187,7 @@ void RTPipelineResources::DestoryBindLayouts()
 
 bool RTPipelineResources::RefreshResourceBind()
 {
-	m_descSetLayoutBindings.resize(9);
+	m_descSetLayoutBindings.resize(10);
 	//enum ѱ??
 	//as
 	m_descSetLayoutBindings[0].binding = 0;
@@ -215,6 +243,12 @@ bool RTPipelineResources::RefreshResourceBind()
 	m_descSetLayoutBindings[8].descriptorCount = gTexContainer.GetTextureCount();
 	m_descSetLayoutBindings[8].stageFlags = VK_SHADER_STAGE_CLOSEST_HIT_BIT_KHR;
 
+	//geometry constants
+	m_descSetLayoutBindings[9].binding = 9;
+	m_descSetLayoutBindings[9].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+	m_descSetLayoutBindings[9].descriptorCount = 1;
+	m_descSetLayoutBindings[9].stageFlags = VK_SHADER_STAGE_CLOSEST_HIT_BIT_KHR;
+
 	VkDescriptorSetLayoutCreateInfo layoutCreateInfo = {};
 	layoutCreateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
 	layoutCreateInfo.bindingCount = static_cast<uint32_t>(m_descSetLayoutBindings.size());
@@ -241,12 +275,14 @@ bool RTPipelineResources::RefreshResourceBind()
 		return false;
 	}
 
+	//every set shares the single layout
+	std::vector<VkDescriptorSetLayout> setLayouts(m_numDescriptorSet, m_descLayouts[0]);
 	std::vector<VkDescriptorSetAllocateInfo> descSetAllocateInfo(1);
 	descSetAllocateInfo[0].sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
 	descSetAllocateInfo[0].pNext = nullptr;
 	descSetAllocateInfo[0].descriptorPool = m_descPool;
 	descSetAllocateInfo[0].descriptorSetCount = m_numDescriptorSet;
-	descSetAllocateInfo[0].pSetLayouts = m_descLayouts.data();
+	descSetAllocateInfo[0].pSetLayouts = setLayouts.data();
 
 	m_descSets.resize(m_numDescriptorSet);
 	res = vkAllocateDescriptorSets(gLogicalDevice, descSetAllocateInfo.data(), m_descSets.data());
@@ -283,10 +319,10 @@ void RTPipelineResources::RefreshWriteDescriptorSet()
 	VkWriteDescriptorSetAccelerationStructureKHR asWriteDesc = {};
 	asWriteDesc.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET_ACCELERATION_STRUCTURE_KHR;
 	asWriteDesc.accelerationStructureCount = 1;
-	asWriteDesc.pAccelerationStructures = &m_tlasHandle;
+	asWriteDesc.pAccelerationStructures = &m_tlasHandles[0];
 
 	//ϴ ̷  ߿ ȭ..
-	std::vector<VkWriteDescriptorSet> writeDescs(9);
+	std::vector<VkWriteDescriptorSet> writeDescs(10);
 	writeDescs[0].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
 	writeDescs[0].pNext = &asWriteDesc;
 	writeDescs[0].dstSet = m_descSets[0];
@@ -359,32 +395,105 @@ void RTPipelineResources::RefreshWriteDescriptorSet()
 	writeDescs[8].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
 	writeDescs[8].pImageInfo = imageInfos.data();
 
-	vkUpdateDescriptorSets(gLogicalDevice, static_cast<uint32_t>(writeDescs.size()), writeDescs.data(), 0, nullptr);
+	writeDescs[9].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+	writeDescs[9].dstSet = m_descSets[0];
+	writeDescs[9].dstBinding = 9;
+	writeDescs[9].dstArrayElement = 0;
+	writeDescs[9].descriptorCount = 1;
+	writeDescs[9].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+	writeDescs[9].pBufferInfo = &m_geometryConstantsBuffer.GetBufferInfo();
+
+	//sets differ only in the tlas binding
+	for (uint32_t i = 0; i < m_descSets.size(); i++)
+	{
+		asWriteDesc.pAccelerationStructures = &m_tlasHandles[i];
+		for (auto& cur : writeDescs)
+		{
+			cur.dstSet = m_descSets[i];
+		}
+		vkUpdateDescriptorSets(gLogicalDevice, static_cast<uint32_t>(writeDescs.size()), writeDescs.data(), 0, nullptr);
+	}
 }
 
 //TODO :
 //Ʈ  ͸ ε ְ ʿ
 void RTPipelineResources::UpdateInstanceConstants()
 {
-	uint32_t instPreMeshCount = gRenderObjContainer.GetRenderObjectInstancePerMeshCount();
-	for (uint32_t i = 0; i < instPreMeshCount; i++)
+	//instance constants are indexed by tlas instance, merged geometries share one instance
+	uint32_t instanceCount = m_bottomLevelAsGroup->GetAsInstanceDescCount();
+	if (m_instanceConstants.size() != instanceCount)
 	{
-		SampleRenderObjectInstancePerMesh* instPerMesh = gRenderObjContainer.GetRenderObjectInstancePerMesh(i);
+		gVkDeviceRes.GraphicsQueueWaitIdle();
+		m_instanceConstants.resize(instanceCount);
+		ResizeBuffer(m_instanceConstantsBuffer, instanceCount);
+		m_instanceLayoutVersion = UINT32_MAX;
+	}
 
-		if (instPerMesh != nullptr)
+	//memory is host coherent, written constants need no flush
+	if (instanceCount == 0 || !m_instanceConstantsBuffer.Map())
+	{
+		return;
+	}
+
+	InstanceTransformStore& transformStore = gRenderObjContainer.GetTransformStore();
+	if (m_instanceLayoutVersion != m_bottomLevelAsGroup->GetInstanceLayoutVersion())
+	{
+		for (uint32_t i = 0; i < instanceCount; i++)
 		{
-			m_instanceConstants[i].GeometryID = gGeomContainer.GetMeshBindIndex(instPerMesh->GetMeshData());
-			m_instanceConstants[i].MaterialID = gMaterialContainer.GetBindIndex(instPerMesh->GetMaterial());
-			SampleRenderObjectInstance* parentInst = instPerMesh->GetParentInstance();
-			if (parentInst != nullptr)
+			AsInstanceDesc& instanceDesc = m_bottomLevelAsGroup->GetAsInstanceDesc(i);
+			SampleRenderObjectInstancePerMesh* instPerMesh = gRenderObjContainer.GetRenderObjectInstancePerMesh(instanceDesc.InstPerMeshIndex);
+
+			if (instPerMesh != nullptr)
 			{
-				m_instanceConstants[i].WorldMat = parentInst->GetWorldMatrix();
+				//ids of the first geometry, same as the geometry table entry at GeometryTableOffset
+				m_instanceConstants[i].GeometryID = gGeomContainer.GetMeshBindIndex(instPerMesh->GetMeshData());
+				m_instanceConstants[i].MaterialID = gMaterialContainer.GetBindIndex(instPerMesh->GetMaterial());
+				m_instanceConstants[i].GeometryTableOffset = static_cast<int>(instanceDesc.GeometryTableOffset);
+				InstanceTransformStore::ToMatrix(transformStore.GetRows(instanceDesc.TransformSlot), m_instanceConstants[i].WorldMat);
 			}
 		}
+		m_instanceConstantsBuffer.WriteMappedRange(m_instanceConstants.data(), 0, instanceCount);
+
+		m_instanceLayoutVersion = m_bottomLevelAsGroup->GetInstanceLayoutVersion();
+		m_bottomLevelAsGroup->ClearTransformUpdatedInstances();
+		return;
 	}
 
-	m_instanceConstantsBuffer.UpdateResource(m_instanceConstants.data(), static_cast<uint32_t>(m_instanceConstants.size()));
+	//only the world matrices of the instances moved by the transform pass of the acceleration structure update
+	std::vector<uint32_t>& updatedInstances = m_bottomLevelAsGroup->GetTransformUpdatedInstances();
+	for (uint32_t index : updatedInstances)
+	{
+		if (index < instanceCount)
+		{
+			AsInstanceDesc& instanceDesc = m_bottomLevelAsGroup->GetAsInstanceDesc(index);
+			InstanceTransformStore::ToMatrix(transformStore.GetRows(instanceDesc.TransformSlot), m_instanceConstants[index].WorldMat);
+			m_instanceConstantsBuffer.WriteMappedRange(&m_instanceConstants[index], index, 1);
+		}
+	}
+	m_bottomLevelAsGroup->ClearTransformUpdatedInstances();
+}
+
+void RTPipelineResources::UpdateGeometryConstants()
+{
+	uint32_t geometryCount = m_bottomLevelAsGroup->GetGeometryTableSize();
+	if (m_geometryConstants.size() != geometryCount)
+	{
+		gVkDeviceRes.GraphicsQueueWaitIdle();
+		m_geometryConstants.resize(geometryCount);
+		ResizeBuffer(m_geometryConstantsBuffer, geometryCount);
+	}
+
+	for (uint32_t i = 0; i < geometryCount; i++)
+	{
+		SampleRenderObjectInstancePerMesh* instPerMesh = m_bottomLevelAsGroup->GetGeometryTableEntry(i);
+		if (instPerMesh != nullptr)
+		{
+			m_geometryConstants[i].GeometryID = gGeomContainer.GetMeshBindIndex(instPerMesh->GetMeshData());
+			m_geometryConstants[i].MaterialID = gMaterialContainer.GetBindIndex(instPerMesh->GetMaterial());
+		}
+	}
 
+	m_geometryConstantsBuffer.UpdateResource(m_geometryConstants.data(), static_cast<uint32_t>(m_geometryConstants.size()));
 }
 
 void RTPipelineResources::UpdateMaterialConstants()
@@ -434,5 +543,6 @@ void RTPipelineResources::UpdateMaterialConstants()
 
 void RTPipelineResources::UpdateGlobalConstants(GlobalConstants& globalConstnats)
 {
+	m_globalConstants = globalConstnats;
 	m_globalConstantsBuffer.UpdateResource(globalConstnats);
 }
\ No newline at end of file
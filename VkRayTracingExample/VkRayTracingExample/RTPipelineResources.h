@@ -3,6 +3,8 @@
 #include "DeviceBuffers.h"
 #include "TextureContainer.h"
 
+class BottomLevelAsGroup;
+
 struct GlobalConstants
 {
 	glm::mat4 MatViewInv = glm::mat4(1.0f);
@@ -20,10 +22,17 @@ public:
 
 		int GeometryID;
 		int MaterialID;
-		float Padding0;
+		int GeometryTableOffset;
 		float Padding1;
 	};
 
+	//indexed by GeometryTableOffset of the instance + gl_GeometryIndexEXT
+	struct GeometryConstants
+	{
+		int GeometryID;
+		int MaterialID;
+	};
+
 	struct MaterialConstants
 	{
 		glm::vec4 m_color = glm::vec4(1.0f);
@@ -45,12 +54,16 @@ public:
 	};
 
 public:
-	bool Build(VkAccelerationStructureKHR tlasHandle, RtTargetImageBuffer* targetImageBuffer, SimpleCubmapTexture* cubeMap);
-	void Update(GlobalConstants& globalConstnats, VkAccelerationStructureKHR tlasHandle = VK_NULL_HANDLE);
+	//one descriptor set is written per tlas handle, the set of a frame binds the tlas of the frame
+	bool Build(std::vector<VkAccelerationStructureKHR>& tlasHandles, RtTargetImageBuffer* targetImageBuffer, SimpleCubmapTexture* cubeMap);
+	void Update(GlobalConstants& globalConstnats, std::vector<VkAccelerationStructureKHR>* tlasHandles = nullptr);
 	void Destroy();
 
+	//tlas instances and geometry table of the group are bound to instance and geometry constants
+	void SetBottomLevelAsGroup(BottomLevelAsGroup* bottomLevelAsGroup) { m_bottomLevelAsGroup = bottomLevelAsGroup; }
+
 public:
-	bool RefreshResourceBind(VkAccelerationStructureKHR tlasHandle, RtTargetImageBuffer* targetImageBuffer, SimpleCubmapTexture* cubeMap);
+	bool RefreshResourceBind(std::vector<VkAccelerationStructureKHR>& tlasHandles, RtTargetImageBuffer* targetImageBuffer, SimpleCubmapTexture* cubeMap);
 	void RefreshWriteDescriptorSet();
 
 protected:
@@ -65,23 +78,38 @@ public:
 	uint32_t GetDescriptorSetCount() { return static_cast<uint32_t>(m_descSets.size()); }
 	std::vector<VkDescriptorSet>& GetDescriptorSet() { return m_descSets; }
 
+	//host copies of the uploaded constants, read by the cpu reference renderer
+	std::vector<InstanceConstants>& GetInstanceConstants() { return m_instanceConstants; }
+	std::vector<GeometryConstants>& GetGeometryConstants() { return m_geometryConstants; }
+	std::vector<MaterialConstants>& GetMaterialConstants() { return m_materialConstants; }
+	GlobalConstants& GetGlobalConstants() { return m_globalConstants; }
+	BottomLevelAsGroup* GetBottomLevelAsGroup() { return m_bottomLevelAsGroup; }
+
 protected:
 
 	template <typename BufferType>
 	void ResizeBuffer(BufferType& buffer, int count);
 	void UpdateInstanceConstants();
+	void UpdateGeometryConstants();
 	void UpdateMaterialConstants();
 	void UpdateGlobalConstants(GlobalConstants& globalConstnats);
 
 private:
 
-	VkAccelerationStructureKHR m_tlasHandle = VK_NULL_HANDLE;
+	std::vector<VkAccelerationStructureKHR> m_tlasHandles = {};
 	RtTargetImageBuffer* m_targetImageBuffer = nullptr;
 
 	SimpleCubmapTexture* m_skyCubeMap;
 
+	BottomLevelAsGroup* m_bottomLevelAsGroup = nullptr;
+
 	std::vector<InstanceConstants> m_instanceConstants = {};
 	StructuredBufferData<InstanceConstants> m_instanceConstantsBuffer = {};
+	//instance layout of the bottom level as group the constants are written with
+	uint32_t m_instanceLayoutVersion = UINT32_MAX;
+
+	std::vector<GeometryConstants> m_geometryConstants = {};
+	StructuredBufferData<GeometryConstants> m_geometryConstantsBuffer = {};
 
 	std::vector<MaterialConstants> m_materialConstants = {};
 	StructuredBufferData<MaterialConstants> m_materialConstantsBuffer = {};
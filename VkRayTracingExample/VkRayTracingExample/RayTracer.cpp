@@ -2,6 +2,7 @@
 #include "VulkanDeviceResources.h"
 #include "TextureContainer.h"
 #include "PipelineBarrier.h"
+#include "CpuReferenceRenderer.h"
 
 bool RayTracer::Initialize(uint32_t width, uint32_t height, VkFormat rtTargetFormat)
 {
@@ -28,6 +29,11 @@ bool RayTracer::Initialize(uint32_t width, uint32_t height, VkFormat rtTargetFor
 	{
 		return false;
 	}
+
+	if (!CreateTraceTimeQueryPool())
+	{
+		REPORT(EReportType::REPORT_TYPE_WARN, "Trace time query is not available.");
+	}
 	
 	m_screenSizeChangedEventHandle = gVkDeviceRes.OnRenderTargetSizeChanged.Add
 	(
@@ -42,24 +48,45 @@ bool RayTracer::Initialize(uint32_t width, uint32_t height, VkFormat rtTargetFor
 
 void RayTracer::Update(GlobalConstants& globalConstants, uint32_t frameIndex)
 {
-	m_accelerationStructure.Update();
+	m_accelerationStructure.Update(frameIndex);
 
 	m_currentCommandBuffers.clear();
+	m_waitSemaphores.clear();
+	m_waitStageMasks.clear();
 	if (m_accelerationStructure.HasWaitingCommandToBuild())
 	{
-		CommandBuffer* buildCmdBuffer = m_accelerationStructure.GetBuildCommandBuffer();
-		if (buildCmdBuffer != nullptr)
+		if (m_accelerationStructure.IsAsyncBuild())
+		{
+			//the build overlaps the trace of the previous frame, only the trace of this frame waits it
+			VkSemaphore buildCompleteSemaphore = VK_NULL_HANDLE;
+			if (m_accelerationStructure.SubmitBuildCommand(buildCompleteSemaphore))
+			{
+				m_waitSemaphores.push_back(buildCompleteSemaphore);
+				m_waitStageMasks.push_back(VK_PIPELINE_STAGE_RAY_TRACING_SHADER_BIT_KHR);
+			}
+		}
+		else
 		{
-			m_currentCommandBuffers.push_back(buildCmdBuffer);
+			CommandBuffer* buildCmdBuffer = m_accelerationStructure.GetBuildCommandBuffer();
+			if (buildCmdBuffer != nullptr)
+			{
+				m_currentCommandBuffers.push_back(buildCmdBuffer);
+			}
+			m_accelerationStructure.NotifyBuildCommandSubmitted();
 		}
-		m_accelerationStructure.NotifyBuildCommandSubmitted();
 	}
 	CommandBuffer* renderCmdBuffer = m_commandBufferContainer.GetCommandBuffer(frameIndex);
 	m_currentCommandBuffers.push_back(renderCmdBuffer);
+	ReadTraceTime(frameIndex);
 
 	if (m_accelerationStructure.IsPipelineResourceUpdated())
 	{
-		m_pipelineResources.Update(globalConstants, m_accelerationStructure.GetTopLevelAs().GetAccelerationStructure());
+		//descriptor sets of every frame are rewritten, the frame in flight must be completed
+		m_accelerationStructure.WaitForFramesInFlight(frameIndex);
+
+		std::vector<VkAccelerationStructureKHR> tlasHandles;
+		GetTopLevelAsHandles(tlasHandles);
+		m_pipelineResources.Update(globalConstants, &tlasHandles);
 		m_pipeline.Build(m_pipelineResources.GetPipelineLayout());
 		m_shaderBindingTable.Refresh();
 
@@ -67,7 +94,16 @@ void RayTracer::Update(GlobalConstants& globalConstants, uint32_t frameIndex)
 	}
 	else
 	{
-		m_pipelineResources.Update(globalConstants, VK_NULL_HANDLE);
+		m_pipelineResources.Update(globalConstants);
+	}
+}
+
+void RayTracer::GetTopLevelAsHandles(std::vector<VkAccelerationStructureKHR>& outTlasHandles)
+{
+	outTlasHandles.clear();
+	for (uint32_t i = 0; i < m_accelerationStructure.GetTopLevelAsCount(); i++)
+	{
+		outTlasHandles.push_back(m_accelerationStructure.GetTopLevelAs(i).GetAccelerationStructure());
 	}
 }
 
@@ -91,7 +127,13 @@ void RayTracer::Destroy()
 	m_accelerationStructure.Destroy();
 	m_commandBufferContainer.Clear();
 
+	m_readbackBuffer.Destroy();
 	m_rtTargetImage.Destroy();
+	if (m_traceTimeQueryPool != VK_NULL_HANDLE)
+	{
+		vkDestroyQueryPool(gLogicalDevice, m_traceTimeQueryPool, nullptr);
+		m_traceTimeQueryPool = VK_NULL_HANDLE;
+	}
 	if (m_commandPool != VK_NULL_HANDLE)
 	{
 		vkDestroyCommandPool(gLogicalDevice, m_commandPool, nullptr);
@@ -110,7 +152,7 @@ void RayTracer::LoadMissShader(std::string& missFilePath)
 
 bool RayTracer::Build()
 {
-	if (!m_accelerationStructure.Initialize(m_commandPool))
+	if (!m_accelerationStructure.Initialize(m_commandPool, m_commandBufferContainer.GetCommandBufferCount()))
 	{
 		return false;
 	}
@@ -120,7 +162,10 @@ bool RayTracer::Build()
 		return false;
 	}
 
-	if (!m_pipelineResources.Build(m_accelerationStructure.GetTopLevelAs().GetAccelerationStructure(),
+	m_pipelineResources.SetBottomLevelAsGroup(&m_accelerationStructure.GetBottomLevelAsGroup());
+	std::vector<VkAccelerationStructureKHR> tlasHandles;
+	GetTopLevelAsHandles(tlasHandles);
+	if (!m_pipelineResources.Build(tlasHandles,
 								   &m_rtTargetImage,
 								   m_envCubmapTexture))
 	{
@@ -172,8 +217,22 @@ bool RayTracer::BuildCommandBuffers()
 
 		if (curCmdBuffer->Begin())
 		{
-			VkImage curBackBuffer = VulkanDeviceResources::Instance().GetSwapChainBuffer(i)->m_image;
 			VkCommandBuffer vkCmdBuf = curCmdBuffer->GetCommandBuffer();
+			if (gVkDeviceRes.IsHeadless())
+			{
+				WriteTraceRaysCommand(vkCmdBuf, i);
+				if (m_readbackBuffer.IsAllocated())
+				{
+					WriteReadbackCommand(vkCmdBuf, subResourceRange);
+				}
+				if (!curCmdBuffer->End())
+				{
+					return false;
+				}
+				continue;
+			}
+
+			VkImage curBackBuffer = VulkanDeviceResources::Instance().GetSwapChainBuffer(i)->m_image;
 
 			PipelineBarrier pipeLineBarrier(curCmdBuffer->GetCommandBuffer());
 			pipeLineBarrier.SetAccessMask(0, VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT, curBackBuffer);
@@ -181,33 +240,7 @@ bool RayTracer::BuildCommandBuffers()
 			pipeLineBarrier.SetImageSubresouceRange(subResourceRange, curBackBuffer);
 			pipeLineBarrier.Write();
 
-			vkCmdBindPipeline(vkCmdBuf, VK_PIPELINE_BIND_POINT_RAY_TRACING_KHR, m_pipeline.GetPipeline());
-
-			vkCmdBindDescriptorSets
-			(
-				vkCmdBuf,
-				VK_PIPELINE_BIND_POINT_RAY_TRACING_KHR,
-				m_pipelineResources.GetPipelineLayout(),
-				0,
-				m_pipelineResources.GetDescriptorSetCount(),
-				m_pipelineResources.GetDescriptorSet().data(),
-				0,
-				nullptr
-			);
-
-			VkStridedDeviceAddressRegionKHR callableShaderSbtEntry = {};
-
-			vkCmdTraceRaysKHR
-			(
-				vkCmdBuf,
-				m_shaderBindingTable.GetStridedBufferRegion(SHADER_GROUP_TYPE_RAY_GEN),
-				m_shaderBindingTable.GetStridedBufferRegion(SHADER_GROUP_TYPE_MISS),
-				m_shaderBindingTable.GetStridedBufferRegion(SHADER_GROUP_TYPE_HIT),
-				m_shaderBindingTable.GetStridedBufferRegion(SHADER_GROUP_TYPE_CALLABLE),
-				m_width,
-				m_height,
-				1
-			);
+			WriteTraceRaysCommand(vkCmdBuf, i);
 
 			pipeLineBarrier.SetAccessMask(VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT, VK_ACCESS_TRANSFER_WRITE_BIT, curBackBuffer);
 			pipeLineBarrier.SetLayout(VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, curBackBuffer);
@@ -258,12 +291,207 @@ bool RayTracer::BuildCommandBuffers()
 	return true;
 }
 
+void RayTracer::WriteTraceRaysCommand(VkCommandBuffer vkCmdBuf, uint32_t commandBufferIndex)
+{
+	if (m_traceTimeQueryPool != VK_NULL_HANDLE)
+	{
+		vkCmdResetQueryPool(vkCmdBuf, m_traceTimeQueryPool, commandBufferIndex * 2, 2);
+		vkCmdWriteTimestamp(vkCmdBuf, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, m_traceTimeQueryPool, commandBufferIndex * 2);
+	}
+
+	vkCmdBindPipeline(vkCmdBuf, VK_PIPELINE_BIND_POINT_RAY_TRACING_KHR, m_pipeline.GetPipeline());
+
+	vkCmdBindDescriptorSets
+	(
+		vkCmdBuf,
+		VK_PIPELINE_BIND_POINT_RAY_TRACING_KHR,
+		m_pipelineResources.GetPipelineLayout(),
+		0,
+		1,
+		&m_pipelineResources.GetDescriptorSet()[commandBufferIndex],
+		0,
+		nullptr
+	);
+
+	vkCmdTraceRaysKHR
+	(
+		vkCmdBuf,
+		m_shaderBindingTable.GetStridedBufferRegion(SHADER_GROUP_TYPE_RAY_GEN),
+		m_shaderBindingTable.GetStridedBufferRegion(SHADER_GROUP_TYPE_MISS),
+		m_shaderBindingTable.GetStridedBufferRegion(SHADER_GROUP_TYPE_HIT),
+		m_shaderBindingTable.GetStridedBufferRegion(SHADER_GROUP_TYPE_CALLABLE),
+		m_width,
+		m_height,
+		1
+	);
+
+	if (m_traceTimeQueryPool != VK_NULL_HANDLE)
+	{
+		vkCmdWriteTimestamp(vkCmdBuf, VK_PIPELINE_STAGE_RAY_TRACING_SHADER_BIT_KHR, m_traceTimeQueryPool, commandBufferIndex * 2 + 1);
+	}
+}
+
+bool RayTracer::CreateTraceTimeQueryPool()
+{
+	if (!gVkDeviceRes.GetPhysicalDeviceProperty().limits.timestampComputeAndGraphics)
+	{
+		return false;
+	}
+
+	uint32_t commandBufferCount = m_commandBufferContainer.GetCommandBufferCount();
+
+	VkQueryPoolCreateInfo queryPoolCreateInfo = {};
+	queryPoolCreateInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+	queryPoolCreateInfo.queryType = VK_QUERY_TYPE_TIMESTAMP;
+	queryPoolCreateInfo.queryCount = commandBufferCount * 2;
+	if (vkCreateQueryPool(gLogicalDevice, &queryPoolCreateInfo, nullptr, &m_traceTimeQueryPool) != VkResult::VK_SUCCESS)
+	{
+		m_traceTimeQueryPool = VK_NULL_HANDLE;
+		return false;
+	}
+	m_traceTimeQuerySubmitted.assign(commandBufferCount, false);
+
+	return true;
+}
+
+void RayTracer::ReadTraceTime(uint32_t commandBufferIndex)
+{
+	if (m_traceTimeQueryPool == VK_NULL_HANDLE || commandBufferIndex >= m_traceTimeQuerySubmitted.size())
+	{
+		return;
+	}
+
+	//results of the previous submission of this command buffer, skipped when not ready yet
+	if (m_traceTimeQuerySubmitted[commandBufferIndex])
+	{
+		uint64_t timestamps[2] = {};
+		VkResult res = vkGetQueryPoolResults
+		(
+			gLogicalDevice,
+			m_traceTimeQueryPool,
+			commandBufferIndex * 2,
+			2,
+			sizeof(timestamps),
+			timestamps,
+			sizeof(uint64_t),
+			VK_QUERY_RESULT_64_BIT
+		);
+		if (res == VkResult::VK_SUCCESS && timestamps[1] >= timestamps[0])
+		{
+			float timestampPeriod = gVkDeviceRes.GetPhysicalDeviceProperty().limits.timestampPeriod;
+			float traceTimeMs = static_cast<float>(timestamps[1] - timestamps[0]) * timestampPeriod / 1000000.0f;
+			m_accelerationStructure.GetRebuildPolicy().AddTraceTime(commandBufferIndex, traceTimeMs);
+		}
+	}
+	m_traceTimeQuerySubmitted[commandBufferIndex] = true;
+}
+
+void RayTracer::WriteReadbackCommand(VkCommandBuffer vkCmdBuf, VkImageSubresourceRange& subResourceRange)
+{
+	PipelineBarrier pipeLineBarrier(vkCmdBuf);
+	pipeLineBarrier.SetAccessMask(VK_ACCESS_SHADER_WRITE_BIT, VK_ACCESS_TRANSFER_READ_BIT, m_rtTargetImage.GetImage());
+	pipeLineBarrier.SetLayout(VK_IMAGE_LAYOUT_GENERAL, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, m_rtTargetImage.GetImage());
+	pipeLineBarrier.SetImageSubresouceRange(subResourceRange, m_rtTargetImage.GetImage());
+	pipeLineBarrier.Write();
+
+	VkBufferImageCopy copyRegion = {};
+	copyRegion.bufferOffset = 0;
+	copyRegion.bufferRowLength = 0;
+	copyRegion.bufferImageHeight = 0;
+	copyRegion.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+	copyRegion.imageSubresource.mipLevel = 0;
+	copyRegion.imageSubresource.baseArrayLayer = 0;
+	copyRegion.imageSubresource.layerCount = 1;
+	copyRegion.imageOffset = { 0, 0, 0 };
+	copyRegion.imageExtent = { m_width, m_height, 1 };
+	vkCmdCopyImageToBuffer
+	(
+		vkCmdBuf,
+		m_rtTargetImage.GetImage(),
+		VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+		m_readbackBuffer.GetBuffer(),
+		1,
+		&copyRegion
+	);
+
+	pipeLineBarrier.SetAccessMask(VK_ACCESS_TRANSFER_READ_BIT, VK_ACCESS_SHADER_WRITE_BIT, m_rtTargetImage.GetImage());
+	pipeLineBarrier.SetLayout(VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, VK_IMAGE_LAYOUT_GENERAL, m_rtTargetImage.GetImage());
+	pipeLineBarrier.SetImageSubresouceRange(subResourceRange, m_rtTargetImage.GetImage());
+
+	BufferResouceRange readbackRange = {};
+	readbackRange.Offset = 0;
+	readbackRange.Size = VK_WHOLE_SIZE;
+	pipeLineBarrier.SetAccessMask(VK_ACCESS_TRANSFER_WRITE_BIT, VK_ACCESS_HOST_READ_BIT, m_readbackBuffer.GetBuffer());
+	pipeLineBarrier.SetBufferResourceRange(readbackRange, m_readbackBuffer.GetBuffer());
+	pipeLineBarrier.Write();
+}
+
+bool RayTracer::EnableReadback()
+{
+	if (m_readbackBuffer.IsAllocated())
+	{
+		m_readbackBuffer.Destroy();
+	}
+
+	//target format is 4 bytes per pixel (R8G8B8A8)
+	if (!m_readbackBuffer.Initialize(m_width * m_height * 4,
+									 VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+									 VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT))
+	{
+		REPORT(EReportType::REPORT_TYPE_ERROR, "Readback buffer create failed.");
+		return false;
+	}
+	return true;
+}
+
+bool RayTracer::ReadTargetImage(std::vector<uint8_t>& outPixels)
+{
+	if (!m_readbackBuffer.IsAllocated())
+	{
+		REPORT(EReportType::REPORT_TYPE_WARN, "Readback is not enabled.");
+		return false;
+	}
+
+	uint8_t* data = nullptr;
+	if (vkMapMemory(gLogicalDevice, m_readbackBuffer.GetMemory(), 0, m_readbackBuffer.GetBufferSize(), 0, (void**)&data) != VkResult::VK_SUCCESS)
+	{
+		REPORT(EReportType::REPORT_TYPE_WARN, "Memory map failed.");
+		return false;
+	}
+	outPixels.resize(m_readbackBuffer.GetBufferSize());
+	memcpy(outPixels.data(), data, m_readbackBuffer.GetBufferSize());
+	vkUnmapMemory(gLogicalDevice, m_readbackBuffer.GetMemory());
+
+	return true;
+}
+
+bool RayTracer::RenderCpuReference(std::vector<uint8_t>& outPixels)
+{
+	WorkerThreadPool workerPool;
+	workerPool.Initialize();
+
+	CpuReferenceRenderer renderer;
+	bool res = renderer.Initialize(&m_pipelineResources, m_envCubmapTexture, &workerPool);
+	if (res)
+	{
+		res = renderer.Render(m_width, m_height, outPixels, &workerPool);
+	}
+
+	renderer.Destroy();
+	workerPool.Destroy();
+	return res;
+}
+
 void RayTracer::OnScreenSizeChanged(uint32_t width, uint32_t height)
 {
 	m_width		= width;
 	m_height	= height;
 
 	m_rtTargetImage.Resize(m_width, m_height);
+	if (m_readbackBuffer.IsAllocated())
+	{
+		EnableReadback();
+	}
 
 	m_pipelineResources.RefreshWriteDescriptorSet();
 	RebuildCommandBuffer();
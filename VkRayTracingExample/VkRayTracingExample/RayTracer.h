@@ -22,12 +22,37 @@ public:
 
 	bool Build();
 
+	//copies the target image to a host visible buffer after each trace, call before Build
+	bool EnableReadback();
+	bool ReadTargetImage(std::vector<uint8_t>& outPixels);
+	bool IsReadbackEnabled() { return m_readbackBuffer.IsAllocated(); }
+
+	//renders the current scene and camera on cpu with the shading of the hit shaders, rgba8 pixels of the target size
+	bool RenderCpuReference(std::vector<uint8_t>& outPixels);
+
+	//thresholds of refit versus rebuild decision can be tuned here
+	AsRebuildPolicy& GetAsRebuildPolicy() { return m_accelerationStructure.GetRebuildPolicy(); }
+	void RunAsBuildBenchmark(uint32_t iterationCount) { m_accelerationStructure.RunBuildBenchmark(iterationCount); }
+	//skinning and morph target deformations, dispatched before the blas refits of each frame
+	RTMeshDeformer& GetMeshDeformer() { return m_accelerationStructure.GetMeshDeformer(); }
+	//fences of the frame submits, waited instead of the graphics queue when shared resources are rewritten
+	void SetFrameFences(std::vector<Fence>* frameFences) { m_accelerationStructure.SetFrameFences(frameFences); }
+
 public:
 	std::vector<CommandBuffer*>& GetWaitCommandBuffer() { return m_currentCommandBuffers; }
+	//acceleration structure builds submitted to the compute queue, the frame submit must wait them
+	std::vector<VkSemaphore>& GetWaitSemaphores() { return m_waitSemaphores; }
+	std::vector<VkPipelineStageFlags>& GetWaitStageMasks() { return m_waitStageMasks; }
+	RtTargetImageBuffer& GetTargetImage() { return m_rtTargetImage; }
 
 protected:
 	void RebuildCommandBuffer();
 	bool BuildCommandBuffers();
+	void WriteTraceRaysCommand(VkCommandBuffer vkCmdBuf, uint32_t commandBufferIndex);
+	bool CreateTraceTimeQueryPool();
+	void ReadTraceTime(uint32_t commandBufferIndex);
+	void GetTopLevelAsHandles(std::vector<VkAccelerationStructureKHR>& outTlasHandles);
+	void WriteReadbackCommand(VkCommandBuffer vkCmdBuf, VkImageSubresourceRange& subResourceRange);
 	
 
 public:
@@ -45,8 +70,15 @@ private:
 	RTShaderBindingTable m_shaderBindingTable = {};
 	RTAccelerationStructure m_accelerationStructure = {};
 	StaticCommandBufferContainer m_commandBufferContainer = {};
+	BufferData m_readbackBuffer = {};
+
+	//two timestamps per command buffer around trace rays
+	VkQueryPool m_traceTimeQueryPool = VK_NULL_HANDLE;
+	std::vector<bool> m_traceTimeQuerySubmitted = {};
 
 	std::vector<CommandBuffer*> m_currentCommandBuffers = {};
+	std::vector<VkSemaphore> m_waitSemaphores = {};
+	std::vector<VkPipelineStageFlags> m_waitStageMasks = {};
 	
 	std::vector<SimpleShader*> m_rayGenShaders;
 	std::vector<SimpleShader*> m_missShaders;
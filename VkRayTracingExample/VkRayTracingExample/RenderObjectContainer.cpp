@@ -2,121 +2,159 @@
 
 SimpleRenderObject* RenderObjectContainer::CreateRenderObject(std::string fbxFilePath, ExampleMaterialType exampleMaterialType)
 {
-	SimpleRenderObject* obj = Create<SimpleRenderObject, std::unordered_map<UID, SimpleRenderObject*> >(&m_renderObjList);
+	SimpleRenderObject* obj = Create(&m_renderObjList);
 	obj->Initialize(fbxFilePath, exampleMaterialType);
 	return obj;
 }
 
+SimpleRenderObject* RenderObjectContainer::CreateRenderObject(std::string fbxFilePath, SimpleMaterial* material)
+{
+	SimpleRenderObject* obj = Create(&m_renderObjList);
+	obj->Initialize(fbxFilePath, material);
+	return obj;
+}
+
 void RenderObjectContainer::RemoveRenderObject(SimpleRenderObject* obj)
 {
 	Remove(obj, &m_renderObjList);
 }
 
-SampleRenderObjectInstance* RenderObjectContainer::CreateRenderObjectInstance(glm::mat4& matWorld)
+SampleRenderObjectInstance* RenderObjectContainer::CreateRenderObjectInstance(const glm::mat4& matWorld)
 {
-	SampleRenderObjectInstance* inst = Create<SampleRenderObjectInstance, std::unordered_map<UID, SampleRenderObjectInstance*> >(&m_instList);
+	SampleRenderObjectInstance* inst = Create(&m_instList);
 	inst->Initialzie(matWorld);
 
-	OnInstPerMeshAdded.Exec(static_cast<uint32_t>(m_instPerMeshList.size() - 1));
-
 	return inst;
 }
 
 void RenderObjectContainer::RemoveRenderObjectInstance(SampleRenderObjectInstance* instance)
 {
-	Remove(instance, &m_instList);
+	//instances per mesh of the instance are notified together
+	BeginBatch();
+	Remove(instance, &m_instList, true);
+	EndBatch();
+}
+
+void RenderObjectContainer::ReserveRenderObjectInstances(uint32_t instanceCount, uint32_t instancePerMeshCount)
+{
+	m_instList.Reserve(m_instList.GetCount() + instanceCount);
+	m_instPerMeshList.Reserve(m_instPerMeshList.GetCount() + instancePerMeshCount);
+	m_transformStore.Reserve(m_transformStore.GetCapacity() + instanceCount);
 }
 
 SampleRenderObjectInstancePerMesh* RenderObjectContainer::CreateRenderObjectInstancePerMesh(SampleRenderObjectInstance* parentInst, SimpleMeshData* meshData, SimpleMaterial* material)
 {
-	SampleRenderObjectInstancePerMesh* instPerMesh = Create<SampleRenderObjectInstancePerMesh, std::unordered_map<UID, SampleRenderObjectInstancePerMesh*> >(&m_instPerMeshList);
+	SampleRenderObjectInstancePerMesh* instPerMesh = Create(&m_instPerMeshList);
 	instPerMesh->Initialize(parentInst, meshData, material);
 
-	OnInstPerMeshAdded.Exec();
+	//appended, bind indices of the existing instances per mesh are unchanged
+	BeginBatch();
+	AddPendingRange(m_pendingAddedRange, m_instPerMeshList.GetCount() - 1);
+	EndBatch();
 
 	return instPerMesh;
 }
 
 void RenderObjectContainer::RemoveRenderObjectInstancePerMesh(SampleRenderObjectInstancePerMesh* instancePreMesh)
 {
-	int removeIndex = GetRenderObjectInstancePerMeshBindIndex(instancePreMesh);
-	if (removeIndex != -1)
+	BeginBatch();
+	int removeIndex = Remove(instancePreMesh, &m_instPerMeshList, true);
+	if (removeIndex != INVALID_INDEX_INT)
 	{
-		Remove(instancePreMesh, &m_instPerMeshList);
+		AddPendingRange(m_pendingRemovedRange, static_cast<uint32_t>(removeIndex));
+	}
+	EndBatch();
+}
 
-		OnInstPerMeshRemoved.Exec(static_cast<uint32_t>(removeIndex));
+void RenderObjectContainer::BeginBatch()
+{
+	m_batchDepth++;
+}
+
+void RenderObjectContainer::EndBatch()
+{
+	if (m_batchDepth == 0 || --m_batchDepth > 0)
+	{
+		return;
+	}
+
+	//ranges are reset before the listeners run, they may create or remove again
+	RenderObjectIndexRange removedRange = m_pendingRemovedRange;
+	RenderObjectIndexRange addedRange = m_pendingAddedRange;
+	m_pendingRemovedRange = RenderObjectIndexRange();
+	m_pendingAddedRange = RenderObjectIndexRange();
+	if (removedRange.Count > 0)
+	{
+		OnInstPerMeshRemoved.Exec(removedRange);
+	}
+	if (addedRange.Count > 0)
+	{
+		OnInstPerMeshAdded.Exec(addedRange);
 	}
 }
 
+void RenderObjectContainer::AddPendingRange(RenderObjectIndexRange& pendingRange, uint32_t index)
+{
+	if (pendingRange.Count == 0 || index < pendingRange.Begin)
+	{
+		pendingRange.Begin = index;
+	}
+	pendingRange.Count++;
+}
+
 void RenderObjectContainer::Clear()
 {
-	for (auto& cur : m_renderObjList)
+	BeginBatch();
+	for (SimpleRenderObject* cur : m_renderObjList)
 	{
-		if (cur.second != nullptr)
+		if (cur != nullptr)
 		{
-			cur.second->Destroy();
-			delete cur.second;
+			cur->Destroy();
+			delete cur;
 		}
 	}
-	m_renderObjList.clear();
-	m_instList.clear();
-	m_instPerMeshList.clear();
+	m_renderObjList.Clear();
+	m_instList.Clear();
+	m_instPerMeshList.Clear();
+	m_sceneGraph.Clear();
+	m_transformStore.Clear();
+	EndBatch();
 }
 
 uint32_t RenderObjectContainer::GetRenderObjectCount()
 {
-	return static_cast<uint32_t>(m_renderObjList.size());
+	return m_renderObjList.GetCount();
 }
 
 SimpleRenderObject* RenderObjectContainer::GetRenderObject(uint32_t index)
 {
-	if (index < m_renderObjList.size())
-	{
-		auto pos = m_renderObjList.begin();
-		std::advance(pos, index);
-		return pos->second;
-	}
-	return nullptr;
+	return m_renderObjList.GetAt(index);
 }
 
 int RenderObjectContainer::GetRenderObjectBindIndex(SimpleRenderObject* renderObj)
 {
 	if (renderObj != nullptr)
 	{
-		auto iterFind = m_instList.find(renderObj->GetUID());
-		if (iterFind != m_instList.end())
-		{
-			return static_cast<int>(std::distance(m_instList.begin(), iterFind));
-		}
+		return m_renderObjList.GetIndex(renderObj->GetUID());
 	}
 	return INVALID_INDEX_INT;
 }
 
 uint32_t RenderObjectContainer::GetRenderObjectInstanceCount()
 {
-	return static_cast<uint32_t>(m_instList.size());
+	return m_instList.GetCount();
 }
 
 SampleRenderObjectInstance* RenderObjectContainer::GetRenderObjectInstance(uint32_t index)
 {
-	if (index < m_instList.size())
-	{
-		auto pos = m_instList.begin();
-		std::advance(pos, index);
-		return pos->second;
-	}
-	return nullptr;
+	return m_instList.GetAt(index);
 }
 
 int RenderObjectContainer::GetRenderObjectInstanceBindIndex(SampleRenderObjectInstance* inst)
 {
 	if (inst != nullptr)
 	{
-		auto iterFind = m_instList.find(inst->GetUID());
-		if (iterFind != m_instList.end())
-		{
-			return static_cast<int>(std::distance(m_instList.begin(), iterFind));
-		}
+		return m_instList.GetIndex(inst->GetUID());
 	}
 	return INVALID_INDEX_INT;
 }
@@ -125,27 +163,17 @@ int RenderObjectContainer::GetRenderObjectInstancePerMeshBindIndex(SampleRenderO
 {
 	if (instPerMesh != nullptr)
 	{
-		auto iterFind = m_instPerMeshList.find(instPerMesh->GetUID());
-		if (iterFind != m_instPerMeshList.end())
-		{
-			return static_cast<int>(std::distance(m_instPerMeshList.begin(), iterFind));
-		}
+		return m_instPerMeshList.GetIndex(instPerMesh->GetUID());
 	}
 	return INVALID_INDEX_INT;
 }
 
 uint32_t RenderObjectContainer::GetRenderObjectInstancePerMeshCount()
 {
-	return static_cast<uint32_t>(m_instPerMeshList.size());
+	return m_instPerMeshList.GetCount();
 }
 
 SampleRenderObjectInstancePerMesh* RenderObjectContainer::GetRenderObjectInstancePerMesh(uint32_t index)
 {
-	if (index < m_instPerMeshList.size())
-	{
-		auto pos = m_instPerMeshList.begin();
-		std::advance(pos, index);
-		return pos->second;
-	}
-	return nullptr;
+	return m_instPerMeshList.GetAt(index);
 }
\ No newline at end of file
@@ -2,6 +2,16 @@
 
 #include "SimpleRenderObject.h"
 #include "Singleton.h"
+#include "SlotMap.h"
+#include "InstanceTransformStore.h"
+#include "SceneGraph.h"
+
+//instances per mesh added or removed by one operation, bind indices from Begin may have changed
+struct RenderObjectIndexRange
+{
+	uint32_t Begin = 0;
+	uint32_t Count = 0;
+};
 
 class RenderObjectContainer : public TSingleton<RenderObjectContainer>
 {
@@ -12,16 +22,22 @@ public:
 
 public:
 	SimpleRenderObject* CreateRenderObject(std::string fbxFilePath, ExampleMaterialType exampleMaterialType);
+	SimpleRenderObject* CreateRenderObject(std::string fbxFilePath, SimpleMaterial* material);
 	void RemoveRenderObject(SimpleRenderObject* obj);
 
-	SampleRenderObjectInstance* CreateRenderObjectInstance(glm::mat4& matWorld);
+	SampleRenderObjectInstance* CreateRenderObjectInstance(const glm::mat4& matWorld);
 	void RemoveRenderObjectInstance(SampleRenderObjectInstance* instance);
+	void ReserveRenderObjectInstances(uint32_t instanceCount, uint32_t instancePerMeshCount);
 
 	SampleRenderObjectInstancePerMesh* CreateRenderObjectInstancePerMesh(SampleRenderObjectInstance* parentInst, SimpleMeshData* meshData, SimpleMaterial* material);
 	void RemoveRenderObjectInstancePerMesh(SampleRenderObjectInstancePerMesh* instancePreMesh);
 
 	void Clear();
 
+	//instances per mesh created or removed until the outermost end are notified with one range of each kind
+	void BeginBatch();
+	void EndBatch();
+
 public:
 
 	uint32_t GetRenderObjectCount();
@@ -36,52 +52,70 @@ public:
 	SampleRenderObjectInstancePerMesh* GetRenderObjectInstancePerMesh(uint32_t index);
 	int GetRenderObjectInstancePerMeshBindIndex(SampleRenderObjectInstancePerMesh* instPerMesh);
 
+	//world transforms of the instances, referenced by the transform slot of each instance
+	InstanceTransformStore& GetTransformStore() { return m_transformStore; }
+	//parent child transforms of the instances, propagated into the transform store before the transform pass
+	SceneGraph& GetSceneGraph() { return m_sceneGraph; }
+
 	bool IsDirty() { return m_isDirty; }
 	void SetDirty(bool isDirty) { m_isDirty = true; }
 
-	LambdaCommandListWithOneParam<std::function<void(uint32_t)>, uint32_t> OnInstPerMeshAdded;
-	LambdaCommandListWithOneParam<std::function<void(uint32_t)>, uint32_t> OnInstPerMeshRemoved;
+	TDelegateList<void(RenderObjectIndexRange)> OnInstPerMeshAdded;
+	TDelegateList<void(RenderObjectIndexRange)> OnInstPerMeshRemoved;
 
 protected:
 
-	template <typename CreateItemType, typename ListType>
-	CreateItemType* Create(ListType* itemList);
+	template <typename CreateItemType>
+	CreateItemType* Create(TUidSlotMap<CreateItemType>* itemList);
+
+	//returns the bind index the item had
+	template <typename RemoveItemType>
+	int Remove(RemoveItemType* item, TUidSlotMap<RemoveItemType>* itemList, bool swapRemove = false);
 
-	template <typename RemoveItemType, typename ListType>
-	void Remove(RemoveItemType* item, ListType* itemList);
+	void AddPendingRange(RenderObjectIndexRange& pendingRange, uint32_t index);
 
 private:
 
-	std::unordered_map<UID, SimpleRenderObject*> m_renderObjList;
-	std::unordered_map<UID, SampleRenderObjectInstance*> m_instList;
-	std::unordered_map<UID, SampleRenderObjectInstancePerMesh*> m_instPerMeshList;
+	//dense, the position of an item is its bind index
+	//instances and instances per mesh are swap removed, their listeners remap every index on change
+	TUidSlotMap<SimpleRenderObject> m_renderObjList;
+	TUidSlotMap<SampleRenderObjectInstance> m_instList;
+	TUidSlotMap<SampleRenderObjectInstancePerMesh> m_instPerMeshList;
+
+	InstanceTransformStore m_transformStore;
+	SceneGraph m_sceneGraph;
+
+	uint32_t m_batchDepth = 0;
+	RenderObjectIndexRange m_pendingAddedRange;
+	RenderObjectIndexRange m_pendingRemovedRange;
 
 	bool m_isDirty = false;
 };
 
-template <typename CreateItemType, typename ListType>
-CreateItemType* RenderObjectContainer::Create(ListType* itemList)
+template <typename CreateItemType>
+CreateItemType* RenderObjectContainer::Create(TUidSlotMap<CreateItemType>* itemList)
 {
 	CreateItemType* item = new CreateItemType();
-	itemList->insert(std::make_pair(item->GetUID(), item));
+	itemList->Insert(item);
 	m_isDirty = true;
 	return item;
 }
 
-template <typename RemoveItemType, typename ListType>
-void RenderObjectContainer::Remove(RemoveItemType* item, ListType* itemList)
+template <typename RemoveItemType>
+int RenderObjectContainer::Remove(RemoveItemType* item, TUidSlotMap<RemoveItemType>* itemList, bool swapRemove)
 {
-	auto iterIdxFind = itemList->find(item->GetUID());
-	if (iterIdxFind != itemList->end())
+	int removeIndex = INVALID_INDEX_INT;
+	if (item != nullptr)
 	{
-		if (iterIdxFind->second != nullptr)
+		removeIndex = swapRemove ? itemList->SwapRemove(item->GetUID()) : itemList->Remove(item->GetUID());
+		if (removeIndex != INVALID_INDEX_INT)
 		{
-			iterIdxFind->second->Destroy();
-			delete iterIdxFind->second;
-			itemList->erase(iterIdxFind);
+			item->Destroy();
+			delete item;
 			m_isDirty = true;
 		}
 	}
+	return removeIndex;
 }
 
 #define gRenderObjContainer RenderObjectContainer::Instance()
\ No newline at end of file
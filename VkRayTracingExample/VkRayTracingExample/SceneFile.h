@@ -0,0 +1,93 @@
+#pragma once
+
+#include <stdint.h>
+
+//binary scene layout, written by SceneJsonCooker and read in place by SceneLoader
+//the header is followed by sections, each starts at a SCENE_FILE_SECTION_ALIGNMENT boundary
+//strings are stored once in the string section and referenced by their byte offset
+#define SCENE_FILE_MAGIC 0x4E435352
+#define SCENE_FILE_VERSION 1
+#define SCENE_FILE_SECTION_ALIGNMENT 16
+#define SCENE_FILE_INVALID_INDEX UINT32_MAX
+
+enum class ESceneFileSection : uint32_t
+{
+	STRINGS = 0,
+	//uint32_t path string offset of each texture
+	TEXTURES,
+	MATERIALS,
+	RENDER_OBJECTS,
+	//3x4 row major world transform of each instance, same layout as InstanceTransformRows
+	INSTANCE_TRANSFORMS,
+	//uint32_t material index of each instance, SCENE_FILE_INVALID_INDEX uses the material of its render object
+	INSTANCE_MATERIALS,
+	END
+};
+
+enum class ESceneTextureSlot : uint32_t
+{
+	DIFFUSE = 0,
+	NORMAL,
+	ROUGHNESS,
+	METALLIC,
+	AMBIENT_OCCLUSION,
+	END
+};
+
+enum class ESceneHitShader : uint32_t
+{
+	CLOSEST_HIT = 0,
+	ANY_HIT,
+	INTERSECTION,
+	END
+};
+
+#define SCENE_RENDER_OBJECT_FLAG_MERGE_MESHES 0x1
+
+struct SceneFileSectionDesc
+{
+	uint64_t Offset = 0;
+	uint64_t Size = 0;
+};
+
+struct SceneFileHeader
+{
+	uint32_t Magic = SCENE_FILE_MAGIC;
+	uint32_t Version = SCENE_FILE_VERSION;
+	uint32_t SectionCount = static_cast<uint32_t>(ESceneFileSection::END);
+	uint32_t InstanceCount = 0;
+	SceneFileSectionDesc Sections[static_cast<uint32_t>(ESceneFileSection::END)];
+};
+
+struct SceneFileMaterial
+{
+	float Color[4] = { 1.0f, 1.0f, 1.0f, 1.0f };
+	uint32_t NameOffset = SCENE_FILE_INVALID_INDEX;
+	//EMaterialType
+	uint32_t SurfaceType = 0;
+	float IndexOfRefraction = 1.0f;
+	float Metallic = 0.0f;
+	float Roughness = 1.0f;
+	float UvScale = 1.0f;
+	uint32_t TextureIndices[static_cast<uint32_t>(ESceneTextureSlot::END)] = { SCENE_FILE_INVALID_INDEX, SCENE_FILE_INVALID_INDEX, SCENE_FILE_INVALID_INDEX, SCENE_FILE_INVALID_INDEX, SCENE_FILE_INVALID_INDEX };
+	uint32_t HitShaderPathOffsets[static_cast<uint32_t>(ESceneHitShader::END)] = { SCENE_FILE_INVALID_INDEX, SCENE_FILE_INVALID_INDEX, SCENE_FILE_INVALID_INDEX };
+};
+
+//instances of a render object are contiguous in the instance sections
+struct SceneFileRenderObject
+{
+	uint32_t NameOffset = SCENE_FILE_INVALID_INDEX;
+	uint32_t MeshPathOffset = SCENE_FILE_INVALID_INDEX;
+	uint32_t MaterialIndex = SCENE_FILE_INVALID_INDEX;
+	uint32_t Flags = 0;
+	//EAsBuildProfile, SCENE_FILE_INVALID_INDEX keeps the profile of the mesh
+	uint32_t BuildProfile = SCENE_FILE_INVALID_INDEX;
+	uint32_t InstanceBegin = 0;
+	uint32_t InstanceCount = 0;
+	uint32_t Reserved = 0;
+};
+
+struct SceneFileInstanceTransform
+{
+	float Rows[3][4];
+};
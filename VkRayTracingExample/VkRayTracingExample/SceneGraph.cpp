@@ -0,0 +1,430 @@
+#include <algorithm>
+
+#include "SceneGraph.h"
+#include "InstanceTransformStore.h"
+#include "SimpleRenderObject.h"
+
+uint32_t SceneGraph::CreateNode(const glm::mat4& localMat, uint32_t parentNode)
+{
+	if (parentNode != INVALID_SCENE_NODE && !IsValid(parentNode))
+	{
+		REPORT(EReportType::REPORT_TYPE_WARN, "Invalid parent node.");
+		return INVALID_SCENE_NODE;
+	}
+
+	uint32_t node = 0;
+	if (!m_freeNodes.empty())
+	{
+		node = m_freeNodes.back();
+		m_freeNodes.pop_back();
+	}
+	else
+	{
+		node = static_cast<uint32_t>(m_nodeParents.size());
+		m_nodeParents.push_back(INVALID_SCENE_NODE);
+		m_nodeOrderIndices.push_back(INVALID_SCENE_NODE);
+		m_nodeLevels.push_back(0);
+		m_nodeInstances.push_back(nullptr);
+		m_nodeAlive.push_back(0);
+	}
+
+	//appended out of order, placed at its level by the next layout refresh
+	uint32_t orderIndex = static_cast<uint32_t>(m_orderNodes.size());
+	m_nodeParents[node] = parentNode;
+	m_nodeOrderIndices[node] = orderIndex;
+	m_nodeInstances[node] = nullptr;
+	m_nodeAlive[node] = 1;
+
+	m_orderNodes.push_back(node);
+	m_orderParents.push_back(INVALID_SCENE_NODE);
+	m_localMats.push_back(localMat);
+	m_worldMats.push_back(localMat);
+	m_transformSlots.push_back(INVALID_SLOT_INDEX);
+	m_dirtyFlags.push_back(1);
+
+	m_isLayoutDirty = true;
+	return node;
+}
+
+void SceneGraph::RemoveNode(uint32_t node)
+{
+	if (!IsValid(node))
+	{
+		return;
+	}
+
+	//parents precede their children in the refreshed order, one pass finds every descendant
+	RefreshLayout();
+	m_nodeAlive[node] = 0;
+	uint32_t nodeCount = static_cast<uint32_t>(m_orderNodes.size());
+	for (uint32_t i = m_nodeOrderIndices[node] + 1; i < nodeCount; i++)
+	{
+		uint32_t cur = m_orderNodes[i];
+		uint32_t parent = m_nodeParents[cur];
+		if (parent != INVALID_SCENE_NODE && m_nodeAlive[parent] == 0)
+		{
+			m_nodeAlive[cur] = 0;
+		}
+	}
+
+	for (uint32_t i = m_nodeOrderIndices[node]; i < nodeCount; i++)
+	{
+		uint32_t cur = m_orderNodes[i];
+		if (m_nodeAlive[cur] == 0 && m_nodeOrderIndices[cur] != INVALID_SCENE_NODE)
+		{
+			DetachInstance(cur);
+			m_nodeOrderIndices[cur] = INVALID_SCENE_NODE;
+			m_freeNodes.push_back(cur);
+		}
+	}
+
+	m_isLayoutDirty = true;
+}
+
+bool SceneGraph::SetParent(uint32_t node, uint32_t parentNode)
+{
+	if (!IsValid(node) || (parentNode != INVALID_SCENE_NODE && !IsValid(parentNode)))
+	{
+		return false;
+	}
+
+	for (uint32_t cur = parentNode; cur != INVALID_SCENE_NODE; cur = m_nodeParents[cur])
+	{
+		if (cur == node)
+		{
+			REPORT(EReportType::REPORT_TYPE_WARN, "A node can not be parented to its descendant.");
+			return false;
+		}
+	}
+
+	m_nodeParents[node] = parentNode;
+	MarkDirty(m_nodeOrderIndices[node]);
+	m_isLayoutDirty = true;
+	return true;
+}
+
+void SceneGraph::Clear()
+{
+	for (uint32_t i = 0; i < m_nodeInstances.size(); i++)
+	{
+		if (m_nodeAlive[i] != 0)
+		{
+			DetachInstance(i);
+		}
+	}
+
+	m_nodeParents.clear();
+	m_nodeOrderIndices.clear();
+	m_nodeLevels.clear();
+	m_nodeInstances.clear();
+	m_nodeAlive.clear();
+	m_freeNodes.clear();
+
+	m_orderNodes.clear();
+	m_orderParents.clear();
+	m_localMats.clear();
+	m_worldMats.clear();
+	m_transformSlots.clear();
+	m_dirtyFlags.clear();
+
+	m_levelOffsets.clear();
+	m_levelDirtyCounts.clear();
+	m_isLayoutDirty = false;
+}
+
+void SceneGraph::SetLocalTransform(uint32_t node, const glm::mat4& localMat)
+{
+	if (!IsValid(node))
+	{
+		return;
+	}
+	uint32_t orderIndex = m_nodeOrderIndices[node];
+	m_localMats[orderIndex] = localMat;
+	MarkDirty(orderIndex);
+}
+
+glm::mat4 SceneGraph::GetLocalTransform(uint32_t node)
+{
+	if (!IsValid(node))
+	{
+		return glm::mat4(1.0f);
+	}
+	return m_localMats[m_nodeOrderIndices[node]];
+}
+
+glm::mat4 SceneGraph::GetWorldTransform(uint32_t node)
+{
+	if (!IsValid(node))
+	{
+		return glm::mat4(1.0f);
+	}
+	return m_worldMats[m_nodeOrderIndices[node]];
+}
+
+uint32_t SceneGraph::GetParent(uint32_t node)
+{
+	if (!IsValid(node))
+	{
+		return INVALID_SCENE_NODE;
+	}
+	return m_nodeParents[node];
+}
+
+void SceneGraph::AttachInstance(uint32_t node, SampleRenderObjectInstance* instance)
+{
+	if (!IsValid(node) || instance == nullptr)
+	{
+		return;
+	}
+
+	//an instance follows one node only
+	if (instance->m_sceneNode != INVALID_SCENE_NODE)
+	{
+		DetachInstance(instance->m_sceneNode);
+	}
+	DetachInstance(node);
+
+	uint32_t orderIndex = m_nodeOrderIndices[node];
+	m_nodeInstances[node] = instance;
+	m_transformSlots[orderIndex] = instance->GetTransformSlot();
+	instance->m_sceneNode = node;
+	MarkDirty(orderIndex);
+}
+
+void SceneGraph::DetachInstance(uint32_t node)
+{
+	if (node >= m_nodeInstances.size() || m_nodeInstances[node] == nullptr)
+	{
+		return;
+	}
+
+	m_nodeInstances[node]->m_sceneNode = INVALID_SCENE_NODE;
+	m_nodeInstances[node] = nullptr;
+	if (m_nodeOrderIndices[node] != INVALID_SCENE_NODE)
+	{
+		m_transformSlots[m_nodeOrderIndices[node]] = INVALID_SLOT_INDEX;
+	}
+}
+
+void SceneGraph::Update(InstanceTransformStore& transformStore, WorkerThreadPool* workerPool)
+{
+	if (m_isLayoutDirty)
+	{
+		RefreshLayout();
+	}
+
+	uint32_t levelCount = GetLevelCount();
+	bool parentLevelChanged = false;
+	uint32_t firstChangedLevel = levelCount;
+	uint32_t usedJobCount = 0;
+	for (uint32_t level = 0; level < levelCount; level++)
+	{
+		//a level is skipped when neither its nodes nor their parents are changed
+		if (m_levelDirtyCounts[level] == 0 && !parentLevelChanged)
+		{
+			continue;
+		}
+		if (firstChangedLevel == levelCount)
+		{
+			firstChangedLevel = level;
+		}
+
+		uint32_t begin = m_levelOffsets[level];
+		uint32_t end = m_levelOffsets[level + 1];
+		uint32_t nodeCount = end - begin;
+		bool useWorkers = workerPool != nullptr && workerPool->IsInitialized() && nodeCount >= SCENE_GRAPH_PARALLEL_NODE_COUNT;
+		uint32_t jobCount = useWorkers ? (nodeCount + SCENE_GRAPH_NODES_PER_JOB - 1) / SCENE_GRAPH_NODES_PER_JOB : 1;
+		if (m_jobInstanceNodes.size() < usedJobCount + jobCount)
+		{
+			m_jobInstanceNodes.resize(usedJobCount + jobCount);
+		}
+
+		//levels are processed in order, jobs of one level write disjoint ranges and read only the finished level above
+		std::vector<uint8_t> jobChanged(jobCount, 0);
+		if (useWorkers)
+		{
+			for (uint32_t i = 0; i < jobCount; i++)
+			{
+				uint32_t jobBegin = begin + i * SCENE_GRAPH_NODES_PER_JOB;
+				uint32_t jobEnd = jobBegin + SCENE_GRAPH_NODES_PER_JOB < end ? jobBegin + SCENE_GRAPH_NODES_PER_JOB : end;
+				std::vector<uint32_t>* instanceNodes = &m_jobInstanceNodes[usedJobCount + i];
+				uint8_t* changed = &jobChanged[i];
+				workerPool->Enqueue
+				(
+					[this, jobBegin, jobEnd, instanceNodes, changed]()
+					{
+						*changed = PropagateRange(jobBegin, jobEnd, *instanceNodes) ? 1 : 0;
+					}
+				);
+			}
+			workerPool->WaitIdle();
+		}
+		else
+		{
+			jobChanged[0] = PropagateRange(begin, end, m_jobInstanceNodes[usedJobCount]) ? 1 : 0;
+		}
+		usedJobCount += jobCount;
+
+		parentLevelChanged = false;
+		for (auto cur : jobChanged)
+		{
+			parentLevelChanged = parentLevelChanged || cur != 0;
+		}
+		m_levelDirtyCounts[level] = 0;
+	}
+
+	//store is not thread safe, changed instances are written after the propagation
+	for (uint32_t i = 0; i < usedJobCount; i++)
+	{
+		for (auto orderIndex : m_jobInstanceNodes[i])
+		{
+			transformStore.SetTransform(m_transformSlots[orderIndex], m_worldMats[orderIndex]);
+		}
+		m_jobInstanceNodes[i].clear();
+	}
+
+	//dirty flags are kept until here so the children of a changed node see it
+	if (firstChangedLevel < levelCount)
+	{
+		std::fill(m_dirtyFlags.begin() + m_levelOffsets[firstChangedLevel], m_dirtyFlags.end(), 0);
+	}
+}
+
+void SceneGraph::RefreshLayout()
+{
+	if (!m_isLayoutDirty)
+	{
+		return;
+	}
+
+	//depth of every alive node, parents are resolved before their children
+	uint32_t maxLevel = 0;
+	std::vector<uint8_t> levelResolved(m_nodeParents.size(), 0);
+	std::vector<uint32_t> pendingNodes;
+	for (uint32_t node = 0; node < m_nodeParents.size(); node++)
+	{
+		if (m_nodeAlive[node] == 0 || levelResolved[node] != 0)
+		{
+			continue;
+		}
+		uint32_t cur = node;
+		while (cur != INVALID_SCENE_NODE && levelResolved[cur] == 0)
+		{
+			pendingNodes.push_back(cur);
+			cur = m_nodeParents[cur];
+		}
+		uint32_t level = cur == INVALID_SCENE_NODE ? 0 : m_nodeLevels[cur] + 1;
+		while (!pendingNodes.empty())
+		{
+			uint32_t pendingNode = pendingNodes.back();
+			pendingNodes.pop_back();
+			m_nodeLevels[pendingNode] = level;
+			levelResolved[pendingNode] = 1;
+			maxLevel = level > maxLevel ? level : maxLevel;
+			level++;
+		}
+	}
+
+	//counting sort by level keeps the previous order inside each level
+	uint32_t aliveCount = 0;
+	m_levelOffsets.assign(maxLevel + 2, 0);
+	//entries of removed nodes stay in the order until here, a reused node is counted at its new entry only
+	for (uint32_t i = 0; i < m_orderNodes.size(); i++)
+	{
+		uint32_t node = m_orderNodes[i];
+		if (m_nodeAlive[node] != 0 && m_nodeOrderIndices[node] == i)
+		{
+			m_levelOffsets[m_nodeLevels[node] + 1]++;
+			aliveCount++;
+		}
+	}
+	if (aliveCount == 0)
+	{
+		m_levelOffsets.clear();
+	}
+	for (uint32_t i = 1; i < m_levelOffsets.size(); i++)
+	{
+		m_levelOffsets[i] += m_levelOffsets[i - 1];
+	}
+
+	std::vector<uint32_t> orderNodes(aliveCount);
+	std::vector<glm::mat4> localMats(aliveCount);
+	std::vector<glm::mat4> worldMats(aliveCount);
+	std::vector<uint32_t> transformSlots(aliveCount);
+	std::vector<uint8_t> dirtyFlags(aliveCount);
+	m_levelDirtyCounts.assign(GetLevelCount(), 0);
+	std::vector<uint32_t> levelCursors(m_levelOffsets.begin(), m_levelOffsets.empty() ? m_levelOffsets.end() : m_levelOffsets.end() - 1);
+	for (uint32_t i = 0; i < m_orderNodes.size(); i++)
+	{
+		uint32_t node = m_orderNodes[i];
+		if (m_nodeAlive[node] == 0 || m_nodeOrderIndices[node] != i)
+		{
+			continue;
+		}
+		uint32_t level = m_nodeLevels[node];
+		uint32_t orderIndex = levelCursors[level]++;
+		orderNodes[orderIndex] = node;
+		localMats[orderIndex] = m_localMats[i];
+		worldMats[orderIndex] = m_worldMats[i];
+		transformSlots[orderIndex] = m_transformSlots[i];
+		dirtyFlags[orderIndex] = m_dirtyFlags[i];
+		if (dirtyFlags[orderIndex] != 0)
+		{
+			m_levelDirtyCounts[level]++;
+		}
+	}
+
+	m_orderParents.resize(aliveCount);
+	for (uint32_t i = 0; i < aliveCount; i++)
+	{
+		m_nodeOrderIndices[orderNodes[i]] = i;
+	}
+	for (uint32_t i = 0; i < aliveCount; i++)
+	{
+		uint32_t parent = m_nodeParents[orderNodes[i]];
+		m_orderParents[i] = parent == INVALID_SCENE_NODE ? INVALID_SCENE_NODE : m_nodeOrderIndices[parent];
+	}
+
+	m_orderNodes.swap(orderNodes);
+	m_localMats.swap(localMats);
+	m_worldMats.swap(worldMats);
+	m_transformSlots.swap(transformSlots);
+	m_dirtyFlags.swap(dirtyFlags);
+	m_isLayoutDirty = false;
+}
+
+void SceneGraph::MarkDirty(uint32_t orderIndex)
+{
+	if (m_dirtyFlags[orderIndex] != 0)
+	{
+		return;
+	}
+	m_dirtyFlags[orderIndex] = 1;
+	//levels of appended nodes are known after the layout refresh, which counts the flags again
+	if (!m_isLayoutDirty)
+	{
+		m_levelDirtyCounts[m_nodeLevels[m_orderNodes[orderIndex]]]++;
+	}
+}
+
+bool SceneGraph::PropagateRange(uint32_t begin, uint32_t end, std::vector<uint32_t>& outInstanceNodes)
+{
+	bool isChanged = false;
+	for (uint32_t i = begin; i < end; i++)
+	{
+		uint32_t parent = m_orderParents[i];
+		if (m_dirtyFlags[i] == 0 && (parent == INVALID_SCENE_NODE || m_dirtyFlags[parent] == 0))
+		{
+			continue;
+		}
+
+		m_worldMats[i] = parent == INVALID_SCENE_NODE ? m_localMats[i] : m_worldMats[parent] * m_localMats[i];
+		m_dirtyFlags[i] = 1;
+		isChanged = true;
+		if (m_transformSlots[i] != INVALID_SLOT_INDEX)
+		{
+			outInstanceNodes.push_back(i);
+		}
+	}
+	return isChanged;
+}
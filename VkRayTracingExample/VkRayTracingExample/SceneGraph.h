@@ -0,0 +1,76 @@
+#pragma once
+
+#include <vector>
+
+#include "Utils.h"
+#include "WorkerThreadPool.h"
+
+class SampleRenderObjectInstance;
+class InstanceTransformStore;
+
+#define INVALID_SCENE_NODE UINT32_MAX
+//levels with less nodes are propagated on the calling thread
+#define SCENE_GRAPH_PARALLEL_NODE_COUNT 1024
+#define SCENE_GRAPH_NODES_PER_JOB 256
+
+//hierarchy of local transforms, world transforms of the nodes with an attached instance are written to the transform store
+//nodes are stored breadth first, each depth level is contiguous so a level only reads the level above it
+class SceneGraph
+{
+public:
+	uint32_t CreateNode(const glm::mat4& localMat, uint32_t parentNode = INVALID_SCENE_NODE);
+	//descendants are removed together, their instances are detached
+	void RemoveNode(uint32_t node);
+	//fails if the parent is the node itself or one of its descendants
+	bool SetParent(uint32_t node, uint32_t parentNode);
+	void Clear();
+
+	void SetLocalTransform(uint32_t node, const glm::mat4& localMat);
+	glm::mat4 GetLocalTransform(uint32_t node);
+	//result of the last update
+	glm::mat4 GetWorldTransform(uint32_t node);
+	uint32_t GetParent(uint32_t node);
+
+	//world matrix of the instance follows the node, SetWorldMatrix of the instance is overwritten when the node moves
+	void AttachInstance(uint32_t node, SampleRenderObjectInstance* instance);
+	void DetachInstance(uint32_t node);
+
+	bool IsValid(uint32_t node) { return node < m_nodeAlive.size() && m_nodeAlive[node] != 0; }
+	uint32_t GetNodeCount() { return static_cast<uint32_t>(m_orderNodes.size()); }
+	uint32_t GetLevelCount() { return m_levelOffsets.empty() ? 0 : static_cast<uint32_t>(m_levelOffsets.size()) - 1; }
+
+	//propagates the dirty subtrees level by level, changed instance transforms are marked dirty in the store
+	void Update(InstanceTransformStore& transformStore, WorkerThreadPool* workerPool = nullptr);
+
+protected:
+	//sorts the nodes by depth after nodes are created, removed or reparented
+	void RefreshLayout();
+	void MarkDirty(uint32_t orderIndex);
+	//returns true if any node of the range is changed, changed nodes with an instance are appended to outInstanceNodes
+	bool PropagateRange(uint32_t begin, uint32_t end, std::vector<uint32_t>& outInstanceNodes);
+
+private:
+	//indexed by node
+	std::vector<uint32_t> m_nodeParents;
+	std::vector<uint32_t> m_nodeOrderIndices;
+	std::vector<uint32_t> m_nodeLevels;
+	std::vector<SampleRenderObjectInstance*> m_nodeInstances;
+	std::vector<uint8_t> m_nodeAlive;
+	std::vector<uint32_t> m_freeNodes;
+
+	//indexed in breadth first order, parents are order indices too
+	std::vector<uint32_t> m_orderNodes;
+	std::vector<uint32_t> m_orderParents;
+	std::vector<glm::mat4> m_localMats;
+	std::vector<glm::mat4> m_worldMats;
+	std::vector<uint32_t> m_transformSlots;
+	std::vector<uint8_t> m_dirtyFlags;
+
+	//level i is [m_levelOffsets[i], m_levelOffsets[i + 1])
+	std::vector<uint32_t> m_levelOffsets;
+	std::vector<uint32_t> m_levelDirtyCounts;
+	//changed instance nodes of each job, kept to reuse the allocations
+	std::vector<std::vector<uint32_t>> m_jobInstanceNodes;
+
+	bool m_isLayoutDirty = false;
+};
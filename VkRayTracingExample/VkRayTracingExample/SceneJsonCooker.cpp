@@ -0,0 +1,425 @@
+#include <fstream>
+#include <sstream>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include "SceneJsonCooker.h"
+
+bool SceneJsonCooker::Cook(const std::string& jsonFilePath, const std::string& sceneFilePath)
+{
+	std::ifstream jsonFile(jsonFilePath, std::ios::binary);
+	if (!jsonFile.is_open())
+	{
+		REPORT(EReportType::REPORT_TYPE_ERROR, "Scene json open failed.");
+		return false;
+	}
+	std::stringstream jsonStream;
+	jsonStream << jsonFile.rdbuf();
+
+	SimpleJsonValue root;
+	std::string error = "";
+	if (!SimpleJsonValue::Parse(jsonStream.str(), root, error))
+	{
+		error = "Scene json parse failed : " + error;
+		REPORT(EReportType::REPORT_TYPE_ERROR, error.c_str());
+		return false;
+	}
+
+	Reset();
+	const SimpleJsonValue* materials = root.Find("Materials");
+	if (materials != nullptr && materials->IsArray())
+	{
+		for (uint32_t i = 0; i < materials->GetCount(); i++)
+		{
+			if (!AddMaterial(materials->GetAt(i)))
+			{
+				return false;
+			}
+		}
+	}
+
+	const SimpleJsonValue* renderObjects = root.Find("RenderObjects");
+	if (renderObjects == nullptr || !renderObjects->IsArray())
+	{
+		REPORT(EReportType::REPORT_TYPE_ERROR, "Scene json has no RenderObjects array.");
+		return false;
+	}
+	for (uint32_t i = 0; i < renderObjects->GetCount(); i++)
+	{
+		if (!AddRenderObject(renderObjects->GetAt(i)))
+		{
+			return false;
+		}
+	}
+
+	return Write(sceneFilePath);
+}
+
+void SceneJsonCooker::Reset()
+{
+	m_strings.clear();
+	m_stringOffsets.clear();
+	m_textures.clear();
+	m_textureIndices.clear();
+	m_materials.clear();
+	m_materialIndices.clear();
+	m_renderObjects.clear();
+	m_instanceTransforms.clear();
+	m_instanceMaterials.clear();
+}
+
+uint32_t SceneJsonCooker::AddString(const std::string& str)
+{
+	auto iterFind = m_stringOffsets.find(str);
+	if (iterFind != m_stringOffsets.end())
+	{
+		return iterFind->second;
+	}
+
+	uint32_t offset = static_cast<uint32_t>(m_strings.size());
+	m_strings.append(str);
+	m_strings.push_back('\0');
+	m_stringOffsets.insert(std::make_pair(str, offset));
+	return offset;
+}
+
+uint32_t SceneJsonCooker::AddTexture(const SimpleJsonValue* path)
+{
+	if (path == nullptr || !path->IsString() || path->GetString().empty())
+	{
+		return SCENE_FILE_INVALID_INDEX;
+	}
+
+	auto iterFind = m_textureIndices.find(path->GetString());
+	if (iterFind != m_textureIndices.end())
+	{
+		return iterFind->second;
+	}
+
+	uint32_t index = static_cast<uint32_t>(m_textures.size());
+	m_textures.push_back(AddString(path->GetString()));
+	m_textureIndices.insert(std::make_pair(path->GetString(), index));
+	return index;
+}
+
+bool SceneJsonCooker::AddMaterial(const SimpleJsonValue& material)
+{
+	static const char* TEXTURE_KEYS[] = { "DiffuseTexture", "NormalTexture", "RoughnessTexture", "MetallicTexture", "AmbientOcclusionTexture" };
+	static const char* HIT_SHADER_KEYS[] = { "ClosestHitShader", "AnyHitShader", "IntersectionShader" };
+	static const char* SURFACE_TYPE_NAMES[] = { "Default", "Transparent", "Refract" };
+	static const char* DEFAULT_CLOSEST_HIT_SHADER_PATHS[] =
+	{
+		"../Resources/Shaders/Hit_Default.spr",
+		"../Resources/Shaders/Hit_Transparent.spr",
+		"../Resources/Shaders/Hit_Refract.spr",
+	};
+
+	const SimpleJsonValue* name = material.Find("Name");
+	if (name == nullptr || !name->IsString() || name->GetString().empty())
+	{
+		REPORT(EReportType::REPORT_TYPE_ERROR, "Scene material needs a Name.");
+		return false;
+	}
+	if (m_materialIndices.find(name->GetString()) != m_materialIndices.end())
+	{
+		REPORT(EReportType::REPORT_TYPE_ERROR, "Scene material name is duplicated.");
+		return false;
+	}
+
+	SceneFileMaterial desc = {};
+	desc.NameOffset = AddString(name->GetString());
+
+	const SimpleJsonValue* surfaceType = material.Find("SurfaceType");
+	if (surfaceType != nullptr)
+	{
+		uint32_t surfaceTypeIndex = SCENE_FILE_INVALID_INDEX;
+		for (uint32_t i = 0; i < sizeof(SURFACE_TYPE_NAMES) / sizeof(SURFACE_TYPE_NAMES[0]); i++)
+		{
+			surfaceTypeIndex = surfaceType->GetString() == SURFACE_TYPE_NAMES[i] ? i : surfaceTypeIndex;
+		}
+		if (surfaceTypeIndex == SCENE_FILE_INVALID_INDEX)
+		{
+			REPORT(EReportType::REPORT_TYPE_ERROR, "Scene material SurfaceType is unknown.");
+			return false;
+		}
+		desc.SurfaceType = surfaceTypeIndex;
+	}
+
+	const SimpleJsonValue* color = material.Find("Color");
+	if (color != nullptr && color->IsArray())
+	{
+		for (uint32_t i = 0; i < 4 && i < color->GetCount(); i++)
+		{
+			desc.Color[i] = static_cast<float>(color->GetAt(i).GetNumber(desc.Color[i]));
+		}
+	}
+	const SimpleJsonValue* value = material.Find("IndexOfRefraction");
+	desc.IndexOfRefraction = value != nullptr ? static_cast<float>(value->GetNumber(desc.IndexOfRefraction)) : desc.IndexOfRefraction;
+	value = material.Find("Metallic");
+	desc.Metallic = value != nullptr ? static_cast<float>(value->GetNumber(desc.Metallic)) : desc.Metallic;
+	value = material.Find("Roughness");
+	desc.Roughness = value != nullptr ? static_cast<float>(value->GetNumber(desc.Roughness)) : desc.Roughness;
+	value = material.Find("UvScale");
+	desc.UvScale = value != nullptr ? static_cast<float>(value->GetNumber(desc.UvScale)) : desc.UvScale;
+
+	for (uint32_t i = 0; i < static_cast<uint32_t>(ESceneTextureSlot::END); i++)
+	{
+		desc.TextureIndices[i] = AddTexture(material.Find(TEXTURE_KEYS[i]));
+	}
+	for (uint32_t i = 0; i < static_cast<uint32_t>(ESceneHitShader::END); i++)
+	{
+		const SimpleJsonValue* shaderPath = material.Find(HIT_SHADER_KEYS[i]);
+		if (shaderPath != nullptr && shaderPath->IsString())
+		{
+			desc.HitShaderPathOffsets[i] = AddString(shaderPath->GetString());
+		}
+	}
+	if (desc.HitShaderPathOffsets[static_cast<uint32_t>(ESceneHitShader::CLOSEST_HIT)] == SCENE_FILE_INVALID_INDEX)
+	{
+		desc.HitShaderPathOffsets[static_cast<uint32_t>(ESceneHitShader::CLOSEST_HIT)] = AddString(DEFAULT_CLOSEST_HIT_SHADER_PATHS[desc.SurfaceType]);
+	}
+
+	m_materialIndices.insert(std::make_pair(name->GetString(), static_cast<uint32_t>(m_materials.size())));
+	m_materials.push_back(desc);
+	return true;
+}
+
+bool SceneJsonCooker::AddRenderObject(const SimpleJsonValue& renderObject)
+{
+	static const char* BUILD_PROFILE_NAMES[] = { "Static", "Dynamic", "Deforming" };
+
+	const SimpleJsonValue* mesh = renderObject.Find("Mesh");
+	if (mesh == nullptr || !mesh->IsString() || mesh->GetString().empty())
+	{
+		REPORT(EReportType::REPORT_TYPE_ERROR, "Scene render object needs a Mesh path.");
+		return false;
+	}
+
+	SceneFileRenderObject desc = {};
+	const SimpleJsonValue* name = renderObject.Find("Name");
+	desc.NameOffset = name != nullptr && name->IsString() ? AddString(name->GetString()) : SCENE_FILE_INVALID_INDEX;
+	desc.MeshPathOffset = AddString(mesh->GetString());
+	if (!FindMaterialIndex(renderObject.Find("Material"), desc.MaterialIndex))
+	{
+		return false;
+	}
+	if (desc.MaterialIndex == SCENE_FILE_INVALID_INDEX)
+	{
+		REPORT(EReportType::REPORT_TYPE_ERROR, "Scene render object needs a Material.");
+		return false;
+	}
+
+	const SimpleJsonValue* mergeMeshes = renderObject.Find("MergeMeshes");
+	desc.Flags |= mergeMeshes != nullptr && mergeMeshes->GetBool() ? SCENE_RENDER_OBJECT_FLAG_MERGE_MESHES : 0;
+	const SimpleJsonValue* buildProfile = renderObject.Find("BuildProfile");
+	if (buildProfile != nullptr)
+	{
+		for (uint32_t i = 0; i < sizeof(BUILD_PROFILE_NAMES) / sizeof(BUILD_PROFILE_NAMES[0]); i++)
+		{
+			desc.BuildProfile = buildProfile->GetString() == BUILD_PROFILE_NAMES[i] ? i : desc.BuildProfile;
+		}
+		if (desc.BuildProfile == SCENE_FILE_INVALID_INDEX)
+		{
+			REPORT(EReportType::REPORT_TYPE_ERROR, "Scene render object BuildProfile is unknown.");
+			return false;
+		}
+	}
+
+	desc.InstanceBegin = static_cast<uint32_t>(m_instanceTransforms.size());
+	const SimpleJsonValue* instances = renderObject.Find("Instances");
+	if (instances != nullptr && instances->IsArray())
+	{
+		for (uint32_t i = 0; i < instances->GetCount(); i++)
+		{
+			if (!AddInstance(instances->GetAt(i)))
+			{
+				return false;
+			}
+		}
+	}
+	const SimpleJsonValue* instanceGrids = renderObject.Find("InstanceGrids");
+	if (instanceGrids != nullptr && instanceGrids->IsArray())
+	{
+		for (uint32_t i = 0; i < instanceGrids->GetCount(); i++)
+		{
+			if (!AddInstanceGrid(instanceGrids->GetAt(i)))
+			{
+				return false;
+			}
+		}
+	}
+	desc.InstanceCount = static_cast<uint32_t>(m_instanceTransforms.size()) - desc.InstanceBegin;
+
+	m_renderObjects.push_back(desc);
+	return true;
+}
+
+bool SceneJsonCooker::AddInstance(const SimpleJsonValue& instance)
+{
+	uint32_t materialIndex = SCENE_FILE_INVALID_INDEX;
+	if (!FindMaterialIndex(instance.Find("Material"), materialIndex))
+	{
+		return false;
+	}
+	AppendInstance(ReadTransform(instance), materialIndex);
+	return true;
+}
+
+bool SceneJsonCooker::AddInstanceGrid(const SimpleJsonValue& instanceGrid)
+{
+	uint32_t materialIndex = SCENE_FILE_INVALID_INDEX;
+	if (!FindMaterialIndex(instanceGrid.Find("Material"), materialIndex))
+	{
+		return false;
+	}
+
+	//every cell gets the same local transform, moved by its cell position
+	glm::vec3 counts = ReadVec3(instanceGrid.Find("Count"), glm::vec3(1.0f));
+	glm::vec3 spacing = ReadVec3(instanceGrid.Find("Spacing"), glm::vec3(1.0f));
+	glm::vec3 origin = ReadVec3(instanceGrid.Find("Origin"), glm::vec3(0.0f));
+	glm::mat4 localMat = ReadTransform(instanceGrid);
+	uint32_t countX = static_cast<uint32_t>(counts.x);
+	uint32_t countY = static_cast<uint32_t>(counts.y);
+	uint32_t countZ = static_cast<uint32_t>(counts.z);
+	m_instanceTransforms.reserve(m_instanceTransforms.size() + countX * countY * countZ);
+	m_instanceMaterials.reserve(m_instanceMaterials.size() + countX * countY * countZ);
+	for (uint32_t z = 0; z < countZ; z++)
+	{
+		for (uint32_t y = 0; y < countY; y++)
+		{
+			for (uint32_t x = 0; x < countX; x++)
+			{
+				glm::vec3 position = origin + spacing * glm::vec3(static_cast<float>(x), static_cast<float>(y), static_cast<float>(z));
+				AppendInstance(glm::translate(glm::mat4(1.0f), position) * localMat, materialIndex);
+			}
+		}
+	}
+	return true;
+}
+
+void SceneJsonCooker::AppendInstance(const glm::mat4& worldMat, uint32_t materialIndex)
+{
+	SceneFileInstanceTransform transform = {};
+	for (uint32_t row = 0; row < 3; row++)
+	{
+		for (uint32_t col = 0; col < 4; col++)
+		{
+			transform.Rows[row][col] = worldMat[col][row];
+		}
+	}
+	m_instanceTransforms.push_back(transform);
+	m_instanceMaterials.push_back(materialIndex);
+}
+
+bool SceneJsonCooker::FindMaterialIndex(const SimpleJsonValue* name, uint32_t& outIndex)
+{
+	outIndex = SCENE_FILE_INVALID_INDEX;
+	if (name == nullptr || name->IsNull())
+	{
+		return true;
+	}
+
+	auto iterFind = m_materialIndices.find(name->GetString());
+	if (iterFind == m_materialIndices.end())
+	{
+		std::string message = "Scene material is not found : " + name->GetString();
+		REPORT(EReportType::REPORT_TYPE_ERROR, message.c_str());
+		return false;
+	}
+	outIndex = iterFind->second;
+	return true;
+}
+
+bool SceneJsonCooker::Write(const std::string& sceneFilePath)
+{
+	struct SectionSource
+	{
+		const void* Data;
+		uint64_t Size;
+	};
+	SectionSource sources[static_cast<uint32_t>(ESceneFileSection::END)] =
+	{
+		{ m_strings.data(), m_strings.size() },
+		{ m_textures.data(), m_textures.size() * sizeof(uint32_t) },
+		{ m_materials.data(), m_materials.size() * sizeof(SceneFileMaterial) },
+		{ m_renderObjects.data(), m_renderObjects.size() * sizeof(SceneFileRenderObject) },
+		{ m_instanceTransforms.data(), m_instanceTransforms.size() * sizeof(SceneFileInstanceTransform) },
+		{ m_instanceMaterials.data(), m_instanceMaterials.size() * sizeof(uint32_t) },
+	};
+
+	SceneFileHeader header = {};
+	header.InstanceCount = static_cast<uint32_t>(m_instanceTransforms.size());
+	uint64_t offset = sizeof(SceneFileHeader);
+	for (uint32_t i = 0; i < static_cast<uint32_t>(ESceneFileSection::END); i++)
+	{
+		offset = (offset + SCENE_FILE_SECTION_ALIGNMENT - 1) & ~static_cast<uint64_t>(SCENE_FILE_SECTION_ALIGNMENT - 1);
+		header.Sections[i].Offset = offset;
+		header.Sections[i].Size = sources[i].Size;
+		offset += sources[i].Size;
+	}
+
+	std::ofstream sceneFile(sceneFilePath, std::ios::binary | std::ios::trunc);
+	if (!sceneFile.is_open())
+	{
+		REPORT(EReportType::REPORT_TYPE_ERROR, "Scene file create failed.");
+		return false;
+	}
+
+	static const char PADDING[SCENE_FILE_SECTION_ALIGNMENT] = {};
+	uint64_t written = sizeof(SceneFileHeader);
+	sceneFile.write(reinterpret_cast<const char*>(&header), sizeof(SceneFileHeader));
+	for (uint32_t i = 0; i < static_cast<uint32_t>(ESceneFileSection::END); i++)
+	{
+		sceneFile.write(PADDING, static_cast<std::streamsize>(header.Sections[i].Offset - written));
+		sceneFile.write(static_cast<const char*>(sources[i].Data), static_cast<std::streamsize>(sources[i].Size));
+		written = header.Sections[i].Offset + sources[i].Size;
+	}
+
+	if (!sceneFile.good())
+	{
+		REPORT(EReportType::REPORT_TYPE_ERROR, "Scene file write failed.");
+		return false;
+	}
+	return true;
+}
+
+glm::mat4 SceneJsonCooker::ReadTransform(const SimpleJsonValue& value)
+{
+	const SimpleJsonValue* matrix = value.Find("Matrix");
+	if (matrix != nullptr && matrix->IsArray() && (matrix->GetCount() == 12 || matrix->GetCount() == 16))
+	{
+		glm::mat4 worldMat = glm::mat4(1.0f);
+		for (uint32_t i = 0; i < matrix->GetCount(); i++)
+		{
+			worldMat[i % 4][i / 4] = static_cast<float>(matrix->GetAt(i).GetNumber());
+		}
+		return worldMat;
+	}
+
+	glm::vec3 translation = ReadVec3(value.Find("Translation"), glm::vec3(0.0f));
+	glm::vec3 rotation = glm::radians(ReadVec3(value.Find("Rotation"), glm::vec3(0.0f)));
+	glm::vec3 scale = ReadVec3(value.Find("Scale"), glm::vec3(1.0f));
+	glm::mat4 worldMat = glm::translate(glm::mat4(1.0f), translation);
+	worldMat = glm::rotate(worldMat, rotation.z, glm::vec3(0.0f, 0.0f, 1.0f));
+	worldMat = glm::rotate(worldMat, rotation.y, glm::vec3(0.0f, 1.0f, 0.0f));
+	worldMat = glm::rotate(worldMat, rotation.x, glm::vec3(1.0f, 0.0f, 0.0f));
+	return glm::scale(worldMat, scale);
+}
+
+glm::vec3 SceneJsonCooker::ReadVec3(const SimpleJsonValue* value, glm::vec3 defaultValue)
+{
+	if (value == nullptr)
+	{
+		return defaultValue;
+	}
+	//a single number is used for every axis
+	if (value->IsNumber())
+	{
+		return glm::vec3(static_cast<float>(value->GetNumber()));
+	}
+	glm::vec3 result = defaultValue;
+	for (uint32_t i = 0; i < 3 && i < value->GetCount() && value->IsArray(); i++)
+	{
+		result[i] = static_cast<float>(value->GetAt(i).GetNumber(defaultValue[i]));
+	}
+	return result;
+}
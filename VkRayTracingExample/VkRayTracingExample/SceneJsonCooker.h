@@ -0,0 +1,45 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <unordered_map>
+
+#include "Utils.h"
+#include "SceneFile.h"
+#include "SimpleJson.h"
+
+//converts a json scene written by hand into the binary scene format
+//materials are referenced by name, instances are listed one by one or generated by grids for large test scenes
+class SceneJsonCooker
+{
+public:
+	bool Cook(const std::string& jsonFilePath, const std::string& sceneFilePath);
+
+protected:
+	void Reset();
+	uint32_t AddString(const std::string& str);
+	uint32_t AddTexture(const SimpleJsonValue* path);
+	bool AddMaterial(const SimpleJsonValue& material);
+	bool AddRenderObject(const SimpleJsonValue& renderObject);
+	bool AddInstance(const SimpleJsonValue& instance);
+	bool AddInstanceGrid(const SimpleJsonValue& instanceGrid);
+	void AppendInstance(const glm::mat4& worldMat, uint32_t materialIndex);
+	//SCENE_FILE_INVALID_INDEX if value is null, false if the name is unknown
+	bool FindMaterialIndex(const SimpleJsonValue* name, uint32_t& outIndex);
+	bool Write(const std::string& sceneFilePath);
+
+	//"Matrix" is 12 or 16 row major numbers, otherwise Translation * Rotation(z * y * x, degrees) * Scale
+	static glm::mat4 ReadTransform(const SimpleJsonValue& value);
+	static glm::vec3 ReadVec3(const SimpleJsonValue* value, glm::vec3 defaultValue);
+
+private:
+	std::string m_strings = "";
+	std::unordered_map<std::string, uint32_t> m_stringOffsets;
+	std::vector<uint32_t> m_textures;
+	std::unordered_map<std::string, uint32_t> m_textureIndices;
+	std::vector<SceneFileMaterial> m_materials;
+	std::unordered_map<std::string, uint32_t> m_materialIndices;
+	std::vector<SceneFileRenderObject> m_renderObjects;
+	std::vector<SceneFileInstanceTransform> m_instanceTransforms;
+	std::vector<uint32_t> m_instanceMaterials;
+};
@@ -0,0 +1,305 @@
+#include <chrono>
+
+#include "SceneLoader.h"
+#include "SceneJsonCooker.h"
+#include "MaterialContainer.h"
+#include "AssetLoader.h"
+
+bool SceneLoader::Load(const std::string& filePath, std::vector<SimpleRenderObject*>& outRenderObjects)
+{
+	std::chrono::high_resolution_clock::time_point startTime = std::chrono::high_resolution_clock::now();
+
+	std::string sceneFilePath = filePath;
+	size_t extensionPos = filePath.find_last_of('.');
+	if (extensionPos != std::string::npos && filePath.compare(extensionPos, std::string::npos, ".json") == 0)
+	{
+		sceneFilePath = filePath.substr(0, extensionPos) + SCENE_BINARY_EXTENSION;
+		uint64_t jsonWriteTime = MappedFile::GetLastWriteTime(filePath);
+		if (jsonWriteTime == 0)
+		{
+			REPORT(EReportType::REPORT_TYPE_ERROR, "Scene json is not found.");
+			return false;
+		}
+		if (MappedFile::GetLastWriteTime(sceneFilePath) <= jsonWriteTime)
+		{
+			SceneJsonCooker cooker;
+			if (!cooker.Cook(filePath, sceneFilePath))
+			{
+				return false;
+			}
+		}
+	}
+
+	if (!m_file.Open(sceneFilePath))
+	{
+		REPORT(EReportType::REPORT_TYPE_ERROR, "Scene file open failed.");
+		return false;
+	}
+	m_header = reinterpret_cast<const SceneFileHeader*>(m_file.GetData());
+	if (!Validate())
+	{
+		m_file.Close();
+		m_header = nullptr;
+		return false;
+	}
+
+	RequestAssets();
+	gAssetLoader.LoadRequests();
+
+	uint32_t materialCount = 0;
+	GetSection<SceneFileMaterial>(ESceneFileSection::MATERIALS, materialCount);
+	m_materials.assign(materialCount, nullptr);
+
+	uint32_t renderObjectCount = 0;
+	const SceneFileRenderObject* renderObjects = GetSection<SceneFileRenderObject>(ESceneFileSection::RENDER_OBJECTS, renderObjectCount);
+	uint32_t firstRenderObject = static_cast<uint32_t>(outRenderObjects.size());
+	bool res = true;
+
+	//listeners are notified once for the whole scene
+	gRenderObjContainer.BeginBatch();
+	for (uint32_t i = 0; i < renderObjectCount && res; i++)
+	{
+		res = LoadRenderObject(renderObjects[i], outRenderObjects);
+	}
+	gRenderObjContainer.EndBatch();
+
+	uint32_t instanceCount = m_header->InstanceCount;
+	m_file.Close();
+	m_header = nullptr;
+	m_materials.clear();
+	m_chunkWorldMats = std::vector<glm::mat4>();
+	m_chunkMaterials = std::vector<SimpleMaterial*>();
+
+	if (res)
+	{
+		std::chrono::duration<double, std::milli> elapsed = std::chrono::high_resolution_clock::now() - startTime;
+		char message[256] = {};
+		sprintf_s
+		(
+			message,
+			"Scene loaded : %u render objects, %u instances in %.3f ms.",
+			static_cast<uint32_t>(outRenderObjects.size()) - firstRenderObject,
+			instanceCount,
+			elapsed.count()
+		);
+		REPORT(EReportType::REPORT_TYPE_LOG, message);
+	}
+	return res;
+}
+
+bool SceneLoader::Validate()
+{
+	uint64_t fileSize = m_file.GetSize();
+	if (fileSize < sizeof(SceneFileHeader) ||
+		m_header->Magic != SCENE_FILE_MAGIC ||
+		m_header->Version != SCENE_FILE_VERSION ||
+		m_header->SectionCount != static_cast<uint32_t>(ESceneFileSection::END))
+	{
+		REPORT(EReportType::REPORT_TYPE_ERROR, "Scene file header is invalid, the file may be written by another version.");
+		return false;
+	}
+
+	static const uint64_t ELEMENT_SIZES[] =
+	{
+		1,
+		sizeof(uint32_t),
+		sizeof(SceneFileMaterial),
+		sizeof(SceneFileRenderObject),
+		sizeof(SceneFileInstanceTransform),
+		sizeof(uint32_t),
+	};
+	for (uint32_t i = 0; i < static_cast<uint32_t>(ESceneFileSection::END); i++)
+	{
+		const SceneFileSectionDesc& section = m_header->Sections[i];
+		if (section.Offset % SCENE_FILE_SECTION_ALIGNMENT != 0 ||
+			section.Offset > fileSize ||
+			section.Size > fileSize - section.Offset ||
+			section.Size % ELEMENT_SIZES[i] != 0)
+		{
+			REPORT(EReportType::REPORT_TYPE_ERROR, "Scene file section is out of the file.");
+			return false;
+		}
+	}
+
+	uint32_t stringSize = 0;
+	const char* strings = GetSection<char>(ESceneFileSection::STRINGS, stringSize);
+	if (stringSize > 0 && strings[stringSize - 1] != '\0')
+	{
+		REPORT(EReportType::REPORT_TYPE_ERROR, "Scene file strings are not terminated.");
+		return false;
+	}
+
+	uint32_t transformCount = 0;
+	uint32_t instanceMaterialCount = 0;
+	GetSection<SceneFileInstanceTransform>(ESceneFileSection::INSTANCE_TRANSFORMS, transformCount);
+	GetSection<uint32_t>(ESceneFileSection::INSTANCE_MATERIALS, instanceMaterialCount);
+	if (transformCount != m_header->InstanceCount || instanceMaterialCount != m_header->InstanceCount)
+	{
+		REPORT(EReportType::REPORT_TYPE_ERROR, "Scene file instance sections do not match.");
+		return false;
+	}
+
+	uint32_t renderObjectCount = 0;
+	const SceneFileRenderObject* renderObjects = GetSection<SceneFileRenderObject>(ESceneFileSection::RENDER_OBJECTS, renderObjectCount);
+	for (uint32_t i = 0; i < renderObjectCount; i++)
+	{
+		if (renderObjects[i].InstanceBegin > m_header->InstanceCount || renderObjects[i].InstanceCount > m_header->InstanceCount - renderObjects[i].InstanceBegin)
+		{
+			REPORT(EReportType::REPORT_TYPE_ERROR, "Scene file render object instances are out of range.");
+			return false;
+		}
+	}
+
+	return true;
+}
+
+void SceneLoader::RequestAssets()
+{
+	uint32_t renderObjectCount = 0;
+	const SceneFileRenderObject* renderObjects = GetSection<SceneFileRenderObject>(ESceneFileSection::RENDER_OBJECTS, renderObjectCount);
+	for (uint32_t i = 0; i < renderObjectCount; i++)
+	{
+		const char* meshPath = GetString(renderObjects[i].MeshPathOffset);
+		if (meshPath != nullptr)
+		{
+			gAssetLoader.RequestMesh(meshPath);
+		}
+	}
+
+	uint32_t textureCount = 0;
+	const uint32_t* textures = GetSection<uint32_t>(ESceneFileSection::TEXTURES, textureCount);
+	for (uint32_t i = 0; i < textureCount; i++)
+	{
+		const char* texturePath = GetString(textures[i]);
+		if (texturePath != nullptr)
+		{
+			gAssetLoader.RequestImage(texturePath);
+		}
+	}
+
+	uint32_t materialCount = 0;
+	const SceneFileMaterial* materials = GetSection<SceneFileMaterial>(ESceneFileSection::MATERIALS, materialCount);
+	for (uint32_t i = 0; i < materialCount; i++)
+	{
+		for (uint32_t j = 0; j < static_cast<uint32_t>(ESceneHitShader::END); j++)
+		{
+			const char* shaderPath = GetString(materials[i].HitShaderPathOffsets[j]);
+			if (shaderPath != nullptr)
+			{
+				gAssetLoader.RequestShaderCode(shaderPath);
+			}
+		}
+	}
+}
+
+bool SceneLoader::LoadRenderObject(const SceneFileRenderObject& desc, std::vector<SimpleRenderObject*>& outRenderObjects)
+{
+	const char* meshPath = GetString(desc.MeshPathOffset);
+	SimpleMaterial* material = GetMaterial(desc.MaterialIndex);
+	if (meshPath == nullptr || material == nullptr)
+	{
+		REPORT(EReportType::REPORT_TYPE_ERROR, "Scene render object has no mesh or material.");
+		return false;
+	}
+
+	SimpleRenderObject* renderObj = gRenderObjContainer.CreateRenderObject(meshPath, material);
+	if (renderObj->GetGeometry() == nullptr)
+	{
+		REPORT(EReportType::REPORT_TYPE_ERROR, "Scene render object mesh load failed.");
+		gRenderObjContainer.RemoveRenderObject(renderObj);
+		return false;
+	}
+	if ((desc.Flags & SCENE_RENDER_OBJECT_FLAG_MERGE_MESHES) != 0)
+	{
+		renderObj->SetMergeMeshes(true);
+	}
+	if (desc.BuildProfile != SCENE_FILE_INVALID_INDEX)
+	{
+		renderObj->SetBuildProfile(static_cast<EAsBuildProfile>(desc.BuildProfile));
+	}
+	outRenderObjects.push_back(renderObj);
+
+	if (desc.InstanceCount == 0)
+	{
+		return true;
+	}
+
+	//reserved once, the chunks below only append
+	uint32_t meshCount = renderObj->GetGeometry()->GetMeshCount();
+	gRenderObjContainer.ReserveRenderObjectInstances(desc.InstanceCount, desc.InstanceCount * meshCount);
+	renderObj->ReserveInstances(desc.InstanceCount);
+
+	uint32_t instanceCount = 0;
+	const SceneFileInstanceTransform* transforms = GetSection<SceneFileInstanceTransform>(ESceneFileSection::INSTANCE_TRANSFORMS, instanceCount) + desc.InstanceBegin;
+	const uint32_t* materialIndices = GetSection<uint32_t>(ESceneFileSection::INSTANCE_MATERIALS, instanceCount) + desc.InstanceBegin;
+	for (uint32_t chunkBegin = 0; chunkBegin < desc.InstanceCount; chunkBegin += SCENE_LOAD_INSTANCE_CHUNK_SIZE)
+	{
+		uint32_t chunkCount = desc.InstanceCount - chunkBegin < SCENE_LOAD_INSTANCE_CHUNK_SIZE ? desc.InstanceCount - chunkBegin : SCENE_LOAD_INSTANCE_CHUNK_SIZE;
+		m_chunkWorldMats.resize(chunkCount);
+		m_chunkMaterials.resize(chunkCount);
+		for (uint32_t i = 0; i < chunkCount; i++)
+		{
+			InstanceTransformStore::ToMatrix(reinterpret_cast<const InstanceTransformRows&>(transforms[chunkBegin + i]), m_chunkWorldMats[i]);
+			uint32_t materialIndex = materialIndices[chunkBegin + i];
+			m_chunkMaterials[i] = materialIndex == SCENE_FILE_INVALID_INDEX ? nullptr : GetMaterial(materialIndex);
+		}
+		renderObj->CreateInstances(m_chunkWorldMats.data(), m_chunkMaterials.data(), chunkCount);
+	}
+
+	return true;
+}
+
+SimpleMaterial* SceneLoader::GetMaterial(uint32_t index)
+{
+	if (index >= m_materials.size())
+	{
+		return nullptr;
+	}
+	if (m_materials[index] != nullptr)
+	{
+		return m_materials[index];
+	}
+
+	uint32_t materialCount = 0;
+	uint32_t textureCount = 0;
+	const SceneFileMaterial& fileMaterial = GetSection<SceneFileMaterial>(ESceneFileSection::MATERIALS, materialCount)[index];
+	const uint32_t* textures = GetSection<uint32_t>(ESceneFileSection::TEXTURES, textureCount);
+
+	SimpleMaterialDesc desc;
+	const char* name = GetString(fileMaterial.NameOffset);
+	desc.Name = name != nullptr ? name : "";
+	desc.Color = glm::vec4(fileMaterial.Color[0], fileMaterial.Color[1], fileMaterial.Color[2], fileMaterial.Color[3]);
+	desc.SurfaceType = fileMaterial.SurfaceType <= static_cast<uint32_t>(EMaterialType::MATERIAL_TYPE_TRANSPARENT_REFRACT) ? static_cast<EMaterialType>(fileMaterial.SurfaceType) : EMaterialType::SURFACE_TYPE_DEFAULT;
+	desc.IndexOfRefraction = fileMaterial.IndexOfRefraction;
+	desc.Metallic = fileMaterial.Metallic;
+	desc.Roughness = fileMaterial.Roughness;
+	desc.UvScale = fileMaterial.UvScale;
+
+	std::string* texturePaths[] = { &desc.DiffuseTexPath, &desc.NormalTexPath, &desc.RoughnessTexPath, &desc.MetallicTexPath, &desc.AmbientOcclusionTexPath };
+	for (uint32_t i = 0; i < static_cast<uint32_t>(ESceneTextureSlot::END); i++)
+	{
+		uint32_t textureIndex = fileMaterial.TextureIndices[i];
+		const char* path = textureIndex < textureCount ? GetString(textures[textureIndex]) : nullptr;
+		*texturePaths[i] = path != nullptr ? path : "";
+	}
+	std::string* shaderPaths[] = { &desc.ClosestHitShaderPath, &desc.AnyHitShaderPath, &desc.IntersectionShaderPath };
+	for (uint32_t i = 0; i < static_cast<uint32_t>(ESceneHitShader::END); i++)
+	{
+		const char* path = GetString(fileMaterial.HitShaderPathOffsets[i]);
+		*shaderPaths[i] = path != nullptr ? path : "";
+	}
+
+	m_materials[index] = gMaterialContainer.CreateMaterial(desc);
+	return m_materials[index];
+}
+
+const char* SceneLoader::GetString(uint32_t offset)
+{
+	uint32_t stringSize = 0;
+	const char* strings = GetSection<char>(ESceneFileSection::STRINGS, stringSize);
+	if (offset >= stringSize)
+	{
+		return nullptr;
+	}
+	return strings + offset;
+}
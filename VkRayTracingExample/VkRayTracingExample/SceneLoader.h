@@ -0,0 +1,52 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "SceneFile.h"
+#include "MappedFile.h"
+#include "RenderObjectContainer.h"
+
+#define SCENE_BINARY_EXTENSION ".scnb"
+//instances are converted and created in chunks, only one chunk of matrices is kept on the heap
+#define SCENE_LOAD_INSTANCE_CHUNK_SIZE 4096
+
+//creates render objects, materials and instances from a binary scene file read in place through a file mapping
+//sections are touched only when they are consumed, instances of each render object are created in bulk
+//files of the scene and the files requested by the caller before Load are decoded in parallel by the asset loader
+class SceneLoader
+{
+public:
+	//a .json path is cooked to a binary file with the same name and SCENE_BINARY_EXTENSION first,
+	//the binary is reused while it is newer than the json
+	bool Load(const std::string& filePath, std::vector<SimpleRenderObject*>& outRenderObjects);
+
+protected:
+	bool Validate();
+	//meshes, textures and hit shaders of the scene are decoded together before the first object is created
+	void RequestAssets();
+	bool LoadRenderObject(const SceneFileRenderObject& desc, std::vector<SimpleRenderObject*>& outRenderObjects);
+	//materials are created when first referenced, nullptr for an invalid index
+	SimpleMaterial* GetMaterial(uint32_t index);
+	//nullptr if offset is SCENE_FILE_INVALID_INDEX
+	const char* GetString(uint32_t offset);
+
+	template <typename T>
+	const T* GetSection(ESceneFileSection section, uint32_t& outCount);
+
+private:
+	MappedFile m_file;
+	const SceneFileHeader* m_header = nullptr;
+	std::vector<SimpleMaterial*> m_materials;
+
+	std::vector<glm::mat4> m_chunkWorldMats;
+	std::vector<SimpleMaterial*> m_chunkMaterials;
+};
+
+template <typename T>
+const T* SceneLoader::GetSection(ESceneFileSection section, uint32_t& outCount)
+{
+	const SceneFileSectionDesc& sectionDesc = m_header->Sections[static_cast<uint32_t>(section)];
+	outCount = static_cast<uint32_t>(sectionDesc.Size / sizeof(T));
+	return reinterpret_cast<const T*>(m_file.GetData() + sectionDesc.Offset);
+}
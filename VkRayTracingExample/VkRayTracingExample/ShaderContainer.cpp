@@ -9,14 +9,9 @@ SimpleShader* ShaderContainer::CreateShader(ERTShaderType shaderType, std::strin
 	auto iterKeyFinded = m_keyTable.find(filePath);
 	if (iterKeyFinded != m_keyTable.end())
 	{
-		auto iterListFinded = m_shaderDatas.find(groupType);
-		if (iterListFinded != m_shaderDatas.end())
+		if (groupType != SHADER_GROUP_TYPE_INVALID)
 		{
-			auto iterShaderFinded = iterListFinded->second.find(iterKeyFinded->second);
-			if (iterShaderFinded != iterListFinded->second.end())
-			{
-				shader = iterShaderFinded->second;	
-			}
+			shader = m_shaderDatas[groupType].Find(iterKeyFinded->second);
 		}
 	}
 
@@ -40,63 +35,26 @@ SimpleShader* ShaderContainer::CreateShader(ERTShaderType shaderType, std::strin
 
 int ShaderContainer::GetBindIndex(SimpleShader* shader)
 {
-	uint32_t rayGenOffset = 0;
-	uint32_t missOffset = 0;
-	uint32_t hitOffset = 0;
-	auto iterRgenList = m_shaderDatas.find(SHADER_GROUP_TYPE_RAY_GEN);
-	if (iterRgenList != m_shaderDatas.end())
-	{
-		rayGenOffset += static_cast<uint32_t>(iterRgenList->second.size());
-	}
-
-	auto iterMissList = m_shaderDatas.find(SHADER_GROUP_TYPE_MISS);
-	if (iterMissList != m_shaderDatas.end())
-	{	
-		missOffset += static_cast<uint32_t>(iterMissList->second.size());
-	}
-
-	auto iterHitList = m_shaderDatas.find(SHADER_GROUP_TYPE_HIT);
-	if (iterHitList != m_shaderDatas.end())
+	ERTShaderGroupType groupType = GetShaderGroupType(shader->GetShaderType());
+	if (groupType == SHADER_GROUP_TYPE_INVALID)
 	{
-		hitOffset += static_cast<uint32_t>(iterHitList->second.size());
+		return INVALID_INDEX_INT;
 	}
 
+	//ray gen, miss, hit and callable shaders are bound in order of the group types
 	uint32_t offset = 0;
-	ERTShaderGroupType groupType = GetShaderGroupType(shader->GetShaderType());
-	switch(groupType)
+	for (uint32_t i = 0; i < static_cast<uint32_t>(groupType); i++)
 	{
-		case SHADER_GROUP_TYPE_MISS :
-		{
-			offset = rayGenOffset;
-		}
-		break;
-		case SHADER_GROUP_TYPE_HIT :
-		{
-			offset = rayGenOffset + missOffset;
-		}
-		break;
-		case SHADER_GROUP_TYPE_CALLABLE :
-		{
-			offset = rayGenOffset + missOffset + hitOffset;
-		}
-		break;
+		offset += m_shaderDatas[i].GetCount();
 	}
 
-	int index = INVALID_INDEX_INT;
-
-	groupType = GetShaderGroupType(shader->GetShaderType());
-	auto iterListFinded = m_shaderDatas.find(groupType);
-	if (iterListFinded != m_shaderDatas.end())
+	int index = m_shaderDatas[groupType].GetIndex(shader->GetUID());
+	if (index == INVALID_INDEX_INT)
 	{
-		auto iterShaderFind = iterListFinded->second.find(shader->GetUID());
-		if (iterShaderFind != iterListFinded->second.end())
-		{
-			int pos = static_cast<int>(std::distance(iterListFinded->second.begin(), iterShaderFind));
-			index = offset + pos;
-		}
+		return INVALID_INDEX_INT;
 	}
 
-	return index;
+	return static_cast<int>(offset) + index;
 }
 
 void ShaderContainer::RemoveUnusedShaders()
@@ -104,11 +62,11 @@ void ShaderContainer::RemoveUnusedShaders()
 	std::vector<SimpleShader*> m_removeList;
 	for (auto& curList : m_shaderDatas)
 	{
-		for (auto& curShader : curList.second)
+		for (SimpleShader* curShader : curList)
 		{
-			if (curShader.second->GetRefCount() == 0)
+			if (curShader->GetRefCount() == 0)
 			{
-				m_removeList.push_back(curShader.second);
+				m_removeList.push_back(curShader);
 			}
 		}
 	}
@@ -123,17 +81,17 @@ void ShaderContainer::Clear()
 {
 	for (auto& curList : m_shaderDatas)
 	{
-		for (auto& curShader : curList.second)
+		for (SimpleShader* curShader : curList)
 		{
-			if (curShader.second->GetRefCount() == 0)
+			if (curShader->GetRefCount() == 0)
 			{
-				m_keyTable.erase(curShader.second->GetSrcFilePath());
-				curShader.second->Unload();
-				delete curShader.second;
+				m_keyTable.erase(curShader->GetSrcFilePath());
+				curShader->Unload();
+				delete curShader;
 			}
 		}
+		curList.Clear();
 	}
-	m_shaderDatas.clear();
 }
 
 uint32_t ShaderContainer::GetShaderCount()
@@ -141,11 +99,7 @@ uint32_t ShaderContainer::GetShaderCount()
 	uint32_t shaderCount = 0;
 	for (uint32_t i = 0; i < static_cast<uint32_t>(SHADER_GROUP_TYPE_END); i++)
 	{
-		auto iterFind = m_shaderDatas.find(static_cast<ERTShaderGroupType>(i));
-		if (iterFind != m_shaderDatas.end())
-		{
-			shaderCount += static_cast<uint32_t>(iterFind->second.size());
-		}
+		shaderCount += m_shaderDatas[i].GetCount();
 	}
 
 	return shaderCount;
@@ -153,52 +107,40 @@ uint32_t ShaderContainer::GetShaderCount()
 
 uint32_t ShaderContainer::GetShaderCount(ERTShaderGroupType shaderType)
 {
-	auto iterFind = m_shaderDatas.find(shaderType);
-	if (iterFind != m_shaderDatas.end())
+	if (shaderType == SHADER_GROUP_TYPE_INVALID || shaderType >= SHADER_GROUP_TYPE_END)
 	{
-		return static_cast<uint32_t>(iterFind->second.size());
+		return 0;
 	}
-	return 0;
+	return m_shaderDatas[shaderType].GetCount();
 }
 
 SimpleShader* ShaderContainer::GetShader(ERTShaderGroupType shaderType, uint32_t index)
 {
-	auto iterFind = m_shaderDatas.find(shaderType);
-	if (iterFind != m_shaderDatas.end())
+	if (shaderType == SHADER_GROUP_TYPE_INVALID || shaderType >= SHADER_GROUP_TYPE_END)
 	{
-		if (index < iterFind->second.size())
-		{
-			auto pos = iterFind->second.begin();
-			std::advance(pos, index);
-			return pos->second;
-		}
+		return nullptr;
 	}
-	return nullptr;
+	return m_shaderDatas[shaderType].GetAt(index);
 }
 
 SimpleShader* ShaderContainer::LoadShader(ERTShaderType shaderType, std::string& filePath)
 {
 	ERTShaderGroupType groupType = GetShaderGroupType(shaderType);
-	auto iterListFind = m_shaderDatas.find(groupType);
-	std::unordered_map<UID, SimpleShader*>* shaderList;
-	if (iterListFind == m_shaderDatas.end())
-	{
-		m_shaderDatas.insert(std::make_pair(groupType, std::unordered_map<UID, SimpleShader*>() = {}));
-		m_shaderDatas[groupType].reserve(RESOURCE_CONTAINER_INITIAL_SIZE);
-		shaderList = &m_shaderDatas[groupType];
-	}
-	else
+	if (groupType == SHADER_GROUP_TYPE_INVALID)
 	{
-		shaderList = &iterListFind->second;
+		REPORT(EReportType::REPORT_TYPE_ERROR, "Invalid shader type.");
+		return nullptr;
 	}
 
+	//a failed shader is not inserted, bind indices of the loaded shaders stay contiguous
 	SimpleShader* shader = new SimpleShader();
-	shaderList->insert(std::make_pair(shader->GetUID(), shader));
 	if (!shader->Load(shaderType, filePath))
 	{
 		REPORT(EReportType::REPORT_TYPE_LOG, "Shader load failed");
+		delete shader;
 		return nullptr;
 	}
+	m_shaderDatas[groupType].Insert(shader);
 
 	UID uid = shader->GetUID();
 	m_keyTable.insert(std::make_pair(filePath, uid));
@@ -210,18 +152,15 @@ void ShaderContainer::UnloadShader(SimpleShader* shader)
 {
 	
 	ERTShaderGroupType shaderGroupType = GetShaderGroupType(shader->GetShaderType());
-	auto iterListFind = m_shaderDatas.find(shaderGroupType);
-	if (iterListFind != m_shaderDatas.end())
+	if (shaderGroupType == SHADER_GROUP_TYPE_INVALID)
 	{
-		UID indexTableUid = shader->GetUID();
-		auto iterShaderFind = iterListFind->second.find(indexTableUid);
-		if (iterShaderFind != iterListFind->second.end())
-		{
-			m_keyTable.erase(iterShaderFind->second->GetSrcFilePath());
-			iterShaderFind->second->Unload();
-			delete iterShaderFind->second;
-			iterListFind->second.erase(indexTableUid);
-		}
+		return;
+	}
+	if (m_shaderDatas[shaderGroupType].Remove(shader->GetUID()) != INVALID_INDEX_INT)
+	{
+		m_keyTable.erase(shader->GetSrcFilePath());
+		shader->Unload();
+		delete shader;
 	}
 }
 
@@ -268,32 +207,26 @@ RtHitShaderGroup* RayHitGroupContainer::CreateHitGroup(std::string& closetHitFil
 	auto iterKeyFind = m_keyTable.find(key);
 	if (iterKeyFind != m_keyTable.end())
 	{
-		auto iterHitGroupFind = m_hitGroupList.find(iterKeyFind->second);
-		if (iterHitGroupFind != m_hitGroupList.end())
-		{
-			hitGroup = iterHitGroupFind->second;
-		}
+		hitGroup = m_hitGroupList.Find(iterKeyFind->second);
 	}
 
 	if (hitGroup == nullptr)
 	{
-		RtHitShaderGroup* newHitGroup = new RtHitShaderGroup();
-		UID uid = newHitGroup->GetUID();
-		newHitGroup->IncRef();
-		m_hitGroupList.insert(std::make_pair(uid, newHitGroup));
+		hitGroup = new RtHitShaderGroup();
+		hitGroup->IncRef();
+		m_hitGroupList.Insert(hitGroup);
 		if (!closetHitFilePath.empty())
 		{
-			m_hitGroupList[uid]->LoadShader(SHADER_TYPE_CLOSET_HIT, closetHitFilePath);
+			hitGroup->LoadShader(SHADER_TYPE_CLOSET_HIT, closetHitFilePath);
 		}
 		if (!anyHitFilePath.empty())
 		{
-			m_hitGroupList[uid]->LoadShader(SHADER_TYPE_ANY_HIT, anyHitFilePath);
+			hitGroup->LoadShader(SHADER_TYPE_ANY_HIT, anyHitFilePath);
 		}
 		if (!intersectionFilePath.empty())
 		{
-			m_hitGroupList[uid]->LoadShader(SHADER_TYPE_INTERSECTION, intersectionFilePath);
+			hitGroup->LoadShader(SHADER_TYPE_INTERSECTION, intersectionFilePath);
 		}
-		hitGroup = m_hitGroupList[uid];
 		m_keyTable.insert(std::make_pair(key, hitGroup->GetUID()));
 	}
 	return hitGroup;
@@ -302,11 +235,11 @@ RtHitShaderGroup* RayHitGroupContainer::CreateHitGroup(std::string& closetHitFil
 void RayHitGroupContainer::RemoveUnusedShaderGroups()
 {
 	std::vector<RtHitShaderGroup*> m_removeList;
-	for (auto& cur : m_hitGroupList)
+	for (RtHitShaderGroup* cur : m_hitGroupList)
 	{
-		if (cur.second->GetRefCount() == 0)
+		if (cur->GetRefCount() == 0)
 		{
-			m_removeList.push_back(cur.second);
+			m_removeList.push_back(cur);
 		}
 	}
 
@@ -318,53 +251,40 @@ void RayHitGroupContainer::RemoveUnusedShaderGroups()
 		{
 			m_keyTable.erase(key);
 		}
-		UID uid = cur->GetUID();
-		auto iterHitGroupFind = m_hitGroupList.find(uid);
-		if (iterHitGroupFind != m_hitGroupList.end())
+		if (m_hitGroupList.Remove(cur->GetUID()) != INVALID_INDEX_INT)
 		{
-			if (iterHitGroupFind->second != nullptr)
-			{
-				iterHitGroupFind->second->Destroy();
-				delete iterHitGroupFind->second;
-				m_hitGroupList.erase(uid);
-			}
+			cur->Destroy();
+			delete cur;
 		}
 	}
 }
 
 void RayHitGroupContainer::Clear()
 {
-	for (auto& cur : m_hitGroupList)
+	for (RtHitShaderGroup* cur : m_hitGroupList)
 	{
-		if (cur.second->GetRefCount() == 0)
+		if (cur->GetRefCount() == 0)
 		{
-			cur.second->Destroy();
-			delete cur.second;
+			cur->Destroy();
+			delete cur;
 		}
 	}
-	m_hitGroupList.clear();
+	m_hitGroupList.Clear();
 	m_keyTable.clear();
 }
 
 int RayHitGroupContainer::GetBindIndex(RtHitShaderGroup* hitShaderGroup)
 {
-	auto iterFind = m_hitGroupList.find(hitShaderGroup->GetUID());
-	if (iterFind != m_hitGroupList.end())
-	{
-		return static_cast<int>(std::distance(m_hitGroupList.begin(), iterFind));
-	}
-	return INVALID_INDEX_INT;
+	return m_hitGroupList.GetIndex(hitShaderGroup->GetUID());
 }
 
 RtHitShaderGroup* RayHitGroupContainer::GetHitGroup(int index)
 {
-	if (index < m_hitGroupList.size())
+	if (index < 0)
 	{
-		auto pos = m_hitGroupList.begin();
-		std::advance(pos, index);
-		return pos->second;
+		return nullptr;
 	}
-	return nullptr;
+	return m_hitGroupList.GetAt(static_cast<uint32_t>(index));
 }
 
 RayHitGroupContainer::HitGroupKey RayHitGroupContainer::GetKeyFromGroup(RtHitShaderGroup* group)
@@ -2,6 +2,7 @@
 
 #include "SimpleShader.h"
 #include "Singleton.h"
+#include "SlotMap.h"
 
 #include <unordered_map>
 
@@ -29,8 +30,6 @@ protected:
 	SimpleShader* LoadShader(ERTShaderType shaderType, std::string& filePath);
 	void UnloadShader(SimpleShader* shader);
 
-	void RefreshIndexTable();
-
 	ERTShaderGroupType GetShaderGroupType(ERTShaderType shaderType);
 
 private:
@@ -38,7 +37,8 @@ private:
 	//rgen shader + miss shader + hit shaders
 	//ΰ ǾѴ.
 	std::map<std::string, UID> m_keyTable;
-	std::unordered_map<ERTShaderGroupType, std::unordered_map<UID, SimpleShader*> > m_shaderDatas;
+	//one dense list per group type, bind index is the position in the list after the lists of the preceding group types
+	TUidSlotMap<SimpleShader> m_shaderDatas[SHADER_GROUP_TYPE_END];
 };
 
 #define gShaderContainer ShaderContainer::Instance()
@@ -48,7 +48,7 @@ class RayHitGroupContainer : public TSingleton<RayHitGroupContainer>
 public:
 	RayHitGroupContainer(token) 
 	{
-		m_hitGroupList.reserve(RESOURCE_CONTAINER_INITIAL_SIZE);
+		m_hitGroupList.Reserve(RESOURCE_CONTAINER_INITIAL_SIZE);
 	};
 
 private:
@@ -81,7 +81,7 @@ public:
 
 	int GetBindIndex(RtHitShaderGroup* hitShaderGroup);
 
-	uint32_t GetHitGroupCount() { return static_cast<int>(m_hitGroupList.size()); }
+	uint32_t GetHitGroupCount() { return m_hitGroupList.GetCount(); }
 	RtHitShaderGroup* GetHitGroup(int index);
 
 protected:
@@ -90,7 +90,7 @@ protected:
 private:
 
 	std::map<HitGroupKey, UID> m_keyTable;
-	std::unordered_map<UID, RtHitShaderGroup*> m_hitGroupList;
+	TUidSlotMap<RtHitShaderGroup> m_hitGroupList;
 };
 
 #define gHitGroupContainer RayHitGroupContainer::Instance()
\ No newline at end of file
@@ -1,5 +1,7 @@
 #include "SimpleGeometry.h"
 #include "GeometryContainer.h"
+#include "AssetLoader.h"
+#include "MeshCache.h"
 
 void SimpleGeometry::Destroy()
 {
@@ -17,12 +19,32 @@ SimpleMeshData* SimpleGeometry::GetMesh(uint32_t index)
 
 bool SimpleGeometry::Load(std::string& fbxFilePath)
 {
-	std::vector<FbxGeometryData> geomDatas;
-	gFbxGeomLoader.Load(fbxFilePath, geomDatas);
+	//the fbx is parsed only when its cooked meshes are missing or stale
+	if (!m_meshCache.Open(fbxFilePath))
+	{
+		//parsed by the asset loader if the file was requested before, it cooks the cache too when it can
+		std::vector<FbxGeometryData> geomDatas;
+		if (!gAssetLoader.TakeMesh(fbxFilePath, geomDatas) || geomDatas.empty())
+		{
+			gFbxGeomLoader.Load(fbxFilePath, geomDatas);
+		}
 
-	for (auto& cur : geomDatas)
+		if (!MeshCache::Write(fbxFilePath, geomDatas) || !m_meshCache.Open(fbxFilePath))
+		{
+			REPORT(EReportType::REPORT_TYPE_WARN, "Mesh cache write failed, the fbx is parsed again on the next load.");
+			for (auto& cur : geomDatas)
+			{
+				SimpleMeshData* meshData = gGeomContainer.LoadMesh(cur);
+				meshData->m_parentGeometry = this;
+				m_meshList.push_back(meshData);
+			}
+		}
+	}
+
+	for (uint32_t i = 0; i < m_meshCache.GetMeshCount(); i++)
 	{
-		SimpleMeshData* meshData = gGeomContainer.LoadMesh(cur);
+		SimpleMeshData* meshData = gGeomContainer.LoadMesh(m_meshCache, i);
+		meshData->m_parentGeometry = this;
 		m_meshList.push_back(meshData);
 	}
 	m_srcFilePath = fbxFilePath;
@@ -38,45 +60,97 @@ void SimpleGeometry::Unload()
 		gGeomContainer.UnloadMesh(cur);
 	}
 	m_meshList.clear();
+	m_meshCache.Close();
 }
 
 bool SimpleMeshData::Load(FbxGeometryData& geometryData)
 {
-	std::vector<DefaultVertex> verts(geometryData.m_positions.size());
-	std::vector<uint32_t> indices(geometryData.m_indices);
-	
+	std::vector<DefaultVertex> verts;
+	BuildVertices(geometryData, verts, m_boundsMin, m_boundsMax);
+
+	uint32_t vertexCount = static_cast<uint32_t>(geometryData.m_positions.size());
+	uint32_t indexCount = static_cast<uint32_t>(geometryData.m_indices.size());
+	m_contentHash = ComputeContentHash(geometryData.m_positions.data(), vertexCount, geometryData.m_indices.data(), indexCount);
+
+	m_hostPositions = geometryData.m_positions;
+	m_hostIndices = geometryData.m_indices;
+	m_hostVertices = verts;
+
+	if (!m_vertexBuffer.Initialzie(verts.data(), vertexCount))
+	{
+		return false;
+	}
+
+	if (!m_indexBuffer.Initialzie(geometryData.m_indices.data(), indexCount))
+	{
+		return false;
+	}
+
+	return true;
+}
+
+bool SimpleMeshData::Load(MeshCache& meshCache, uint32_t meshIndex)
+{
+	const MeshCacheFileMesh& mesh = meshCache.GetMesh(meshIndex);
+	m_boundsMin = glm::vec3(mesh.BoundsMin[0], mesh.BoundsMin[1], mesh.BoundsMin[2]);
+	m_boundsMax = glm::vec3(mesh.BoundsMax[0], mesh.BoundsMax[1], mesh.BoundsMax[2]);
+	m_contentHash = mesh.ContentHash;
+	m_meshCache = &meshCache;
+	m_meshCacheIndex = meshIndex;
+
+	const DefaultVertex* verts = meshCache.GetVertices(meshIndex);
+	const uint32_t* indices = meshCache.GetIndices(meshIndex);
+
+	if (!m_vertexBuffer.Initialzie(verts, mesh.VertexCount))
+	{
+		return false;
+	}
+
+	if (!m_indexBuffer.Initialzie(indices, mesh.IndexCount))
+	{
+		return false;
+	}
+
+	return true;
+}
+
+void SimpleMeshData::BuildVertices(FbxGeometryData& geometryData, std::vector<DefaultVertex>& outVerts, glm::vec3& outBoundsMin, glm::vec3& outBoundsMax)
+{
+	outVerts.resize(geometryData.m_positions.size());
+	if (geometryData.m_positions.size() != 0)
+	{
+		outBoundsMin = geometryData.m_positions[0];
+		outBoundsMax = geometryData.m_positions[0];
+	}
+
 	for (int i = 0; i < geometryData.m_positions.size(); i++)
 	{
-		verts[i].m_position = glm::vec4(geometryData.m_positions[i], 1.0f);
+		outVerts[i].m_position = glm::vec4(geometryData.m_positions[i], 1.0f);
+		outBoundsMin = glm::min(outBoundsMin, geometryData.m_positions[i]);
+		outBoundsMax = glm::max(outBoundsMax, geometryData.m_positions[i]);
 		if (geometryData.m_normals.size() != 0)
 		{
-			verts[i].m_normal = glm::vec4(geometryData.m_normals[i], 0.0f);
+			outVerts[i].m_normal = glm::vec4(geometryData.m_normals[i], 0.0f);
 		}
 		if (geometryData.m_tangents.size() != 0)
 		{
-			verts[i].m_tangent = glm::vec4(geometryData.m_tangents[i], 0.0f);
+			outVerts[i].m_tangent = glm::vec4(geometryData.m_tangents[i], 0.0f);
 		}
 		if (geometryData.m_color.size() != 0)
 		{
-			verts[i].m_color = geometryData.m_color[i];
+			outVerts[i].m_color = geometryData.m_color[i];
 		}
 		if (geometryData.m_uv.size() != 0)
 		{
-			verts[i].m_texcoord = glm::vec4(geometryData.m_uv[i], 0.0f, 0.0f);
+			outVerts[i].m_texcoord = glm::vec4(geometryData.m_uv[i], 0.0f, 0.0f);
 		}
 	}
+}
 
-	if (!m_vertexBuffer.Initialzie(verts))
-	{
-		return false;
-	}
-
-	if (!m_indexBuffer.Initialzie(indices))
-	{
-		return false;
-	}
-
-	return true;
+uint64_t SimpleMeshData::ComputeContentHash(const glm::vec3* positions, uint32_t vertexCount, const uint32_t* indices, uint32_t indexCount)
+{
+	uint64_t contentHash = HashBytes(positions, vertexCount * sizeof(glm::vec3));
+	return HashBytes(indices, indexCount * sizeof(uint32_t), contentHash);
 }
 
 void SimpleMeshData::Unload()
@@ -85,6 +159,40 @@ void SimpleMeshData::Unload()
 
 	m_vertexBuffer.Destroy();
 	m_indexBuffer.Destroy();
+	m_hostPositions.clear();
+	m_hostIndices.clear();
+	m_hostVertices.clear();
+	m_meshCache = nullptr;
+}
+
+std::vector<glm::vec3>& SimpleMeshData::GetHostPositions()
+{
+	if (m_hostPositions.empty() && m_meshCache != nullptr && m_meshCache->IsOpened())
+	{
+		const glm::vec3* positions = m_meshCache->GetPositions(m_meshCacheIndex);
+		m_hostPositions.assign(positions, positions + m_meshCache->GetMesh(m_meshCacheIndex).VertexCount);
+	}
+	return m_hostPositions;
+}
+
+std::vector<uint32_t>& SimpleMeshData::GetHostIndices()
+{
+	if (m_hostIndices.empty() && m_meshCache != nullptr && m_meshCache->IsOpened())
+	{
+		const uint32_t* indices = m_meshCache->GetIndices(m_meshCacheIndex);
+		m_hostIndices.assign(indices, indices + m_meshCache->GetMesh(m_meshCacheIndex).IndexCount);
+	}
+	return m_hostIndices;
+}
+
+std::vector<DefaultVertex>& SimpleMeshData::GetHostVertices()
+{
+	if (m_hostVertices.empty() && m_meshCache != nullptr && m_meshCache->IsOpened())
+	{
+		const DefaultVertex* verts = m_meshCache->GetVertices(m_meshCacheIndex);
+		m_hostVertices.assign(verts, verts + m_meshCache->GetMesh(m_meshCacheIndex).VertexCount);
+	}
+	return m_hostVertices;
 }
 
 void SimpleMeshData::OnUpdated()
@@ -94,7 +202,7 @@ void SimpleMeshData::OnUpdated()
 		int index = gGeomContainer.GetMeshBindIndex(this);
 		if (index != -1)
 		{
-			OnMeshUpdated.Exec(static_cast<uint32_t>(index));
+			OnMeshUpdated(static_cast<uint32_t>(index));
 		}
 	}
 }
\ No newline at end of file
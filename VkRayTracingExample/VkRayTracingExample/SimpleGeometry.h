@@ -3,26 +3,81 @@
 #include <functional>
 
 #include "DeviceBuffers.h"
+#include "MeshCache.h"
+#include "Delegate.h"
 #include "Singleton.h"
 
+//selects the acceleration structure build flags of a mesh
+enum class EAsBuildProfile
+{
+	STATIC,		//fast trace with compaction, no update
+	DYNAMIC,	//fast build, refitted on update
+	DEFORMING,	//fast trace, refitted on update and rebuilt periodically
+};
+
+class SimpleGeometry;
+
 class SimpleMeshData : public UniqueIdentifier
 {
 	friend class GeometryContainer;
+	friend class SimpleGeometry;
 public:
 	AsVertexBuffer* GetVertexBuffer() { return &m_vertexBuffer; }
 	AsIndexBuffer* GetIndexBuffer() { return &m_indexBuffer; }
 
-protected:
-	bool Load(FbxGeometryData& geometryData);
-	void Unload();
+	//object space bounds of the source positions
+	glm::vec3& GetBoundsMin() { return m_boundsMin; }
+	glm::vec3& GetBoundsMax() { return m_boundsMax; }
+
+	//applied on the next full build of the blas
+	void SetBuildProfile(EAsBuildProfile buildProfile) { m_buildProfile = buildProfile; }
+	EAsBuildProfile GetBuildProfile() { return m_buildProfile; }
+
+	SimpleGeometry* GetParentGeometry() { return m_parentGeometry; }
+
+	//hash of source positions and indices, identifies the blas built from the mesh
+	uint64_t GetContentHash() { return m_contentHash; }
 
+	//host copies of the source positions and indices, read by host acceleration structure builds
+	//meshes loaded from the mesh cache copy them from the mapping on the first call, not thread safe
+	std::vector<glm::vec3>& GetHostPositions();
+	std::vector<uint32_t>& GetHostIndices();
+	//host copy of the uploaded vertices, rest pose of deformations and read by the cpu reference renderer
+	std::vector<DefaultVertex>& GetHostVertices();
+
+	//call after the vertex buffer is rewritten, the blas of the mesh is refitted on the next acceleration structure update
 	void OnUpdated();
 
-	LambdaCommandWithOneParam<std::function<void(uint32_t)>, uint32_t> OnMeshUpdated;
+	//called with the mesh bind index
+	TDelegate<void(uint32_t)> OnMeshUpdated;
+
+	//uploaded vertex layout and object space bounds of a parsed geometry
+	static void BuildVertices(FbxGeometryData& geometryData, std::vector<DefaultVertex>& outVerts, glm::vec3& outBoundsMin, glm::vec3& outBoundsMax);
+	static uint64_t ComputeContentHash(const glm::vec3* positions, uint32_t vertexCount, const uint32_t* indices, uint32_t indexCount);
+
+protected:
+	bool Load(FbxGeometryData& geometryData);
+	//the blobs of the cooked mesh are copied from the mapping to the staging buffers, host copies are made on demand
+	//the mesh cache must stay opened until the mesh is unloaded
+	bool Load(MeshCache& meshCache, uint32_t meshIndex);
+	void Unload();
 
 private:
 	AsVertexBuffer m_vertexBuffer;
 	AsIndexBuffer m_indexBuffer;
+
+	glm::vec3 m_boundsMin = glm::vec3(0.0f);
+	glm::vec3 m_boundsMax = glm::vec3(0.0f);
+
+	EAsBuildProfile m_buildProfile = EAsBuildProfile::STATIC;
+	uint64_t m_contentHash = 0;
+	std::vector<glm::vec3> m_hostPositions;
+	std::vector<uint32_t> m_hostIndices;
+	std::vector<DefaultVertex> m_hostVertices;
+	MeshCache* m_meshCache = nullptr;
+	uint32_t m_meshCacheIndex = 0;
+
+	SimpleGeometry* m_parentGeometry = nullptr;
 };
 
 class SimpleGeometry : public RefCounter, public UniqueIdentifier
@@ -37,6 +92,10 @@ public:
 	uint32_t GetMeshCount() { return static_cast<uint32_t>(m_meshList.size()); }
 	SimpleMeshData* GetMesh(uint32_t index);
 
+	//every mesh becomes one geometry of a single blas, applied when the blas of the meshes are created
+	void SetMergeMeshes(bool mergeMeshes) { m_mergeMeshes = mergeMeshes; }
+	bool IsMergeMeshes() { return m_mergeMeshes; }
+
 protected:
 	bool Load(std::string& fbxFilePath);
 	void Unload();
@@ -44,5 +103,8 @@ protected:
 private:
 
 	std::vector<SimpleMeshData*> m_meshList = {};
+	//kept mapped while the meshes are loaded, they read their host copies from it
+	MeshCache m_meshCache;
 	std::string m_srcFilePath = "";
+	bool m_mergeMeshes = false;
 };
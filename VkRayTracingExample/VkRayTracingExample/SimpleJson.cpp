@@ -0,0 +1,322 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "SimpleJson.h"
+
+class SimpleJsonParser
+{
+public:
+	SimpleJsonParser(const std::string& text) : m_text(text) {}
+
+public:
+	bool ParseDocument(SimpleJsonValue& outValue, std::string& outError)
+	{
+		bool res = ParseValue(outValue, 0);
+		SkipSpaces();
+		if (res && m_cursor != m_text.size())
+		{
+			res = SetError("Unexpected character after the document");
+		}
+		if (!res)
+		{
+			uint32_t line = 1;
+			for (size_t i = 0; i < m_errorCursor && i < m_text.size(); i++)
+			{
+				line += m_text[i] == '\n' ? 1 : 0;
+			}
+			outError = m_error + " at line " + std::to_string(line) + ".";
+		}
+		return res;
+	}
+
+protected:
+	bool SetError(const char* error)
+	{
+		if (m_error.empty())
+		{
+			m_error = error;
+			m_errorCursor = m_cursor;
+		}
+		return false;
+	}
+
+	void SkipSpaces()
+	{
+		while (m_cursor < m_text.size())
+		{
+			char cur = m_text[m_cursor];
+			if (cur == ' ' || cur == '\t' || cur == '\r' || cur == '\n')
+			{
+				m_cursor++;
+			}
+			//line comments are allowed in authoring files
+			else if (cur == '/' && m_cursor + 1 < m_text.size() && m_text[m_cursor + 1] == '/')
+			{
+				while (m_cursor < m_text.size() && m_text[m_cursor] != '\n')
+				{
+					m_cursor++;
+				}
+			}
+			else
+			{
+				break;
+			}
+		}
+	}
+
+	bool ConsumeLiteral(const char* literal)
+	{
+		size_t length = strlen(literal);
+		if (m_text.compare(m_cursor, length, literal) != 0)
+		{
+			return SetError("Unknown literal");
+		}
+		m_cursor += length;
+		return true;
+	}
+
+	bool ParseValue(SimpleJsonValue& outValue, uint32_t depth)
+	{
+		if (depth > MAX_DEPTH)
+		{
+			return SetError("Too deep nesting");
+		}
+
+		SkipSpaces();
+		if (m_cursor >= m_text.size())
+		{
+			return SetError("Unexpected end of the document");
+		}
+
+		char cur = m_text[m_cursor];
+		switch (cur)
+		{
+			case '{':
+				return ParseObject(outValue, depth);
+			case '[':
+				return ParseArray(outValue, depth);
+			case '"':
+				outValue.m_type = EJsonValueType::JSON_STRING;
+				return ParseString(outValue.m_string);
+			case 't':
+				outValue.m_type = EJsonValueType::JSON_BOOL;
+				outValue.m_bool = true;
+				return ConsumeLiteral("true");
+			case 'f':
+				outValue.m_type = EJsonValueType::JSON_BOOL;
+				outValue.m_bool = false;
+				return ConsumeLiteral("false");
+			case 'n':
+				outValue.m_type = EJsonValueType::JSON_NULL;
+				return ConsumeLiteral("null");
+			default:
+				return ParseNumber(outValue);
+		}
+	}
+
+	bool ParseObject(SimpleJsonValue& outValue, uint32_t depth)
+	{
+		outValue.m_type = EJsonValueType::JSON_OBJECT;
+		m_cursor++;
+		SkipSpaces();
+		if (m_cursor < m_text.size() && m_text[m_cursor] == '}')
+		{
+			m_cursor++;
+			return true;
+		}
+
+		while (true)
+		{
+			SkipSpaces();
+			if (m_cursor >= m_text.size() || m_text[m_cursor] != '"')
+			{
+				return SetError("Object key expected");
+			}
+			outValue.m_members.push_back(std::make_pair(std::string(), SimpleJsonValue()));
+			std::pair<std::string, SimpleJsonValue>& member = outValue.m_members.back();
+			if (!ParseString(member.first))
+			{
+				return false;
+			}
+			SkipSpaces();
+			if (m_cursor >= m_text.size() || m_text[m_cursor] != ':')
+			{
+				return SetError("':' expected");
+			}
+			m_cursor++;
+			if (!ParseValue(member.second, depth + 1))
+			{
+				return false;
+			}
+
+			SkipSpaces();
+			if (m_cursor < m_text.size() && m_text[m_cursor] == ',')
+			{
+				m_cursor++;
+				continue;
+			}
+			if (m_cursor < m_text.size() && m_text[m_cursor] == '}')
+			{
+				m_cursor++;
+				return true;
+			}
+			return SetError("',' or '}' expected");
+		}
+	}
+
+	bool ParseArray(SimpleJsonValue& outValue, uint32_t depth)
+	{
+		outValue.m_type = EJsonValueType::JSON_ARRAY;
+		m_cursor++;
+		SkipSpaces();
+		if (m_cursor < m_text.size() && m_text[m_cursor] == ']')
+		{
+			m_cursor++;
+			return true;
+		}
+
+		while (true)
+		{
+			outValue.m_elements.push_back(SimpleJsonValue());
+			if (!ParseValue(outValue.m_elements.back(), depth + 1))
+			{
+				return false;
+			}
+
+			SkipSpaces();
+			if (m_cursor < m_text.size() && m_text[m_cursor] == ',')
+			{
+				m_cursor++;
+				continue;
+			}
+			if (m_cursor < m_text.size() && m_text[m_cursor] == ']')
+			{
+				m_cursor++;
+				return true;
+			}
+			return SetError("',' or ']' expected");
+		}
+	}
+
+	bool ParseString(std::string& outString)
+	{
+		//opening quote
+		m_cursor++;
+		outString.clear();
+		while (m_cursor < m_text.size())
+		{
+			char cur = m_text[m_cursor++];
+			if (cur == '"')
+			{
+				return true;
+			}
+			if (cur != '\\')
+			{
+				outString.push_back(cur);
+				continue;
+			}
+
+			if (m_cursor >= m_text.size())
+			{
+				break;
+			}
+			char escaped = m_text[m_cursor++];
+			switch (escaped)
+			{
+				case '"':	outString.push_back('"');	break;
+				case '\\':	outString.push_back('\\');	break;
+				case '/':	outString.push_back('/');	break;
+				case 'b':	outString.push_back('\b');	break;
+				case 'f':	outString.push_back('\f');	break;
+				case 'n':	outString.push_back('\n');	break;
+				case 'r':	outString.push_back('\r');	break;
+				case 't':	outString.push_back('\t');	break;
+				case 'u':
+				{
+					//paths and names are expected, code points are written as utf-8 without surrogate pairs
+					if (m_cursor + 4 > m_text.size())
+					{
+						return SetError("Invalid unicode escape");
+					}
+					uint32_t codePoint = static_cast<uint32_t>(strtoul(m_text.substr(m_cursor, 4).c_str(), nullptr, 16));
+					m_cursor += 4;
+					if (codePoint < 0x80)
+					{
+						outString.push_back(static_cast<char>(codePoint));
+					}
+					else if (codePoint < 0x800)
+					{
+						outString.push_back(static_cast<char>(0xC0 | (codePoint >> 6)));
+						outString.push_back(static_cast<char>(0x80 | (codePoint & 0x3F)));
+					}
+					else
+					{
+						outString.push_back(static_cast<char>(0xE0 | (codePoint >> 12)));
+						outString.push_back(static_cast<char>(0x80 | ((codePoint >> 6) & 0x3F)));
+						outString.push_back(static_cast<char>(0x80 | (codePoint & 0x3F)));
+					}
+					break;
+				}
+				default:
+					return SetError("Invalid escape");
+			}
+		}
+		return SetError("Unterminated string");
+	}
+
+	bool ParseNumber(SimpleJsonValue& outValue)
+	{
+		const char* begin = m_text.c_str() + m_cursor;
+		char* end = nullptr;
+		double number = strtod(begin, &end);
+		if (end == begin)
+		{
+			return SetError("Unexpected character");
+		}
+		outValue.m_type = EJsonValueType::JSON_NUMBER;
+		outValue.m_number = number;
+		m_cursor += static_cast<size_t>(end - begin);
+		return true;
+	}
+
+private:
+	static const uint32_t MAX_DEPTH = 64;
+
+	const std::string& m_text;
+	size_t m_cursor = 0;
+	size_t m_errorCursor = 0;
+	std::string m_error = "";
+};
+
+bool SimpleJsonValue::GetBool(bool defaultValue) const
+{
+	return m_type == EJsonValueType::JSON_BOOL ? m_bool : defaultValue;
+}
+
+double SimpleJsonValue::GetNumber(double defaultValue) const
+{
+	return m_type == EJsonValueType::JSON_NUMBER ? m_number : defaultValue;
+}
+
+const SimpleJsonValue* SimpleJsonValue::Find(const char* key) const
+{
+	if (m_type != EJsonValueType::JSON_OBJECT)
+	{
+		return nullptr;
+	}
+	for (auto& cur : m_members)
+	{
+		if (cur.first == key)
+		{
+			return &cur.second;
+		}
+	}
+	return nullptr;
+}
+
+bool SimpleJsonValue::Parse(const std::string& text, SimpleJsonValue& outValue, std::string& outError)
+{
+	outValue = SimpleJsonValue();
+	SimpleJsonParser parser(text);
+	return parser.ParseDocument(outValue, outError);
+}
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <utility>
+#include <stdint.h>
+
+enum class EJsonValueType
+{
+	JSON_NULL,
+	JSON_BOOL,
+	JSON_NUMBER,
+	JSON_STRING,
+	JSON_ARRAY,
+	JSON_OBJECT,
+};
+
+//parsed json document, only used for authoring files so it favors simplicity over speed
+class SimpleJsonValue
+{
+public:
+	EJsonValueType GetType() const { return m_type; }
+	bool IsNull() const { return m_type == EJsonValueType::JSON_NULL; }
+	bool IsNumber() const { return m_type == EJsonValueType::JSON_NUMBER; }
+	bool IsString() const { return m_type == EJsonValueType::JSON_STRING; }
+	bool IsArray() const { return m_type == EJsonValueType::JSON_ARRAY; }
+	bool IsObject() const { return m_type == EJsonValueType::JSON_OBJECT; }
+
+	//return defaultValue if the type does not match
+	bool GetBool(bool defaultValue = false) const;
+	double GetNumber(double defaultValue = 0.0) const;
+	const std::string& GetString() const { return m_string; }
+
+	uint32_t GetCount() const { return static_cast<uint32_t>(m_type == EJsonValueType::JSON_OBJECT ? m_members.size() : m_elements.size()); }
+	const SimpleJsonValue& GetAt(uint32_t index) const { return m_elements[index]; }
+	//nullptr if this is not an object or the key is not found
+	const SimpleJsonValue* Find(const char* key) const;
+
+	//text is parsed as a whole, outError has the line of the first error
+	static bool Parse(const std::string& text, SimpleJsonValue& outValue, std::string& outError);
+
+protected:
+	friend class SimpleJsonParser;
+
+	EJsonValueType m_type = EJsonValueType::JSON_NULL;
+	bool m_bool = false;
+	double m_number = 0.0;
+	std::string m_string = "";
+	std::vector<SimpleJsonValue> m_elements;
+	std::vector<std::pair<std::string, SimpleJsonValue>> m_members;
+};
@@ -61,5 +61,7 @@ public:
 	float m_uvScale = 1.0f;
 	
 	ExampleMaterialType m_materialType = ExampleMaterialType::EXAMPLE_MAT_TYPE_INVALID;
+	//set for materials created from a desc, EXAMPLE_MAT_TYPE_INVALID type
+	std::string m_name = "";
 	RtHitShaderGroup* m_hitShaderGroup;
 };
\ No newline at end of file
@@ -37,23 +37,32 @@ SimpleMaterial* SampleRenderObjectInstancePerMesh::GetMaterial()
 	return m_material;
 }
 
-void SampleRenderObjectInstancePerMesh::OnMeshUpdate()
+void SampleRenderObjectInstancePerMesh::OnMeshUpdate(VkCommandBuffer commandBuffer)
 {
-	OnMeshUpdated.Exec();
+	OnMeshUpdated.Exec(commandBuffer);
 }
 
 void SampleRenderObjectInstance::Initialzie(glm::mat4 worldMat)
 {
-	m_worldMatrix = worldMat;
+	m_transformSlot = gRenderObjContainer.GetTransformStore().Allocate(worldMat);
 }
 
 void SampleRenderObjectInstance::Destroy()
 {
 	OnInstanceUpdated.Clear();
+	if (m_sceneNode != INVALID_SCENE_NODE)
+	{
+		gRenderObjContainer.GetSceneGraph().DetachInstance(m_sceneNode);
+	}
 	for (auto& cur : m_instancePerMesh)
 	{
 		gRenderObjContainer.RemoveRenderObjectInstancePerMesh(cur);
 	}
+	if (m_transformSlot != INVALID_SLOT_INDEX)
+	{
+		gRenderObjContainer.GetTransformStore().Free(m_transformSlot);
+		m_transformSlot = INVALID_SLOT_INDEX;
+	}
 }
 
 void SampleRenderObjectInstance::CreateInstancePerMesh(SimpleMeshData* meshData, SimpleMaterial* material)
@@ -63,8 +72,8 @@ void SampleRenderObjectInstance::CreateInstancePerMesh(SimpleMeshData* meshData,
 
 void SampleRenderObjectInstance::SetWorldMatrix(glm::mat4& matWorld, bool isUpdate) 
 {
-	m_worldMatrix = matWorld;
-	if (isUpdate)
+	gRenderObjContainer.GetTransformStore().SetTransform(m_transformSlot, matWorld, isUpdate);
+	if (isUpdate && OnInstanceUpdated.GetCommandCount() > 0)
 	{
 		for (auto& cur : m_instancePerMesh)
 		{
@@ -73,10 +82,15 @@ void SampleRenderObjectInstance::SetWorldMatrix(glm::mat4& matWorld, bool isUpda
 			{
 				OnInstanceUpdated.Exec(index);
 			}
-		}	
+		}
 	}
 }
 
+glm::mat4 SampleRenderObjectInstance::GetWorldMatrix()
+{
+	return gRenderObjContainer.GetTransformStore().GetTransform(m_transformSlot);
+}
+
 void SampleRenderObjectInstance::SetOverrideMaterial(ExampleMaterialType type)
 {
 	for (auto& cur : m_instancePerMesh)
@@ -110,12 +124,32 @@ void SimpleRenderObject::Initialize(std::string fbxFilePath, ExampleMaterialType
 	m_material = gMaterialContainer.CreateMaterial(exampleMaterialType);
 }
 
+void SimpleRenderObject::Initialize(std::string fbxFilePath, SimpleMaterial* material)
+{
+	if (m_geometry != nullptr)
+	{
+		m_geometry->Destroy();
+		m_geometry = nullptr;
+	}
+	m_geometry = gGeomContainer.CreateGeometry(fbxFilePath);
+
+	if (m_material != nullptr && m_material != material)
+	{
+		gMaterialContainer.RemoveMaterial(m_material);
+	}
+	m_material = material;
+}
+
 void SimpleRenderObject::Destroy()
 {
+	gRenderObjContainer.BeginBatch();
 	for (auto& curInstance : m_instances)
 	{
 		gRenderObjContainer.RemoveRenderObjectInstance(curInstance);
 	}
+	gRenderObjContainer.EndBatch();
+	m_instances.clear();
+	m_indexTable.clear();
 	if (m_geometry != nullptr)
 	{
 		m_geometry->Destroy();
@@ -129,34 +163,138 @@ void SimpleRenderObject::Destroy()
 	
 SampleRenderObjectInstance* SimpleRenderObject::CreateInstance(glm::mat4 matWorld)
 {
-	SampleRenderObjectInstance* inst = nullptr;
+	std::vector<SampleRenderObjectInstance*> instances;
+	CreateInstances(&matWorld, nullptr, 1, &instances);
+	return instances.empty() ? nullptr : instances[0];
+}
+
+void SimpleRenderObject::RemoveInstance(SampleRenderObjectInstance* subMeshInstance)
+{
+	RemoveInstances(&subMeshInstance, 1);
+}
+
+void SimpleRenderObject::CreateInstances(const glm::mat4* worldMats, const ExampleMaterialType* materialTypes, uint32_t count, std::vector<SampleRenderObjectInstance*>* outInstances)
+{
+	if (materialTypes == nullptr)
+	{
+		CreateInstances(worldMats, static_cast<SimpleMaterial* const*>(nullptr), count, outInstances);
+		return;
+	}
+
+	//materials are shared by type, runs of the same type are resolved once
+	std::vector<SimpleMaterial*> materials(count, nullptr);
+	ExampleMaterialType lastMaterialType = ExampleMaterialType::EXAMPLE_MAT_TYPE_INVALID;
+	for (uint32_t i = 0; i < count; i++)
+	{
+		if (materialTypes[i] != lastMaterialType)
+		{
+			lastMaterialType = materialTypes[i];
+			materials[i] = lastMaterialType == ExampleMaterialType::EXAMPLE_MAT_TYPE_INVALID ? nullptr : gMaterialContainer.CreateMaterial(lastMaterialType);
+		}
+		else if (i > 0)
+		{
+			materials[i] = materials[i - 1];
+		}
+	}
+	CreateInstances(worldMats, materials.data(), count, outInstances);
+}
+
+void SimpleRenderObject::CreateInstances(const glm::mat4* worldMats, SimpleMaterial* const* materials, uint32_t count, std::vector<SampleRenderObjectInstance*>* outInstances)
+{
+	if (m_geometry == nullptr || m_material == nullptr || count == 0)
+	{
+		return;
+	}
+
+	std::vector<SimpleMeshData*> meshDatas;
+	for (uint32_t i = 0; i < m_geometry->GetMeshCount(); i++)
+	{
+		SimpleMeshData* meshData = m_geometry->GetMesh(i);
+		if (meshData != nullptr)
+		{
+			meshDatas.push_back(meshData);
+		}
+	}
+
+	gRenderObjContainer.ReserveRenderObjectInstances(count, count * static_cast<uint32_t>(meshDatas.size()));
+	ReserveInstances(count);
+	if (outInstances != nullptr)
+	{
+		outInstances->reserve(outInstances->size() + count);
+	}
 
-	if (m_geometry != nullptr && m_material != nullptr)
+	gRenderObjContainer.BeginBatch();
+	for (uint32_t i = 0; i < count; i++)
 	{
-		inst = gRenderObjContainer.CreateRenderObjectInstance(matWorld);
+		SimpleMaterial* material = materials != nullptr && materials[i] != nullptr ? materials[i] : m_material;
+		SampleRenderObjectInstance* inst = gRenderObjContainer.CreateRenderObjectInstance(worldMats[i]);
+		m_indexTable.insert(std::make_pair(inst->GetUID(), static_cast<uint32_t>(m_instances.size())));
 		m_instances.push_back(inst);
-		m_indexTable.insert(std::make_pair(inst->GetUID(), static_cast<uint32_t>(m_instances.size()) - 1));
-		int instancePerMeshIndex = -1;
-		for (uint32_t i = 0; i < m_geometry->GetMeshCount(); i++)
+		for (auto meshData : meshDatas)
 		{
-			SimpleMeshData* meshData = m_geometry->GetMesh(i);
-			if (meshData != nullptr)
-			{
-				inst->CreateInstancePerMesh(meshData, m_material);
-			}
+			inst->CreateInstancePerMesh(meshData, material);
+		}
+		if (outInstances != nullptr)
+		{
+			outInstances->push_back(inst);
 		}
 	}
-	return inst;
+	gRenderObjContainer.EndBatch();
 }
 
-void SimpleRenderObject::RemoveInstance(SampleRenderObjectInstance* subMeshInstance)
+void SimpleRenderObject::ReserveInstances(uint32_t count)
 {
-	auto iterFind = m_indexTable.find(subMeshInstance->GetUID());
-	if (iterFind != m_indexTable.end())
+	m_instances.reserve(m_instances.size() + count);
+	m_indexTable.reserve(m_instances.size() + count);
+}
+
+void SimpleRenderObject::RemoveInstances(SampleRenderObjectInstance* const* instances, uint32_t count)
+{
+	gRenderObjContainer.BeginBatch();
+	for (uint32_t i = 0; i < count; i++)
 	{
+		SampleRenderObjectInstance* inst = instances[i];
+		auto iterFind = m_indexTable.find(inst->GetUID());
+		if (iterFind == m_indexTable.end())
+		{
+			continue;
+		}
+
+		//last instance takes the place of the removed one
 		uint32_t index = iterFind->second;
 		m_indexTable.erase(iterFind);
-		m_instances.erase(m_instances.begin() + index);
+		if (index + 1 < m_instances.size())
+		{
+			m_instances[index] = m_instances.back();
+			m_indexTable[m_instances[index]->GetUID()] = index;
+		}
+		m_instances.pop_back();
+		gRenderObjContainer.RemoveRenderObjectInstance(inst);
+	}
+	gRenderObjContainer.EndBatch();
+}
+
+void SimpleRenderObject::SetBuildProfile(EAsBuildProfile buildProfile)
+{
+	if (m_geometry == nullptr)
+	{
+		return;
+	}
+
+	for (uint32_t i = 0; i < m_geometry->GetMeshCount(); i++)
+	{
+		SimpleMeshData* meshData = m_geometry->GetMesh(i);
+		if (meshData != nullptr)
+		{
+			meshData->SetBuildProfile(buildProfile);
+		}
+	}
+}
+
+void SimpleRenderObject::SetMergeMeshes(bool mergeMeshes)
+{
+	if (m_geometry != nullptr)
+	{
+		m_geometry->SetMergeMeshes(mergeMeshes);
 	}
-	gRenderObjContainer.RemoveRenderObjectInstance(subMeshInstance);
 }
\ No newline at end of file
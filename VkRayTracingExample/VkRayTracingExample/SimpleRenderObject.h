@@ -2,6 +2,7 @@
 
 #include "GeometryContainer.h"
 #include "MaterialContainer.h"
+#include "SceneGraph.h"
 #include "Utils.h"
 class SampleRenderObjectInstance;
 
@@ -17,9 +18,9 @@ public:
 	SimpleMaterial* GetMaterial();
 	SampleRenderObjectInstance* GetParentInstance() { return m_parentInstance; }
 
-	void OnMeshUpdate();
+	void OnMeshUpdate(VkCommandBuffer commandBuffer);
 
-	LambdaCommandListWithOneParam<std::function<void(VkCommandBuffer)>, VkCommandBuffer> OnMeshUpdated;
+	TDelegateList<void(VkCommandBuffer)> OnMeshUpdated;
 
 protected:
 	void Initialize(SampleRenderObjectInstance* parentInstance,  SimpleMeshData* m_meshData, SimpleMaterial* m_material);
@@ -35,6 +36,7 @@ protected:
 class SampleRenderObjectInstance : public UniqueIdentifier
 {
 friend class RenderObjectContainer;
+friend class SceneGraph;
 public:
 	SampleRenderObjectInstance() : UniqueIdentifier() {}
 public:
@@ -45,17 +47,22 @@ public:
 	SampleRenderObjectInstancePerMesh* GetInstancePerMesh(uint32_t index);
 	void CreateInstancePerMesh(SimpleMeshData* meshData, SimpleMaterial* material);
 
+	//isUpdate marks the transform dirty, it is written to the tlas instances by the next transform pass
 	void SetWorldMatrix(glm::mat4& matWorld, bool isUpdate);
-	glm::mat4& GetWorldMatrix() { return m_worldMatrix; }
+	glm::mat4 GetWorldMatrix();
+	uint32_t GetTransformSlot() { return m_transformSlot; }
+	//node of the scene graph driving the world matrix, INVALID_SCENE_NODE if the instance is placed directly
+	uint32_t GetSceneNode() { return m_sceneNode; }
 
-	LambdaCommandListWithOneParam<std::function<void(uint32_t)>, uint32_t> OnInstanceUpdated;
+	TDelegateList<void(uint32_t)> OnInstanceUpdated;
 
 protected:
 	void Initialzie(glm::mat4 worldMat);
 	void Destroy();
 
 private:
-	glm::mat4 m_worldMatrix = glm::mat4(1.0f);
+	uint32_t m_transformSlot = INVALID_SLOT_INDEX;
+	uint32_t m_sceneNode = INVALID_SCENE_NODE;
 	std::vector<SampleRenderObjectInstancePerMesh*> m_instancePerMesh = {};
 };
 
@@ -67,9 +74,26 @@ public:
 public:
 	SampleRenderObjectInstance* CreateInstance(glm::mat4 matWorld);
 	void RemoveInstance(SampleRenderObjectInstance* subMeshInstance);
+	//worldMats and materialTypes hold count items, materialTypes may be null and EXAMPLE_MAT_TYPE_INVALID uses the material of the object
+	//listeners are notified once for the whole batch
+	void CreateInstances(const glm::mat4* worldMats, const ExampleMaterialType* materialTypes, uint32_t count, std::vector<SampleRenderObjectInstance*>* outInstances = nullptr);
+	//materials may be null and a null material uses the material of the object
+	void CreateInstances(const glm::mat4* worldMats, SimpleMaterial* const* materials, uint32_t count, std::vector<SampleRenderObjectInstance*>* outInstances = nullptr);
+	void RemoveInstances(SampleRenderObjectInstance* const* instances, uint32_t count);
+	void ReserveInstances(uint32_t count);
+	uint32_t GetInstanceCount() { return static_cast<uint32_t>(m_instances.size()); }
+	SampleRenderObjectInstance* GetInstance(uint32_t index) { return index < m_instances.size() ? m_instances[index] : nullptr; }
+
+	//meshes are shared by every render object loaded from the same file
+	void SetBuildProfile(EAsBuildProfile buildProfile);
+	//every instance is traced as one tlas instance of a multi geometry blas
+	void SetMergeMeshes(bool mergeMeshes);
+
+	SimpleGeometry* GetGeometry() { return m_geometry; }
 
 protected:
 	void Initialize(std::string fbxFilePath, ExampleMaterialType exampleMaterialType);
+	void Initialize(std::string fbxFilePath, SimpleMaterial* material);
 	void Destroy();
 
 private:
@@ -78,6 +102,7 @@ private:
 	SimpleMaterial* m_material = nullptr;
 	uint32_t m_materialIndex = 0;
 
-	std::map<UID, uint32_t> m_indexTable = {};
+	//position of each instance in m_instances, instances are swap removed
+	std::unordered_map<UID, uint32_t> m_indexTable = {};
 	std::vector<SampleRenderObjectInstance*> m_instances = {};
 };
\ No newline at end of file
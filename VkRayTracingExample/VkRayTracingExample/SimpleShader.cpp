@@ -1,5 +1,6 @@
 #include "SimpleShader.h"
 #include "ShaderContainer.h"
+#include "AssetLoader.h"
 
 void SimpleShader::Destroy()
 {
@@ -10,30 +11,21 @@ bool SimpleShader::Load(ERTShaderType shaderType, std::string& shaderFilePath)
 {
 	m_shaderType = shaderType;
 	m_srcFilePath = shaderFilePath;
-	std::ifstream shaderFile(shaderFilePath, std::ios::binary);
-	if (shaderFile.is_open())
+
+	//read by the asset loader if the file was requested before
+	std::vector<char> binaryData;
+	if (gAssetLoader.TakeShaderCode(shaderFilePath, binaryData) || AssetLoader::ReadBinaryFile(shaderFilePath, binaryData))
 	{
-		shaderFile.seekg(0, std::ios_base::end);
-		uint32_t shaderFileSize = static_cast<uint32_t>(shaderFile.tellg());
+		VkShaderModuleCreateInfo shaderModuleCreateInfo = {};
+		shaderModuleCreateInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+		shaderModuleCreateInfo.codeSize = binaryData.size();
+		shaderModuleCreateInfo.pCode = reinterpret_cast<std::uint32_t const*>(binaryData.data());
 
-		if (shaderFileSize > 0)
+		VkResult res = vkCreateShaderModule(gLogicalDevice, &shaderModuleCreateInfo, nullptr, &m_shaderModule);
+		if (res == VkResult::VK_SUCCESS)
 		{
-			std::vector<char> binaryData(shaderFileSize);
-			shaderFile.seekg(0, std::ios_base::beg);
-			shaderFile.read(binaryData.data(), shaderFileSize);
-
-			VkShaderModuleCreateInfo shaderModuleCreateInfo = {};
-			shaderModuleCreateInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
-			shaderModuleCreateInfo.codeSize = shaderFileSize;
-			shaderModuleCreateInfo.pCode = reinterpret_cast<std::uint32_t const*>(binaryData.data());
-
-			VkResult res = vkCreateShaderModule(gLogicalDevice, &shaderModuleCreateInfo, nullptr, &m_shaderModule);
-			if (res == VkResult::VK_SUCCESS)
-			{
-				return true;
-			}
+			return true;
 		}
-		shaderFile.close();
 	}
 	return false;
 }
@@ -2,6 +2,7 @@
 #include "SimpleTexture.h"
 #include "VulkanDeviceResources.h"
 #include "CommandBuffers.h"
+#include "AssetLoader.h"
 
 #include <stb_image.h>
 
@@ -14,8 +15,15 @@ bool SimpleTexture2D::Load(const char* filePath)
 {
 	m_srcFilePath = filePath;
 
-	int texChannels = 0;
-	stbi_uc* pixels = stbi_load(filePath, &m_width, &m_height, &texChannels, STBI_rgb_alpha);
+	//decoded by the asset loader if the file was requested before
+	DecodedImage image;
+	if (!gAssetLoader.TakeImage(m_srcFilePath, image))
+	{
+		image.Decode(filePath);
+	}
+	stbi_uc* pixels = image.Pixels;
+	m_width = image.Width;
+	m_height = image.Height;
 	VkDeviceSize imageSize = static_cast<uint32_t>(m_width)
 								* static_cast<uint32_t>(m_height)
 								* 4;
@@ -81,7 +89,7 @@ bool SimpleTexture2D::Load(const char* filePath)
 	memcpy(data, pixels, static_cast<size_t>(imageSize));
 	vkUnmapMemory(gLogicalDevice, stagingBufferMemory);
 
-	stbi_image_free(pixels);
+	image.Release();
 
 	VkImageCreateInfo imageCreateInfo = {};
 	imageCreateInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
@@ -259,11 +267,18 @@ SimpleCubmapTexture::SimpleCubmapTexture()
 
 bool SimpleCubmapTexture::Initialize(std::vector<std::string>& filePath)
 {
-	int texChannels = 0;
+	m_srcFilePaths = filePath;
+	DecodedImage faces[6];
 	stbi_uc* pixelBuffer[6] = {};
 	for (int i = 0; i < filePath.size(); i++)
 	{
-		pixelBuffer[i] = stbi_load(filePath[i].c_str(), &m_width, &m_height, &texChannels, STBI_rgb_alpha);
+		if (!gAssetLoader.TakeImage(filePath[i], faces[i]))
+		{
+			faces[i].Decode(filePath[i].c_str());
+		}
+		pixelBuffer[i] = faces[i].Pixels;
+		m_width = faces[i].Width;
+		m_height = faces[i].Height;
 		if (pixelBuffer[i] == nullptr)
 		{
 			//stb image load зα
@@ -335,7 +350,7 @@ bool SimpleCubmapTexture::Initialize(std::vector<std::string>& filePath)
 
 	for (int i = 0; i < 6; i++)
 	{
-		stbi_image_free(pixelBuffer[i]);
+		faces[i].Release();
 	}
 
 	VkImageCreateInfo imageCreateInfo = {};
@@ -48,6 +48,9 @@ public:
 	VkDeviceMemory& GetMemory() { return m_memory; }
 	VkDescriptorImageInfo& GetImageInfo() { return m_imageInfo; }
 
+	//+x, -x, +y, -y, +z, -z
+	std::vector<std::string>& GetSrcFilePaths() { return m_srcFilePaths; }
+
 protected:
 	VkImage			m_image = VK_NULL_HANDLE;
 	VkDeviceMemory	m_memory = VK_NULL_HANDLE;
@@ -60,6 +63,8 @@ protected:
 
 	int						m_width = 0;
 	int						m_height = 0;
+
+	std::vector<std::string> m_srcFilePaths = {};
 };
 
 class RtTargetImageBuffer
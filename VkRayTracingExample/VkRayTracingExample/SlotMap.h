@@ -0,0 +1,360 @@
+#pragma once
+
+#include <vector>
+#include <unordered_map>
+#include <utility>
+#include <stdint.h>
+
+#include "Utils.h"
+
+#define INVALID_SLOT_INDEX UINT32_MAX
+
+//stable reference to an item of a slot map, a removed item invalidates its handle even if the slot is reused
+struct SlotHandle
+{
+	uint32_t Slot = INVALID_SLOT_INDEX;
+	uint32_t Generation = 0;
+
+	bool operator==(const SlotHandle& right) const { return Slot == right.Slot && Generation == right.Generation; }
+	bool operator!=(const SlotHandle& right) const { return !(*this == right); }
+};
+
+//slot handle stored in a 64 bit handle, generation in the upper half
+inline uint64_t PackSlotHandle(SlotHandle handle)
+{
+	return (static_cast<uint64_t>(handle.Generation) << 32) | handle.Slot;
+}
+
+inline SlotHandle UnpackSlotHandle(uint64_t packedHandle)
+{
+	SlotHandle handle;
+	handle.Slot = static_cast<uint32_t>(packedHandle & UINT32_MAX);
+	handle.Generation = static_cast<uint32_t>(packedHandle >> 32);
+	return handle;
+}
+
+//items are stored contiguously in insertion order and the dense index of an item is its bind index
+//insertion appends so the index of an existing item never changes,
+//removal closes the gap keeping the order of the remaining items like an erase of a vector mirrored by the listeners,
+//swap removal moves the last item into the gap for containers whose listeners remap every index anyway
+template <typename T>
+class TSlotMap
+{
+public:
+	void Reserve(uint32_t count);
+
+	SlotHandle Insert(const T& item);
+	SlotHandle Insert(T&& item);
+	//returns the dense index the item had, INVALID_INDEX_INT for a stale handle
+	int Remove(SlotHandle handle);
+	//O(1), the last item takes the dense index of the removed one
+	int SwapRemove(SlotHandle handle);
+	void Clear();
+
+	bool IsValid(SlotHandle handle) const;
+	uint32_t GetCount() const { return static_cast<uint32_t>(m_items.size()); }
+	bool IsEmpty() const { return m_items.empty(); }
+
+	//O(1) in both directions
+	int GetIndex(SlotHandle handle) const;
+	SlotHandle GetHandle(uint32_t index) const;
+
+	T& GetAt(uint32_t index) { return m_items[index]; }
+	T* Find(SlotHandle handle);
+
+	T* GetData() { return m_items.data(); }
+	typename std::vector<T>::iterator begin() { return m_items.begin(); }
+	typename std::vector<T>::iterator end() { return m_items.end(); }
+
+private:
+	struct Slot
+	{
+		uint32_t DenseIndex = INVALID_SLOT_INDEX;
+		uint32_t Generation = 0;
+	};
+
+	std::vector<T> m_items;
+	//slot of each dense item
+	std::vector<uint32_t> m_itemSlots;
+	std::vector<Slot> m_slots;
+	std::vector<uint32_t> m_freeSlots;
+};
+
+template <typename T>
+void TSlotMap<T>::Reserve(uint32_t count)
+{
+	m_items.reserve(count);
+	m_itemSlots.reserve(count);
+	m_slots.reserve(count);
+}
+
+template <typename T>
+SlotHandle TSlotMap<T>::Insert(const T& item)
+{
+	return Insert(T(item));
+}
+
+template <typename T>
+SlotHandle TSlotMap<T>::Insert(T&& item)
+{
+	uint32_t slotIndex = 0;
+	if (!m_freeSlots.empty())
+	{
+		slotIndex = m_freeSlots.back();
+		m_freeSlots.pop_back();
+	}
+	else
+	{
+		slotIndex = static_cast<uint32_t>(m_slots.size());
+		m_slots.push_back(Slot());
+	}
+
+	Slot& slot = m_slots[slotIndex];
+	slot.DenseIndex = static_cast<uint32_t>(m_items.size());
+	m_items.push_back(std::move(item));
+	m_itemSlots.push_back(slotIndex);
+
+	SlotHandle handle;
+	handle.Slot = slotIndex;
+	handle.Generation = slot.Generation;
+	return handle;
+}
+
+template <typename T>
+int TSlotMap<T>::Remove(SlotHandle handle)
+{
+	if (!IsValid(handle))
+	{
+		return INVALID_INDEX_INT;
+	}
+
+	uint32_t removeIndex = m_slots[handle.Slot].DenseIndex;
+	m_items.erase(m_items.begin() + removeIndex);
+	m_itemSlots.erase(m_itemSlots.begin() + removeIndex);
+
+	//only the items behind the removed one move
+	uint32_t itemCount = static_cast<uint32_t>(m_items.size());
+	for (uint32_t i = removeIndex; i < itemCount; i++)
+	{
+		m_slots[m_itemSlots[i]].DenseIndex = i;
+	}
+
+	Slot& slot = m_slots[handle.Slot];
+	slot.DenseIndex = INVALID_SLOT_INDEX;
+	slot.Generation++;
+	m_freeSlots.push_back(handle.Slot);
+
+	return static_cast<int>(removeIndex);
+}
+
+template <typename T>
+int TSlotMap<T>::SwapRemove(SlotHandle handle)
+{
+	if (!IsValid(handle))
+	{
+		return INVALID_INDEX_INT;
+	}
+
+	uint32_t removeIndex = m_slots[handle.Slot].DenseIndex;
+	uint32_t lastIndex = static_cast<uint32_t>(m_items.size()) - 1;
+	if (removeIndex != lastIndex)
+	{
+		m_items[removeIndex] = std::move(m_items[lastIndex]);
+		m_itemSlots[removeIndex] = m_itemSlots[lastIndex];
+		m_slots[m_itemSlots[removeIndex]].DenseIndex = removeIndex;
+	}
+	m_items.pop_back();
+	m_itemSlots.pop_back();
+
+	Slot& slot = m_slots[handle.Slot];
+	slot.DenseIndex = INVALID_SLOT_INDEX;
+	slot.Generation++;
+	m_freeSlots.push_back(handle.Slot);
+
+	return static_cast<int>(removeIndex);
+}
+
+template <typename T>
+void TSlotMap<T>::Clear()
+{
+	for (uint32_t slotIndex : m_itemSlots)
+	{
+		Slot& slot = m_slots[slotIndex];
+		slot.DenseIndex = INVALID_SLOT_INDEX;
+		slot.Generation++;
+		m_freeSlots.push_back(slotIndex);
+	}
+	m_items.clear();
+	m_itemSlots.clear();
+}
+
+template <typename T>
+bool TSlotMap<T>::IsValid(SlotHandle handle) const
+{
+	return handle.Slot < m_slots.size() &&
+		   m_slots[handle.Slot].Generation == handle.Generation &&
+		   m_slots[handle.Slot].DenseIndex != INVALID_SLOT_INDEX;
+}
+
+template <typename T>
+int TSlotMap<T>::GetIndex(SlotHandle handle) const
+{
+	if (IsValid(handle))
+	{
+		return static_cast<int>(m_slots[handle.Slot].DenseIndex);
+	}
+	return INVALID_INDEX_INT;
+}
+
+template <typename T>
+SlotHandle TSlotMap<T>::GetHandle(uint32_t index) const
+{
+	SlotHandle handle;
+	if (index < m_itemSlots.size())
+	{
+		handle.Slot = m_itemSlots[index];
+		handle.Generation = m_slots[handle.Slot].Generation;
+	}
+	return handle;
+}
+
+template <typename T>
+T* TSlotMap<T>::Find(SlotHandle handle)
+{
+	if (IsValid(handle))
+	{
+		return &m_items[m_slots[handle.Slot].DenseIndex];
+	}
+	return nullptr;
+}
+
+//slot map of resources which are also addressed by their uid
+template <typename T>
+class TUidSlotMap : protected TSlotMap<T*>
+{
+public:
+	using TSlotMap<T*>::IsValid;
+	using TSlotMap<T*>::GetCount;
+	using TSlotMap<T*>::IsEmpty;
+	using TSlotMap<T*>::GetIndex;
+	using TSlotMap<T*>::GetHandle;
+	using TSlotMap<T*>::GetData;
+	using TSlotMap<T*>::begin;
+	using TSlotMap<T*>::end;
+
+	void Reserve(uint32_t count);
+
+	SlotHandle Insert(T* item);
+	//returns the dense index the item had, INVALID_INDEX_INT if the uid is not found
+	int Remove(UID uid);
+	int SwapRemove(UID uid);
+	void Clear();
+
+	bool Contains(UID uid) const { return m_uidHandles.find(uid) != m_uidHandles.end(); }
+	int GetIndex(UID uid) const;
+	SlotHandle GetHandleFromUID(UID uid) const;
+
+	T* GetAt(uint32_t index);
+	T* Find(UID uid);
+	T* Find(SlotHandle handle);
+
+private:
+	std::unordered_map<UID, SlotHandle> m_uidHandles;
+};
+
+template <typename T>
+void TUidSlotMap<T>::Reserve(uint32_t count)
+{
+	TSlotMap<T*>::Reserve(count);
+	m_uidHandles.reserve(count);
+}
+
+template <typename T>
+SlotHandle TUidSlotMap<T>::Insert(T* item)
+{
+	SlotHandle handle = TSlotMap<T*>::Insert(item);
+	m_uidHandles[item->GetUID()] = handle;
+	return handle;
+}
+
+template <typename T>
+int TUidSlotMap<T>::Remove(UID uid)
+{
+	auto iterFind = m_uidHandles.find(uid);
+	if (iterFind == m_uidHandles.end())
+	{
+		return INVALID_INDEX_INT;
+	}
+	SlotHandle handle = iterFind->second;
+	m_uidHandles.erase(iterFind);
+	return TSlotMap<T*>::Remove(handle);
+}
+
+template <typename T>
+int TUidSlotMap<T>::SwapRemove(UID uid)
+{
+	auto iterFind = m_uidHandles.find(uid);
+	if (iterFind == m_uidHandles.end())
+	{
+		return INVALID_INDEX_INT;
+	}
+	SlotHandle handle = iterFind->second;
+	m_uidHandles.erase(iterFind);
+	return TSlotMap<T*>::SwapRemove(handle);
+}
+
+template <typename T>
+void TUidSlotMap<T>::Clear()
+{
+	TSlotMap<T*>::Clear();
+	m_uidHandles.clear();
+}
+
+template <typename T>
+int TUidSlotMap<T>::GetIndex(UID uid) const
+{
+	auto iterFind = m_uidHandles.find(uid);
+	if (iterFind != m_uidHandles.end())
+	{
+		return TSlotMap<T*>::GetIndex(iterFind->second);
+	}
+	return INVALID_INDEX_INT;
+}
+
+template <typename T>
+SlotHandle TUidSlotMap<T>::GetHandleFromUID(UID uid) const
+{
+	auto iterFind = m_uidHandles.find(uid);
+	if (iterFind != m_uidHandles.end())
+	{
+		return iterFind->second;
+	}
+	return SlotHandle();
+}
+
+template <typename T>
+T* TUidSlotMap<T>::GetAt(uint32_t index)
+{
+	if (index < this->GetCount())
+	{
+		return TSlotMap<T*>::GetAt(index);
+	}
+	return nullptr;
+}
+
+template <typename T>
+T* TUidSlotMap<T>::Find(UID uid)
+{
+	return Find(GetHandleFromUID(uid));
+}
+
+template <typename T>
+T* TUidSlotMap<T>::Find(SlotHandle handle)
+{
+	T** item = TSlotMap<T*>::Find(handle);
+	if (item != nullptr)
+	{
+		return *item;
+	}
+	return nullptr;
+}
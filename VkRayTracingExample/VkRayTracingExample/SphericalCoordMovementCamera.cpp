@@ -103,17 +103,13 @@ void SphericalCoordMovementCamera::OnMouseEvent(MouseEvent* mouseEvent)
 			m_phi -= mouseEvent->m_dy * DEFAULT_ROTATION_SENSITIVITY * m_rotSensitivity;
 			m_needUpdateViewMatrix = true;
 		}
-		if (mouseEvent->CheckMouseEvent(EMouseEvent::MOUSE_WHEEL_UP))
+		//merged event carries every notch of the frame, up and down notches cancel out
+		if (mouseEvent->CheckMouseEvent(EMouseEvent::MOUSE_WHEEL_UP) || mouseEvent->CheckMouseEvent(EMouseEvent::MOUSE_WHEEL_DOWN))
 		{
-			m_radaius -= DEFAULT_ZOOM_SENSITIVITY * m_zoomSensitivity;
+			m_radaius -= mouseEvent->m_wheelDelta * DEFAULT_ZOOM_SENSITIVITY * m_zoomSensitivity;
 			m_radaius = max(m_radaius, 0.0f);
 			m_needUpdateViewMatrix = true;
 		}
-		if (mouseEvent->CheckMouseEvent(EMouseEvent::MOUSE_WHEEL_DOWN))
-		{
-			m_radaius += DEFAULT_ZOOM_SENSITIVITY * m_zoomSensitivity;
-			m_needUpdateViewMatrix = true;
-		}
 	}
 }
 
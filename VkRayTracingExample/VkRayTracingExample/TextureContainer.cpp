@@ -7,11 +7,7 @@ SimpleTexture2D* TextureContainer::CreateTexture(const char* filePath)
 	auto iterKeyFinded = m_keyTable.find(strFilePath);
 	if (iterKeyFinded != m_keyTable.end())
 	{
-		auto iterFind = m_textureDatas.find(iterKeyFinded->second);
-		if (iterFind != m_textureDatas.end())
-		{
-			texture = iterFind->second;
-		}
+		texture = m_textureDatas.Find(iterKeyFinded->second);
 	}
 
 	if (texture == nullptr)
@@ -29,33 +25,22 @@ SimpleTexture2D* TextureContainer::CreateTexture(const char* filePath)
 
 int TextureContainer::GetBindIndex(SimpleTexture2D* texture)
 {
-	auto iterFind = m_textureDatas.find(texture->GetUID());
-	if (iterFind != m_textureDatas.end())
-	{
-		return static_cast<int>(std::distance(m_textureDatas.begin(), iterFind));
-	}
-	return INVALID_INDEX_INT;
+	return m_textureDatas.GetIndex(texture->GetUID());
 }
 
 SimpleTexture2D* TextureContainer::GetTexture(uint32_t  index)
 {
-	if (index < m_textureDatas.size())
-	{
-		auto pos = m_textureDatas.begin();
-		std::advance(pos, index);
-		return pos->second;
-	}
-	return nullptr;
+	return m_textureDatas.GetAt(index);
 }
 
 void TextureContainer::RemoveUnusedTextrures()
 {
 	std::vector<SimpleTexture2D*> m_removeList;
-	for (auto& cur : m_textureDatas)
+	for (SimpleTexture2D* cur : m_textureDatas)
 	{
-		if (cur.second->GetRefCount() == 0)
+		if (cur->GetRefCount() == 0)
 		{
-			m_removeList.push_back(cur.second);
+			m_removeList.push_back(cur);
 		}
 	}
 
@@ -74,7 +59,7 @@ SimpleTexture2D* TextureContainer::LoadTexture(const char* filePath)
 		return nullptr;
 	}
 	UID uid = texture->GetUID();
-	m_textureDatas.insert(std::make_pair(uid, texture));
+	m_textureDatas.Insert(texture);
 	m_keyTable.insert(std::make_pair(std::string(filePath), uid));
 
 	return texture;
@@ -82,34 +67,28 @@ SimpleTexture2D* TextureContainer::LoadTexture(const char* filePath)
 
 void TextureContainer::UnloadTexture(SimpleTexture2D* texture)
 {
-	UID uid = texture->GetUID();
-	auto iterFind = m_textureDatas.find(uid);
-	if (iterFind != m_textureDatas.end())
+	if (m_textureDatas.Remove(texture->GetUID()) != INVALID_INDEX_INT)
 	{
-		if (iterFind->second != nullptr)
-		{
-			m_keyTable.erase(iterFind->second->GetSrcFilePath());
-			iterFind->second->Unload();
-			delete iterFind->second;
-			m_textureDatas.erase(iterFind);
-		}
+		m_keyTable.erase(texture->GetSrcFilePath());
+		texture->Unload();
+		delete texture;
 	}
 }
 
 void TextureContainer::Clear()
 {
-	for (auto& cur : m_textureDatas)
+	for (SimpleTexture2D* cur : m_textureDatas)
 	{
-		if (cur.second != nullptr && cur.second->GetRefCount() == 0)
+		if (cur != nullptr && cur->GetRefCount() == 0)
 		{
-			cur.second->Unload();
-			delete cur.second;
+			cur->Unload();
+			delete cur;
 		}
 		else
 		{
 			continue;
 		}
 	}
-	m_textureDatas.clear();
+	m_textureDatas.Clear();
 	m_keyTable.clear();
 }
\ No newline at end of file
@@ -3,6 +3,7 @@
 #include "SimpleTexture.h"
 #include "Singleton.h"
 #include "Utils.h"
+#include "SlotMap.h"
 
 #include <unordered_map>
 
@@ -18,7 +19,7 @@ public:
 	void Clear();
 	
 	int GetBindIndex(SimpleTexture2D* texture);
-	uint32_t GetTextureCount() { return static_cast<uint32_t>(m_textureDatas.size()); }
+	uint32_t GetTextureCount() { return m_textureDatas.GetCount(); }
 	SimpleTexture2D* GetTexture(uint32_t  index);
 
 protected:
@@ -27,7 +28,8 @@ protected:
 	
 private:
 	std::map<std::string, UID> m_keyTable;
-	std::unordered_map<UID, SimpleTexture2D*> m_textureDatas;
+	//dense in load order, the position of a texture is its bind index
+	TUidSlotMap<SimpleTexture2D> m_textureDatas;
 };
 
 #define gTexContainer TextureContainer::Instance()
\ No newline at end of file
@@ -1,6 +1,8 @@
 
 #include <stdlib.h>
 
+#include <mutex>
+
 #include "Utils.h"
 #include "VulkanDeviceResources.h"
 
@@ -76,11 +78,19 @@ void Reporter::ReportPopupMessage()
 
 void Reporter::ReportLog()
 {
-	//TODO
+	printf("%s\n", m_reportMessageBuffer);
+#if KCF_WINDOWS_PLATFORM
+	OutputDebugStringA(m_reportMessageBuffer);
+#endif
 }
 
 void Reporter::ReportToPopup()
 {
+	if (!m_usePopup)
+	{
+		fprintf(stderr, "%s\n", m_reportMessageBuffer);
+		return;
+	}
 #if KCF_WINDOWS_PLATFORM
 	MessageBoxA(0, m_reportMessageBuffer, "Error", MB_OK);
 #else
@@ -330,11 +340,34 @@ void SimpleFbxGeometiesLoader::ReadColor(FbxMesh* inMesh, int inCtrlPointIndex,
 	}
 }
 
+//creation and destruction of the managers touch the global state of the sdk
+static std::mutex g_fbxManagerMutex;
+
 void SimpleFbxGeometiesLoader::Load(std::string filePath, std::vector<FbxGeometryData>& fbxGeometryDatas, bool regenNormalAndTangent)
 {
-	fbxsdk::FbxScene* fbxScene = FbxScene::Create(m_fbxManager, "LoadScene");
+	LoadWithManager(m_fbxManager, filePath, fbxGeometryDatas, regenNormalAndTangent);
+}
+
+void SimpleFbxGeometiesLoader::LoadConcurrent(std::string filePath, std::vector<FbxGeometryData>& fbxGeometryDatas, bool regenNormalAndTangent)
+{
+	fbxsdk::FbxManager* fbxManager = nullptr;
+	{
+		std::lock_guard<std::mutex> lock(g_fbxManagerMutex);
+		fbxManager = FbxManager::Create();
+		fbxManager->SetIOSettings(FbxIOSettings::Create(fbxManager, IOSROOT));
+	}
+
+	LoadWithManager(fbxManager, filePath, fbxGeometryDatas, regenNormalAndTangent);
+
+	std::lock_guard<std::mutex> lock(g_fbxManagerMutex);
+	fbxManager->Destroy();
+}
+
+void SimpleFbxGeometiesLoader::LoadWithManager(fbxsdk::FbxManager* fbxManager, std::string& filePath, std::vector<FbxGeometryData>& fbxGeometryDatas, bool regenNormalAndTangent)
+{
+	fbxsdk::FbxScene* fbxScene = FbxScene::Create(fbxManager, "LoadScene");
 
-	FbxImporter* fbxImpoter = FbxImporter::Create(m_fbxManager, "LoadImporter");
+	FbxImporter* fbxImpoter = FbxImporter::Create(fbxManager, "LoadImporter");
 	fbxImpoter->Initialize(filePath.c_str());
 	fbxImpoter->Import(fbxScene);
 
@@ -500,4 +533,16 @@ VkDeviceAddress GetBufferDeviceAddress(VkBuffer buffer)
 	bufferDeviceAddressInfo.buffer = buffer;
 
 	return vkGetBufferDeviceAddressKHR(gLogicalDevice, &bufferDeviceAddressInfo);
+}
+
+uint64_t HashBytes(const void* data, size_t size, uint64_t seed)
+{
+	const uint8_t* bytes = static_cast<const uint8_t*>(data);
+	uint64_t hash = seed;
+	for (size_t i = 0; i < size; i++)
+	{
+		hash ^= bytes[i];
+		hash *= 1099511628211ull;
+	}
+	return hash;
 }
\ No newline at end of file
@@ -48,6 +48,7 @@ public:
 	Reporter(token) {};
 public:
 	void Report(EReportType reportType, const char* message, long line, const char* file, const char* function, bool withShutdown = false);
+	void SetUsePopup(bool usePopup) { m_usePopup = usePopup; }
 
 protected:
 	void ReportError();
@@ -64,6 +65,7 @@ private:
 	static const uint32_t MESSAGE_BUFFER_SIZE = 4096;
 	static const std::string ERROR_TYPES[static_cast<uint32_t>(EReportType::REPORT_TYPE_END)];
 	char m_reportMessageBuffer[MESSAGE_BUFFER_SIZE];
+	bool m_usePopup = true;
 };
 
 #define REPORT(reportType, message) Reporter::Instance().Report(reportType, message, __LINE__, __FILE__, __FUNCTION__)
@@ -115,8 +117,12 @@ protected:
 	void ReadUV(FbxMesh* inMesh, int inCtrlPointIndex, int inVertexCounter, glm::vec2& outUV);
 	void ReadColor(FbxMesh* inMesh, int inCtrlPointIndex, int inVertexCounter, glm::vec4& outColor);
 
+	void LoadWithManager(fbxsdk::FbxManager* fbxManager, std::string& filePath, std::vector<FbxGeometryData>& fbxGeometryDatas, bool regenNormalAndTangent);
+
 public:
 	void Load(std::string filePath, std::vector<FbxGeometryData>& fbxGeometryDatas, bool regenNormalAndTangent = false);
+	//fbx sdk objects are not thread safe, each call creates its own manager so it can run on any thread
+	void LoadConcurrent(std::string filePath, std::vector<FbxGeometryData>& fbxGeometryDatas, bool regenNormalAndTangent = false);
 
 private:
 
@@ -196,3 +202,7 @@ struct BufferResouceRange
 
 bool CreateShaderModule(VkDevice device, std::string shaderFileName, VkShaderModule* shaderModule);
 VkDeviceAddress GetBufferDeviceAddress(VkBuffer buffer);
+
+#define HASH_SEED_DEFAULT 14695981039346656037ull
+//64 bit fnv-1a, chained by passing the previous result as seed
+uint64_t HashBytes(const void* data, size_t size, uint64_t seed = HASH_SEED_DEFAULT);
@@ -43,6 +43,34 @@ bool VulkanDeviceResources::Initialize(HINSTANCE hAppInstance, HWND hMainWnd, ui
 	return true;
 }
 
+bool VulkanDeviceResources::InitializeHeadless(uint32_t width, uint32_t height, bool useRayTracing)
+{
+	m_width			= width;
+	m_height		= height;
+	m_useRayTracing = useRayTracing;
+	m_isHeadless	= true;
+
+	//there is no swapchain, the ray tracing target image is the final render target
+	m_backbufferFormat = VK_FORMAT_R8G8B8A8_UNORM;
+
+	if (!InitDevice())
+	{
+		return false;
+	}
+	if (!InitCommandResources())
+	{
+		return false;
+	}
+	if (!InitDeviceQueue())
+	{
+		return false;
+	}
+
+	m_screenSizeChangedEventHandle = gCoreEventMgr.RegisterScreenSizeChangedEventCallback(this, &VulkanDeviceResources::OnScreenSizeChanged);
+
+	return true;
+}
+
 void VulkanDeviceResources::Destroy()
 {
 	OnRenderTargetSizeChanged.Clear();
@@ -144,6 +172,10 @@ bool VulkanDeviceResources::InitDevice()
 			{
 				extensionNames.push_back(VK_KHR_GET_PHYSICAL_DEVICE_PROPERTIES_2_EXTENSION_NAME);
 			}
+			if (m_isHeadless)
+			{
+				continue;
+			}
 			if (strcmp(VK_KHR_SURFACE_EXTENSION_NAME, extensionProperties[i].extensionName) == 0)
 			{
 				extensionNames.push_back(VK_KHR_SURFACE_EXTENSION_NAME);
@@ -216,6 +248,9 @@ bool VulkanDeviceResources::InitDevice()
 		m_physicalDeviceRayTracingPipelineProperties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_RAY_TRACING_PIPELINE_PROPERTIES_KHR;
 		m_physicalDeviceAccelerationStructureProperties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_ACCELERATION_STRUCTURE_PROPERTIES_KHR;
 		m_physicalDeviceRayTracingPipelineProperties.pNext = &m_physicalDeviceAccelerationStructureProperties;
+		//driver uuid keys the serialized acceleration structure cache
+		m_physicalDeviceIdProperties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_ID_PROPERTIES;
+		m_physicalDeviceAccelerationStructureProperties.pNext = &m_physicalDeviceIdProperties;
 
 		VkPhysicalDeviceProperties2 physicalDeviceProp2 = {};
 		physicalDeviceProp2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2;
@@ -266,24 +301,28 @@ bool VulkanDeviceResources::InitDevice()
 	m_queueFamilyProperties.resize(numQueueFamilys);
 	vkGetPhysicalDeviceQueueFamilyProperties(m_physicalDevices[0], &numQueueFamilys, m_queueFamilyProperties.data());
 
-	VkWin32SurfaceCreateInfoKHR win32SurfaceCreateInfo = {};
-	win32SurfaceCreateInfo.sType = VK_STRUCTURE_TYPE_WIN32_SURFACE_CREATE_INFO_KHR;
-	win32SurfaceCreateInfo.pNext = nullptr;
-	win32SurfaceCreateInfo.flags = 0;
-	win32SurfaceCreateInfo.hinstance = m_win32Instance;
-	win32SurfaceCreateInfo.hwnd = m_win32Wnd;
-
-	res = vkCreateWin32SurfaceKHR(m_vkInstance, &win32SurfaceCreateInfo, nullptr, &m_surface);
-	if (res != VkResult::VK_SUCCESS)
+	VkBool32* supportPresent = nullptr;
+	if (!m_isHeadless)
 	{
-		REPORT(EReportType::REPORT_TYPE_ERROR, "Win32 surface create failed.");
-		return false;
-	}
+		VkWin32SurfaceCreateInfoKHR win32SurfaceCreateInfo = {};
+		win32SurfaceCreateInfo.sType = VK_STRUCTURE_TYPE_WIN32_SURFACE_CREATE_INFO_KHR;
+		win32SurfaceCreateInfo.pNext = nullptr;
+		win32SurfaceCreateInfo.flags = 0;
+		win32SurfaceCreateInfo.hinstance = m_win32Instance;
+		win32SurfaceCreateInfo.hwnd = m_win32Wnd;
 
-	VkBool32* supportPresent = new VkBool32[numQueueFamilys];
-	for (uint32_t i = 0; i < numQueueFamilys; i++)
-	{
-		vkGetPhysicalDeviceSurfaceSupportKHR(m_physicalDevices[0], i, m_surface, &supportPresent[i]);
+		res = vkCreateWin32SurfaceKHR(m_vkInstance, &win32SurfaceCreateInfo, nullptr, &m_surface);
+		if (res != VkResult::VK_SUCCESS)
+		{
+			REPORT(EReportType::REPORT_TYPE_ERROR, "Win32 surface create failed.");
+			return false;
+		}
+
+		supportPresent = new VkBool32[numQueueFamilys];
+		for (uint32_t i = 0; i < numQueueFamilys; i++)
+		{
+			vkGetPhysicalDeviceSurfaceSupportKHR(m_physicalDevices[0], i, m_surface, &supportPresent[i]);
+		}
 	}
 
 	/* create logical device  */
@@ -293,7 +332,7 @@ bool VulkanDeviceResources::InitDevice()
 	{
 		if (m_queueFamilyProperties[i].queueFlags & VK_QUEUE_GRAPHICS_BIT)
 		{
-			if (vkGetPhysicalDeviceWin32PresentationSupportKHR(m_physicalDevices[0], i) && supportPresent[i])
+			if (m_isHeadless || (vkGetPhysicalDeviceWin32PresentationSupportKHR(m_physicalDevices[0], i) && supportPresent[i]))
 			{
 				queueCreateInfo.queueFamilyIndex = i;
 				m_graphicsQueueFamilyIndex = i;
@@ -319,6 +358,31 @@ bool VulkanDeviceResources::InitDevice()
 	queueCreateInfo.queueCount = 1;
 	queueCreateInfo.pQueuePriorities = queue_priorities;
 
+	//compute only family runs acceleration structure builds asynchronously to the graphics queue
+	m_computeQueueFamilyIndex = m_graphicsQueueFamilyIndex;
+	m_hasAsyncComputeQueue = false;
+	for (uint32_t i = 0; i < m_queueFamilyProperties.size(); i++)
+	{
+		if ((m_queueFamilyProperties[i].queueFlags & VK_QUEUE_COMPUTE_BIT) != 0 && 
+			(m_queueFamilyProperties[i].queueFlags & VK_QUEUE_GRAPHICS_BIT) == 0)
+		{
+			m_computeQueueFamilyIndex = i;
+			m_hasAsyncComputeQueue = true;
+			break;
+		}
+	}
+
+	std::vector<VkDeviceQueueCreateInfo> queueCreateInfos = { queueCreateInfo };
+	if (m_hasAsyncComputeQueue)
+	{
+		VkDeviceQueueCreateInfo computeQueueCreateInfo = queueCreateInfo;
+		computeQueueCreateInfo.queueFamilyIndex = m_computeQueueFamilyIndex;
+		queueCreateInfos.push_back(computeQueueCreateInfo);
+
+		m_sharedQueueFamilyIndices[0] = m_graphicsQueueFamilyIndex;
+		m_sharedQueueFamilyIndices[1] = m_computeQueueFamilyIndex;
+	}
+
 	extensionNames.clear();
 	uint32_t numDeviceExtensionProps = 0;
 	res = vkEnumerateDeviceExtensionProperties(m_physicalDevices[0], nullptr, &numDeviceExtensionProps, nullptr);
@@ -329,17 +393,20 @@ bool VulkanDeviceResources::InitDevice()
 		res = vkEnumerateDeviceExtensionProperties(m_physicalDevices[0], nullptr, &numDeviceExtensionProps, extensionProperties.data());
 		for (uint32_t i = 0; i < numDeviceExtensionProps; i++)
 		{	
-			if (strcmp(VK_KHR_SURFACE_EXTENSION_NAME, extensionProperties[i].extensionName) == 0)
+			if (!m_isHeadless)
 			{
-				extensionNames.push_back(VK_KHR_SURFACE_EXTENSION_NAME);
-			}
-			if (strcmp(VK_KHR_WIN32_SURFACE_EXTENSION_NAME, extensionProperties[i].extensionName) == 0)
-			{
-				extensionNames.push_back(VK_KHR_WIN32_SURFACE_EXTENSION_NAME);
-			}
-			if (strcmp(VK_KHR_SWAPCHAIN_EXTENSION_NAME, extensionProperties[i].extensionName) == 0)
-			{
-				extensionNames.push_back(VK_KHR_SWAPCHAIN_EXTENSION_NAME);
+				if (strcmp(VK_KHR_SURFACE_EXTENSION_NAME, extensionProperties[i].extensionName) == 0)
+				{
+					extensionNames.push_back(VK_KHR_SURFACE_EXTENSION_NAME);
+				}
+				if (strcmp(VK_KHR_WIN32_SURFACE_EXTENSION_NAME, extensionProperties[i].extensionName) == 0)
+				{
+					extensionNames.push_back(VK_KHR_WIN32_SURFACE_EXTENSION_NAME);
+				}
+				if (strcmp(VK_KHR_SWAPCHAIN_EXTENSION_NAME, extensionProperties[i].extensionName) == 0)
+				{
+					extensionNames.push_back(VK_KHR_SWAPCHAIN_EXTENSION_NAME);
+				}
 			}
 			if (strcmp(VK_NV_DEVICE_DIAGNOSTIC_CHECKPOINTS_EXTENSION_NAME, extensionProperties[i].extensionName) == 0)
 			{
@@ -389,8 +456,8 @@ bool VulkanDeviceResources::InitDevice()
 	logicalDeviceCreateInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
 	logicalDeviceCreateInfo.pNext = &m_physicalDeviceRayTracingPipelineFeatures;
 	logicalDeviceCreateInfo.flags = 0;
-	logicalDeviceCreateInfo.queueCreateInfoCount = 1;
-	logicalDeviceCreateInfo.pQueueCreateInfos = &queueCreateInfo;
+	logicalDeviceCreateInfo.queueCreateInfoCount = static_cast<uint32_t>(queueCreateInfos.size());
+	logicalDeviceCreateInfo.pQueueCreateInfos = queueCreateInfos.data();
 	logicalDeviceCreateInfo.enabledLayerCount = 0;
 	logicalDeviceCreateInfo.enabledExtensionCount = static_cast<uint32_t>(extensionNames.size());
 	logicalDeviceCreateInfo.ppEnabledExtensionNames = extensionNames.data();
@@ -439,6 +506,15 @@ bool VulkanDeviceResources::InitDeviceQueue()
 		vkGetDeviceQueue(m_logicalDevice, m_presentQueueFamilyIndex, 0, &m_presentQueue);
 	}
 
+	if (m_hasAsyncComputeQueue)
+	{
+		vkGetDeviceQueue(m_logicalDevice, m_computeQueueFamilyIndex, 0, &m_computeQueue);
+	}
+	else
+	{
+		m_computeQueue = m_graphicsQueue;
+	}
+
 	return true;
 }
 
@@ -768,10 +844,13 @@ void VulkanDeviceResources::RefreshSwapchain()
 {
 	WaitForAllDeviceAction();
 
-	DestroySwapChain();
+	if (!m_isHeadless)
+	{
+		DestroySwapChain();
 
-	InitSwapChain();
-	InitSwapChainResources();
+		InitSwapChain();
+		InitSwapChainResources();
+	}
 
 	if (OnRenderTargetSizeChanged.GetCommandCount() > 0)
 	{
@@ -788,10 +867,33 @@ void VulkanDeviceResources::GraphicsQueueWaitIdle()
 	vkQueueWaitIdle(m_graphicsQueue);
 }
 
+void VulkanDeviceResources::ComputeQueueWaitIdle()
+{
+	vkQueueWaitIdle(m_computeQueue);
+}
+
+void VulkanDeviceResources::SetBufferSharingMode(VkBufferCreateInfo& bufferCreateInfo)
+{
+	//buffers with device address can be read or written by acceleration structure builds on the compute queue
+	if (m_hasAsyncComputeQueue && (bufferCreateInfo.usage & VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT) != 0)
+	{
+		bufferCreateInfo.sharingMode = VK_SHARING_MODE_CONCURRENT;
+		bufferCreateInfo.queueFamilyIndexCount = 2;
+		bufferCreateInfo.pQueueFamilyIndices = m_sharedQueueFamilyIndices;
+	}
+	else
+	{
+		bufferCreateInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+		bufferCreateInfo.queueFamilyIndexCount = 0;
+		bufferCreateInfo.pQueueFamilyIndices = nullptr;
+	}
+}
+
 void VulkanDeviceResources::WaitForAllDeviceAction()
 {
 	vkQueueWaitIdle(m_graphicsQueue);
 	vkQueueWaitIdle(m_presentQueue);
+	vkQueueWaitIdle(m_computeQueue);
 	vkDeviceWaitIdle(m_logicalDevice);
 }
 
@@ -9,6 +9,7 @@
 #include "volk.h"
 
 #include "CoreEventManager.h"
+#include "Delegate.h"
 #include "Singleton.h"
 #include "Utils.h"
 
@@ -31,6 +32,7 @@ public:
 	VulkanDeviceResources(token) {};
 
 	bool Initialize(HINSTANCE hAppInstance, HWND hMainWnd, uint32_t width, uint32_t height, bool useRayTracing = false);
+	bool InitializeHeadless(uint32_t width, uint32_t height, bool useRayTracing = false);
 	void Destroy();
 	void DestroySwapChain();
 
@@ -46,13 +48,16 @@ public:
 public:
 
 	void GraphicsQueueWaitIdle();
+	void ComputeQueueWaitIdle();
+	//shares the buffer with the async compute queue family when it exists
+	void SetBufferSharingMode(VkBufferCreateInfo& bufferCreateInfo);
 	void WaitForAllDeviceAction();
 	void RestoreDeviceIfDirtied();
 
 public:
 	void OnScreenSizeChanged(ScreenSizeChangedEvent* screenSizeChangedEvent);
 
-	LambdaCommandList<std::function<void()> > OnRenderTargetSizeChanged;
+	TDelegateList<void()> OnRenderTargetSizeChanged;
 public:
 
 	VkInstance&			GetVkInstance()				{ return m_vkInstance; }
@@ -61,11 +66,14 @@ public:
 	VkSwapchainKHR&		GetSwapchain()				{ return m_swapchain; }
 	VkQueue&			GetGraphicsQueue()			{ return m_graphicsQueue; }
 	VkQueue&			GetPresentQueue()			{ return m_presentQueue; }
+	//same as the graphics queue when there is no compute only queue family
+	VkQueue&			GetComputeQueue()			{ return m_computeQueue; }
 	VkCommandPool&		GetDefaultCommandPool()		{ return m_defaultCommandPool; }
 
 	uint32_t GetGraphicsQueueFamilyIndex() { return m_graphicsQueueFamilyIndex; }
 	uint32_t GetPresentQueueFamilyIndex() { return m_presentQueueFamilyIndex; }
 	uint32_t GetComputeQueueFamilyIndex() { return m_computeQueueFamilyIndex; };
+	bool HasAsyncComputeQueue() { return m_hasAsyncComputeQueue; }
 
 	
 
@@ -77,6 +85,7 @@ public:
 	VkPhysicalDeviceRayTracingPipelineFeaturesKHR&		GetPhysicalDeviceRayTracingPipelineFeatures()		{ return m_physicalDeviceRayTracingPipelineFeatures; }
 	VkPhysicalDeviceAccelerationStructurePropertiesKHR&	GetPhysicalDeviceAccelerationStructureProperties()	{ return m_physicalDeviceAccelerationStructureProperties; }
 	VkPhysicalDeviceAccelerationStructureFeaturesKHR&	GetPhysicalDeviceAccelerationStructureFeatures()	{ return m_physicalDeviceAccelerationStructureFeatures; }
+	VkPhysicalDeviceIDProperties&						GetPhysicalDeviceIdProperties()						{ return m_physicalDeviceIdProperties; }
 
 	DepthBuffer* GetDepthBuffer() { return &m_depthBuffer; }
 	SwapchainBuffer* GetSwapChainBuffer(int index) 
@@ -96,6 +105,8 @@ public:
 	uint32_t GetWidth() { return m_width; }
 	uint32_t GetHeight() { return m_height; }
 
+	bool IsHeadless() { return m_isHeadless; }
+
 public:
 
 	bool MemoryTypeFromProperties(int32_t typeBits, VkFlags requirementsMask, uint32_t* typeIndex);
@@ -107,6 +118,7 @@ protected:
 	VkCommandPool					m_defaultCommandPool	= VK_NULL_HANDLE;
 	VkQueue							m_graphicsQueue			= VK_NULL_HANDLE;
 	VkQueue							m_presentQueue			= VK_NULL_HANDLE;
+	VkQueue							m_computeQueue			= VK_NULL_HANDLE;
 	VkSurfaceKHR					m_surface				= VK_NULL_HANDLE;
 	VkSwapchainKHR					m_swapchain				= VK_NULL_HANDLE;
 
@@ -124,6 +136,7 @@ protected:
 	VkPhysicalDeviceRayTracingPipelineFeaturesKHR		m_physicalDeviceRayTracingPipelineFeatures = {};
 	VkPhysicalDeviceAccelerationStructurePropertiesKHR	m_physicalDeviceAccelerationStructureProperties = {};
 	VkPhysicalDeviceAccelerationStructureFeaturesKHR	m_physicalDeviceAccelerationStructureFeatures = {};
+	VkPhysicalDeviceIDProperties						m_physicalDeviceIdProperties = {};
 
 	std::vector<VkLayerProperties>			m_layerProperties;
 	std::vector<VkQueueFamilyProperties>	m_queueFamilyProperties;
@@ -134,6 +147,8 @@ protected:
 	uint32_t m_graphicsQueueFamilyIndex = 0;
 	uint32_t m_presentQueueFamilyIndex = 0;
 	uint32_t m_computeQueueFamilyIndex = 0;
+	uint32_t m_sharedQueueFamilyIndices[2] = {};
+	bool m_hasAsyncComputeQueue = false;
 
 	HINSTANCE	m_win32Instance	= nullptr;
 	HWND		m_win32Wnd		= nullptr;
@@ -144,6 +159,7 @@ protected:
 
 	bool m_useRayTracing	= false;
 	bool m_isSwapchainDirty = false;
+	bool m_isHeadless		= false;
 
 	CoreEventHandle m_screenSizeChangedEventHandle = {};
 };
@@ -6,6 +6,11 @@
 #include "GlobalSystemValues.h"
 #include "TextureContainer.h"
 #include "GlobalTimer.h"
+#include "SceneLoader.h"
+#include "AssetLoader.h"
+
+#define STB_IMAGE_WRITE_IMPLEMENTATION
+#include <stb_image_write.h>
 
 bool VulkanRayTracingExample::Initialize()
 {
@@ -33,10 +38,18 @@ bool VulkanRayTracingExample::Initialize()
 		"../Resources/Textures/Sky/back.jpg",
 		"../Resources/Textures/Sky/front.jpg",
 	};
-	if (!m_envCubmapTexture.Initialize(cubemapFilePathList))
+	std::string raygenShaderFilePath = "../Resources/Shaders/RayGen.spr";
+	std::string defaultMissShaderFilePath = "../Resources/Shaders/Miss.spr";
+	std::string shadowMissShaderFilePath = "../Resources/Shaders/ShadowMiss.spr";
+
+	//decoded together with the files of the scene by the scene load
+	for (auto& cur : cubemapFilePathList)
 	{
-		return false;
+		gAssetLoader.RequestImage(cur);
 	}
+	gAssetLoader.RequestShaderCode(raygenShaderFilePath);
+	gAssetLoader.RequestShaderCode(defaultMissShaderFilePath);
+	gAssetLoader.RequestShaderCode(shadowMissShaderFilePath);
 
 	m_imageAcquiredSemaphore.resize(NUM_FRAMES);
 	m_renderCompleteSemaphore.resize(NUM_FRAMES);
@@ -68,42 +81,40 @@ bool VulkanRayTracingExample::Initialize()
 	}
 	m_imageFence.resize(NUM_FRAMES, VK_NULL_HANDLE);
 
-	glm::mat4 modelRotMat = glm::rotate(glm::mat4(1.0f), PI, glm::vec3(1.0f, 0.0f, 0.0f));
-	glm::mat4 modelScaleMat = glm::scale(glm::mat4(1.0f), glm::vec3(0.5f, 0.5f, 0.5f));
-
-	m_renderObjects.push_back(gRenderObjContainer.CreateRenderObject("../Resources/Mesh/MeetMat.fbx", ExampleMaterialType::EXAMPLE_MAT_TYPE_METAL1));
-	m_renderObjects.push_back(gRenderObjContainer.CreateRenderObject("../Resources/Mesh/Plane.fbx", ExampleMaterialType::EXAMPLE_MAT_TYPE_PLATE));
-	
-	SampleRenderObjectInstance* curInstance = nullptr;
-	curInstance = m_renderObjects[0]->CreateInstance(modelRotMat * modelScaleMat);
-
-	curInstance = m_renderObjects[0]->CreateInstance(glm::translate(glm::mat4(1.0f), glm::vec3(0.0f, 0.0f, 15.0f)) * modelRotMat * modelScaleMat);
-	curInstance->SetOverrideMaterial(ExampleMaterialType::EXAMPLE_MAT_TYPE_METAL2);
-	m_roteteInstances.push_back(curInstance);
-	curInstance = m_renderObjects[0]->CreateInstance(glm::translate(glm::mat4(1.0f), glm::vec3(-15.0f, 0.0f, 0.0f)) * modelRotMat * modelScaleMat);
-	curInstance->SetOverrideMaterial(ExampleMaterialType::EXAMPLE_MAT_TYPE_METAL3);
-	m_roteteInstances.push_back(curInstance);
-	curInstance = m_renderObjects[0]->CreateInstance(glm::translate(glm::mat4(1.0f), glm::vec3(0.0f, 0.0f, -15.0f)) * modelRotMat * modelScaleMat);
-	curInstance->SetOverrideMaterial(ExampleMaterialType::EXAMPLE_MAT_TYPE_GLASS);
-	m_roteteInstances.push_back(curInstance);
-	curInstance = m_renderObjects[0]->CreateInstance(glm::translate(glm::mat4(1.0f), glm::vec3(15.0f, 0.0f, 0.0f)) * modelRotMat * modelScaleMat);
-	curInstance->SetOverrideMaterial(ExampleMaterialType::EXAMPLE_MAT_TYPE_PAINT_TRANSPARENT);
-	m_roteteInstances.push_back(curInstance);
-	
-	curInstance = m_renderObjects[1]->CreateInstance(glm::translate(glm::mat4(1.0f), glm::vec3(0.0f, 1.0f, 0.0f)) * modelRotMat);
+	SceneLoader sceneLoader;
+	if (!sceneLoader.Load(GlobalSystemValues::Instance().ScenePath, m_renderObjects))
+	{
+		return false;
+	}
+	if (!m_envCubmapTexture.Initialize(cubemapFilePathList))
+	{
+		return false;
+	}
 
-	std::string raygenShaderFilePath = "../Resources/Shaders/RayGen.spr";
-	std::string defaultMissShaderFilePath = "../Resources/Shaders/Miss.spr";
-	std::string shadowMissShaderFilePath = "../Resources/Shaders/ShadowMiss.spr";
 	m_rayTracer.Initialize(m_width, m_height, gVkDeviceRes.GetBackbufferFormat());
 	m_rayTracer.SetEnvCubemap(&m_envCubmapTexture);
+	m_rayTracer.SetFrameFences(&m_drawFence);
 	m_rayTracer.LoadRayGenShader(raygenShaderFilePath);
 	m_rayTracer.LoadMissShader(defaultMissShaderFilePath);
 	m_rayTracer.LoadMissShader(shadowMissShaderFilePath);
+	gAssetLoader.ReleasePayloads();
+	if (gVkDeviceRes.IsHeadless() && !GlobalSystemValues::Instance().HeadlessOutputPath.empty())
+	{
+		if (!m_rayTracer.EnableReadback())
+		{
+			return false;
+		}
+	}
 	if (!m_rayTracer.Build())
 	{
 		return false;
 	}
+	m_rayTracer.RunAsBuildBenchmark(GlobalSystemValues::Instance().AsBuildBenchmarkIterations);
+
+	if (GlobalSystemValues::Instance().UseDeformationDemo)
+	{
+		CreateDeformations();
+	}
 
 	return true;
 }
@@ -113,17 +124,97 @@ void VulkanRayTracingExample::Update(float timeDelta)
 	m_globalConstants.LightDir = glm::vec3(0.0f, 1.0f, -1.0f);
 	m_globalConstants.MatViewInv = glm::inverse(m_camera.GetViewMatrix());
 	m_globalConstants.MatProjInv = glm::inverse(m_camera.GetProjectionMatrix());
+
+	UpdateDeformations(timeDelta);
+}
+
+void VulkanRayTracingExample::CreateDeformations()
+{
+	if (m_renderObjects.empty())
+	{
+		return;
+	}
+
+	//bone 0 holds the bottom of the mesh, bone 1 twists the top around the vertical axis
+	SimpleGeometry* geometry = m_renderObjects[0]->GetGeometry();
+	for (uint32_t i = 0; i < geometry->GetMeshCount(); i++)
+	{
+		SimpleMeshData* mesh = geometry->GetMesh(i);
+		std::vector<DefaultVertex>& vertices = mesh->GetHostVertices();
+		float height = mesh->GetBoundsMax().y - mesh->GetBoundsMin().y;
+		float extent = glm::length(mesh->GetBoundsMax() - mesh->GetBoundsMin());
+
+		std::vector<VertexSkinData> skinData(vertices.size());
+		std::vector<MorphTargetData> morphTargets(1);
+		morphTargets[0].PositionDeltas.resize(vertices.size());
+		for (uint32_t j = 0; j < vertices.size(); j++)
+		{
+			float weight = height > 0.0f ? glm::clamp((vertices[j].m_position.y - mesh->GetBoundsMin().y) / height, 0.0f, 1.0f) : 0.0f;
+			skinData[j].BoneIndices = glm::uvec4(0, 1, 0, 0);
+			skinData[j].BoneWeights = glm::vec4(1.0f - weight, weight, 0.0f, 0.0f);
+			morphTargets[0].PositionDeltas[j] = glm::vec3(vertices[j].m_normal) * extent * 0.03f;
+		}
+
+		MeshDeformation* deformation = m_rayTracer.GetMeshDeformer().CreateDeformation(mesh, skinData, morphTargets);
+		if (deformation != nullptr)
+		{
+			m_deformations.push_back(deformation);
+		}
+	}
+}
+
+void VulkanRayTracingExample::UpdateDeformations(float timeDelta)
+{
+	if (m_deformations.empty())
+	{
+		return;
+	}
+
+	m_deformationTime += timeDelta;
+	float twistAngle = glm::sin(m_deformationTime) * PI * 0.25f;
+	std::vector<float> morphWeights = { 0.5f + 0.5f * glm::sin(m_deformationTime * 2.0f) };
+	for (auto& cur : m_deformations)
+	{
+		SimpleMeshData* mesh = cur->GetMesh();
+		glm::vec3 center = (mesh->GetBoundsMin() + mesh->GetBoundsMax()) * 0.5f;
+		std::vector<glm::mat4> boneMatrices =
+		{
+			glm::mat4(1.0f),
+			glm::translate(glm::mat4(1.0f), center) * glm::rotate(glm::mat4(1.0f), twistAngle, glm::vec3(0.0f, 1.0f, 0.0f)) * glm::translate(glm::mat4(1.0f), -center)
+		};
+		cur->SetBoneMatrices(boneMatrices);
+		cur->SetMorphWeights(morphWeights);
+	}
 }
 
 void VulkanRayTracingExample::PreRender()
 {
+	//tlas and descriptor set of the frame are written in place, the previous submit of the frame must be completed
+	if (!m_drawFence[m_currentFrame].WaitForFence())
+	{
+		return;
+	}
 	m_rayTracer.Update(m_globalConstants, m_currentFrame);
+
+	//scene and camera of the first frame
+	if (!m_isCpuReferenceWritten && !GlobalSystemValues::Instance().CpuReferenceOutputPath.empty())
+	{
+		WriteCpuReferenceImage();
+		m_isCpuReferenceWritten = true;
+	}
 }
 
 void VulkanRayTracingExample::Render()
 {
+	if (gVkDeviceRes.IsHeadless())
+	{
+		RenderHeadless();
+		return;
+	}
+
 	if (!m_drawFence[m_currentFrame].WaitForFence())
 	{
+		WaitPendingBuilds();
 		return;
 	}
 
@@ -138,6 +229,7 @@ void VulkanRayTracingExample::Render()
 	);
 	if (res != VkResult::VK_SUCCESS)
 	{
+		WaitPendingBuilds();
 		return;
 	}
 
@@ -153,6 +245,7 @@ void VulkanRayTracingExample::Render()
 
 	if (!m_drawFence[m_currentFrame].Reset())
 	{
+		WaitPendingBuilds();
 		// Ÿ α
 		return;
 	}
@@ -166,14 +259,17 @@ void VulkanRayTracingExample::Render()
 	}
 	
 	VkSemaphore signalSemaphore[1] = { m_renderCompleteSemaphore[m_currentFrame] };
-	VkSemaphore waitSemaphore[1] = { m_imageAcquiredSemaphore[m_currentFrame] };
-	VkPipelineStageFlags pipelineStageFlag[1] = { m_submitPipelineStageFlags };
+	std::vector<VkSemaphore> waitSemaphores = { m_imageAcquiredSemaphore[m_currentFrame] };
+	std::vector<VkPipelineStageFlags> pipelineStageFlags = { m_submitPipelineStageFlags };
+	//acceleration structure builds on the compute queue
+	waitSemaphores.insert(waitSemaphores.end(), m_rayTracer.GetWaitSemaphores().begin(), m_rayTracer.GetWaitSemaphores().end());
+	pipelineStageFlags.insert(pipelineStageFlags.end(), m_rayTracer.GetWaitStageMasks().begin(), m_rayTracer.GetWaitStageMasks().end());
 	VkSubmitInfo submitInfo[1] = {};
 	submitInfo[0].sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
 	submitInfo[0].pNext = nullptr;
-	submitInfo[0].pWaitDstStageMask = pipelineStageFlag;
-	submitInfo[0].waitSemaphoreCount = 1;
-	submitInfo[0].pWaitSemaphores = waitSemaphore;
+	submitInfo[0].pWaitDstStageMask = pipelineStageFlags.data();
+	submitInfo[0].waitSemaphoreCount = static_cast<uint32_t>(waitSemaphores.size());
+	submitInfo[0].pWaitSemaphores = waitSemaphores.data();
 	submitInfo[0].commandBufferCount = static_cast<uint32_t>(vkCommandBuffers.size());
 	submitInfo[0].pCommandBuffers = vkCommandBuffers.data();
 	submitInfo[0].signalSemaphoreCount = 1;
@@ -213,6 +309,115 @@ void VulkanRayTracingExample::Render()
 	m_currentFrame = (m_currentFrame + 1) % NUM_FRAMES;
 }
 
+void VulkanRayTracingExample::RenderHeadless()
+{
+	if (!m_drawFence[m_currentFrame].WaitForFence() || !m_drawFence[m_currentFrame].Reset())
+	{
+		WaitPendingBuilds();
+		return;
+	}
+
+	std::vector<VkCommandBuffer> vkCommandBuffers;
+	std::vector<CommandBuffer*>& commandBuffers = m_rayTracer.GetWaitCommandBuffer();
+	for (auto cur : commandBuffers)
+	{
+		vkCommandBuffers.push_back(cur->GetCommandBuffer());
+		m_drawFence[m_currentFrame].AddSubmittedCommandBuffer(cur);
+	}
+
+	VkSubmitInfo submitInfo = {};
+	submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+	submitInfo.pNext = nullptr;
+	submitInfo.waitSemaphoreCount = static_cast<uint32_t>(m_rayTracer.GetWaitSemaphores().size());
+	submitInfo.pWaitSemaphores = m_rayTracer.GetWaitSemaphores().data();
+	submitInfo.pWaitDstStageMask = m_rayTracer.GetWaitStageMasks().data();
+	submitInfo.commandBufferCount = static_cast<uint32_t>(vkCommandBuffers.size());
+	submitInfo.pCommandBuffers = vkCommandBuffers.data();
+	submitInfo.signalSemaphoreCount = 0;
+	submitInfo.pSignalSemaphores = nullptr;
+
+	VkResult res = vkQueueSubmit
+	(
+		VulkanDeviceResources::Instance().GetGraphicsQueue(),
+		1,
+		&submitInfo,
+		m_drawFence[m_currentFrame].GetFence()
+	);
+	if (res != VkResult::VK_SUCCESS)
+	{
+		REPORT(EReportType::REPORT_TYPE_ERROR, "Headless frame submit failed.");
+		return;
+	}
+
+	if (m_rayTracer.IsReadbackEnabled())
+	{
+		//readback buffer is shared by all frames, so the frame must be completed before next submit
+		if (m_drawFence[m_currentFrame].WaitForFence())
+		{
+			WriteFrameImage();
+		}
+	}
+
+	m_currentFrame = (m_currentFrame + 1) % NUM_FRAMES;
+	m_frameNumber++;
+}
+
+void VulkanRayTracingExample::WaitPendingBuilds()
+{
+	std::vector<VkSemaphore>& waitSemaphores = m_rayTracer.GetWaitSemaphores();
+	if (waitSemaphores.empty())
+	{
+		return;
+	}
+
+	//empty submit only unsignals the binary semaphores, nothing is traced
+	VkSubmitInfo submitInfo = {};
+	submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+	submitInfo.waitSemaphoreCount = static_cast<uint32_t>(waitSemaphores.size());
+	submitInfo.pWaitSemaphores = waitSemaphores.data();
+	submitInfo.pWaitDstStageMask = m_rayTracer.GetWaitStageMasks().data();
+	if (vkQueueSubmit(VulkanDeviceResources::Instance().GetGraphicsQueue(), 1, &submitInfo, VK_NULL_HANDLE) != VkResult::VK_SUCCESS)
+	{
+		REPORT(EReportType::REPORT_TYPE_WARN, "Acceleration structure build wait submit failed.");
+	}
+	waitSemaphores.clear();
+	m_rayTracer.GetWaitStageMasks().clear();
+}
+
+void VulkanRayTracingExample::WriteFrameImage()
+{
+	std::vector<uint8_t> pixels;
+	if (!m_rayTracer.ReadTargetImage(pixels))
+	{
+		return;
+	}
+
+	std::string filePath = GlobalSystemValues::Instance().HeadlessOutputPath + std::to_string(m_frameNumber) + ".png";
+	int width = static_cast<int>(gVkDeviceRes.GetWidth());
+	int height = static_cast<int>(gVkDeviceRes.GetHeight());
+	if (stbi_write_png(filePath.c_str(), width, height, 4, pixels.data(), width * 4) == 0)
+	{
+		REPORT(EReportType::REPORT_TYPE_WARN, "Frame image write failed.");
+	}
+}
+
+void VulkanRayTracingExample::WriteCpuReferenceImage()
+{
+	std::vector<uint8_t> pixels;
+	if (!m_rayTracer.RenderCpuReference(pixels))
+	{
+		return;
+	}
+
+	std::string filePath = GlobalSystemValues::Instance().CpuReferenceOutputPath + ".png";
+	int width = static_cast<int>(gVkDeviceRes.GetWidth());
+	int height = static_cast<int>(gVkDeviceRes.GetHeight());
+	if (stbi_write_png(filePath.c_str(), width, height, 4, pixels.data(), width * 4) == 0)
+	{
+		REPORT(EReportType::REPORT_TYPE_WARN, "Cpu reference image write failed.");
+	}
+}
+
 void VulkanRayTracingExample::Destroy()
 {
 	gVkDeviceRes.WaitForAllDeviceAction();
@@ -225,6 +430,8 @@ void VulkanRayTracingExample::Destroy()
 		m_drawFence[i].Destory();
 	}
 
+	//deformations are owned by the deformer of the ray tracer
+	m_deformations.clear();
 	m_rayTracer.Destroy();
 
 	gRenderObjContainer.Clear();
@@ -233,6 +440,7 @@ void VulkanRayTracingExample::Destroy()
 	gShaderContainer.Clear();
 	gGeomContainer.Clear();
 	gTexContainer.Clear();
+	gAssetLoader.Destroy();
 }
 
 void VulkanRayTracingExample::OnScreenSizeChanged()
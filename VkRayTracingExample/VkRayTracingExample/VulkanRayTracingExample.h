@@ -26,6 +26,15 @@ public:
 public:
 	void OnScreenSizeChanged();
 
+protected:
+	void RenderHeadless();
+	//frame which is not submitted still waits the builds signaled in PreRender, their semaphores are signaled again by the next one
+	void WaitPendingBuilds();
+	void WriteFrameImage();
+	void WriteCpuReferenceImage();
+	void CreateDeformations();
+	void UpdateDeformations(float timeDelta);
+
 private:
 
 	SphericalCoordMovementCamera m_camera;
@@ -45,9 +54,12 @@ private:
 	GlobalConstants m_globalConstants = {};
 
 	std::vector<SimpleRenderObject*> m_renderObjects = {};
-	std::vector<SampleRenderObjectInstance*> m_roteteInstances = {};
+	std::vector<MeshDeformation*> m_deformations = {};
+	float m_deformationTime = 0.0f;
 
 	uint32_t m_currentBuffer = 0;
+	uint32_t m_frameNumber = 0;
+	bool m_isCpuReferenceWritten = false;
 
 	static const uint32_t NUM_FRAMES = 2;
 };
@@ -102,6 +102,8 @@ int Win32Application::Run(ExampleAppBase* pExample, HINSTANCE hInstance, int nCm
         else
         {
             GlobalTimer::Instance().Tick();
+			//input of the messages since the last frame is dispatched once
+			CoreEventManager::Instance().FlushEvents();
 			if (!g_appPause)
 			{
 				float deltaTime = GlobalTimer::Instance().GetDeltaTime();
@@ -209,6 +211,8 @@ LRESULT CALLBACK Win32Application::WindowProc(HWND hWnd, UINT message, WPARAM wP
 	case WM_MOUSEWHEEL:
 	{
 		short wheel = (short)HIWORD(wParam);
+		//high resolution wheels report less than a notch per message, they still move one notch
+		mouseEvent.m_wheelDelta = wheel / WHEEL_DELTA != 0 ? wheel / WHEEL_DELTA : (wheel > 0 ? 1 : -1);
 		if (wheel > 0)
 		{
 			mouseEvent.AddEvent(EMouseEvent::MOUSE_WHEEL_UP);
@@ -269,7 +273,7 @@ LRESULT CALLBACK Win32Application::WindowProc(HWND hWnd, UINT message, WPARAM wP
 
 	if (mouseEvent.HasMouseEvent())
 	{
-		CoreEventManager::Instance().ExecMouseEvent(&mouseEvent);
+		CoreEventManager::Instance().PostMouseEvent(&mouseEvent);
 	}
 
     // Handle any messages the switch statement didn't.
@@ -0,0 +1,83 @@
+#include "WorkerThreadPool.h"
+
+bool WorkerThreadPool::Initialize(uint32_t threadCount)
+{
+	if (!m_threads.empty())
+	{
+		return false;
+	}
+
+	if (threadCount == 0)
+	{
+		uint32_t hardwareThreadCount = std::thread::hardware_concurrency();
+		threadCount = hardwareThreadCount > 1 ? hardwareThreadCount - 1 : 1;
+	}
+
+	m_isStopping = false;
+	for (uint32_t i = 0; i < threadCount; i++)
+	{
+		m_threads.push_back(std::thread(&WorkerThreadPool::WorkerLoop, this));
+	}
+	return true;
+}
+
+void WorkerThreadPool::Destroy()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_isStopping = true;
+	}
+	m_jobCondition.notify_all();
+
+	for (auto& cur : m_threads)
+	{
+		if (cur.joinable())
+		{
+			cur.join();
+		}
+	}
+	m_threads.clear();
+	m_jobs.clear();
+}
+
+void WorkerThreadPool::Enqueue(std::function<void()> job)
+{
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_jobs.push_back(job);
+	}
+	m_jobCondition.notify_one();
+}
+
+void WorkerThreadPool::WaitIdle()
+{
+	std::unique_lock<std::mutex> lock(m_mutex);
+	m_idleCondition.wait(lock, [this]() { return m_jobs.empty() && m_runningJobCount == 0; });
+}
+
+void WorkerThreadPool::WorkerLoop()
+{
+	while (true)
+	{
+		std::function<void()> job;
+		{
+			std::unique_lock<std::mutex> lock(m_mutex);
+			m_jobCondition.wait(lock, [this]() { return m_isStopping || !m_jobs.empty(); });
+			if (m_isStopping && m_jobs.empty())
+			{
+				return;
+			}
+			job = m_jobs.front();
+			m_jobs.pop_front();
+			m_runningJobCount++;
+		}
+
+		job();
+
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_runningJobCount--;
+		}
+		m_idleCondition.notify_all();
+	}
+}
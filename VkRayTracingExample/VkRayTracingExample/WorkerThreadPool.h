@@ -0,0 +1,36 @@
+#pragma once
+
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+
+//fixed worker threads running queued jobs, jobs are not ordered
+class WorkerThreadPool
+{
+public:
+	//0 uses one thread less than the hardware threads, the calling thread is expected to work too
+	bool Initialize(uint32_t threadCount = 0);
+	void Destroy();
+
+	void Enqueue(std::function<void()> job);
+	//blocks until every queued job is completed
+	void WaitIdle();
+
+	uint32_t GetThreadCount() { return static_cast<uint32_t>(m_threads.size()); }
+	bool IsInitialized() { return !m_threads.empty(); }
+
+protected:
+	void WorkerLoop();
+
+protected:
+	std::vector<std::thread> m_threads;
+	std::deque<std::function<void()>> m_jobs;
+	std::mutex m_mutex;
+	std::condition_variable m_jobCondition;
+	std::condition_variable m_idleCondition;
+	uint32_t m_runningJobCount = 0;
+	bool m_isStopping = false;
+};